@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "coap_client.h"
+#include "platform_clock.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define COAP_VERSION                (1)
+#define COAP_TYPE_CON               (0)
+#define COAP_TYPE_NON               (1)
+#define COAP_TYPE_ACK               (2)
+#define COAP_TYPE_RST               (3)
+
+#define COAP_CODE_EMPTY             (0x00)
+#define COAP_CODE_POST              (0x02)
+#define COAP_CODE_CLASS(aCode)      ((aCode) >> 5)
+#define COAP_CODE_DETAIL(aCode)     ((aCode) & 0x1F)
+
+#define COAP_OPT_URI_PATH           (11)
+#define COAP_OPT_CONTENT_FORMAT     (12)
+#define COAP_OPT_BLOCK1             (27)
+#define COAP_PAYLOAD_MARKER         (0xFF)
+
+#define COAP_TOKEN_LEN              (2)
+#define COAP_RX_MAX                 (64)    /* Acknowledgements only, a longer payload is cut */
+
+#define BLOCK1_NUM(aNum)            ((uint32_t) (aNum) << 4)
+#define BLOCK1_MORE                 (0x08)
+#define BLOCK1_SZX(aValue)          ((aValue) & 0x07)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint8_t     type;
+    uint8_t     code;
+    uint16_t    messageId;
+    uint16_t    token;
+    int32_t     block1;             /* -1 when absent */
+} CoapHeader_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Option with delta and length nibbles extended as in RFC 7252 section 3.1 */
+static int put_option(
+    uint8_t*        aBuf,
+    uint32_t        aSize,
+    uint32_t*       aPos,
+    uint16_t*       aLast,
+    uint16_t        aNumber,
+    const uint8_t*  aValue,
+    uint32_t        aLen)
+{
+    uint32_t    delta   = aNumber - *aLast;
+    uint8_t     ext[4];
+    uint32_t    extLen  = 0;
+    uint8_t     nibble[2];
+    uint32_t    field[2] = { delta, aLen };
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (field[i] < 13)
+        {
+            nibble[i]   = (uint8_t) field[i];
+        }
+        else if (field[i] < 269)
+        {
+            nibble[i]       = 13;
+            ext[extLen++]   = (uint8_t) (field[i] - 13);
+        }
+        else
+        {
+            nibble[i]       = 14;
+            ext[extLen++]   = (uint8_t) ((field[i] - 269) >> 8);
+            ext[extLen++]   = (uint8_t) (field[i] - 269);
+        }
+    }
+
+    if (*aPos + 1 + extLen + aLen > aSize)
+    {
+        return -1;
+    }
+    aBuf[(*aPos)++] = (uint8_t) ((nibble[0] << 4) | nibble[1]);
+    memcpy(aBuf + *aPos, ext, extLen);
+    *aPos  += extLen;
+    memcpy(aBuf + *aPos, aValue, aLen);
+    *aPos  += aLen;
+    *aLast  = aNumber;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Unsigned option value in the fewest bytes, none for 0 */
+static uint32_t uint_option(
+    uint8_t*    aOut,
+    uint32_t    aValue)
+{
+    uint32_t    len = 0;
+
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        if (len > 0 || (aValue >> shift) & 0xFF)
+        {
+            aOut[len++] = (uint8_t) (aValue >> shift);
+        }
+    }
+    return len;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int parse_header(
+    const uint8_t*  aBuf,
+    uint32_t        aLen,
+    CoapHeader_t*   aHdr)
+{
+    uint32_t    pos;
+    uint32_t    tkl;
+    uint32_t    number  = 0;
+    uint32_t    delta;
+    uint32_t    len;
+
+    if (aLen < 4 || COAP_VERSION != (aBuf[0] >> 6))
+    {
+        return -1;
+    }
+    tkl             = aBuf[0] & 0x0F;
+    aHdr->type      = (aBuf[0] >> 4) & 0x03;
+    aHdr->code      = aBuf[1];
+    aHdr->messageId = (uint16_t) ((aBuf[2] << 8) | aBuf[3]);
+    aHdr->token     = (COAP_TOKEN_LEN == tkl && aLen >= 6) ? (uint16_t) ((aBuf[4] << 8) | aBuf[5]) : 0;
+    aHdr->block1    = -1;
+
+    pos = 4 + tkl;
+    while (pos < aLen && COAP_PAYLOAD_MARKER != aBuf[pos])
+    {
+        delta   = aBuf[pos] >> 4;
+        len     = aBuf[pos] & 0x0F;
+        pos++;
+        for (int i = 0; i < 2; i++)
+        {
+            uint32_t*   field   = (0 == i) ? &delta : &len;
+
+            if (13 == *field && pos < aLen)
+            {
+                *field  = 13 + aBuf[pos++];
+            }
+            else if (14 == *field && pos + 1 < aLen)
+            {
+                *field  = 269 + ((aBuf[pos] << 8) | aBuf[pos + 1]);
+                pos    += 2;
+            }
+            else if (*field >= 13)
+            {
+                return -1;
+            }
+        }
+        if (pos + len > aLen)
+        {
+            return -1;
+        }
+
+        number += delta;
+        if (COAP_OPT_BLOCK1 == number && len <= 3)
+        {
+            aHdr->block1    = 0;
+            for (uint32_t i = 0; i < len; i++)
+            {
+                aHdr->block1    = (aHdr->block1 << 8) | aBuf[pos + i];
+            }
+        }
+        pos    += len;
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Sends the message in aClient->msg until it is acknowledged. Confirmable messages from the
+ * server, e.g. a separate response, are acknowledged on the way.
+ *
+ * @return 0 with the acknowledgement in aAck, -1 on reset, timeout or socket error.
+ */
+static int exchange(
+    CoapClient_t*           aClient,
+    const SocketAddress&    aAddr,
+    uint32_t                aLen,
+    uint16_t                aMessageId,
+    CoapHeader_t*           aAck)
+{
+    uint8_t     rx[COAP_RX_MAX];
+    uint8_t     emptyAck[4];
+    uint32_t    timeoutMs;
+    uint32_t    deadlineMs;
+    int32_t     leftMs;
+    int         result;
+
+    /* Initial timeout is random between ACK_TIMEOUT and ACK_TIMEOUT * ACK_RANDOM_FACTOR */
+    timeoutMs   = COAP_ACK_TIMEOUT_MS + (uint32_t) rand() % (COAP_ACK_TIMEOUT_MS * (COAP_ACK_RANDOM_FACTOR_PCT - 100) / 100 + 1);
+
+    for (int tx = 0; tx <= COAP_MAX_RETRANSMIT; tx++)
+    {
+        result  = aClient->socket.sendto(aAddr, aClient->msg, aLen);
+        if (result < 0)
+        {
+            LOG_WARN("CoAP sendto failed, error = %d", result);
+            return -1;
+        }
+        aClient->stats.messages++;
+        aClient->stats.bytesTx     += aLen;
+        aClient->stats.retransmits += (tx > 0) ? 1 : 0;
+
+        deadlineMs  = platform_now_ms() + timeoutMs;
+        while ((leftMs = (int32_t) (deadlineMs - platform_now_ms())) > 0)
+        {
+            aClient->socket.set_timeout(leftMs);
+            result  = aClient->socket.recvfrom(NULL, rx, sizeof(rx));
+            if (result < 0)
+            {
+                break;
+            }
+            aClient->stats.bytesRx += result;
+            if (0 != parse_header(rx, result, aAck))
+            {
+                continue;
+            }
+
+            if (COAP_TYPE_CON == aAck->type)
+            {
+                emptyAck[0] = (COAP_VERSION << 6) | (COAP_TYPE_ACK << 4);
+                emptyAck[1] = COAP_CODE_EMPTY;
+                emptyAck[2] = rx[2];
+                emptyAck[3] = rx[3];
+                aClient->socket.sendto(aAddr, emptyAck, sizeof(emptyAck));
+                aClient->stats.bytesTx += sizeof(emptyAck);
+            }
+            else if ((COAP_TYPE_ACK == aAck->type || COAP_TYPE_RST == aAck->type) &&
+                     aMessageId == aAck->messageId)
+            {
+                return (COAP_TYPE_RST == aAck->type) ? -1 : 0;
+            }
+        }
+        timeoutMs  *= 2;
+    }
+
+    LOG_WARN("CoAP message %u not acknowledged", (unsigned) aMessageId);
+    return -1;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int coap_encode(
+    uint8_t*        aBuf,
+    uint32_t        aSize,
+    uint8_t         aType,
+    uint8_t         aCode,
+    uint16_t        aMessageId,
+    uint16_t        aToken,
+    const char*     aPath,
+    int32_t         aFormat,
+    int32_t         aBlock1,
+    const uint8_t*  aPayload,
+    uint32_t        aLen)
+{
+    uint8_t     value[4];
+    uint32_t    pos     = 4 + COAP_TOKEN_LEN;
+    uint16_t    last    = 0;
+    int         result  = 0;
+
+    if (aSize < pos)
+    {
+        return -1;
+    }
+    aBuf[0] = (uint8_t) ((COAP_VERSION << 6) | (aType << 4) | COAP_TOKEN_LEN);
+    aBuf[1] = aCode;
+    aBuf[2] = (uint8_t) (aMessageId >> 8);
+    aBuf[3] = (uint8_t) aMessageId;
+    aBuf[4] = (uint8_t) (aToken >> 8);
+    aBuf[5] = (uint8_t) aToken;
+
+    /* Options in ascending order */
+    if (NULL != aPath)
+    {
+        result |= put_option(aBuf, aSize, &pos, &last, COAP_OPT_URI_PATH, (const uint8_t*) aPath, strlen(aPath));
+    }
+    if (aFormat >= 0)
+    {
+        result |= put_option(aBuf, aSize, &pos, &last, COAP_OPT_CONTENT_FORMAT, value, uint_option(value, aFormat));
+    }
+    if (aBlock1 >= 0)
+    {
+        result |= put_option(aBuf, aSize, &pos, &last, COAP_OPT_BLOCK1, value, uint_option(value, aBlock1));
+    }
+
+    if (0 != result || (aLen > 0 && pos + 1 + aLen > aSize))
+    {
+        return -1;
+    }
+    if (aLen > 0)
+    {
+        aBuf[pos++] = COAP_PAYLOAD_MARKER;
+        memcpy(aBuf + pos, aPayload, aLen);
+        pos    += aLen;
+    }
+    return pos;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void coap_client_init(
+    CoapClient_t*       aClient,
+    NetworkInterface*   aIface,
+    DnsCache_t*         aDns,
+    const char*         aHost,
+    uint16_t            aPort,
+    const char*         aPath,
+    bool                aConfirmable)
+{
+    aClient->iface          = aIface;
+    aClient->dns            = aDns;
+    aClient->host           = aHost;
+    aClient->port           = aPort;
+    aClient->path           = aPath;
+    aClient->confirmable    = aConfirmable;
+    aClient->open           = false;
+    aClient->messageId      = (uint16_t) rand();
+    aClient->token          = (uint16_t) rand();
+    memset(&aClient->stats, 0, sizeof(aClient->stats));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int coap_client_post(
+    CoapClient_t*   aClient,
+    const uint8_t*  aPayload,
+    uint32_t        aLen,
+    uint16_t        aFormat)
+{
+    SocketAddress   addr;
+    CoapHeader_t    ack;
+    uint32_t        startMs     = platform_now_ms();
+    uint32_t        offset      = 0;
+    uint32_t        szx         = COAP_BLOCK_SZX;
+    uint32_t        chunk;
+    bool            blockwise   = (aLen > COAP_BLOCK_SIZE);
+    bool            more;
+    int             len;
+
+    if (false == aClient->open)
+    {
+        if (aClient->socket.open(aClient->iface) < 0)
+        {
+            LOG_WARN("Failed to open UDP socket");
+            return -1;
+        }
+        aClient->open   = true;
+    }
+    if (0 != dns_cache_resolve(aClient->dns, aClient->host, &addr))
+    {
+        return -1;
+    }
+    addr.set_port(aClient->port);
+
+    /* All blocks of a payload share the token */
+    aClient->token++;
+    do
+    {
+        chunk   = aLen - offset;
+        chunk   = (chunk > (16UL << szx)) ? (16UL << szx) : chunk;
+        more    = (offset + chunk < aLen);
+        len     = coap_encode(aClient->msg, sizeof(aClient->msg),
+                              aClient->confirmable ? COAP_TYPE_CON : COAP_TYPE_NON, COAP_CODE_POST,
+                              ++aClient->messageId, aClient->token, aClient->path, aFormat,
+                              blockwise ? (int32_t) (BLOCK1_NUM(offset >> (4 + szx)) | (more ? BLOCK1_MORE : 0) | szx) : -1,
+                              aPayload + offset, chunk);
+        if (len < 0)
+        {
+            aClient->stats.failures++;
+            return -1;
+        }
+
+        if (false == aClient->confirmable)
+        {
+            if (aClient->socket.sendto(addr, aClient->msg, len) < 0)
+            {
+                aClient->stats.failures++;
+                return -1;
+            }
+            aClient->stats.messages++;
+            aClient->stats.bytesTx += len;
+        }
+        else
+        {
+            if (0 != exchange(aClient, addr, len, aClient->messageId, &ack))
+            {
+                aClient->stats.failures++;
+                return -1;
+            }
+            /* An empty ACK means the response comes separately, the message itself got there */
+            if (COAP_CODE_EMPTY != ack.code && 2 != COAP_CODE_CLASS(ack.code))
+            {
+                LOG_WARN("CoAP response %d.%02d", COAP_CODE_CLASS(ack.code), COAP_CODE_DETAIL(ack.code));
+                aClient->stats.failures++;
+                return -1;
+            }
+            /* The server may ask for smaller blocks, the offset stays aligned */
+            if (blockwise && ack.block1 >= 0 && BLOCK1_SZX(ack.block1) < szx)
+            {
+                szx = BLOCK1_SZX(ack.block1);
+            }
+        }
+        offset += chunk;
+    }
+    while (offset < aLen);
+
+    aClient->stats.requests++;
+    aClient->stats.lastRttMs    = platform_now_ms() - startMs;
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_COAP_CLIENT_H_
+#define NETWORK_COAP_CLIENT_H_
+
+#include "mbed.h"
+#include "dns_cache.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define COAP_DEFAULT_PORT                   (5683)
+#define COAP_BLOCK_SZX                      (4)         /* Block-wise transfer in blocks of 16 << SZX = 256 bytes */
+#define COAP_BLOCK_SIZE                     (16 << COAP_BLOCK_SZX)
+#define COAP_MAX_MESSAGE                    (COAP_BLOCK_SIZE + 64)
+
+#define COAP_ACK_TIMEOUT_MS                 (2000)      /* RFC 7252 transmission parameters */
+#define COAP_ACK_RANDOM_FACTOR_PCT          (150)
+#define COAP_MAX_RETRANSMIT                 (4)
+
+#define COAP_FORMAT_TEXT                    (0)         /* Content-Format numbers */
+#define COAP_FORMAT_JSON                    (50)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    requests;           /* Payloads sent, acknowledged ones for CON */
+    uint32_t    messages;           /* Datagrams sent, including blocks and retransmissions */
+    uint32_t    retransmits;
+    uint32_t    failures;
+    uint32_t    bytesTx;
+    uint32_t    bytesRx;
+    uint32_t    lastRttMs;          /* First block sent to last block acknowledged, CON only */
+} CoapStats_t;
+
+/** CoAP client posting payloads to one resource over UDP.
+ *
+ * A confirmable client waits for each message to be acknowledged and retransmits it with the
+ * RFC 7252 exponential back-off; a non-confirmable one sends and returns. A payload larger than
+ * COAP_BLOCK_SIZE is sent in blocks with the Block1 option (RFC 7959); the server may ask for
+ * smaller blocks in its acknowledgement.
+ */
+typedef struct
+{
+    NetworkInterface*   iface;
+    DnsCache_t*         dns;
+    const char*         host;
+    uint16_t            port;
+    const char*         path;           /* Uri-Path, a single segment */
+    bool                confirmable;
+
+    UDPSocket           socket;
+    bool                open;
+    uint16_t            messageId;
+    uint16_t            token;
+    uint8_t             msg[COAP_MAX_MESSAGE];
+
+    CoapStats_t         stats;
+} CoapClient_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void coap_client_init(
+    CoapClient_t*       aClient,
+    NetworkInterface*   aIface,
+    DnsCache_t*         aDns,
+    const char*         aHost,
+    uint16_t            aPort,
+    const char*         aPath,
+    bool                aConfirmable);
+
+/** POSTs aLen bytes of aPayload with Content-Format aFormat.
+ *
+ * @return 0 once every block was acknowledged with a success code (CON) or sent (NON), -1
+ *         otherwise.
+ */
+int coap_client_post(
+    CoapClient_t*   aClient,
+    const uint8_t*  aPayload,
+    uint32_t        aLen,
+    uint16_t        aFormat);
+
+/** Encodes one message into aBuf. aBlock1 is the Block1 option value, or -1 for none.
+ *
+ * @return Message length, -1 when it does not fit.
+ */
+int coap_encode(
+    uint8_t*        aBuf,
+    uint32_t        aSize,
+    uint8_t         aType,
+    uint8_t         aCode,
+    uint16_t        aMessageId,
+    uint16_t        aToken,
+    const char*     aPath,
+    int32_t         aFormat,
+    int32_t         aBlock1,
+    const uint8_t*  aPayload,
+    uint32_t        aLen);
+
+#endif /* NETWORK_COAP_CLIENT_H_ */
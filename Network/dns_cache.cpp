@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "dns_cache.h"
+#include "platform_clock.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static DnsCacheEntry_t* find_entry(
+    DnsCache_t*     aCache,
+    const char*     aHost)
+{
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        if (0 == strcmp(aCache->entry[i].host, aHost))
+        {
+            return &aCache->entry[i];
+        }
+    }
+    return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A free entry, or the least recently used one */
+static DnsCacheEntry_t* alloc_entry(
+    DnsCache_t*     aCache,
+    const char*     aHost,
+    uint32_t        aNowMs)
+{
+    DnsCacheEntry_t*    victim  = &aCache->entry[0];
+
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        if ('\0' == aCache->entry[i].host[0])
+        {
+            victim  = &aCache->entry[i];
+            break;
+        }
+        if ((int32_t) (aCache->entry[i].lastUseMs - victim->lastUseMs) < 0)
+        {
+            victim  = &aCache->entry[i];
+        }
+    }
+
+    strncpy(victim->host, aHost, DNS_CACHE_HOST_MAX - 1);
+    victim->host[DNS_CACHE_HOST_MAX - 1]    = '\0';
+    victim->valid       = false;
+    victim->resolvedMs  = aNowMs;
+    victim->retryMs     = aNowMs;
+    victim->lastUseMs   = aNowMs;
+    return victim;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int lookup(
+    DnsCache_t*         aCache,
+    DnsCacheEntry_t*    aEntry,
+    uint32_t            aNowMs)
+{
+    SocketAddress   addr;
+    nsapi_error_t   result;
+
+    aCache->stats.lookups++;
+    result  = aCache->iface->gethostbyname(aEntry->host, &addr);
+    if (result < 0)
+    {
+        LOG_WARN("Failed to resolve %s, error = %d", aEntry->host, result);
+        aCache->stats.failures++;
+        aEntry->retryMs     = aNowMs + DNS_CACHE_RETRY_MS;
+        return -1;
+    }
+
+    aEntry->addr        = addr;
+    aEntry->valid       = true;
+    aEntry->resolvedMs  = aNowMs;
+    aEntry->retryMs     = aNowMs;
+    LOG_HI("Resolved %s to %s", aEntry->host, addr.get_ip_address());
+    return 0;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void dns_cache_init(
+    DnsCache_t*         aCache,
+    NetworkInterface*   aIface,
+    uint32_t            aTtlMs)
+{
+    aCache->iface   = aIface;
+    aCache->ttlMs   = aTtlMs;
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        aCache->entry[i].host[0]    = '\0';
+        aCache->entry[i].valid      = false;
+    }
+    memset(&aCache->stats, 0, sizeof(aCache->stats));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int dns_cache_resolve(
+    DnsCache_t*     aCache,
+    const char*     aHost,
+    SocketAddress*  aAddr)
+{
+    uint32_t            nowMs   = platform_now_ms();
+    DnsCacheEntry_t*    entry   = find_entry(aCache, aHost);
+
+    if (NULL == entry)
+    {
+        entry   = alloc_entry(aCache, aHost, nowMs);
+    }
+    entry->lastUseMs    = nowMs;
+
+    if (entry->valid && (nowMs - entry->resolvedMs) < aCache->ttlMs)
+    {
+        aCache->stats.hits++;
+        *aAddr  = entry->addr;
+        return 0;
+    }
+
+    /* A failing resolver is not asked again on every send */
+    if ((false == entry->valid || (int32_t) (nowMs - entry->retryMs) >= 0) &&
+        0 == lookup(aCache, entry, nowMs))
+    {
+        *aAddr  = entry->addr;
+        return 0;
+    }
+
+    if (entry->valid)
+    {
+        LOG_WARN("Using the last known address of %s", aHost);
+        aCache->stats.stale++;
+        *aAddr  = entry->addr;
+        return 0;
+    }
+    return -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void dns_cache_refresh(
+    DnsCache_t*     aCache)
+{
+    uint32_t            nowMs   = platform_now_ms();
+    DnsCacheEntry_t*    entry;
+
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        entry   = &aCache->entry[i];
+        /* Hosts no longer in use are left to expire */
+        if (entry->valid &&
+            (nowMs - entry->lastUseMs) < aCache->ttlMs &&
+            (nowMs - entry->resolvedMs) >= aCache->ttlMs - aCache->ttlMs / 5 &&
+            (int32_t) (nowMs - entry->retryMs) >= 0)
+        {
+            lookup(aCache, entry, nowMs);
+        }
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void dns_cache_invalidate(
+    DnsCache_t*     aCache,
+    const char*     aHost)
+{
+    DnsCacheEntry_t*    entry   = find_entry(aCache, aHost);
+
+    if (NULL != entry)
+    {
+        /* Expired, but kept as the fallback */
+        entry->resolvedMs   = platform_now_ms() - aCache->ttlMs;
+        entry->retryMs      = platform_now_ms();
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_DNS_CACHE_H_
+#define NETWORK_DNS_CACHE_H_
+
+#include "mbed.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define DNS_CACHE_ENTRIES                   (4)
+#define DNS_CACHE_HOST_MAX                  (40)        /* Including the terminating NUL */
+#define DNS_CACHE_RETRY_MS                  (30000)     /* Between lookups while they keep failing */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    char            host[DNS_CACHE_HOST_MAX];   /* Empty when the entry is unused */
+    SocketAddress   addr;
+    bool            valid;                      /* addr holds a result, possibly expired */
+    uint32_t        resolvedMs;                 /* Time of the last successful lookup */
+    uint32_t        retryMs;                    /* No lookup before this time after a failure */
+    uint32_t        lastUseMs;
+} DnsCacheEntry_t;
+
+typedef struct
+{
+    uint32_t    hits;
+    uint32_t    lookups;
+    uint32_t    failures;
+    uint32_t    stale;              /* Expired addresses used because the lookup failed */
+} DnsCacheStats_t;
+
+/** Host name to address cache in front of NetworkInterface::gethostbyname().
+ *
+ * The resolver does not report record TTLs, so every address is kept for the configured ttlMs.
+ * dns_cache_refresh() looks up again the entries in the last fifth of their life, so a caller
+ * that runs it between sends rarely meets an expired entry. When a lookup fails, the last known
+ * address is used until one succeeds.
+ */
+typedef struct
+{
+    NetworkInterface*   iface;
+    uint32_t            ttlMs;
+    DnsCacheEntry_t     entry[DNS_CACHE_ENTRIES];
+    DnsCacheStats_t     stats;
+} DnsCache_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void dns_cache_init(
+    DnsCache_t*         aCache,
+    NetworkInterface*   aIface,
+    uint32_t            aTtlMs);
+
+/** Address of aHost, from the cache while it is fresh. The port of aAddr is left to the caller.
+ *
+ * @return 0 on success, also when an expired address is returned because the lookup failed,
+ *         -1 when there is no address at all.
+ */
+int dns_cache_resolve(
+    DnsCache_t*     aCache,
+    const char*     aHost,
+    SocketAddress*  aAddr);
+
+/** Looks up again the entries close to expiry. Meant to run off the send path. */
+void dns_cache_refresh(
+    DnsCache_t*     aCache);
+
+/** Forces a lookup on the next resolve of aHost, e.g. after a connect to its address failed.
+ * The address is still used if that lookup fails.
+ */
+void dns_cache_invalidate(
+    DnsCache_t*     aCache,
+    const char*     aHost);
+
+#endif /* NETWORK_DNS_CACHE_H_ */
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "http_conn.h"
+#include "http_parser.h"
+#include "platform_clock.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HTTP_RECV_CLOSED            (-2)    /* Connection closed before the first response byte */
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static nsapi_size_or_error_t conn_send(
+    HttpConn_t* aConn,
+    const void* aBuf,
+    uint32_t    aLen)
+{
+    return (NULL != aConn->tls) ? tls_conn_send(aConn->tls, aBuf, aLen) : aConn->socket.send(aBuf, aLen);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static nsapi_size_or_error_t conn_recv(
+    HttpConn_t* aConn,
+    void*       aBuf,
+    uint32_t    aSize)
+{
+    return (NULL != aConn->tls) ? tls_conn_recv(aConn->tls, aBuf, aSize) : aConn->socket.recv(aBuf, aSize);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int conn_open(
+    HttpConn_t* aConn)
+{
+    nsapi_error_t   result;
+    uint32_t        lookups = aConn->dns->stats.lookups;
+    uint32_t        startMs = platform_now_ms();
+
+    result  = dns_cache_resolve(aConn->dns, aConn->host, &aConn->addr);
+    if (lookups != aConn->dns->stats.lookups)
+    {
+        uplink_timing_record(&aConn->timing, UPLINK_PHASE_DNS, platform_now_ms() - startMs);
+    }
+    if (0 != result)
+    {
+        return -1;
+    }
+    aConn->addr.set_port(aConn->port);
+
+    startMs = platform_now_ms();
+    result  = aConn->socket.open(aConn->iface);
+    if (result < 0)
+    {
+        LOG_WARN("Failed to open TCP Socket ... error = %d", result);
+        return -1;
+    }
+    aConn->socket.set_timeout(HTTP_CONN_TIMEOUT_MS);
+
+    LOG_HI("socket.connect...");
+    result  = aConn->socket.connect(aConn->addr);
+    uplink_timing_record(&aConn->timing, UPLINK_PHASE_CONNECT, platform_now_ms() - startMs);
+    if (result < 0)
+    {
+        LOG_WARN("Failed to connect with %s ... error = %d", aConn->host, result);
+        aConn->socket.close();
+        /* The address may have moved, look it up again next time */
+        dns_cache_invalidate(aConn->dns, aConn->host);
+        return -1;
+    }
+
+    if (NULL != aConn->tls)
+    {
+        startMs = platform_now_ms();
+        result  = tls_conn_start(aConn->tls, &aConn->socket);
+        uplink_timing_record(&aConn->timing, UPLINK_PHASE_TLS, platform_now_ms() - startMs);
+        if (0 != result)
+        {
+            aConn->socket.close();
+            return -1;
+        }
+    }
+
+    aConn->open     = true;
+    aConn->stats.connects++;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Reads one response through the parser, aBuf only holds what the last recv() returned. It
+ * returns as soon as the outcome is known: once the body is complete, or right after the status
+ * line when the connection is closed after the response anyway, in which case the rest is not
+ * read at all. *aCloseAfter is set unless the connection is in step for the next request.
+ *
+ * @return Status code, HTTP_RECV_CLOSED when nothing at all was received, -1 on error.
+ */
+static int read_response(
+    HttpConn_t* aConn,
+    char*       aBuf,
+    uint32_t    aBufSize,
+    bool*       aCloseAfter)
+{
+    HttpParser_t    parser;
+    uint32_t        received    = 0;
+    int             result      = 0;
+    int             used        = 0;
+
+    http_parser_init(&parser);
+    while (HTTP_PARSER_DONE != parser.state)
+    {
+        /* Nothing that follows changes the outcome of a response on a connection being closed */
+        if (parser.status >= 200 && (false == aConn->keepAlive || parser.close))
+        {
+            break;
+        }
+
+        result  = conn_recv(aConn, aBuf, aBufSize);
+        if (result <= 0)
+        {
+            if (0 == received)
+            {
+                return HTTP_RECV_CLOSED;
+            }
+            if (0 == result && 0 == http_parser_finish(&parser))
+            {
+                break;
+            }
+            LOG_WARN("HTTP response cut short after %u bytes, error = %d", (unsigned) received, result);
+            return -1;
+        }
+        received               += result;
+        aConn->stats.bytesRx   += result;
+
+        used    = http_parser_feed(&parser, aBuf, result);
+        if (used < 0)
+        {
+            LOG_WARN("Not an HTTP response");
+            return -1;
+        }
+    }
+
+    /* Bytes past the end of the response put the stream out of step */
+    *aCloseAfter    = (false == aConn->keepAlive) || parser.close || (HTTP_PARSER_DONE != parser.state) || (used < result);
+    aConn->status   = parser.status;
+    return parser.status;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * One request, a GET when aBody is NULL, otherwise a POST of aBodyLen bytes of aType. The body
+ * goes in the same segment as the headers when both fit in aBuf.
+ */
+static int do_request(
+    HttpConn_t*     aConn,
+    const char*     aPath,
+    const char*     aQuery,
+    const char*     aType,
+    const char*     aBody,
+    uint32_t        aBodyLen,
+    char*           aBuf,
+    uint32_t        aBufSize)
+{
+    bool        reused;
+    bool        sent;
+    bool        closeAfter;
+    int         bytes;
+    int         result;
+    uint32_t    bodyLeft;
+    uint32_t    startMs;
+    uint32_t    phaseMs;
+
+    if (aConn->open && (platform_now_ms() - aConn->lastUseMs) > aConn->idleMs)
+    {
+        LOG_HI("Connection idle for too long, closing it");
+        http_conn_close(aConn);
+    }
+
+    /* A second attempt only when a reused connection turns out to be closed by the server */
+    startMs = platform_now_ms();
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        /* The previous attempt may have overwritten the request with a partial response. HTTP/1.1
+         * connections are persistent unless one side says otherwise. */
+        bytes   = snprintf(aBuf, aBufSize, "%s %s%s%s HTTP/1.1\r\nHost: %s\r\n%s",
+                           (NULL != aBody) ? "POST" : "GET",
+                           aPath, (NULL != aQuery) ? "?" : "", (NULL != aQuery) ? aQuery : "",
+                           aConn->host, aConn->keepAlive ? "" : "Connection: close\r\n");
+        if (bytes >= 0 && (uint32_t) bytes < aBufSize && NULL != aBody)
+        {
+            bytes  += snprintf(aBuf + bytes, aBufSize - bytes, "Content-Type: %s\r\nContent-Length: %u\r\n",
+                               aType, (unsigned) aBodyLen);
+        }
+        if (bytes >= 0 && (uint32_t) bytes < aBufSize)
+        {
+            bytes  += snprintf(aBuf + bytes, aBufSize - bytes, "\r\n");
+        }
+        if (bytes < 0 || (uint32_t) bytes >= aBufSize)
+        {
+            LOG_WARN("HTTP request does not fit in %u bytes", (unsigned) aBufSize);
+            return -1;
+        }
+        bodyLeft    = (NULL != aBody) ? aBodyLen : 0;
+        if (bodyLeft > 0 && bytes + bodyLeft < aBufSize)
+        {
+            memcpy(aBuf + bytes, aBody, bodyLeft);
+            bytes      += bodyLeft;
+            bodyLeft    = 0;
+        }
+
+        reused  = aConn->open;
+        if (false == reused && 0 != conn_open(aConn))
+        {
+            aConn->stats.connectFailures++;
+            return -1;
+        }
+
+        LOG_HI("socket.send...");
+        phaseMs = platform_now_ms();
+        result  = conn_send(aConn, aBuf, bytes);
+        if (result >= 0 && bodyLeft > 0)
+        {
+            aConn->stats.bytesTx   += bytes;
+            bytes   = bodyLeft;
+            result  = conn_send(aConn, aBody, bodyLeft);
+        }
+        uplink_timing_record(&aConn->timing, UPLINK_PHASE_SEND, platform_now_ms() - phaseMs);
+        sent    = (result >= 0);
+        if (sent)
+        {
+            aConn->stats.bytesTx   += bytes;
+            LOG_HI("socket.recv...");
+            phaseMs = platform_now_ms();
+            result  = read_response(aConn, aBuf, aBufSize, &closeAfter);
+            uplink_timing_record(&aConn->timing, UPLINK_PHASE_RECV, platform_now_ms() - phaseMs);
+        }
+
+        if (result >= 0)
+        {
+            aConn->lastUseMs        = platform_now_ms();
+            aConn->stats.requests++;
+            aConn->stats.reused    += reused ? 1 : 0;
+            aConn->stats.totalMs   += aConn->lastUseMs - startMs;
+            if ((aConn->lastUseMs - startMs) > aConn->stats.maxMs)
+            {
+                aConn->stats.maxMs  = aConn->lastUseMs - startMs;
+            }
+            if (closeAfter)
+            {
+                http_conn_close(aConn);
+            }
+            if (aConn->status >= 400)
+            {
+                aConn->stats.rejected++;
+            }
+            LOG_WARN_COND(200 <= aConn->status && aConn->status < 300, "HTTP status %d", aConn->status);
+            return result;
+        }
+
+        /* Only a reused connection that failed before any response byte is worth a second try */
+        http_conn_close(aConn);
+        if (false == reused || (sent && HTTP_RECV_CLOSED != result))
+        {
+            aConn->stats.sendFailures  += sent ? 0 : 1;
+            aConn->stats.recvFailures  += sent ? 1 : 0;
+            LOG_WARN("HTTP request failed, error = %d", result);
+            return -1;
+        }
+        LOG_HI("Server closed the connection, reconnecting");
+        aConn->stats.retries++;
+    }
+
+    return -1;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void http_conn_init(
+    HttpConn_t*         aConn,
+    NetworkInterface*   aIface,
+    DnsCache_t*         aDns,
+    const char*         aHost,
+    uint16_t            aPort,
+    bool                aKeepAlive,
+    uint32_t            aIdleMs)
+{
+    aConn->iface        = aIface;
+    aConn->dns          = aDns;
+    aConn->host         = aHost;
+    aConn->port         = aPort;
+    aConn->keepAlive    = aKeepAlive;
+    aConn->idleMs       = aIdleMs;
+    aConn->open         = false;
+    aConn->lastUseMs    = 0;
+    aConn->status       = 0;
+    aConn->tls          = NULL;
+    memset(&aConn->stats, 0, sizeof(aConn->stats));
+    uplink_timing_init(&aConn->timing);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void http_conn_set_tls(
+    HttpConn_t*     aConn,
+    TlsConn_t*      aTls)
+{
+    aConn->tls  = aTls;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int http_conn_get(
+    HttpConn_t*     aConn,
+    const char*     aPath,
+    const char*     aQuery,
+    char*           aBuf,
+    uint32_t        aBufSize)
+{
+    return do_request(aConn, aPath, aQuery, NULL, NULL, 0, aBuf, aBufSize);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int http_conn_post(
+    HttpConn_t*     aConn,
+    const char*     aPath,
+    const char*     aType,
+    const char*     aBody,
+    uint32_t        aBodyLen,
+    char*           aBuf,
+    uint32_t        aBufSize)
+{
+    return do_request(aConn, aPath, NULL, aType, aBody, aBodyLen, aBuf, aBufSize);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void http_conn_close(
+    HttpConn_t*     aConn)
+{
+    uint32_t    startMs;
+
+    if (aConn->open)
+    {
+        LOG_HI("socket.close...");
+        startMs     = platform_now_ms();
+        if (NULL != aConn->tls)
+        {
+            tls_conn_close(aConn->tls);
+        }
+        aConn->socket.close();
+        uplink_timing_record(&aConn->timing, UPLINK_PHASE_CLOSE, platform_now_ms() - startMs);
+        aConn->open = false;
+    }
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_HTTP_CONN_H_
+#define NETWORK_HTTP_CONN_H_
+
+#include "mbed.h"
+#include "dns_cache.h"
+#include "uplink_timing.h"
+#include "tls_conn.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HTTP_CONN_TIMEOUT_MS                (30000)     /* Per socket operation */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    connects;           /* TCP connections opened */
+    uint32_t    requests;           /* Requests answered */
+    uint32_t    reused;             /* Requests sent on an already open connection */
+    uint32_t    retries;            /* Requests resent after the server closed an idle connection */
+    uint32_t    rejected;           /* Responses with a 4xx or 5xx status */
+    uint32_t    connectFailures;    /* Requests that got no connection, DNS included */
+    uint32_t    sendFailures;
+    uint32_t    recvFailures;       /* No complete status line before the timeout or the close */
+    uint32_t    bytesTx;
+    uint32_t    bytesRx;
+    uint32_t    totalMs;            /* Request to response of the answered requests */
+    uint32_t    maxMs;
+} HttpConnStats_t;
+
+/** One HTTP/1.1 connection to a single server, kept open across requests.
+ *
+ * The server address comes from the DNS cache on every connect, and is looked up again after a
+ * connect to it fails. The connection is opened on demand and closed when the server asks for it, when the end of a
+ * response is only marked by the close, or after idleMs without a request, as servers drop idle
+ * connections on their own. A response is read no further than needed: on a connection that is
+ * closed afterwards, the status line is enough. A request that finds the connection closed by the
+ * server is sent again once on a new connection. Each phase of a request is timed into timing.
+ * With tls set, every connection is secured before the first request.
+ */
+typedef struct
+{
+    NetworkInterface*   iface;
+    DnsCache_t*         dns;
+    const char*         host;
+    uint16_t            port;
+    bool                keepAlive;      /* false: one connection per request, as HTTP/1.0 */
+    uint32_t            idleMs;
+
+    TCPSocket           socket;
+    TlsConn_t*          tls;            /* NULL: plain TCP */
+    SocketAddress       addr;
+    bool                open;
+    uint32_t            lastUseMs;
+    int                 status;         /* Status code of the last response */
+
+    HttpConnStats_t     stats;
+    UplinkTiming_t      timing;
+} HttpConn_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void http_conn_init(
+    HttpConn_t*         aConn,
+    NetworkInterface*   aIface,
+    DnsCache_t*         aDns,
+    const char*         aHost,
+    uint16_t            aPort,
+    bool                aKeepAlive,
+    uint32_t            aIdleMs);
+
+/** Secures the connections with aTls from the next one on, NULL goes back to plain TCP.
+ */
+void http_conn_set_tls(
+    HttpConn_t*     aConn,
+    TlsConn_t*      aTls);
+
+/** Sends "GET aPath?aQuery" (aQuery may be NULL) and reads the response. aBuf holds the request while it is sent and
+ * then takes the response as it is received, the body is parsed and dropped, never kept.
+ *
+ * @return Status code, also left in aConn->status, -1 when no valid response was received.
+ */
+int http_conn_get(
+    HttpConn_t*     aConn,
+    const char*     aPath,
+    const char*     aQuery,
+    char*           aBuf,
+    uint32_t        aBufSize);
+
+/** Sends "POST aPath" with aBodyLen bytes of aBody as aType and reads the response, aBuf is
+ * used as for http_conn_get(). aBody is sent from where it is and may be longer than aBuf.
+ */
+int http_conn_post(
+    HttpConn_t*     aConn,
+    const char*     aPath,
+    const char*     aType,
+    const char*     aBody,
+    uint32_t        aBodyLen,
+    char*           aBuf,
+    uint32_t        aBufSize);
+
+void http_conn_close(
+    HttpConn_t*     aConn);
+
+#endif /* NETWORK_HTTP_CONN_H_ */
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <ctype.h>
+#include <string.h>
+#include "http_parser.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HTTP_PARSER_LENGTH_MAX      (0x7FFFFFFFUL)
+#define HTTP_PARSER_CHUNK_DIGITS    (7)     /* Hex digits of a chunk size, keeps it below HTTP_PARSER_LENGTH_MAX */
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Case-insensitive match of a header name at the start of a line, returns its value or NULL */
+static const char* header_value(
+    const char* aLine,
+    const char* aName)
+{
+    while (*aName)
+    {
+        if (tolower((unsigned char) *aLine) != *aName)
+        {
+            return NULL;
+        }
+        aLine++;
+        aName++;
+    }
+    if (':' != *aLine++)
+    {
+        return NULL;
+    }
+    while (' ' == *aLine || '\t' == *aLine)
+    {
+        aLine++;
+    }
+    return aLine;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Case-insensitive search of aToken in a comma separated list, only its last element when aLast */
+static bool has_token(
+    const char* aList,
+    const char* aToken,
+    bool        aLast)
+{
+    uint32_t    len     = strlen(aToken);
+    bool        found   = false;
+
+    while ('\0' != *aList)
+    {
+        while (' ' == *aList || '\t' == *aList || ',' == *aList)
+        {
+            aList++;
+        }
+        found   = (0 == strncasecmp(aList, aToken, len)) &&
+                  ('\0' == aList[len] || ',' == aList[len] || ' ' == aList[len] || '\t' == aList[len] || ';' == aList[len]);
+        if (found && false == aLast)
+        {
+            return true;
+        }
+        while ('\0' != *aList && ',' != *aList)
+        {
+            aList++;
+        }
+    }
+    return found;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* "HTTP/1.x NNN reason" */
+static int parse_status(
+    HttpParser_t*   aParser,
+    const char*     aLine)
+{
+    if (0 != strncmp(aLine, "HTTP/1.", 7) || !isdigit((unsigned char) aLine[7]) || ' ' != aLine[8] ||
+        !isdigit((unsigned char) aLine[9]) || !isdigit((unsigned char) aLine[10]) || !isdigit((unsigned char) aLine[11]) ||
+        ('\0' != aLine[12] && ' ' != aLine[12]))
+    {
+        return -1;
+    }
+    aParser->status = (aLine[9] - '0') * 100 + (aLine[10] - '0') * 10 + (aLine[11] - '0');
+    aParser->close  = ('0' == aLine[7]);
+    return (aParser->status < 100) ? -1 : 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int parse_header(
+    HttpParser_t*   aParser,
+    const char*     aLine,
+    bool            aTruncated)
+{
+    const char* value;
+    uint32_t    length  = 0;
+
+    if (NULL != (value = header_value(aLine, "content-length")))
+    {
+        if (aTruncated || !isdigit((unsigned char) *value))
+        {
+            return -1;
+        }
+        for (; isdigit((unsigned char) *value); value++)
+        {
+            if (length > (HTTP_PARSER_LENGTH_MAX - 9) / 10)
+            {
+                return -1;
+            }
+            length  = length * 10 + (*value - '0');
+        }
+        while (' ' == *value || '\t' == *value)
+        {
+            value++;
+        }
+        /* Two different lengths cannot both be right */
+        if ('\0' != *value || (aParser->contentLength >= 0 && (uint32_t) aParser->contentLength != length))
+        {
+            return -1;
+        }
+        aParser->contentLength  = length;
+    }
+    else if (NULL != (value = header_value(aLine, "transfer-encoding")))
+    {
+        /* Any other coding last leaves the body delimited by close */
+        aParser->encoded    = true;
+        aParser->chunked    = has_token(value, "chunked", true);
+    }
+    else if (NULL != (value = header_value(aLine, "connection")))
+    {
+        aParser->close     |= has_token(value, "close", false);
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The empty line after the headers, decides how the body ends */
+static void end_of_head(
+    HttpParser_t*   aParser)
+{
+    if (aParser->status < 200 && 101 != aParser->status)
+    {
+        /* Interim response, the real one follows */
+        aParser->state          = HTTP_PARSER_STATUS;
+        aParser->status         = 0;
+        aParser->contentLength  = -1;
+        aParser->encoded        = false;
+        aParser->chunked        = false;
+        aParser->close          = false;
+    }
+    else if (101 == aParser->status)
+    {
+        /* The connection is no longer HTTP */
+        aParser->close          = true;
+        aParser->state          = HTTP_PARSER_DONE;
+    }
+    else if (204 == aParser->status || 304 == aParser->status)
+    {
+        aParser->state          = HTTP_PARSER_DONE;
+    }
+    else if (aParser->chunked)
+    {
+        aParser->state          = HTTP_PARSER_CHUNK_SIZE;
+    }
+    else if (false == aParser->encoded && aParser->contentLength >= 0)
+    {
+        aParser->remaining      = aParser->contentLength;
+        aParser->state          = (0 == aParser->remaining) ? HTTP_PARSER_DONE : HTTP_PARSER_BODY;
+    }
+    else
+    {
+        aParser->close          = true;
+        aParser->state          = HTTP_PARSER_UNTIL_CLOSE;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Hex size, optionally followed by ";extension" */
+static int parse_chunk_size(
+    HttpParser_t*   aParser,
+    const char*     aLine)
+{
+    uint32_t    size    = 0;
+    int         digits  = 0;
+
+    for (; isxdigit((unsigned char) *aLine); aLine++)
+    {
+        if (++digits > HTTP_PARSER_CHUNK_DIGITS)
+        {
+            return -1;
+        }
+        size    = (size << 4) | (isdigit((unsigned char) *aLine) ? *aLine - '0' : (tolower((unsigned char) *aLine) - 'a' + 10));
+    }
+    while (' ' == *aLine || '\t' == *aLine)
+    {
+        aLine++;
+    }
+    if (0 == digits || ('\0' != *aLine && ';' != *aLine))
+    {
+        return -1;
+    }
+    aParser->remaining  = size;
+    aParser->state      = (0 == size) ? HTTP_PARSER_TRAILER : HTTP_PARSER_CHUNK_DATA;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* One complete line, without its line break */
+static int parse_line(
+    HttpParser_t*   aParser)
+{
+    char*   line        = aParser->line;
+    bool    truncated   = (aParser->lineLen >= HTTP_PARSER_LINE_MAX);
+    bool    empty       = (0 == aParser->lineLen);
+
+    switch (aParser->state)
+    {
+        case HTTP_PARSER_STATUS:
+            /* Stray line breaks ahead of a response are tolerated */
+            return empty ? 0 : parse_status(aParser, line);
+        case HTTP_PARSER_HEADER:
+            if (empty)
+            {
+                end_of_head(aParser);
+                return 0;
+            }
+            return parse_header(aParser, line, truncated);
+        case HTTP_PARSER_CHUNK_SIZE:
+            return parse_chunk_size(aParser, line);
+        case HTTP_PARSER_CHUNK_END:
+            aParser->state  = HTTP_PARSER_CHUNK_SIZE;
+            return empty ? 0 : -1;
+        case HTTP_PARSER_TRAILER:
+            aParser->state  = empty ? HTTP_PARSER_DONE : HTTP_PARSER_TRAILER;
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void http_parser_init(
+    HttpParser_t*   aParser)
+{
+    memset(aParser, 0, sizeof(*aParser));
+    aParser->state          = HTTP_PARSER_STATUS;
+    aParser->contentLength  = -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int http_parser_feed(
+    HttpParser_t*   aParser,
+    const char*     aData,
+    uint32_t        aLen)
+{
+    uint32_t    used    = 0;
+    uint32_t    count;
+    char        c;
+
+    while (used < aLen)
+    {
+        switch (aParser->state)
+        {
+            case HTTP_PARSER_BODY:
+            case HTTP_PARSER_CHUNK_DATA:
+                /* Skipped in one go, the body is never looked at */
+                count   = (aLen - used < aParser->remaining) ? aLen - used : aParser->remaining;
+                used                += count;
+                aParser->remaining  -= count;
+                aParser->bodyBytes  += count;
+                if (0 == aParser->remaining)
+                {
+                    aParser->state   = (HTTP_PARSER_BODY == aParser->state) ? HTTP_PARSER_DONE : HTTP_PARSER_CHUNK_END;
+                }
+                break;
+
+            case HTTP_PARSER_UNTIL_CLOSE:
+                aParser->bodyBytes  += aLen - used;
+                used                 = aLen;
+                break;
+
+            case HTTP_PARSER_DONE:
+                return used;
+
+            case HTTP_PARSER_ERROR:
+                return -1;
+
+            default:
+                c   = aData[used++];
+                if (HTTP_PARSER_STATUS == aParser->state || HTTP_PARSER_HEADER == aParser->state)
+                {
+                    aParser->headBytes++;
+                }
+                if ('\0' == c || aParser->headBytes > HTTP_PARSER_HEAD_MAX)
+                {
+                    aParser->state  = HTTP_PARSER_ERROR;
+                    return -1;
+                }
+                if ('\n' != c)
+                {
+                    /* The rest of a long line is dropped, what is looked at comes first */
+                    if (aParser->lineLen < HTTP_PARSER_LINE_MAX)
+                    {
+                        aParser->line[aParser->lineLen++]   = c;
+                    }
+                    break;
+                }
+
+                /* The CR of CRLF is optional, a truncated line has already lost it */
+                if (aParser->lineLen > 0 && aParser->lineLen < HTTP_PARSER_LINE_MAX && '\r' == aParser->line[aParser->lineLen - 1])
+                {
+                    aParser->lineLen--;
+                }
+                aParser->line[(aParser->lineLen < HTTP_PARSER_LINE_MAX) ? aParser->lineLen : HTTP_PARSER_LINE_MAX - 1]  = '\0';
+                if (0 != parse_line(aParser))
+                {
+                    aParser->state  = HTTP_PARSER_ERROR;
+                    return -1;
+                }
+                if (HTTP_PARSER_STATUS == aParser->state && 0 != aParser->status)
+                {
+                    aParser->state  = HTTP_PARSER_HEADER;
+                }
+                aParser->lineLen    = 0;
+                break;
+        }
+    }
+
+    return used;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int http_parser_finish(
+    HttpParser_t*   aParser)
+{
+    if (HTTP_PARSER_UNTIL_CLOSE == aParser->state)
+    {
+        aParser->state  = HTTP_PARSER_DONE;
+    }
+    else if (HTTP_PARSER_DONE != aParser->state)
+    {
+        aParser->state  = HTTP_PARSER_ERROR;
+    }
+    return (HTTP_PARSER_DONE == aParser->state) ? 0 : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+bool http_parser_head_done(
+    const HttpParser_t* aParser)
+{
+    return aParser->state > HTTP_PARSER_HEADER && HTTP_PARSER_ERROR != aParser->state;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_HTTP_PARSER_H_
+#define NETWORK_HTTP_PARSER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HTTP_PARSER_LINE_MAX                (64)        /* Kept of each line, enough for the headers looked at */
+#define HTTP_PARSER_HEAD_MAX                (4096)      /* Status line and headers, a longer head is an error */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    HTTP_PARSER_STATUS,             /* Status line */
+    HTTP_PARSER_HEADER,
+    HTTP_PARSER_BODY,               /* Content-Length bytes */
+    HTTP_PARSER_CHUNK_SIZE,
+    HTTP_PARSER_CHUNK_DATA,
+    HTTP_PARSER_CHUNK_END,          /* CRLF after the chunk data */
+    HTTP_PARSER_TRAILER,
+    HTTP_PARSER_UNTIL_CLOSE,        /* Body delimited by the server closing the connection */
+    HTTP_PARSER_DONE,
+    HTTP_PARSER_ERROR,
+} HttpParserState_e;
+
+/** Incremental parser of one HTTP/1.x response, fed whatever recv() returned.
+ *
+ * Only the status line and the Content-Length, Transfer-Encoding and Connection headers are
+ * looked at. The body, plain or chunked, is counted and skipped without being kept, so the
+ * parser needs no buffer beyond one header line. Interim 1xx responses are skipped.
+ */
+typedef struct
+{
+    uint8_t     state;              /* HttpParserState_e */
+    bool        encoded;            /* Transfer-Encoding given, Content-Length no longer counts */
+    bool        chunked;
+    bool        close;              /* The server closes the connection after this response */
+    int         status;             /* 0 until the status line is complete */
+    int32_t     contentLength;      /* -1 when not given */
+    uint32_t    remaining;          /* Of the body or of the current chunk */
+    uint32_t    headBytes;
+    uint32_t    bodyBytes;          /* Chunk framing not included */
+    uint16_t    lineLen;
+    char        line[HTTP_PARSER_LINE_MAX];
+} HttpParser_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void http_parser_init(
+    HttpParser_t*   aParser);
+
+/** Parses the next aLen bytes of the response, stopping at its end.
+ *
+ * @return Bytes used, less than aLen when the response ended before them, -1 when the
+ *         response is malformed.
+ */
+int http_parser_feed(
+    HttpParser_t*   aParser,
+    const char*     aData,
+    uint32_t        aLen);
+
+/** To be called when the server closed the connection, ends a body delimited by the close.
+ *
+ * @return 0 when the response is complete, -1 otherwise.
+ */
+int http_parser_finish(
+    HttpParser_t*   aParser);
+
+/** true once the status line and all headers are in, the state of the body is then known */
+bool http_parser_head_done(
+    const HttpParser_t* aParser);
+
+#endif /* NETWORK_HTTP_PARSER_H_ */
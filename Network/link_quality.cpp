@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "link_quality.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define CESQ_UNKNOWN                (255)
+#define CESQ_RSRP_MAX               (97)    /* 3GPP TS 27.007 +CESQ: rsrp 0..97 is -141..-44 dBm */
+#define CESQ_RSRQ_MAX               (34)    /* rsrq 0..34 is -20..-3 dB in 0.5 dB steps */
+#define LINK_SMOOTHING_SHIFT        (1)     /* Each sample moves the metric half way */
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Level of aMetric dB, a level better than aCurrent needs LINK_HYSTERESIS_DB above its threshold */
+static uint8_t classify(
+    int32_t     aMetric,
+    int32_t     aFair,
+    int32_t     aPoor,
+    uint8_t     aCurrent)
+{
+    if (aMetric >= aFair + ((aCurrent > LINK_LEVEL_GOOD) ? LINK_HYSTERESIS_DB : 0))
+    {
+        return LINK_LEVEL_GOOD;
+    }
+    if (aMetric >= aPoor + ((aCurrent > LINK_LEVEL_FAIR) ? LINK_HYSTERESIS_DB : 0))
+    {
+        return LINK_LEVEL_FAIR;
+    }
+    return LINK_LEVEL_POOR;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void link_quality_init(
+    LinkQuality_t*      aLink,
+    CellularNetwork*    aNetwork,
+    uint32_t            aPeriodMs)
+{
+    memset(aLink, 0, sizeof(*aLink));
+    aLink->network      = aNetwork;
+    aLink->periodMs     = aPeriodMs;
+    aLink->last.rssiDbm = LINK_QUALITY_UNKNOWN;
+    aLink->last.rsrpDbm = LINK_QUALITY_UNKNOWN;
+    aLink->last.rsrqDb  = LINK_QUALITY_UNKNOWN;
+    aLink->level        = LINK_LEVEL_GOOD;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+bool link_quality_poll(
+    LinkQuality_t*  aLink,
+    uint32_t        aNowMs)
+{
+    LinkSample_t    sample;
+    int             rssi;
+    int             rxlev;
+    int             ber;
+    int             rscp;
+    int             ecno;
+    int             rsrq;
+    int             rsrp;
+
+    if (NULL == aLink->network || 0 == aLink->periodMs ||
+        (aLink->samples + aLink->failures > 0 && (aNowMs - aLink->lastMs) < aLink->periodMs))
+    {
+        return false;
+    }
+    aLink->lastMs   = aNowMs;
+
+    sample.rssiDbm  = LINK_QUALITY_UNKNOWN;
+    sample.rsrpDbm  = LINK_QUALITY_UNKNOWN;
+    sample.rsrqDb   = LINK_QUALITY_UNKNOWN;
+    if (NSAPI_ERROR_OK == aLink->network->get_signal_quality(rssi) && CellularNetwork::SignalQualityUnknown != rssi)
+    {
+        sample.rssiDbm  = rssi;
+    }
+    if (NSAPI_ERROR_OK == aLink->network->get_extended_signal_quality(rxlev, ber, rscp, ecno, rsrq, rsrp))
+    {
+        if (rsrp >= 0 && rsrp <= CESQ_RSRP_MAX)
+        {
+            sample.rsrpDbm  = rsrp - 141;
+        }
+        if (rsrq >= 0 && rsrq <= CESQ_RSRQ_MAX)
+        {
+            sample.rsrqDb   = (rsrq - 40) / 2;
+        }
+    }
+
+    if (LINK_QUALITY_UNKNOWN == sample.rssiDbm && LINK_QUALITY_UNKNOWN == sample.rsrpDbm)
+    {
+        aLink->failures++;
+        LOG_WARN("No signal quality from the modem");
+        return false;
+    }
+    return link_quality_update(aLink, &sample);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+bool link_quality_update(
+    LinkQuality_t*      aLink,
+    const LinkSample_t* aSample)
+{
+    bool        byRsrp  = (LINK_QUALITY_UNKNOWN != aSample->rsrpDbm);
+    int32_t     value   = byRsrp ? aSample->rsrpDbm : aSample->rssiDbm;
+    uint8_t     level;
+
+    if (LINK_QUALITY_UNKNOWN == value)
+    {
+        return false;
+    }
+
+    aLink->last = *aSample;
+    /* RSSI and RSRP are not on the same scale, a switch starts the smoothing over */
+    if (0 == aLink->samples || byRsrp != aLink->byRsrp)
+    {
+        aLink->metric16 = value * 16;
+        aLink->byRsrp   = byRsrp;
+    }
+    else
+    {
+        int32_t step    = (value * 16 - aLink->metric16) / (1 << LINK_SMOOTHING_SHIFT);
+
+        /* The division stops short of a steady value, the last 1/16 dB is taken at once */
+        aLink->metric16 += (0 != step) ? step : value * 16 - aLink->metric16;
+    }
+    aLink->samples++;
+
+    level   = byRsrp ? classify(aLink->metric16 / 16, LINK_RSRP_FAIR_DBM, LINK_RSRP_POOR_DBM, aLink->level)
+                     : classify(aLink->metric16 / 16, LINK_RSSI_FAIR_DBM, LINK_RSSI_POOR_DBM, aLink->level);
+    if (level == aLink->level)
+    {
+        return false;
+    }
+    aLink->level    = level;
+    aLink->changes++;
+    return true;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+const char* link_level_name(
+    uint8_t     aLevel)
+{
+    static const char* const names[LINK_LEVEL_COUNT] = { "good", "fair", "poor" };
+
+    return (aLevel < LINK_LEVEL_COUNT) ? names[aLevel] : "?";
+}
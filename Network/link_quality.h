@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_LINK_QUALITY_H_
+#define NETWORK_LINK_QUALITY_H_
+
+#include "mbed.h"
+#include "CellularNetwork.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define LINK_QUALITY_UNKNOWN                (-32768)    /* Value the modem did not report */
+
+#define LINK_RSRP_FAIR_DBM                  (-100)      /* Levels from RSRP, or from RSSI when there is no RSRP */
+#define LINK_RSRP_POOR_DBM                  (-110)
+#define LINK_RSSI_FAIR_DBM                  (-85)
+#define LINK_RSSI_POOR_DBM                  (-95)
+#define LINK_HYSTERESIS_DB                  (3)         /* Above a threshold by this much to move up a level */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    LINK_LEVEL_GOOD,
+    LINK_LEVEL_FAIR,
+    LINK_LEVEL_POOR,
+    LINK_LEVEL_COUNT,
+} LinkLevel_e;
+
+typedef struct
+{
+    int16_t     rssiDbm;            /* LINK_QUALITY_UNKNOWN when not reported */
+    int16_t     rsrpDbm;
+    int16_t     rsrqDb;
+} LinkSample_t;
+
+/** Signal quality of the cellular link, sampled every periodMs, and the coverage level it puts
+ * the device in.
+ *
+ * RSSI comes from AT+CSQ, RSRP and RSRQ from AT+CESQ; the modems this runs on report no SINR
+ * through the standard commands. The level follows RSRP, smoothed over about two samples so a
+ * single fade does not change it, and needs LINK_HYSTERESIS_DB more than a threshold to move up.
+ * RSSI stands in for RSRP while the modem reports none.
+ */
+typedef struct
+{
+    CellularNetwork*    network;        /* NULL: only fed through link_quality_update() */
+    uint32_t            periodMs;       /* 0: never sampled */
+    uint32_t            lastMs;
+    LinkSample_t        last;
+    bool                byRsrp;         /* The smoothed metric is RSRP, otherwise RSSI */
+    int32_t             metric16;       /* Smoothed metric in 1/16 dB, valid once samples > 0 */
+    uint8_t             level;          /* LinkLevel_e */
+
+    uint32_t            samples;
+    uint32_t            failures;       /* Samples the modem did not answer */
+    uint32_t            changes;        /* Level changes */
+} LinkQuality_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void link_quality_init(
+    LinkQuality_t*      aLink,
+    CellularNetwork*    aNetwork,
+    uint32_t            aPeriodMs);
+
+/** Samples the modem when periodMs has passed since the last sample, which takes two AT
+ * commands, so it belongs off the sampling path.
+ *
+ * @return true when the level changed.
+ */
+bool link_quality_poll(
+    LinkQuality_t*  aLink,
+    uint32_t        aNowMs);
+
+/** Takes one sample, from the modem or a recorded trace.
+ *
+ * @return true when the level changed.
+ */
+bool link_quality_update(
+    LinkQuality_t*      aLink,
+    const LinkSample_t* aSample);
+
+const char* link_level_name(
+    uint8_t     aLevel);
+
+#endif /* NETWORK_LINK_QUALITY_H_ */
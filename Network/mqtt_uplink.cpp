@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "mqtt_uplink.h"
+#include "MQTTTimer.h"
+#include "MQTTClient.h"
+#include "platform_clock.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define MQTT_KEY_MAX                (32)
+#define MQTT_TOPIC_MAX              (112)       /* Cayenne user name and client ID are 36 character UUIDs */
+#define MQTT_PAYLOAD_MAX            (48)
+#define MQTT_POLL_MS                (10)        /* Time given to the broker per mqtt_uplink_poll() */
+#define MQTT_VERSION_3_1            (3)         /* As the Cayenne client connects */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* The network the Paho client reads and writes through, a TCP socket that counts bytes */
+class MqttSocket
+{
+public:
+    int read(unsigned char* aBuf, int aLen, int aTimeoutMs);
+    int write(unsigned char* aBuf, int aLen, int aTimeoutMs);
+
+    TCPSocket           socket;
+    MqttUplinkStats_t*  stats;
+};
+
+typedef MQTT::Client<MqttSocket, MQTTTimer, MQTT_UPLINK_PACKET_MAX, 0> MqttClient_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static MqttSocket       mqttSocket;
+static MqttClient_t     mqttClient(mqttSocket, MQTT_UPLINK_COMMAND_TIMEOUT_MS);
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Up to aLen bytes, fewer when aTimeoutMs passes first, -1 once the connection is gone */
+int MqttSocket::read(
+    unsigned char*  aBuf,
+    int             aLen,
+    int             aTimeoutMs)
+{
+    int     got     = 0;
+    int     result;
+
+    socket.set_timeout((aTimeoutMs > 0) ? aTimeoutMs : 0);
+    while (got < aLen)
+    {
+        result  = socket.recv(aBuf + got, aLen - got);
+        if (NSAPI_ERROR_WOULD_BLOCK == result)
+        {
+            break;
+        }
+        if (result <= 0)
+        {
+            return -1;
+        }
+        got    += result;
+    }
+    stats->bytesRx += got;
+    return got;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int MqttSocket::write(
+    unsigned char*  aBuf,
+    int             aLen,
+    int             aTimeoutMs)
+{
+    int     sent    = 0;
+    int     result;
+
+    socket.set_timeout((aTimeoutMs > 0) ? aTimeoutMs : 0);
+    while (sent < aLen)
+    {
+        result  = socket.send(aBuf + sent, aLen - sent);
+        if (result <= 0)
+        {
+            return -1;
+        }
+        sent   += result;
+    }
+    stats->bytesTx += sent;
+    return sent;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int session_open(
+    MqttUplink_t*   aUplink)
+{
+    MQTTPacket_connectData  options = MQTTPacket_connectData_initializer;
+    SocketAddress           addr;
+
+    if (0 != dns_cache_resolve(aUplink->dns, aUplink->host, &addr))
+    {
+        return -1;
+    }
+    addr.set_port(aUplink->port);
+
+    if (mqttSocket.socket.open(aUplink->iface) < 0)
+    {
+        LOG_WARN("Failed to open TCP Socket");
+        return -1;
+    }
+    mqttSocket.socket.set_timeout(MQTT_UPLINK_COMMAND_TIMEOUT_MS);
+    if (mqttSocket.socket.connect(addr) < 0)
+    {
+        LOG_WARN("Failed to connect with %s", aUplink->host);
+        mqttSocket.socket.close();
+        dns_cache_invalidate(aUplink->dns, aUplink->host);
+        return -1;
+    }
+
+    /* The broker keeps the session across connections to the same client ID */
+    options.MQTTVersion         = MQTT_VERSION_3_1;
+    options.clientID.cstring    = (char*) aUplink->clientId;
+    options.username.cstring    = (char*) aUplink->username;
+    options.password.cstring    = (char*) aUplink->password;
+    options.keepAliveInterval   = aUplink->keepAliveS;
+    options.cleansession        = 0;
+    if (MQTT::SUCCESS != mqttClient.connect(options))
+    {
+        LOG_WARN("MQTT connect to %s refused", aUplink->host);
+        mqttSocket.socket.close();
+        mqttClient.disconnect();
+        return -1;
+    }
+
+    aUplink->connected  = true;
+    aUplink->stats.connects++;
+    LOG_HI("MQTT session open, keep-alive %u s", (unsigned) aUplink->keepAliveS);
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Drops the session after an error, the socket goes first so the client does not wait on it */
+static void session_fail(
+    MqttUplink_t*   aUplink)
+{
+    aUplink->stats.failures++;
+    aUplink->connected  = false;
+    mqttSocket.socket.close();
+    mqttClient.disconnect();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static const MqttChannel_t* channel_find(
+    MqttUplink_t*   aUplink,
+    const char*     aKey)
+{
+    for (uint32_t i = 0; i < aUplink->mapCount; i++)
+    {
+        if (0 == strcmp(aUplink->map[i].key, aKey))
+        {
+            return &aUplink->map[i];
+        }
+    }
+    return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int publish_value(
+    MqttUplink_t*           aUplink,
+    const MqttChannel_t*    aChannel,
+    const char*             aValue,
+    int                     aValueLen)
+{
+    char            topic[MQTT_TOPIC_MAX];
+    char            payload[MQTT_PAYLOAD_MAX];
+    MQTT::Message   message;
+    uint32_t        startMs;
+    int             len;
+
+    snprintf(topic, sizeof(topic), "v1/%s/things/%s/data/%u", aUplink->username, aUplink->clientId, (unsigned) aChannel->channel);
+    len = snprintf(payload, sizeof(payload), "%s,%s=%.*s", aChannel->type, aChannel->unit, aValueLen, aValue);
+    if (len < 0 || len >= (int) sizeof(payload))
+    {
+        LOG_WARN("MQTT payload for %s too long", aChannel->key);
+        return -1;
+    }
+
+    message.qos         = aChannel->qos ? MQTT::QOS1 : MQTT::QOS0;
+    message.retained    = false;
+    message.dup         = false;
+    message.payload     = payload;
+    message.payloadlen  = len;
+
+    startMs = platform_now_ms();
+    if (MQTT::SUCCESS != mqttClient.publish(topic, message))
+    {
+        LOG_WARN("MQTT publish of %s failed", aChannel->key);
+        return -1;
+    }
+    aUplink->stats.publishes++;
+    if (aChannel->qos)
+    {
+        aUplink->stats.acked++;
+        aUplink->stats.lastAckMs    = platform_now_ms() - startMs;
+    }
+    return 0;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void mqtt_uplink_init(
+    MqttUplink_t*           aUplink,
+    NetworkInterface*       aIface,
+    DnsCache_t*             aDns,
+    const char*             aHost,
+    uint16_t                aPort,
+    const char*             aUsername,
+    const char*             aPassword,
+    const char*             aClientId,
+    uint16_t                aKeepAliveS,
+    const MqttChannel_t*    aMap,
+    uint32_t                aMapCount)
+{
+    aUplink->iface      = aIface;
+    aUplink->dns        = aDns;
+    aUplink->host       = aHost;
+    aUplink->port       = aPort;
+    aUplink->username   = aUsername;
+    aUplink->password   = aPassword;
+    aUplink->clientId   = aClientId;
+    aUplink->keepAliveS = aKeepAliveS;
+    aUplink->map        = aMap;
+    aUplink->mapCount   = aMapCount;
+    aUplink->connected  = false;
+    memset(&aUplink->stats, 0, sizeof(aUplink->stats));
+
+    mqttSocket.stats    = &aUplink->stats;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int mqtt_uplink_publish(
+    MqttUplink_t*   aUplink,
+    const char*     aReport)
+{
+    char                    key[MQTT_KEY_MAX];
+    const char*             pair    = aReport;
+    const char*             value;
+    const char*             end;
+    const MqttChannel_t*    channel;
+
+    if (false == aUplink->connected && 0 != session_open(aUplink))
+    {
+        aUplink->stats.failures++;
+        return -1;
+    }
+
+    while ('\0' != *pair)
+    {
+        end     = strchr(pair, '&');
+        end     = (NULL != end) ? end : pair + strlen(pair);
+        value   = (const char*) memchr(pair, '=', end - pair);
+        channel = NULL;
+        if (NULL != value && (value - pair) < MQTT_KEY_MAX)
+        {
+            memcpy(key, pair, value - pair);
+            key[value - pair]   = '\0';
+            channel = channel_find(aUplink, key);
+            value++;
+        }
+
+        if (NULL == channel)
+        {
+            aUplink->stats.unmapped++;
+        }
+        else if (0 != publish_value(aUplink, channel, value, end - value))
+        {
+            session_fail(aUplink);
+            return -1;
+        }
+        pair    = ('\0' != *end) ? end + 1 : end;
+    }
+
+    aUplink->stats.reports++;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void mqtt_uplink_poll(
+    MqttUplink_t*   aUplink)
+{
+    if (false == aUplink->connected)
+    {
+        return;
+    }
+
+    /* Reads anything from the broker and pings it once the keep-alive interval passed */
+    if (MQTT::FAILURE == mqttClient.yield(MQTT_POLL_MS) || false == mqttClient.isConnected())
+    {
+        LOG_WARN("MQTT session lost");
+        session_fail(aUplink);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void mqtt_uplink_close(
+    MqttUplink_t*   aUplink)
+{
+    if (aUplink->connected)
+    {
+        mqttClient.disconnect();
+        mqttSocket.socket.close();
+        aUplink->connected  = false;
+    }
+}
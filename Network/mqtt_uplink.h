@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_MQTT_UPLINK_H_
+#define NETWORK_MQTT_UPLINK_H_
+
+#include "mbed.h"
+#include "dns_cache.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define MQTT_UPLINK_PORT                    (1883)
+#define MQTT_UPLINK_PACKET_MAX              (192)       /* Largest PUBLISH, topic and payload together */
+#define MQTT_UPLINK_COMMAND_TIMEOUT_MS      (10000)     /* CONNACK and PUBACK */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Maps a report key to a Cayenne channel. The value is published to the channel data topic as
+ * "type,unit=value", type and unit as listed in the Cayenne data types.
+ */
+typedef struct
+{
+    const char* key;
+    uint16_t    channel;
+    const char* type;
+    const char* unit;
+    uint8_t     qos;                /* 0: fire and forget, 1: acknowledged by the broker */
+} MqttChannel_t;
+
+typedef struct
+{
+    uint32_t    connects;           /* Sessions opened */
+    uint32_t    reports;            /* Reports published in full */
+    uint32_t    publishes;
+    uint32_t    acked;              /* QoS 1 publishes acknowledged */
+    uint32_t    unmapped;           /* Report keys with no channel, not published */
+    uint32_t    failures;
+    uint32_t    bytesTx;
+    uint32_t    bytesRx;
+    uint32_t    lastAckMs;          /* PUBLISH to PUBACK of the last QoS 1 publish */
+} MqttUplinkStats_t;
+
+/** Publishes reports to a Cayenne MQTT broker over one persistent session.
+ *
+ * The session is opened on the first report with a fixed client ID and clean session off, and
+ * stays open across reports; mqtt_uplink_poll() keeps it alive by pinging the broker when nothing was sent for
+ * keepAliveS, which has to stay below the idle timeout of the carrier NAT. Any failure closes the
+ * session, the next report opens a new one. The MQTT client is the Paho client bundled with
+ * Cayenne-MQTT-mbed and holds a reference to the socket, so there is one instance.
+ */
+typedef struct
+{
+    NetworkInterface*       iface;
+    DnsCache_t*             dns;
+    const char*             host;
+    uint16_t                port;
+    const char*             username;
+    const char*             password;
+    const char*             clientId;
+    uint16_t                keepAliveS;
+    const MqttChannel_t*    map;
+    uint32_t                mapCount;
+
+    bool                    connected;
+    MqttUplinkStats_t       stats;
+} MqttUplink_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void mqtt_uplink_init(
+    MqttUplink_t*           aUplink,
+    NetworkInterface*       aIface,
+    DnsCache_t*             aDns,
+    const char*             aHost,
+    uint16_t                aPort,
+    const char*             aUsername,
+    const char*             aPassword,
+    const char*             aClientId,
+    uint16_t                aKeepAliveS,
+    const MqttChannel_t*    aMap,
+    uint32_t                aMapCount);
+
+/** Publishes each KEY=VALUE pair of a report (pairs separated by '&') to the channel aMap gives
+ * for KEY, with the QoS of that channel. Keys missing from aMap are skipped.
+ *
+ * @return 0 when all pairs were published, QoS 1 ones acknowledged, -1 otherwise. Pairs before
+ *         the failing one were published and will be published again if the report is resent.
+ */
+int mqtt_uplink_publish(
+    MqttUplink_t*           aUplink,
+    const char*             aReport);
+
+/** Handles traffic from the broker and sends a ping when the keep-alive interval passed without
+ * a packet, to be called once per loop. Does nothing while no session is open.
+ */
+void mqtt_uplink_poll(
+    MqttUplink_t*           aUplink);
+
+void mqtt_uplink_close(
+    MqttUplink_t*           aUplink);
+
+#endif /* NETWORK_MQTT_UPLINK_H_ */
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "report_codec.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define LPP_DIGITAL_INPUT           (0)     /* 1 byte */
+#define LPP_ANALOG_INPUT            (2)     /* 2 bytes signed, 0.01 */
+#define LPP_ILLUMINANCE             (101)   /* 2 bytes unsigned, 1 lux */
+#define LPP_TEMPERATURE             (103)   /* 2 bytes signed, 0.1 degC */
+#define LPP_HUMIDITY                (104)   /* 1 byte unsigned, 0.5 % */
+#define LPP_BAROMETER               (115)   /* 2 bytes unsigned, 0.1 hPa */
+#define LPP_VOLTAGE                 (116)   /* 2 bytes unsigned, 0.01 V */
+#define LPP_DISTANCE                (130)   /* 4 bytes unsigned, 0.001 m */
+#define LPP_DIRECTION               (132)   /* 2 bytes unsigned, 1 deg */
+
+#define CBOR_MAJOR_UINT             (0x00)
+#define CBOR_MAJOR_NINT             (0x20)
+#define CBOR_MAJOR_MAP              (0xA0)
+#define CBOR_ARG_DIRECT_MAX         (23)    /* Larger arguments follow the initial byte */
+
+#define REPORT_KEY_MAX              (32)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static int32_t clamp(
+    int32_t     aValue,
+    int32_t     aMin,
+    int32_t     aMax)
+{
+    return (aValue < aMin) ? aMin : ((aValue > aMax) ? aMax : aValue);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int lpp_begin(
+    ReportEncoder_t*    aEncoder)
+{
+    (void) aEncoder;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int lpp_add(
+    ReportEncoder_t*        aEncoder,
+    const ReportChannel_t*  aChannel,
+    int32_t                 aValue)
+{
+    uint8_t*    out;
+    uint8_t     type;
+    uint32_t    bytes;
+    int32_t     data;
+
+    switch (aChannel->kind)
+    {
+        case REPORT_KIND_DIGITAL:
+            type    = LPP_DIGITAL_INPUT;
+            bytes   = 1;
+            data    = clamp(aValue, 0, 255);
+            break;
+        case REPORT_KIND_ANALOG:
+            type    = LPP_ANALOG_INPUT;
+            bytes   = 2;
+            data    = clamp(aValue, -327, 327) * 100;
+            break;
+        case REPORT_KIND_ANALOG_MILLI:
+            type    = LPP_ANALOG_INPUT;
+            bytes   = 2;
+            data    = clamp(aValue / 10, -32768, 32767);
+            break;
+        case REPORT_KIND_TEMPERATURE:
+            type    = LPP_TEMPERATURE;
+            bytes   = 2;
+            data    = clamp(aValue, -3276, 3276) * 10;
+            break;
+        case REPORT_KIND_HUMIDITY:
+            type    = LPP_HUMIDITY;
+            bytes   = 1;
+            data    = clamp(aValue, 0, 127) * 2;
+            break;
+        case REPORT_KIND_PRESSURE:
+            type    = LPP_BAROMETER;
+            bytes   = 2;
+            data    = clamp(aValue, 0, 6553) * 10;
+            break;
+        case REPORT_KIND_ILLUMINANCE:
+            type    = LPP_ILLUMINANCE;
+            bytes   = 2;
+            data    = clamp(aValue, 0, 65535);
+            break;
+        case REPORT_KIND_VOLTAGE_MV:
+            type    = LPP_VOLTAGE;
+            bytes   = 2;
+            data    = clamp(aValue / 10, 0, 65535);
+            break;
+        case REPORT_KIND_DISTANCE_CM:
+            type    = LPP_DISTANCE;
+            bytes   = 4;
+            data    = clamp(aValue, 0, INT32_MAX / 10) * 10;
+            break;
+        case REPORT_KIND_DIRECTION:
+            type    = LPP_DIRECTION;
+            bytes   = 2;
+            data    = clamp(aValue, 0, 65535);
+            break;
+        default:
+            return -1;
+    }
+
+    if (aEncoder->used + 2 + bytes > aEncoder->size)
+    {
+        return -1;
+    }
+    out     = aEncoder->buf + aEncoder->used;
+    *out++  = aChannel->channel;
+    *out++  = type;
+    for (uint32_t i = bytes; i > 0; i--)
+    {
+        *out++  = (uint8_t) ((uint32_t) data >> (8 * (i - 1)));
+    }
+    aEncoder->used += 2 + bytes;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int lpp_end(
+    ReportEncoder_t*    aEncoder)
+{
+    return aEncoder->used;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Initial byte and argument of a CBOR data item, bytes written or 0 when there is no room */
+static uint32_t cbor_head(
+    uint8_t*    aBuf,
+    uint32_t    aRoom,
+    uint8_t     aMajor,
+    uint32_t    aArg)
+{
+    uint32_t    bytes   = (aArg <= CBOR_ARG_DIRECT_MAX) ? 0 : ((aArg <= 0xFF) ? 1 : ((aArg <= 0xFFFF) ? 2 : 4));
+
+    if (1 + bytes > aRoom)
+    {
+        return 0;
+    }
+    /* Argument lengths 1, 2 and 4 are coded as 24, 25 and 26 */
+    *aBuf++ = aMajor | ((0 == bytes) ? aArg : (23 + ((bytes < 4) ? bytes : 3)));
+    for (uint32_t i = bytes; i > 0; i--)
+    {
+        *aBuf++ = (uint8_t) (aArg >> (8 * (i - 1)));
+    }
+    return 1 + bytes;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int cbor_begin(
+    ReportEncoder_t*    aEncoder)
+{
+    /* Room for the map head, filled in once the number of values is known */
+    if (aEncoder->size < 1)
+    {
+        return -1;
+    }
+    aEncoder->used  = 1;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int cbor_add(
+    ReportEncoder_t*        aEncoder,
+    const ReportChannel_t*  aChannel,
+    int32_t                 aValue)
+{
+    uint8_t*    out     = aEncoder->buf + aEncoder->used;
+    uint32_t    room    = aEncoder->size - aEncoder->used;
+    uint32_t    key;
+    uint32_t    value;
+
+    key     = cbor_head(out, room, CBOR_MAJOR_UINT, aChannel->channel);
+    value   = (0 == key) ? 0 :
+              ((aValue >= 0) ? cbor_head(out + key, room - key, CBOR_MAJOR_UINT, (uint32_t) aValue)
+                             : cbor_head(out + key, room - key, CBOR_MAJOR_NINT, (uint32_t) (-1 - aValue)));
+    if (0 == value)
+    {
+        return -1;
+    }
+    aEncoder->used += key + value;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int cbor_end(
+    ReportEncoder_t*    aEncoder)
+{
+    uint8_t     head[3];
+    uint32_t    bytes   = cbor_head(head, sizeof(head), CBOR_MAJOR_MAP, aEncoder->count);
+
+    /* One byte was reserved, a longer head moves the values up */
+    if (aEncoder->used - 1 + bytes > aEncoder->size)
+    {
+        return -1;
+    }
+    memmove(aEncoder->buf + bytes, aEncoder->buf + 1, aEncoder->used - 1);
+    memcpy(aEncoder->buf, head, bytes);
+    aEncoder->used += bytes - 1;
+    return aEncoder->used;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+const ReportFormat_t reportFormatLpp =
+{
+    "lpp", 42 /* application/octet-stream */, lpp_begin, lpp_add, lpp_end
+};
+
+const ReportFormat_t reportFormatCbor =
+{
+    "cbor", 60 /* application/cbor */, cbor_begin, cbor_add, cbor_end
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int report_encoder_begin(
+    ReportEncoder_t*        aEncoder,
+    const ReportFormat_t*   aFormat,
+    uint8_t*                aBuf,
+    uint32_t                aSize)
+{
+    aEncoder->format    = aFormat;
+    aEncoder->buf       = aBuf;
+    aEncoder->size      = aSize;
+    aEncoder->used      = 0;
+    aEncoder->count     = 0;
+    aEncoder->overflow  = (0 != aFormat->begin(aEncoder));
+    return aEncoder->overflow ? -1 : 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int report_encoder_add(
+    ReportEncoder_t*        aEncoder,
+    const ReportChannel_t*  aChannel,
+    int32_t                 aValue)
+{
+    if (0 != aEncoder->format->add(aEncoder, aChannel, aValue))
+    {
+        aEncoder->overflow  = true;
+        return -1;
+    }
+    aEncoder->count++;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int report_encoder_end(
+    ReportEncoder_t*        aEncoder)
+{
+    if (aEncoder->overflow)
+    {
+        return -1;
+    }
+    return aEncoder->format->end(aEncoder);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int report_encode_text(
+    const ReportFormat_t*   aFormat,
+    const ReportChannel_t*  aMap,
+    uint32_t                aMapCount,
+    const char*             aReport,
+    uint8_t*                aBuf,
+    uint32_t                aSize)
+{
+    ReportEncoder_t encoder;
+    char            key[REPORT_KEY_MAX];
+    const char*     pair    = aReport;
+    const char*     value;
+    const char*     end;
+
+    report_encoder_begin(&encoder, aFormat, aBuf, aSize);
+    while ('\0' != *pair)
+    {
+        end     = strchr(pair, '&');
+        end     = (NULL != end) ? end : pair + strlen(pair);
+        value   = (const char*) memchr(pair, '=', end - pair);
+        if (NULL != value && (value - pair) < REPORT_KEY_MAX)
+        {
+            memcpy(key, pair, value - pair);
+            key[value - pair]   = '\0';
+            for (uint32_t i = 0; i < aMapCount; i++)
+            {
+                if (0 == strcmp(aMap[i].key, key))
+                {
+                    report_encoder_add(&encoder, &aMap[i], strtol(value + 1, NULL, 10));
+                    break;
+                }
+            }
+        }
+        pair    = ('\0' != *end) ? end + 1 : end;
+    }
+    return report_encoder_end(&encoder);
+}
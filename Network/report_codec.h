@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_REPORT_CODEC_H_
+#define NETWORK_REPORT_CODEC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** What a channel value is. Binary formats that carry units (Cayenne LPP) use it to pick the data
+ * type and its resolution; formats that carry plain integers (CBOR) ignore it.
+ */
+typedef enum
+{
+    REPORT_KIND_DIGITAL,            /* 0..255, LPP digital input */
+    REPORT_KIND_ANALOG,             /* Plain number, LPP analog input, saturates at +-327.67 */
+    REPORT_KIND_ANALOG_MILLI,       /* Thousandths, LPP analog input */
+    REPORT_KIND_TEMPERATURE,        /* degC */
+    REPORT_KIND_HUMIDITY,           /* %RH */
+    REPORT_KIND_PRESSURE,           /* hPa */
+    REPORT_KIND_ILLUMINANCE,        /* lux */
+    REPORT_KIND_VOLTAGE_MV,         /* mV */
+    REPORT_KIND_DISTANCE_CM,        /* cm */
+    REPORT_KIND_DIRECTION,          /* Degrees, 0..359 */
+} ReportKind_e;
+
+/** Maps a text report key to a channel number and the kind of its value.
+ */
+typedef struct
+{
+    const char* key;
+    uint8_t     channel;
+    uint8_t     kind;               /* ReportKind_e */
+} ReportChannel_t;
+
+typedef struct ReportEncoder_s ReportEncoder_t;
+
+/** One binary report format, the encoder calls begin once, add per value and end once.
+ */
+typedef struct
+{
+    const char* name;
+    uint16_t    coapFormat;         /* CoAP Content-Format number */
+    int         (*begin)(ReportEncoder_t* aEncoder);
+    int         (*add)(ReportEncoder_t* aEncoder, const ReportChannel_t* aChannel, int32_t aValue);
+    int         (*end)(ReportEncoder_t* aEncoder);
+} ReportFormat_t;
+
+/** Writes one report into a caller supplied buffer, nothing is allocated. A value that does not
+ * fit leaves the report as it was and sets overflow.
+ */
+struct ReportEncoder_s
+{
+    const ReportFormat_t*   format;
+    uint8_t*                buf;
+    uint32_t                size;
+    uint32_t                used;
+    uint32_t                count;
+    bool                    overflow;
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   V A R I A B L E   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Cayenne Low Power Payload: per value a channel byte, a type byte and 1..4 bytes of data, big
+ * endian. Types beyond the original Cayenne set (voltage, distance, direction) are the extended
+ * ones most LPP decoders know.
+ */
+extern const ReportFormat_t reportFormatLpp;
+
+/** CBOR (RFC 8949) map of channel number to integer value, in the units of the text report.
+ */
+extern const ReportFormat_t reportFormatCbor;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int report_encoder_begin(
+    ReportEncoder_t*        aEncoder,
+    const ReportFormat_t*   aFormat,
+    uint8_t*                aBuf,
+    uint32_t                aSize);
+
+/** @return 0, -1 when the value does not fit.
+ */
+int report_encoder_add(
+    ReportEncoder_t*        aEncoder,
+    const ReportChannel_t*  aChannel,
+    int32_t                 aValue);
+
+/** @return Length of the report, -1 when a value did not fit.
+ */
+int report_encoder_end(
+    ReportEncoder_t*        aEncoder);
+
+/** Encodes a "KEY=value&..." text report, as sent to dweet, in aFormat. Keys missing from aMap
+ * are skipped.
+ *
+ * @return Length of the report, -1 when it does not fit in aSize.
+ */
+int report_encode_text(
+    const ReportFormat_t*   aFormat,
+    const ReportChannel_t*  aMap,
+    uint32_t                aMapCount,
+    const char*             aReport,
+    uint8_t*                aBuf,
+    uint32_t                aSize);
+
+#endif /* NETWORK_REPORT_CODEC_H_ */
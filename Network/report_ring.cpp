@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "mbed.h"
+#include "report_ring.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Copies a report into the slot at head and publishes it, -1 when the ring is full */
+static int enqueue(
+    ReportRing_t*           aRing,
+    const char*             aReport,
+    const ReportRingSlot_t* aSlot)
+{
+    uint32_t    head    = aRing->head;
+    uint32_t    index   = head & (aRing->slotCount - 1);
+
+    if (head - core_util_atomic_load_u32(&aRing->tail) >= aRing->slotCount)
+    {
+        return -1;
+    }
+    memcpy(aRing->data + index * aRing->slotSize, aReport, aSlot->len + 1);
+    aRing->slots[index] = *aSlot;
+    /* The report is complete before the consumer can see it */
+    core_util_atomic_store_u32(&aRing->head, head + 1);
+    aRing->pushed++;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Sets aKey to aValue in a "KEY=value&..." report, appending the pair when the key is new */
+static int merge_pair(
+    char*       aDst,
+    uint32_t    aSize,
+    const char* aKey,
+    uint32_t    aKeyLen,
+    const char* aValue,
+    uint32_t    aValueLen)
+{
+    uint32_t    len     = strlen(aDst);
+    char*       pair    = aDst;
+    char*       value;
+    char*       end;
+
+    while ('\0' != *pair)
+    {
+        end     = strchr(pair, '&');
+        end     = (NULL != end) ? end : aDst + len;
+        if (0 == strncmp(pair, aKey, aKeyLen) && '=' == pair[aKeyLen])
+        {
+            value   = pair + aKeyLen + 1;
+            if (len - (end - value) + aValueLen >= aSize)
+            {
+                return -1;
+            }
+            memmove(value + aValueLen, end, aDst + len + 1 - end);
+            memcpy(value, aValue, aValueLen);
+            return 0;
+        }
+        pair    = ('\0' != *end) ? end + 1 : end;
+    }
+
+    if (len + (len > 0) + aKeyLen + 1 + aValueLen >= aSize)
+    {
+        return -1;
+    }
+    if (len > 0)
+    {
+        aDst[len++] = '&';
+    }
+    memcpy(aDst + len, aKey, aKeyLen);
+    aDst[len + aKeyLen] = '=';
+    memcpy(aDst + len + aKeyLen + 1, aValue, aValueLen);
+    aDst[len + aKeyLen + 1 + aValueLen] = '\0';
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Merges every pair of aReport into the staging report, it is left as it was when one does not fit */
+static int coalesce(
+    ReportRing_t*   aRing,
+    const char*     aReport)
+{
+    const char* pair    = aReport;
+    const char* value;
+    const char* end;
+    char*       merged  = aRing->scratch;
+
+    /* Merged into a copy, a pair that does not fit would otherwise leave the report half edited */
+    strcpy(merged, aRing->staging);
+    while ('\0' != *pair)
+    {
+        end     = strchr(pair, '&');
+        end     = (NULL != end) ? end : pair + strlen(pair);
+        value   = (const char*) memchr(pair, '=', end - pair);
+        if (NULL != value &&
+            0 != merge_pair(merged, aRing->slotSize, pair, value - pair, value + 1, end - value - 1))
+        {
+            return -1;
+        }
+        pair    = ('\0' != *end) ? end + 1 : end;
+    }
+    aRing->scratch          = aRing->staging;
+    aRing->staging          = merged;
+    aRing->stagingSlot.len  = strlen(merged);
+    return 0;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void report_ring_init(
+    ReportRing_t*       aRing,
+    ReportRingSlot_t*   aSlots,
+    char*               aData,
+    uint32_t            aSlotSize,
+    uint32_t            aSlotCount,
+    ReportRingPolicy_e  aPolicy,
+    char*               aStaging)
+{
+    memset(aRing, 0, sizeof(*aRing));
+    aRing->slots        = aSlots;
+    aRing->data         = aData;
+    aRing->slotSize     = aSlotSize;
+    aRing->slotCount    = aSlotCount;
+    aRing->policy       = aPolicy;
+    aRing->staging      = aStaging;
+    if (NULL != aStaging)
+    {
+        aRing->scratch  = aStaging + aSlotSize;
+        aStaging[0]     = '\0';
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int report_ring_push(
+    ReportRing_t*       aRing,
+    const char*         aReport,
+    bool                aUrgent,
+    uint32_t            aTimeMs)
+{
+    ReportRingSlot_t    slot;
+    uint32_t            tail;
+
+    slot.len    = strlen(aReport);
+    slot.timeMs = aTimeMs;
+    slot.urgent = aUrgent;
+    if (slot.len >= aRing->slotSize)
+    {
+        return -1;
+    }
+
+    report_ring_flush(aRing);
+    if (REPORT_RING_COALESCE == aRing->policy && '\0' != aRing->staging[0])
+    {
+        /* Still no room, the held-back report takes the new values */
+        if (0 != coalesce(aRing, aReport))
+        {
+            aRing->dropped++;
+            return 1;
+        }
+        aRing->stagingSlot.urgent  |= aUrgent;
+        aRing->coalesced++;
+        return 1;
+    }
+
+    if (0 == enqueue(aRing, aReport, &slot))
+    {
+        return 0;
+    }
+
+    if (REPORT_RING_COALESCE == aRing->policy)
+    {
+        memcpy(aRing->staging, aReport, slot.len + 1);
+        aRing->stagingSlot  = slot;
+        aRing->coalesced++;
+        return 1;
+    }
+
+    /* The consumer may take the oldest report at the same time, then there is room anyway */
+    tail    = core_util_atomic_load_u32(&aRing->tail);
+    if (aRing->head - tail >= aRing->slotCount &&
+        core_util_atomic_cas_u32(&aRing->tail, &tail, tail + 1))
+    {
+        aRing->dropped++;
+    }
+    enqueue(aRing, aReport, &slot);
+    return 1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void report_ring_flush(
+    ReportRing_t*       aRing)
+{
+    if (NULL != aRing->staging && '\0' != aRing->staging[0] &&
+        0 == enqueue(aRing, aRing->staging, &aRing->stagingSlot))
+    {
+        aRing->staging[0]   = '\0';
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int report_ring_pop(
+    ReportRing_t*       aRing,
+    char*               aBuf,
+    uint32_t            aBufSize,
+    bool*               aUrgent,
+    uint32_t*           aTimeMs)
+{
+    ReportRingSlot_t    slot;
+    uint32_t            tail;
+    uint32_t            index;
+
+    while (true)
+    {
+        tail    = core_util_atomic_load_u32(&aRing->tail);
+        if (tail == core_util_atomic_load_u32(&aRing->head))
+        {
+            return -1;
+        }
+        index   = tail & (aRing->slotCount - 1);
+        slot    = aRing->slots[index];
+        /* The length may be torn by a drop, the CAS below then throws the copy away */
+        slot.len    = (slot.len < aBufSize) ? slot.len : aBufSize - 1;
+        slot.len    = (slot.len < aRing->slotSize) ? slot.len : aRing->slotSize - 1;
+        memcpy(aBuf, aRing->data + index * aRing->slotSize, slot.len);
+        aBuf[slot.len]  = '\0';
+
+        if (core_util_atomic_cas_u32(&aRing->tail, &tail, tail + 1))
+        {
+            aRing->popped++;
+            *aUrgent    = slot.urgent;
+            *aTimeMs    = slot.timeMs;
+            return slot.len;
+        }
+        aRing->discarded++;
+    }
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_REPORT_RING_H_
+#define NETWORK_REPORT_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    REPORT_RING_DROP_OLDEST,        /* A full ring drops its oldest report */
+    REPORT_RING_COALESCE,           /* A full ring merges reports per key into a held-back report */
+} ReportRingPolicy_e;
+
+typedef struct
+{
+    uint32_t    len;
+    uint32_t    timeMs;             /* Time stamp given by the producer, returned with the report */
+    bool        urgent;
+} ReportRingSlot_t;
+
+/** Bounded single-producer single-consumer queue of text reports, without locks.
+ *
+ * The producer owns head and the consumer owns tail, except that a full ring with
+ * REPORT_RING_DROP_OLDEST lets the producer move tail past the oldest report. The consumer
+ * therefore copies a report out first and only keeps the copy when it can still move tail
+ * from where it read it; a report dropped and overwritten while it was being copied is
+ * discarded. With REPORT_RING_COALESCE the producer keeps reports that find the ring full in a
+ * staging buffer of its own, where a later value replaces an earlier one for the same key, and
+ * pushes it ahead of the next report once there is room. slotCount has to be a power of two.
+ */
+typedef struct
+{
+    ReportRingSlot_t*   slots;
+    char*               data;           /* slotCount reports of slotSize bytes */
+    uint32_t            slotSize;
+    uint32_t            slotCount;
+    uint8_t             policy;         /* ReportRingPolicy_e */
+    char*               staging;        /* slotSize bytes, REPORT_RING_COALESCE only */
+    char*               scratch;        /* slotSize bytes the staging report is merged in, swapped with it */
+    ReportRingSlot_t    stagingSlot;
+
+    volatile uint32_t   head;           /* Reports pushed */
+    volatile uint32_t   tail;           /* Reports popped or dropped */
+
+    uint32_t            pushed;         /* Producer side */
+    uint32_t            dropped;
+    uint32_t            coalesced;
+    uint32_t            popped;         /* Consumer side */
+    uint32_t            discarded;      /* Copies lost to a drop while being read */
+} ReportRing_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** aStaging is 2 * aSlotSize bytes with REPORT_RING_COALESCE, NULL otherwise.
+ */
+void report_ring_init(
+    ReportRing_t*       aRing,
+    ReportRingSlot_t*   aSlots,
+    char*               aData,
+    uint32_t            aSlotSize,
+    uint32_t            aSlotCount,
+    ReportRingPolicy_e  aPolicy,
+    char*               aStaging);
+
+/** Producer side. Queues a copy of aReport, first the staging report if one is waiting.
+ *
+ * @return 0 when queued, 1 when the oldest report was dropped to make room or aReport went into
+ *         the staging report, -1 when aReport is longer than a slot.
+ */
+int report_ring_push(
+    ReportRing_t*       aRing,
+    const char*         aReport,
+    bool                aUrgent,
+    uint32_t            aTimeMs);
+
+/** Producer side. Queues the staging report if one is waiting and there is room, to be called
+ * when there is nothing to push.
+ */
+void report_ring_flush(
+    ReportRing_t*       aRing);
+
+/** Consumer side. Copies the oldest report into aBuf, NUL terminated, and removes it.
+ *
+ * @return Report length, -1 when the ring is empty.
+ */
+int report_ring_pop(
+    ReportRing_t*       aRing,
+    char*               aBuf,
+    uint32_t            aBufSize,
+    bool*               aUrgent,
+    uint32_t*           aTimeMs);
+
+#endif /* NETWORK_REPORT_RING_H_ */
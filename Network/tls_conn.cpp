@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "tls_conn.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/platform_util.h"
+#include "platform_clock.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define TLS_DRBG_PERSONAL           "manhole-uplink"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* mbedTLS output, counted on the way to the socket */
+static int bio_send(
+    void*                   aCtx,
+    const unsigned char*    aBuf,
+    size_t                  aLen)
+{
+    TlsConn_t*              tls     = (TlsConn_t*) aCtx;
+    nsapi_size_or_error_t   result  = tls->socket->send(aBuf, aLen);
+
+    if (NSAPI_ERROR_WOULD_BLOCK == result)
+    {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    if (result < 0)
+    {
+        return MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+    tls->stats.bytesTx += result;
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* mbedTLS input, 0 is the end of the connection */
+static int bio_recv(
+    void*           aCtx,
+    unsigned char*  aBuf,
+    size_t          aLen)
+{
+    TlsConn_t*              tls     = (TlsConn_t*) aCtx;
+    nsapi_size_or_error_t   result  = tls->socket->recv(aBuf, aLen);
+
+    if (NSAPI_ERROR_WOULD_BLOCK == result)
+    {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (result < 0)
+    {
+        return MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+    tls->stats.bytesRx += result;
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void session_drop(
+    TlsConn_t*  aTls)
+{
+    mbedtls_ssl_session_free(&aTls->session);
+    mbedtls_ssl_session_init(&aTls->session);
+    aTls->haveSession   = false;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int tls_conn_init(
+    TlsConn_t*      aTls,
+    const char*     aHost,
+    const char*     aCaPem)
+{
+    int     result;
+
+    aTls->host          = aHost;
+    aTls->socket        = NULL;
+    aTls->ready         = false;
+    aTls->open          = false;
+    aTls->haveSession   = false;
+    memset(&aTls->stats, 0, sizeof(aTls->stats));
+
+    mbedtls_entropy_init(&aTls->entropy);
+    mbedtls_ctr_drbg_init(&aTls->drbg);
+    mbedtls_x509_crt_init(&aTls->ca);
+    mbedtls_ssl_config_init(&aTls->conf);
+    mbedtls_ssl_init(&aTls->ssl);
+    mbedtls_ssl_session_init(&aTls->session);
+
+    result  = mbedtls_ctr_drbg_seed(&aTls->drbg, mbedtls_entropy_func, &aTls->entropy,
+                                    (const unsigned char*) TLS_DRBG_PERSONAL, sizeof(TLS_DRBG_PERSONAL) - 1);
+    if (0 == result)
+    {
+        /* The PEM parser wants the terminating NUL in the length. A positive result is the
+         * number of certificates that did not parse, the others are used. */
+        result  = mbedtls_x509_crt_parse(&aTls->ca, (const unsigned char*) aCaPem, strlen(aCaPem) + 1);
+        if (result > 0)
+        {
+            LOG_WARN("%d CA certificates not parsed", result);
+            result  = 0;
+        }
+    }
+    if (0 == result)
+    {
+        result  = mbedtls_ssl_config_defaults(&aTls->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                              MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (0 == result)
+    {
+        mbedtls_ssl_conf_authmode(&aTls->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+        mbedtls_ssl_conf_ca_chain(&aTls->conf, &aTls->ca, NULL);
+        mbedtls_ssl_conf_rng(&aTls->conf, mbedtls_ctr_drbg_random, &aTls->drbg);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        /* Resumption without server state, it survives server restarts and load balancers */
+        mbedtls_ssl_conf_session_tickets(&aTls->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+        result  = mbedtls_ssl_setup(&aTls->ssl, &aTls->conf);
+    }
+    if (0 == result)
+    {
+        result  = mbedtls_ssl_set_hostname(&aTls->ssl, aHost);
+    }
+    if (0 != result)
+    {
+        LOG_ERROR("TLS set-up failed, error = -0x%x", (unsigned) -result);
+        return -1;
+    }
+    mbedtls_ssl_set_bio(&aTls->ssl, aTls, bio_send, bio_recv, NULL);
+
+    aTls->ready = true;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int tls_conn_start(
+    TlsConn_t*      aTls,
+    TCPSocket*      aSocket)
+{
+    uint32_t        startMs     = platform_now_ms();
+    uint32_t        startBytes  = aTls->stats.bytesTx + aTls->stats.bytesRx;
+    unsigned char   offeredMaster[sizeof(aTls->session.master)];
+    bool            offered     = false;
+    bool            resumed;
+    int             result;
+
+    if (false == aTls->ready)
+    {
+        return -1;
+    }
+    aTls->socket    = aSocket;
+    mbedtls_ssl_session_reset(&aTls->ssl);
+
+    if (aTls->haveSession && 0 == mbedtls_ssl_set_session(&aTls->ssl, &aTls->session))
+    {
+        /* Only a resumed session keeps its master secret, the session ID does not tell as the
+         * client makes up a new one when it offers a ticket */
+        memcpy(offeredMaster, aTls->session.master, sizeof(offeredMaster));
+        offered     = true;
+    }
+
+    /* A receive that would block ran into the socket timeout */
+    do
+    {
+        result  = mbedtls_ssl_handshake(&aTls->ssl);
+    } while (MBEDTLS_ERR_SSL_WANT_WRITE == result);
+
+    if (0 != result)
+    {
+        aTls->stats.failures++;
+        LOG_WARN("TLS handshake with %s failed, error = -0x%x, verify = 0x%x", aTls->host, (unsigned) -result,
+                 (unsigned) mbedtls_ssl_get_verify_result(&aTls->ssl));
+        /* Start over with a full handshake in case the saved session is the problem */
+        session_drop(aTls);
+        mbedtls_platform_zeroize(offeredMaster, sizeof(offeredMaster));
+        return -1;
+    }
+
+    session_drop(aTls);
+    aTls->haveSession   = (0 == mbedtls_ssl_get_session(&aTls->ssl, &aTls->session));
+    resumed             = aTls->haveSession && offered &&
+                          0 == memcmp(offeredMaster, aTls->session.master, sizeof(offeredMaster));
+    mbedtls_platform_zeroize(offeredMaster, sizeof(offeredMaster));
+
+    aTls->open                      = true;
+    aTls->stats.lastHandshakeMs     = platform_now_ms() - startMs;
+    aTls->stats.lastHandshakeBytes  = aTls->stats.bytesTx + aTls->stats.bytesRx - startBytes;
+    aTls->stats.handshakeMs        += aTls->stats.lastHandshakeMs;
+    aTls->stats.handshakeBytes     += aTls->stats.lastHandshakeBytes;
+    if (resumed)
+    {
+        aTls->stats.resumed++;
+    }
+    else
+    {
+        aTls->stats.handshakes++;
+    }
+    LOG_HI("TLS %s with %s (%s), %u ms, %u bytes", resumed ? "session resumed" : "full handshake", aTls->host,
+           mbedtls_ssl_get_ciphersuite(&aTls->ssl), (unsigned) aTls->stats.lastHandshakeMs,
+           (unsigned) aTls->stats.lastHandshakeBytes);
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_size_or_error_t tls_conn_send(
+    TlsConn_t*      aTls,
+    const void*     aBuf,
+    uint32_t        aLen)
+{
+    uint32_t    sent    = 0;
+    int         result;
+
+    while (sent < aLen)
+    {
+        result  = mbedtls_ssl_write(&aTls->ssl, (const unsigned char*) aBuf + sent, aLen - sent);
+        if (MBEDTLS_ERR_SSL_WANT_WRITE == result)
+        {
+            return NSAPI_ERROR_WOULD_BLOCK;
+        }
+        if (result < 0)
+        {
+            LOG_WARN("TLS send failed, error = -0x%x", (unsigned) -result);
+            return NSAPI_ERROR_DEVICE_ERROR;
+        }
+        sent   += result;
+    }
+    return sent;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_size_or_error_t tls_conn_recv(
+    TlsConn_t*      aTls,
+    void*           aBuf,
+    uint32_t        aSize)
+{
+    int     result  = mbedtls_ssl_read(&aTls->ssl, (unsigned char*) aBuf, aSize);
+
+    if (MBEDTLS_ERR_SSL_WANT_READ == result)
+    {
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+    if (MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY == result || MBEDTLS_ERR_SSL_CONN_EOF == result)
+    {
+        return 0;
+    }
+    if (result < 0)
+    {
+        LOG_WARN("TLS receive failed, error = -0x%x", (unsigned) -result);
+        return NSAPI_ERROR_DEVICE_ERROR;
+    }
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void tls_conn_close(
+    TlsConn_t*      aTls)
+{
+    if (aTls->open)
+    {
+        /* Without close_notify some servers forget the session */
+        mbedtls_ssl_close_notify(&aTls->ssl);
+        aTls->open  = false;
+    }
+    aTls->socket    = NULL;
+}
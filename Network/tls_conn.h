@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_TLS_CONN_H_
+#define NETWORK_TLS_CONN_H_
+
+#include "mbed.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    handshakes;         /* Full handshakes, with the server certificate */
+    uint32_t    resumed;            /* Abbreviated handshakes on the saved session */
+    uint32_t    failures;
+    uint32_t    handshakeMs;        /* All handshakes together */
+    uint32_t    handshakeBytes;     /* Both ways, records included */
+    uint32_t    lastHandshakeMs;
+    uint32_t    lastHandshakeBytes;
+    uint32_t    bytesTx;            /* On the wire, handshakes included */
+    uint32_t    bytesRx;
+} TlsConnStats_t;
+
+/** TLS 1.2 client with mbedTLS on top of a connected TCPSocket, for one server at a time.
+ *
+ * Everything costly is set up once by tls_conn_init(): the random generator, the parsed CA
+ * chain, and the SSL context with its buffers. After each handshake the session is saved, with
+ * the server certificate it was verified with and the session ticket if the server gave one. The
+ * next connection offers it back, so a server that still knows it answers with an abbreviated
+ * handshake: no certificate, no key exchange, one round trip less. A server that does not falls
+ * back to a full handshake on its own.
+ */
+typedef struct
+{
+    const char*                 host;       /* Server name sent and verified */
+    TCPSocket*                  socket;
+    bool                        ready;      /* Set up, handshakes can be tried */
+    bool                        open;
+    bool                        haveSession;
+
+    mbedtls_entropy_context     entropy;
+    mbedtls_ctr_drbg_context    drbg;
+    mbedtls_x509_crt            ca;
+    mbedtls_ssl_config          conf;
+    mbedtls_ssl_context         ssl;
+    mbedtls_ssl_session         session;    /* Offered on the next handshake when haveSession */
+
+    TlsConnStats_t              stats;
+} TlsConn_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Sets up TLS to aHost, with the server certificate verified against the PEM certificates in
+ * aCaPem. aHost and aCaPem are referenced, not copied.
+ *
+ * @return 0 on success, -1 when the random generator, the CA chain or the context failed.
+ */
+int tls_conn_init(
+    TlsConn_t*      aTls,
+    const char*     aHost,
+    const char*     aCaPem);
+
+/** Handshakes on aSocket, connected to the server, offering the saved session. Socket timeouts
+ * stay with the caller, a receive that times out fails the handshake.
+ *
+ * @return 0 once the connection is secured, -1 otherwise.
+ */
+int tls_conn_start(
+    TlsConn_t*      aTls,
+    TCPSocket*      aSocket);
+
+/** Sends all of aLen bytes, as TCPSocket::send().
+ *
+ * @return aLen, or a negative nsapi error, NSAPI_ERROR_WOULD_BLOCK on timeout.
+ */
+nsapi_size_or_error_t tls_conn_send(
+    TlsConn_t*      aTls,
+    const void*     aBuf,
+    uint32_t        aLen);
+
+/** Receives up to aSize bytes, as TCPSocket::recv().
+ *
+ * @return Bytes received, 0 once the server closed the connection, or a negative nsapi error,
+ *         NSAPI_ERROR_WOULD_BLOCK on timeout.
+ */
+nsapi_size_or_error_t tls_conn_recv(
+    TlsConn_t*      aTls,
+    void*           aBuf,
+    uint32_t        aSize);
+
+/** Tells the server the connection ends, the saved session stays for the next one. The socket
+ * is left to the caller.
+ */
+void tls_conn_close(
+    TlsConn_t*      aTls);
+
+#endif /* NETWORK_TLS_CONN_H_ */
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_TLS_ROOT_CA_H_
+#define NETWORK_TLS_ROOT_CA_H_
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   V A R I A B L E   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Root certificates the uplink servers are verified against, in PEM, one after the other.
+ * Servers signed by another root need theirs added, a local stand-in its own.
+ */
+extern const char tlsRootCaPem[];
+
+#endif /* NETWORK_TLS_ROOT_CA_H_ */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "uplink_batch.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define BATCH_OPEN                  "{\"samples\":["
+#define BATCH_CLOSE_RESERVE         (24)    /* "],\"now\":4294967295}" and the NUL */
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Appends aLen bytes at *aPos, keeping room to close the body */
+static int put(
+    UplinkBatch_t*  aBatch,
+    uint32_t*       aPos,
+    const char*     aStr,
+    uint32_t        aLen)
+{
+    if (*aPos + aLen > aBatch->size - BATCH_CLOSE_RESERVE)
+    {
+        return -1;
+    }
+    memcpy(aBatch->buf + *aPos, aStr, aLen);
+    *aPos  += aLen;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static bool is_integer(
+    const char* aStr,
+    uint32_t    aLen)
+{
+    uint32_t    i   = ('-' == aStr[0]) ? 1 : 0;
+
+    if (i >= aLen)
+    {
+        return false;
+    }
+    for (; i < aLen; i++)
+    {
+        if (aStr[i] < '0' || aStr[i] > '9')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A JSON string, quotes and backslashes escaped and control characters dropped */
+static int put_string(
+    UplinkBatch_t*  aBatch,
+    uint32_t*       aPos,
+    const char*     aStr,
+    uint32_t        aLen)
+{
+    int result  = put(aBatch, aPos, "\"", 1);
+
+    for (uint32_t i = 0; i < aLen && 0 == result; i++)
+    {
+        if ('"' == aStr[i] || '\\' == aStr[i])
+        {
+            result  = put(aBatch, aPos, "\\", 1);
+        }
+        if (0 == result && (unsigned char) aStr[i] >= ' ')
+        {
+            result  = put(aBatch, aPos, &aStr[i], 1);
+        }
+    }
+    return (0 == result) ? put(aBatch, aPos, "\"", 1) : -1;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void uplink_batch_init(
+    UplinkBatch_t*  aBatch,
+    char*           aBuf,
+    uint32_t        aSize,
+    uint32_t        aMaxCount,
+    uint32_t        aMaxAgeMs)
+{
+    aBatch->buf         = aBuf;
+    aBatch->size        = aSize;
+    aBatch->maxCount    = aMaxCount;
+    aBatch->maxAgeMs    = aMaxAgeMs;
+    uplink_batch_reset(aBatch);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int uplink_batch_add(
+    UplinkBatch_t*  aBatch,
+    uint32_t        aTimeMs,
+    const char*     aReadings,
+    bool            aUrgent)
+{
+    char        stamp[24];
+    uint32_t    pos     = aBatch->used;
+    const char* key     = aReadings;
+    const char* value;
+    const char* end;
+    int         result;
+
+    result  = put(aBatch, &pos, stamp, snprintf(stamp, sizeof(stamp), "%s{\"t\":%u", (0 == aBatch->count) ? "" : ",", (unsigned) aTimeMs));
+
+    while (0 == result && '\0' != *key)
+    {
+        end     = strchr(key, '&');
+        end     = (NULL != end) ? end : key + strlen(key);
+        value   = (const char*) memchr(key, '=', end - key);
+
+        /* Pairs without a key or a value are dropped */
+        if (NULL != value && value > key && value + 1 < end)
+        {
+            result  = put(aBatch, &pos, ",", 1);
+            result |= put_string(aBatch, &pos, key, value - key);
+            result |= put(aBatch, &pos, ":", 1);
+            value++;
+            if (is_integer(value, end - value))
+            {
+                result |= put(aBatch, &pos, value, end - value);
+            }
+            else
+            {
+                result |= put_string(aBatch, &pos, value, end - value);
+            }
+        }
+        key     = ('\0' != *end) ? end + 1 : end;
+    }
+
+    if (0 != result || 0 != put(aBatch, &pos, "}", 1))
+    {
+        return -1;
+    }
+
+    if (0 == aBatch->count)
+    {
+        aBatch->firstMs = aTimeMs;
+    }
+    aBatch->used    = pos;
+    aBatch->count++;
+    aBatch->urgent |= aUrgent;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void uplink_batch_set_limits(
+    UplinkBatch_t*  aBatch,
+    uint32_t        aMaxCount,
+    uint32_t        aMaxAgeMs)
+{
+    aBatch->maxCount    = aMaxCount;
+    aBatch->maxAgeMs    = aMaxAgeMs;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+bool uplink_batch_due(
+    const UplinkBatch_t*    aBatch,
+    uint32_t                aNowMs)
+{
+    if (0 == aBatch->count)
+    {
+        return false;
+    }
+    return aBatch->urgent ||
+           aBatch->count >= aBatch->maxCount ||
+           (aNowMs - aBatch->firstMs) >= aBatch->maxAgeMs;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+char* uplink_batch_close(
+    UplinkBatch_t*  aBatch,
+    uint32_t        aNowMs)
+{
+    snprintf(aBatch->buf + aBatch->used, BATCH_CLOSE_RESERVE, "],\"now\":%u}", (unsigned) aNowMs);
+    return aBatch->buf;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void uplink_batch_reset(
+    UplinkBatch_t*  aBatch)
+{
+    strcpy(aBatch->buf, BATCH_OPEN);
+    aBatch->used    = sizeof(BATCH_OPEN) - 1;
+    aBatch->count   = 0;
+    aBatch->firstMs = 0;
+    aBatch->urgent  = false;
+}
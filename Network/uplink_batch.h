@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_UPLINK_BATCH_H_
+#define NETWORK_UPLINK_BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Reports collected into one JSON body, sent as a single request:
+ *
+ *      {"samples":[{"t":<ms>,"KEY":<value>,...},...],"now":<ms>}
+ *
+ * Each sample is a "KEY=value&..." report with the time it was taken; "now" is the time the
+ * batch was closed, so the receiver can place every sample as its arrival time - (now - t).
+ * The body is built in place in a caller supplied buffer, which also bounds its size.
+ */
+typedef struct
+{
+    char*       buf;
+    uint32_t    size;
+    uint32_t    used;
+    uint32_t    count;
+    uint32_t    maxCount;           /* Samples that close the batch */
+    uint32_t    maxAgeMs;           /* Age of the first sample that closes the batch */
+    uint32_t    firstMs;
+    bool        urgent;             /* An urgent sample closes the batch at once */
+} UplinkBatch_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void uplink_batch_init(
+    UplinkBatch_t*  aBatch,
+    char*           aBuf,
+    uint32_t        aSize,
+    uint32_t        aMaxCount,
+    uint32_t        aMaxAgeMs);
+
+/** Adds the "KEY=value&..." report aReadings taken at aTimeMs. Values that are integers are
+ * sent as JSON numbers, others as strings.
+ *
+ * @return 0 on success, -1 when it does not fit; the batch is then left as it was.
+ */
+int uplink_batch_add(
+    UplinkBatch_t*  aBatch,
+    uint32_t        aTimeMs,
+    const char*     aReadings,
+    bool            aUrgent);
+
+/** Changes the count and age that close the batch, a pending batch is held to the new limits. */
+void uplink_batch_set_limits(
+    UplinkBatch_t*  aBatch,
+    uint32_t        aMaxCount,
+    uint32_t        aMaxAgeMs);
+
+/** @return true once the batch is full, old enough or holds an urgent sample. */
+bool uplink_batch_due(
+    const UplinkBatch_t*    aBatch,
+    uint32_t                aNowMs);
+
+/** Closes the JSON body and returns it, NUL terminated. Nothing can be added until
+ * uplink_batch_reset().
+ */
+char* uplink_batch_close(
+    UplinkBatch_t*  aBatch,
+    uint32_t        aNowMs);
+
+void uplink_batch_reset(
+    UplinkBatch_t*  aBatch);
+
+static inline bool uplink_batch_empty(
+    const UplinkBatch_t*    aBatch)
+{
+    return (0 == aBatch->count);
+}
+
+#endif /* NETWORK_UPLINK_BATCH_H_ */
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "uplink_retry.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Random between aMs / 2 and aMs */
+static uint32_t jitter_half(
+    uint32_t    aMs)
+{
+    return aMs / 2 + (uint32_t) rand() % (aMs - aMs / 2 + 1);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static uint32_t backoff_ms(
+    const UplinkRetry_t*    aRetry)
+{
+    uint32_t    delayMs = aRetry->config.baseMs;
+
+    for (uint32_t i = 1; i < aRetry->failuresInRow && delayMs < aRetry->config.capMs; i++)
+    {
+        delayMs    *= 2;
+    }
+    return jitter_half((delayMs < aRetry->config.capMs) ? delayMs : aRetry->config.capMs);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void uplink_retry_init(
+    UplinkRetry_t*              aRetry,
+    const UplinkRetryConfig_t*  aConfig)
+{
+    memset(aRetry, 0, sizeof(*aRetry));
+    aRetry->config  = *aConfig;
+    aRetry->state   = UPLINK_RETRY_CLOSED;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+bool uplink_retry_allow(
+    UplinkRetry_t*  aRetry,
+    uint32_t        aNowMs)
+{
+    if (UPLINK_RETRY_HALF_OPEN == aRetry->state ||
+        (aRetry->failuresInRow > 0 && (int32_t) (aNowMs - aRetry->nextTryMs) < 0))
+    {
+        /* A probe is out, or the backoff is not over */
+        aRetry->stats.deferred++;
+        return false;
+    }
+
+    if (UPLINK_RETRY_OPEN == aRetry->state)
+    {
+        aRetry->state   = UPLINK_RETRY_HALF_OPEN;
+        aRetry->stats.probes++;
+    }
+    aRetry->stats.attempts++;
+    return true;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void uplink_retry_success(
+    UplinkRetry_t*  aRetry)
+{
+    aRetry->state               = UPLINK_RETRY_CLOSED;
+    aRetry->failuresInRow       = 0;
+    aRetry->linkFailuresInRow   = 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+UplinkRetryAction_e uplink_retry_failure(
+    UplinkRetry_t*  aRetry,
+    uint32_t        aNowMs,
+    bool            aLinkDown)
+{
+    aRetry->stats.failures++;
+    aRetry->failuresInRow++;
+    /* Only an unbroken run of link failures counts, one server answer shows the link works */
+    aRetry->linkFailuresInRow   = aLinkDown ? aRetry->linkFailuresInRow + 1 : 0;
+    aRetry->stats.linkFailures += aLinkDown ? 1 : 0;
+
+    if (UPLINK_RETRY_HALF_OPEN == aRetry->state ||
+        (aRetry->config.openAfter > 0 && aRetry->failuresInRow >= aRetry->config.openAfter))
+    {
+        if (UPLINK_RETRY_OPEN != aRetry->state)
+        {
+            aRetry->stats.opens    += (UPLINK_RETRY_CLOSED == aRetry->state) ? 1 : 0;
+            aRetry->state           = UPLINK_RETRY_OPEN;
+        }
+        aRetry->nextTryMs   = aNowMs + aRetry->config.openMs + (uint32_t) rand() % (aRetry->config.openMs / 10 + 1);
+    }
+    else
+    {
+        aRetry->nextTryMs   = aNowMs + backoff_ms(aRetry);
+    }
+
+    if (aRetry->config.resetAfter > 0 && aRetry->linkFailuresInRow >= aRetry->config.resetAfter)
+    {
+        return UPLINK_RETRY_RESET;
+    }
+    return UPLINK_RETRY_WAIT;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t uplink_retry_wait_ms(
+    const UplinkRetry_t*    aRetry,
+    uint32_t                aNowMs)
+{
+    if (0 == aRetry->failuresInRow || (int32_t) (aNowMs - aRetry->nextTryMs) >= 0)
+    {
+        return 0;
+    }
+    return aRetry->nextTryMs - aNowMs;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_UPLINK_RETRY_H_
+#define NETWORK_UPLINK_RETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    UPLINK_RETRY_CLOSED,            /* Sending, with a backoff after each failure */
+    UPLINK_RETRY_OPEN,              /* Parked after too many failures in a row */
+    UPLINK_RETRY_HALF_OPEN,         /* One probe allowed, its outcome closes or opens the breaker */
+} UplinkRetryState_e;
+
+typedef enum
+{
+    UPLINK_RETRY_WAIT,              /* Try again once uplink_retry_allow() says so */
+    UPLINK_RETRY_RESET,             /* The link itself is down for good, reset the modem */
+} UplinkRetryAction_e;
+
+typedef struct
+{
+    uint32_t    baseMs;             /* Backoff after the first failure, doubled after each one */
+    uint32_t    capMs;              /* Longest backoff */
+    uint32_t    openAfter;          /* Failures in a row that open the breaker, 0 = never */
+    uint32_t    openMs;             /* Time parked before a probe */
+    uint32_t    resetAfter;         /* Link-level failures in a row that call for a modem reset, 0 = never */
+} UplinkRetryConfig_t;
+
+typedef struct
+{
+    uint32_t    attempts;
+    uint32_t    failures;
+    uint32_t    deferred;           /* Sends not attempted because of a backoff or the breaker */
+    uint32_t    opens;
+    uint32_t    probes;
+    uint32_t    linkFailures;       /* Failures with the link down */
+} UplinkRetryStats_t;
+
+/** Retry policy of the uplink: capped exponential backoff and a circuit breaker.
+ *
+ * After the n-th failure in a row nothing is sent for a random time between half and all of
+ * min(capMs, baseMs << (n - 1)), so devices that lost the same server do not all come back at
+ * once. openAfter failures in a row open the breaker: nothing is sent for openMs, a random
+ * tenth more, then one probe decides whether sending resumes or stays parked. Failures are told
+ * apart by whether the link was down. A server that fails while the link is up never calls for
+ * a reset; resetAfter link-level failures in a row do.
+ */
+typedef struct
+{
+    UplinkRetryConfig_t config;
+    uint8_t             state;          /* UplinkRetryState_e */
+    uint32_t            failuresInRow;
+    uint32_t            linkFailuresInRow;
+    uint32_t            nextTryMs;      /* No attempt before, while failuresInRow > 0 */
+    UplinkRetryStats_t  stats;
+} UplinkRetry_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void uplink_retry_init(
+    UplinkRetry_t*              aRetry,
+    const UplinkRetryConfig_t*  aConfig);
+
+/** true when a send may be attempted at aNowMs. Once the breaker was open for long enough,
+ * true for one probe only, until its outcome is reported.
+ */
+bool uplink_retry_allow(
+    UplinkRetry_t*  aRetry,
+    uint32_t        aNowMs);
+
+void uplink_retry_success(
+    UplinkRetry_t*  aRetry);
+
+/** Reports a failed attempt, aLinkDown when there is evidence the link rather than the server
+ * failed.
+ */
+UplinkRetryAction_e uplink_retry_failure(
+    UplinkRetry_t*  aRetry,
+    uint32_t        aNowMs,
+    bool            aLinkDown);
+
+/** Time left before the next attempt is allowed, 0 when it already is */
+uint32_t uplink_retry_wait_ms(
+    const UplinkRetry_t*    aRetry,
+    uint32_t                aNowMs);
+
+#endif /* NETWORK_UPLINK_RETRY_H_ */
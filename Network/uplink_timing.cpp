@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "uplink_timing.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Upper bound of each bucket but the last */
+static const uint32_t   bucketMs[UPLINK_TIMING_BUCKETS - 1] = { 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000 };
+
+static const char* const    phaseNames[UPLINK_PHASE_COUNT] = { "dns", "connect", "tls", "send", "recv", "close" };
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void uplink_timing_init(
+    UplinkTiming_t* aTiming)
+{
+    memset(aTiming, 0, sizeof(*aTiming));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void uplink_timing_record(
+    UplinkTiming_t* aTiming,
+    UplinkPhase_e   aPhase,
+    uint32_t        aMs)
+{
+    UplinkHistogram_t*  hist    = &aTiming->phase[aPhase];
+    uint32_t            i       = 0;
+
+    while (i < UPLINK_TIMING_BUCKETS - 1 && aMs > bucketMs[i])
+    {
+        i++;
+    }
+    hist->bucket[i]++;
+    hist->count++;
+    hist->totalMs  += aMs;
+    if (aMs > hist->maxMs)
+    {
+        hist->maxMs = aMs;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t uplink_timing_percentile(
+    const UplinkTiming_t*   aTiming,
+    UplinkPhase_e           aPhase,
+    uint32_t                aPercent)
+{
+    const UplinkHistogram_t*    hist    = &aTiming->phase[aPhase];
+    uint32_t                    rank    = (hist->count * aPercent + 99) / 100;  /* Runs at or below the percentile */
+    uint32_t                    seen    = 0;
+
+    if (0 == hist->count)
+    {
+        return 0;
+    }
+    for (uint32_t i = 0; i < UPLINK_TIMING_BUCKETS - 1; i++)
+    {
+        seen   += hist->bucket[i];
+        if (seen >= rank)
+        {
+            /* The bucket bound overstates a phase that never got close to it */
+            return (bucketMs[i] < hist->maxMs) ? bucketMs[i] : hist->maxMs;
+        }
+    }
+    return hist->maxMs;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+const char* uplink_phase_name(
+    UplinkPhase_e   aPhase)
+{
+    return (aPhase < UPLINK_PHASE_COUNT) ? phaseNames[aPhase] : "?";
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void uplink_timing_report(
+    UplinkTiming_t* aTiming)
+{
+    aTiming->reports++;
+    for (uint32_t i = 0; i < UPLINK_PHASE_COUNT; i++)
+    {
+        const UplinkHistogram_t*    hist    = &aTiming->phase[i];
+
+#if defined(ENABLE_SEGGER_RTT)
+        /* No colour codes or prefix, the line is parsed as it is */
+        SEGGER_RTT_printf(0, "UPLINK,%u,%u,%s,%u,%u,%u,%u",
+                          (unsigned) UPLINK_TIMING_FORMAT_VERSION, (unsigned) aTiming->reports, phaseNames[i],
+                          (unsigned) hist->count, (unsigned) (hist->count ? hist->totalMs / hist->count : 0),
+                          (unsigned) uplink_timing_percentile(aTiming, (UplinkPhase_e) i, 90), (unsigned) hist->maxMs);
+        for (uint32_t b = 0; b < UPLINK_TIMING_BUCKETS; b++)
+        {
+            SEGGER_RTT_printf(0, ",%u", (unsigned) hist->bucket[b]);
+        }
+        SEGGER_RTT_printf(0, "\n");
+#else
+        (void) hist;
+#endif
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void uplink_timing_clear(
+    UplinkTiming_t* aTiming)
+{
+    memset(aTiming->phase, 0, sizeof(aTiming->phase));
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NETWORK_UPLINK_TIMING_H_
+#define NETWORK_UPLINK_TIMING_H_
+
+#include <stdint.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define UPLINK_TIMING_BUCKETS               (10)
+#define UPLINK_TIMING_FORMAT_VERSION        (1)     /* Bumped whenever the UPLINK line layout changes */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    UPLINK_PHASE_DNS,           /* Address lookups, cache hits are not timed */
+    UPLINK_PHASE_CONNECT,       /* Socket open and TCP handshake */
+    UPLINK_PHASE_TLS,           /* TLS handshake, full or resumed */
+    UPLINK_PHASE_SEND,          /* Request handed to the modem */
+    UPLINK_PHASE_RECV,          /* Request sent to response read */
+    UPLINK_PHASE_CLOSE,
+    UPLINK_PHASE_COUNT
+} UplinkPhase_e;
+
+typedef struct
+{
+    uint32_t    count;
+    uint32_t    totalMs;
+    uint32_t    maxMs;
+    uint32_t    bucket[UPLINK_TIMING_BUCKETS];
+} UplinkHistogram_t;
+
+/** Durations of the phases of an uplink request, in fixed buckets of 50, 100, 200, 500 ms,
+ * 1, 2, 5, 10, 20 s and above. Failed phases are recorded too, a connect that runs into the
+ * timeout is the case worth seeing. Percentiles are read back as the upper bound of their bucket.
+ */
+typedef struct
+{
+    UplinkHistogram_t   phase[UPLINK_PHASE_COUNT];
+    uint32_t            reports;
+} UplinkTiming_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void uplink_timing_init(
+    UplinkTiming_t* aTiming);
+
+/** Adds one run of aPhase that took aMs.
+ */
+void uplink_timing_record(
+    UplinkTiming_t* aTiming,
+    UplinkPhase_e   aPhase,
+    uint32_t        aMs);
+
+/** Bucket bound below which aPercent of the runs of aPhase finished, the longest run when it
+ * falls in the last bucket, 0 when the phase did not run.
+ */
+uint32_t uplink_timing_percentile(
+    const UplinkTiming_t*   aTiming,
+    UplinkPhase_e           aPhase,
+    uint32_t                aPercent);
+
+/** Name of aPhase in lower case, as printed by uplink_timing_report().
+ */
+const char* uplink_phase_name(
+    UplinkPhase_e   aPhase);
+
+/** Prints one line per phase on RTT channel 0, in a fixed CSV layout meant for scripts:
+ *
+ *      UPLINK,<version>,<report>,<phase>,<count>,<mean ms>,<p90 ms>,<max ms>,<bucket counts>
+ */
+void uplink_timing_report(
+    UplinkTiming_t* aTiming);
+
+/** Empties the histograms for the next window.
+ */
+void uplink_timing_clear(
+    UplinkTiming_t* aTiming);
+
+#endif /* NETWORK_UPLINK_TIMING_H_ */
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PLATFORM_PLATFORM_CLOCK_H_
+#define PLATFORM_PLATFORM_CLOCK_H_
+
+#include <stdint.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Monotonic time in ms, wraps after 49 days; compare with (int32_t) (a - b).
+ *
+ * The acquisition path reads and spends time only through these two functions. On target they
+ * map to the RTOS kernel tick; an off-target build supplies its own definitions, e.g. a virtual
+ * clock that platform_sleep_ms() advances without waiting.
+ */
+uint32_t platform_now_ms(void);
+
+/** Monotonic time in us for short intervals, wraps after 71 minutes. */
+uint32_t platform_now_us(void);
+
+void platform_sleep_ms(
+    uint32_t    aMs);
+
+#endif /* PLATFORM_PLATFORM_CLOCK_H_ */
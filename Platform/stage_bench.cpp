@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "stage_bench.h"
+#include "platform_clock.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Insertion sort, rows are a few dozen entries and mostly ordered after the first pass */
+static void sort_us(
+    uint32_t*   aUs,
+    uint32_t    aCount)
+{
+    for (uint32_t i = 1; i < aCount; i++)
+    {
+        uint32_t    v   = aUs[i];
+        uint32_t    j   = i;
+
+        while (j > 0 && aUs[j - 1] > v)
+        {
+            aUs[j]  = aUs[j - 1];
+            j--;
+        }
+        aUs[j]  = v;
+    }
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void stage_bench_init(
+    StageBench_t*       aBench,
+    const char* const*  aNames,
+    uint32_t            aStages,
+    uint32_t*           aSamplesUs,
+    uint32_t            aCycles)
+{
+    memset(aBench, 0, sizeof(*aBench));
+    aBench->names       = aNames;
+    aBench->stageCount  = (aStages < STAGE_BENCH_MAX_STAGES) ? aStages : STAGE_BENCH_MAX_STAGES;
+    aBench->samplesUs   = aSamplesUs;
+    aBench->cycles      = aCycles;
+    aBench->lapUs       = platform_now_us();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void stage_bench_lap(
+    StageBench_t*   aBench)
+{
+    aBench->lapUs   = platform_now_us();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void stage_bench_mark(
+    StageBench_t*   aBench,
+    uint32_t        aStage)
+{
+    uint32_t    nowUs   = platform_now_us();
+
+    stage_bench_record(aBench, aStage, nowUs - aBench->lapUs);
+    aBench->lapUs   = nowUs;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void stage_bench_record(
+    StageBench_t*   aBench,
+    uint32_t        aStage,
+    uint32_t        aUs)
+{
+    if (aStage >= aBench->stageCount || 0 == aBench->cycles)
+    {
+        return;
+    }
+
+    aBench->samplesUs[aStage * aBench->cycles + aBench->count[aStage] % aBench->cycles] = aUs;
+    aBench->count[aStage]++;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+bool stage_bench_cycle_done(
+    StageBench_t*   aBench)
+{
+    if (++aBench->cycleCount < aBench->cycles)
+    {
+        return false;
+    }
+
+    stage_bench_report(aBench);
+
+    aBench->cycleCount  = 0;
+    aBench->reports++;
+    memset(aBench->count, 0, sizeof(aBench->count));
+
+    /* Printing is not part of any stage */
+    aBench->lapUs       = platform_now_us();
+    return true;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void stage_bench_stats(
+    StageBench_t*       aBench,
+    uint32_t            aStage,
+    StageBenchStats_t*  aStats)
+{
+    uint32_t*   row;
+    uint32_t    n;
+
+    memset(aStats, 0, sizeof(*aStats));
+    if (aStage >= aBench->stageCount || 0 == aBench->count[aStage])
+    {
+        return;
+    }
+
+    row = &aBench->samplesUs[aStage * aBench->cycles];
+    n   = (aBench->count[aStage] < aBench->cycles) ? aBench->count[aStage] : aBench->cycles;
+    sort_us(row, n);
+
+    /* Nearest-rank percentiles */
+    aStats->count       = n;
+    aStats->minUs       = row[0];
+    aStats->medianUs    = row[(n - 1) / 2];
+    aStats->p99Us       = row[(99 * n + 99) / 100 - 1];
+    aStats->maxUs       = row[n - 1];
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void stage_bench_report(
+    StageBench_t*   aBench)
+{
+    StageBenchStats_t   stats;
+
+    for (uint32_t i = 0; i < aBench->stageCount; i++)
+    {
+        stage_bench_stats(aBench, i, &stats);
+#if defined(ENABLE_SEGGER_RTT)
+        /* No colour codes or prefix, the line is parsed as it is */
+        SEGGER_RTT_printf(0, "BENCH,%u,%u,%s,%u,%u,%u,%u,%u\n",
+                          (unsigned) STAGE_BENCH_FORMAT_VERSION, (unsigned) aBench->reports, aBench->names[i],
+                          (unsigned) stats.count, (unsigned) stats.minUs, (unsigned) stats.medianUs,
+                          (unsigned) stats.p99Us, (unsigned) stats.maxUs);
+#endif
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PLATFORM_STAGE_BENCH_H_
+#define PLATFORM_STAGE_BENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define STAGE_BENCH_MAX_STAGES              (16)
+#define STAGE_BENCH_FORMAT_VERSION          (1)     /* Bumped whenever the BENCH line layout changes */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Per-stage latency collector. Each stage keeps the durations of its last runs in its own row of
+ * a caller supplied array of aStages * aCycles entries, so a stage that does not run every cycle
+ * (e.g. the uplink) still gets a full set of samples.
+ */
+typedef struct
+{
+    const char* const*  names;
+    uint32_t            stageCount;
+    uint32_t            cycles;             /* Samples per stage and cycles per report */
+    uint32_t*           samplesUs;          /* [stageCount][cycles] */
+    uint32_t            count[STAGE_BENCH_MAX_STAGES];
+    uint32_t            lapUs;              /* End of the last marked stage */
+    uint32_t            cycleCount;
+    uint32_t            reports;
+} StageBench_t;
+
+typedef struct
+{
+    uint32_t    count;
+    uint32_t    minUs;
+    uint32_t    medianUs;
+    uint32_t    p99Us;
+    uint32_t    maxUs;
+} StageBenchStats_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Binds the stage names and the sample array, aSamplesUs holds aStages * aCycles entries.
+ */
+void stage_bench_init(
+    StageBench_t*       aBench,
+    const char* const*  aNames,
+    uint32_t            aStages,
+    uint32_t*           aSamplesUs,
+    uint32_t            aCycles);
+
+/** Starts timing from now without recording, at the start of a cycle or after a stage that is
+ * not measured.
+ */
+void stage_bench_lap(
+    StageBench_t*   aBench);
+
+/** Records the time since the previous mark or lap as one run of aStage.
+ */
+void stage_bench_mark(
+    StageBench_t*   aBench,
+    uint32_t        aStage);
+
+/** Records a duration measured by the caller. Once a stage is full, later runs overwrite the
+ * oldest ones.
+ */
+void stage_bench_record(
+    StageBench_t*   aBench,
+    uint32_t        aStage,
+    uint32_t        aUs);
+
+/** Ends a cycle. Every aCycles cycles the statistics of all stages are printed and the
+ * collector starts over.
+ *
+ * @return true when a report was printed.
+ */
+bool stage_bench_cycle_done(
+    StageBench_t*   aBench);
+
+/** Sorts the samples of a stage in place and computes its statistics.
+ */
+void stage_bench_stats(
+    StageBench_t*       aBench,
+    uint32_t            aStage,
+    StageBenchStats_t*  aStats);
+
+/** Prints one line per stage on RTT channel 0, in a fixed CSV layout meant for scripts:
+ *
+ *      BENCH,<version>,<report>,<stage>,<count>,<min us>,<median us>,<p99 us>,<max us>
+ *
+ * Stages that did not run in the window are printed with a count of 0.
+ */
+void stage_bench_report(
+    StageBench_t*   aBench);
+
+#endif /* PLATFORM_STAGE_BENCH_H_ */
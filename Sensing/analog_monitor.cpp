@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include "analog_monitor.h"
+#include "platform_clock.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define BATTERY_MON_ON                      (1)
+#define BATTERY_MON_OFF                     (0)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Averages ANALOG_OVERSAMPLE conversions, keeping the extra resolution until the final scaling. */
+static uint32_t analog_oversample(
+    AnalogIn*   aIn)
+{
+    uint32_t    sum = 0;
+
+    for (int i = 0; i < ANALOG_OVERSAMPLE; i++)
+    {
+        sum += aIn->read_u16();
+    }
+    return sum;
+}
+
+static int32_t analog_to_mv(
+    uint32_t            aSum,
+    const AnalogCal_t*  aCal)
+{
+    uint64_t    scaled  = (uint64_t) aSum * (uint32_t) aCal->fullScaleMv;
+
+    /* aSum is ANALOG_OVERSAMPLE times a 16 bit reading */
+    scaled  = (scaled + (ANALOG_OVERSAMPLE << 15)) / ((uint64_t) ANALOG_OVERSAMPLE << 16);
+    return (int32_t) scaled + aCal->offsetMv;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void analog_monitor_init(
+    AnalogMonitor_t*    aMon,
+    AnalogIn*           aBattery,
+    DigitalOut*         aBatteryEn,
+    AnalogIn*           aFlex,
+    const AnalogCal_t*  aBatteryCal,
+    const AnalogCal_t*  aFlexCal)
+{
+    aMon->battery       = aBattery;
+    aMon->batteryEn     = aBatteryEn;
+    aMon->flex          = aFlex;
+    aMon->batteryCal    = *aBatteryCal;
+    aMon->flexCal       = *aFlexCal;
+
+    *aMon->batteryEn    = BATTERY_MON_OFF;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void analog_monitor_sample(
+    AnalogMonitor_t*    aMon,
+    int32_t*            aBatteryMv,
+    int32_t*            aFlexMv)
+{
+    uint32_t    sum;
+
+    *aMon->batteryEn    = BATTERY_MON_ON;
+    platform_sleep_ms(ANALOG_DIVIDER_SETTLE_MS);
+    sum                 = analog_oversample(aMon->battery);
+    *aMon->batteryEn    = BATTERY_MON_OFF;
+    *aBatteryMv         = analog_to_mv(sum, &aMon->batteryCal);
+
+    *aFlexMv            = analog_to_mv(analog_oversample(aMon->flex), &aMon->flexCal);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_ANALOG_MONITOR_H_
+#define SENSING_ANALOG_MONITOR_H_
+
+#include "mbed.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define ANALOG_OVERSAMPLE                   (16)        /* Conversions averaged per reading, power of 2 */
+#define ANALOG_DIVIDER_SETTLE_MS            (1)         /* Battery divider settling after enable */
+
+#define ANALOG_ADC_FULL_SCALE_MV            (3600)      /* nRF52 SAADC, 0.6 V reference with 1/6 gain */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Linear calibration: mV = raw16 * fullScaleMv / 65536 + offsetMv.
+ * fullScaleMv includes any resistor divider in front of the pin.
+ */
+typedef struct
+{
+    int32_t     fullScaleMv;
+    int32_t     offsetMv;
+} AnalogCal_t;
+
+typedef struct
+{
+    AnalogIn*       battery;
+    DigitalOut*     batteryEn;
+    AnalogIn*       flex;
+
+    AnalogCal_t     batteryCal;
+    AnalogCal_t     flexCal;
+} AnalogMonitor_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Binds the ADC inputs and leaves the battery divider switched off.
+ */
+void analog_monitor_init(
+    AnalogMonitor_t*    aMon,
+    AnalogIn*           aBattery,
+    DigitalOut*         aBatteryEn,
+    AnalogIn*           aFlex,
+    const AnalogCal_t*  aBatteryCal,
+    const AnalogCal_t*  aFlexCal);
+
+/** Takes one oversampled reading of both inputs. The battery divider is only powered
+ * for the duration of its conversions.
+ */
+void analog_monitor_sample(
+    AnalogMonitor_t*    aMon,
+    int32_t*            aBatteryMv,
+    int32_t*            aFlexMv);
+
+#endif /* SENSING_ANALOG_MONITOR_H_ */
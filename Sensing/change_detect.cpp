@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "change_detect.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis.h"
+#endif
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Saturating a - b, so that extreme raw readings can not wrap the deviation. */
+static inline int32_t cd_sub_sat(
+    int32_t     aA,
+    int32_t     aB)
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    int32_t     diff    = __QSUB(aA, aB);
+
+    return diff + (INT32_MIN == diff);
+#else
+    int64_t diff    = (int64_t) aA - (int64_t) aB;
+
+    if (diff > INT32_MAX)
+    {
+        diff    = INT32_MAX;
+    }
+    else if (diff < -INT32_MAX)
+    {
+        diff    = -INT32_MAX;
+    }
+    return (int32_t) diff;
+#endif
+}
+
+/* Branch-free |a|; the argument is never INT32_MIN since it comes from cd_sub_sat(). */
+static inline int32_t cd_abs(
+    int32_t     aA)
+{
+    int32_t     sign    = aA >> 31;
+
+    return (aA ^ sign) - sign;
+}
+
+/* Shortest signed distance between two angles, in (-180, 180]. */
+static inline int32_t cd_wrap_angle(
+    int32_t     aDiff)
+{
+    aDiff  %= (2 * CD_ANGLE_HALF_TURN);
+    if (aDiff > CD_ANGLE_HALF_TURN)
+    {
+        aDiff  -= 2 * CD_ANGLE_HALF_TURN;
+    }
+    else if (aDiff <= -CD_ANGLE_HALF_TURN)
+    {
+        aDiff  += 2 * CD_ANGLE_HALF_TURN;
+    }
+    return aDiff;
+}
+
+static inline int32_t cd_diff(
+    const ChangeDetect_t*   aCd,
+    int                     aIdx,
+    int32_t                 aA,
+    int32_t                 aB)
+{
+    int32_t     diff    = cd_sub_sat(aA, aB);
+
+    return (aCd->angleMask & (1UL << aIdx)) ? cd_wrap_angle(diff) : diff;
+}
+
+static int32_t cd_deadband(
+    const ChangeDetectChannel_t*    aCfg,
+    int32_t                         aRef)
+{
+    int32_t     rel     = (int32_t) (((int64_t) cd_abs(aRef) * aCfg->relDeadbandPm) / 1000);
+
+    return (rel > aCfg->absDeadband) ? rel : aCfg->absDeadband;
+}
+
+static void cd_snapshot(
+    ChangeDetect_t*     aCd,
+    const int32_t       aVal[],
+    uint32_t            aMask)
+{
+    for (int i = 0; i < aCd->count; i++)
+    {
+        if (aMask & (1UL << i))
+        {
+            aCd->send[i]    = aVal[i];
+            aCd->devSend[i] = cd_abs(cd_diff(aCd, i, aVal[i], aCd->ref[i]));
+        }
+    }
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int change_detect_init(
+    ChangeDetect_t*                 aCd,
+    const ChangeDetectChannel_t*    aTable,
+    int                             aCount,
+    uint32_t                        aNowMs)
+{
+    if (NULL == aTable || aCount <= 0 || aCount > CD_MAX_CHANNELS)
+    {
+        return -1;
+    }
+
+    memset(aCd, 0, sizeof(*aCd));
+    aCd->table  = aTable;
+    aCd->count  = aCount;
+
+    for (int i = 0; i < aCount; i++)
+    {
+        aCd->thrUp[i]           = cd_deadband(&aTable[i], 0);
+        aCd->thrDown[i]         = aCd->thrUp[i];
+        aCd->lastReportMs[i]    = aNowMs;
+
+        for (int j = 0; j < aCount; j++)
+        {
+            if (aTable[j].group == aTable[i].group)
+            {
+                aCd->groupMask[i]   |= (1UL << j);
+            }
+        }
+
+        if (aTable[i].flags & CD_FLAG_REPORT_INITIAL)
+        {
+            aCd->fresh      |= (1UL << i);
+        }
+        if (aTable[i].flags & CD_FLAG_ANGLE)
+        {
+            aCd->angleMask  |= (1UL << i);
+        }
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void change_detect_set_reference(
+    ChangeDetect_t*     aCd,
+    int                 aIdx,
+    int32_t             aValue)
+{
+    aCd->ref[aIdx]      = aValue;
+    aCd->send[aIdx]     = aValue;
+    aCd->devSend[aIdx]  = 0;
+    aCd->last[aIdx]     = aValue;
+    aCd->thrUp[aIdx]    = cd_deadband(&aCd->table[aIdx], aValue);
+    aCd->thrDown[aIdx]  = aCd->thrUp[aIdx];
+    aCd->seen          |= (1UL << aIdx);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t change_detect_process(
+    ChangeDetect_t*     aCd,
+    const int32_t       aVal[],
+    uint32_t            aValidMask)
+{
+    uint32_t    exceed  = 0;
+    uint32_t    bigger  = 0;
+    uint32_t    done    = 0;
+    uint32_t    trigger;
+    uint32_t    snap    = 0;
+
+    /* One pass over the columns, no per-sensor branches. */
+    for (int i = 0; i < aCd->count; i++)
+    {
+        int32_t     diff    = cd_diff(aCd, i, aVal[i], aCd->ref[i]);
+        int32_t     dev     = cd_abs(diff);
+        int32_t     thr     = (diff >= 0) ? aCd->thrUp[i] : aCd->thrDown[i];
+
+        exceed  |= (uint32_t) (dev > thr) << i;
+        bigger  |= (uint32_t) (dev > aCd->devSend[i]) << i;
+    }
+
+    exceed  &= aValidMask;
+    bigger  &= aValidMask;
+
+    for (int i = 0; i < aCd->count; i++)
+    {
+        if (aValidMask & (1UL << i))
+        {
+            aCd->last[i]    = aVal[i];
+        }
+    }
+    aCd->seen   |= aValidMask;
+
+    /* First sample of channels that must be reported unconditionally. */
+    snap        |= aCd->fresh & aValidMask;
+    aCd->fresh  &= ~aValidMask;
+
+    /* Resolve per group: a crossing on any member snapshots the whole group, either because
+     * nothing was pending yet or because some member deviates more than the pending value. */
+    trigger = 0;
+    for (int i = 0; i < aCd->count; i++)
+    {
+        uint32_t    group   = aCd->groupMask[i];
+
+        if ((done & (1UL << i)) || 0 == (exceed & group))
+        {
+            continue;
+        }
+        done    |= group;
+
+        if (0 == (aCd->pending & group) || 0 != (bigger & group))
+        {
+            snap    |= group;
+        }
+        trigger |= group;
+    }
+
+    cd_snapshot(aCd, aVal, snap & aValidMask);
+    aCd->pending    |= trigger | (snap & aValidMask);
+
+    return exceed;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t change_detect_due(
+    ChangeDetect_t*     aCd,
+    uint32_t            aNowMs)
+{
+    uint32_t    due         = 0;
+    uint32_t    heartbeat   = 0;
+    uint32_t    expanded    = 0;
+
+    for (int i = 0; i < aCd->count; i++)
+    {
+        const ChangeDetectChannel_t*    cfg     = &aCd->table[i];
+        uint32_t                        elapsed = aNowMs - aCd->lastReportMs[i];
+
+        if ((aCd->pending & (1UL << i)) && elapsed >= cfg->minIntervalMs)
+        {
+            due         |= (1UL << i);
+        }
+        else if (0 != cfg->maxIntervalMs && elapsed >= cfg->maxIntervalMs && (aCd->seen & (1UL << i)))
+        {
+            heartbeat   |= (1UL << i);
+        }
+    }
+
+    for (int i = 0; i < aCd->count; i++)
+    {
+        if ((due | heartbeat) & (1UL << i))
+        {
+            expanded    |= aCd->groupMask[i];
+        }
+    }
+
+    /* Channels reported only because of their heartbeat carry the latest sample. */
+    for (int i = 0; i < aCd->count; i++)
+    {
+        if ((expanded & ~aCd->pending) & (1UL << i))
+        {
+            aCd->send[i]    = aCd->last[i];
+        }
+    }
+
+    return expanded & aCd->seen;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void change_detect_commit(
+    ChangeDetect_t*     aCd,
+    uint32_t            aMask,
+    uint32_t            aNowMs)
+{
+    for (int i = 0; i < aCd->count; i++)
+    {
+        if (0 == (aMask & (1UL << i)))
+        {
+            continue;
+        }
+
+        const ChangeDetectChannel_t*    cfg     = &aCd->table[i];
+        int32_t                         db      = cd_deadband(cfg, aCd->send[i]);
+        int32_t                         moved   = cd_diff(aCd, i, aCd->send[i], aCd->ref[i]);
+
+        /* Hysteresis: moving back against the direction just reported needs a larger step. */
+        aCd->thrUp[i]           = db;
+        aCd->thrDown[i]         = db;
+        if (moved > 0)
+        {
+            aCd->thrDown[i]    += cfg->hysteresis;
+        }
+        else if (moved < 0)
+        {
+            aCd->thrUp[i]      += cfg->hysteresis;
+        }
+
+        aCd->ref[i]             = aCd->send[i];
+        aCd->devSend[i]         = 0;
+        aCd->lastReportMs[i]    = aNowMs;
+    }
+    aCd->pending    &= ~aMask;
+}
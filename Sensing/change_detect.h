@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_CHANGE_DETECT_H_
+#define SENSING_CHANGE_DETECT_H_
+
+#include <stdint.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define CD_MAX_CHANNELS                     (32)    /* Channel masks are 32 bit wide */
+
+#define CD_FLAG_REPORT_INITIAL              (0x01)  /* Report the first valid sample even if it is inside the deadband */
+#define CD_FLAG_ANGLE                       (0x02)  /* Values are degrees, deviations wrap at +/-180 */
+
+#define CD_ANGLE_HALF_TURN                  (180)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Static configuration of one change-detection channel.
+ *
+ * A channel is reported when its deviation from the last reported value exceeds
+ * max(absDeadband, |reference| * relDeadbandPm / 1000). While a report is pending the
+ * sample with the largest deviation is kept. Channels sharing a group (e.g. the three
+ * axes of one sensor) always trigger and snapshot together.
+ */
+typedef struct
+{
+    int         channel;            /* Uplink channel identifier, opaque to the engine */
+    uint8_t     group;              /* Channels with the same group are reported together */
+    uint8_t     flags;              /* CD_FLAG_* */
+    uint16_t    relDeadbandPm;      /* Relative deadband in per mille of the reference, 0 = off */
+    int32_t     absDeadband;        /* Absolute deadband */
+    int32_t     hysteresis;         /* Extra deviation needed to move against the last reported direction */
+    uint32_t    minIntervalMs;      /* Hold pending reports until this long after the last one, 0 = off */
+    uint32_t    maxIntervalMs;      /* Force a report after this long without one, 0 = off */
+} ChangeDetectChannel_t;
+
+/** Runtime state, kept column-wise so that all channels are processed in one pass.
+ */
+typedef struct
+{
+    const ChangeDetectChannel_t*    table;
+    int                             count;
+
+    int32_t     ref[CD_MAX_CHANNELS];           /* Last reported value */
+    int32_t     send[CD_MAX_CHANNELS];          /* Value to report (largest deviation seen) */
+    int32_t     devSend[CD_MAX_CHANNELS];       /* |send - ref| */
+    int32_t     last[CD_MAX_CHANNELS];          /* Latest valid sample */
+    int32_t     thrUp[CD_MAX_CHANNELS];         /* Deadband above the reference */
+    int32_t     thrDown[CD_MAX_CHANNELS];       /* Deadband below the reference */
+    uint32_t    lastReportMs[CD_MAX_CHANNELS];
+    uint32_t    groupMask[CD_MAX_CHANNELS];     /* Mask of all channels in the channel's group */
+
+    uint32_t    angleMask;                      /* CD_FLAG_ANGLE channels */
+    uint32_t    pending;                        /* Channels holding an unreported change */
+    uint32_t    fresh;                          /* CD_FLAG_REPORT_INITIAL channels not sampled yet */
+    uint32_t    seen;                           /* Channels that had at least one valid sample */
+} ChangeDetect_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Binds a channel table to the engine state. The table must outlive the state.
+ *
+ * @return 0 on success, -1 if the table is empty or too large.
+ */
+int change_detect_init(
+    ChangeDetect_t*                 aCd,
+    const ChangeDetectChannel_t*    aTable,
+    int                             aCount,
+    uint32_t                        aNowMs);
+
+/** Sets the reference of a channel without reporting it (e.g. a calibration read).
+ */
+void change_detect_set_reference(
+    ChangeDetect_t*     aCd,
+    int                 aIdx,
+    int32_t             aValue);
+
+/** Runs deadband/hysteresis detection on one sample vector.
+ *
+ * @param aVal          One sample per table entry.
+ * @param aValidMask    Bit i set when aVal[i] holds a fresh reading.
+ * @return Mask of channels that crossed their deadband on this sample.
+ */
+uint32_t change_detect_process(
+    ChangeDetect_t*     aCd,
+    const int32_t       aVal[],
+    uint32_t            aValidMask);
+
+/** Returns the channels that should go into the next report: pending channels past
+ * their minimum interval and channels past their maximum interval, expanded to groups.
+ */
+uint32_t change_detect_due(
+    ChangeDetect_t*     aCd,
+    uint32_t            aNowMs);
+
+/** Value to report for a channel.
+ */
+static inline int32_t change_detect_value(
+    const ChangeDetect_t*   aCd,
+    int                     aIdx)
+{
+    return aCd->send[aIdx];
+}
+
+/** Marks the channels in aMask as reported: their report values become the new references.
+ */
+void change_detect_commit(
+    ChangeDetect_t*     aCd,
+    uint32_t            aMask,
+    uint32_t            aNowMs);
+
+#endif /* SENSING_CHANGE_DETECT_H_ */
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "event_detect.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Signed excursion of the input away from the baseline, in the direction the rule looks at. */
+static int32_t evt_excursion(
+    const EventRule_t*  aRule,
+    int32_t             aVal,
+    int32_t             aBaseline)
+{
+    int32_t     diff    = aVal - aBaseline;
+
+    switch (aRule->type)
+    {
+        case EVT_RULE_RISE:
+            return diff;
+
+        case EVT_RULE_DROP:
+            return -diff;
+
+        case EVT_RULE_ANGLE_DEVIATION:
+            diff   %= 360;
+            if (diff > 180)
+            {
+                diff   -= 360;
+            }
+            else if (diff <= -180)
+            {
+                diff   += 360;
+            }
+            return (diff < 0) ? -diff : diff;
+
+        case EVT_RULE_DEVIATION:
+        default:
+            return (diff < 0) ? -diff : diff;
+    }
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int event_detect_init(
+    EventDetect_t*      aEd,
+    const EventRule_t*  aRules,
+    int                 aCount)
+{
+    if (NULL == aRules || aCount <= 0 || aCount > EVT_MAX_RULES)
+    {
+        return -1;
+    }
+
+    memset(aEd, 0, sizeof(*aEd));
+    aEd->rules  = aRules;
+    aEd->count  = aCount;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t event_detect_process(
+    EventDetect_t*      aEd,
+    const int32_t       aVal[],
+    uint32_t            aValidMask,
+    uint32_t*           aCleared)
+{
+    uint32_t    raised  = 0;
+    uint32_t    cleared = 0;
+
+    for (int i = 0; i < aEd->count; i++)
+    {
+        const EventRule_t*  rule    = &aEd->rules[i];
+        uint32_t            bit     = (1UL << i);
+        int32_t             val;
+        int32_t             excursion;
+
+        if (0 == (aValidMask & (1UL << rule->input)))
+        {
+            continue;
+        }
+        val = aVal[rule->input];
+
+        if (0 == (aEd->primed & bit))
+        {
+            aEd->baseline[i]    = val * (1 << 8);
+            aEd->primed        |= bit;
+            continue;
+        }
+
+        excursion   = evt_excursion(rule, val, event_detect_baseline(aEd, i));
+
+        if (aEd->active & bit)
+        {
+            if (excursion <= rule->release)
+            {
+                aEd->active    &= ~bit;
+                aEd->hits[i]    = 0;
+                cleared        |= bit;
+            }
+            continue;
+        }
+
+        if (excursion > rule->trigger)
+        {
+            if (++aEd->hits[i] >= rule->debounce)
+            {
+                aEd->active    |= bit;
+                raised         |= bit;
+            }
+        }
+        else
+        {
+            aEd->hits[i]    = 0;
+
+            /* Only samples inside the trigger band move the baseline, a step change is never absorbed. */
+            if (0 != rule->baselineShift)
+            {
+                aEd->baseline[i]   += (val * (1 << 8) - aEd->baseline[i]) >> rule->baselineShift;
+            }
+        }
+    }
+
+    if (NULL != aCleared)
+    {
+        *aCleared   = cleared;
+    }
+    return raised;
+}
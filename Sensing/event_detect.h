@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_EVENT_DETECT_H_
+#define SENSING_EVENT_DETECT_H_
+
+#include <stdint.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define EVT_MAX_RULES                       (32)    /* Rule masks are 32 bit wide */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** How a rule compares its input against the baseline.
+ */
+typedef enum
+{
+    EVT_RULE_RISE,              /* Input above baseline + trigger */
+    EVT_RULE_DROP,              /* Input below baseline - trigger */
+    EVT_RULE_DEVIATION,         /* |input - baseline| above trigger */
+    EVT_RULE_ANGLE_DEVIATION    /* As EVT_RULE_DEVIATION, input in degrees wrapping at +/-180 */
+} EventRuleType_e;
+
+/** One detection rule. Several rules may raise the same event.
+ *
+ * The baseline is the first valid input. With baselineShift > 0 it then follows the input
+ * (EMA, alpha = 1/2^baselineShift) while the rule is idle, so slow drifts never raise events.
+ */
+typedef struct
+{
+    int         event;          /* Event identifier, opaque to the engine */
+    uint8_t     input;          /* Index into the sample vector */
+    uint8_t     type;           /* EventRuleType_e */
+    uint8_t     debounce;       /* Consecutive samples beyond trigger needed to raise */
+    uint8_t     baselineShift;  /* Baseline tracking speed while idle, 0 = fixed */
+    int32_t     trigger;        /* Raise when beyond the baseline by more than this */
+    int32_t     release;        /* Clear when back within this of the baseline */
+} EventRule_t;
+
+typedef struct
+{
+    const EventRule_t*  rules;
+    int                 count;
+
+    int32_t     baseline[EVT_MAX_RULES];    /* Q8 */
+    uint8_t     hits[EVT_MAX_RULES];
+
+    uint32_t    primed;                     /* Rules with a baseline */
+    uint32_t    active;                     /* Rules currently raised */
+} EventDetect_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Binds a rule table to the detector state. The table must outlive the state.
+ *
+ * @return 0 on success, -1 if the table is empty or too large.
+ */
+int event_detect_init(
+    EventDetect_t*      aEd,
+    const EventRule_t*  aRules,
+    int                 aCount);
+
+/** Evaluates all rules on one sample vector.
+ *
+ * @param aVal          Sample vector, indexed by EventRule_t::input.
+ * @param aValidMask    Bit n set when aVal[n] holds a fresh reading.
+ * @param aCleared      Out: rules that returned to idle on this sample (may be NULL).
+ * @return Rules raised on this sample.
+ */
+uint32_t event_detect_process(
+    EventDetect_t*      aEd,
+    const int32_t       aVal[],
+    uint32_t            aValidMask,
+    uint32_t*           aCleared);
+
+/** Baseline of a rule, in input units.
+ */
+static inline int32_t event_detect_baseline(
+    const EventDetect_t*    aEd,
+    int                     aRule)
+{
+    return aEd->baseline[aRule] / (1 << 8);
+}
+
+#endif /* SENSING_EVENT_DETECT_H_ */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stddef.h>
+#include "orientation_fusion.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define FX_Q15_ONE                          (1L << 15)
+
+/* atan(z) ~= (pi/4) z - z (|z| - 1) (0.2447 + 0.0663 |z|), |z| <= 1, in centidegrees */
+#define FX_ATAN_C0                          (4500)
+#define FX_ATAN_C1                          (1402)
+#define FX_ATAN_C2                          (380)
+
+#define ORIENT_MIN_GRAVITY_MG               (200)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* atan of a Q15 ratio in [-1, 1] */
+static int32_t fx_atan_q15(
+    int32_t     aZ)
+{
+    int64_t     absZ    = (aZ < 0) ? -aZ : aZ;
+    int64_t     lin     = (int64_t) FX_ATAN_C0 * aZ;                                        /* Q15 */
+    int64_t     inner   = (int64_t) FX_ATAN_C1 * FX_Q15_ONE + FX_ATAN_C2 * absZ;            /* Q15 */
+    int64_t     corr    = (((int64_t) aZ * (absZ - FX_Q15_ONE)) >> 15) * inner;             /* Q30 */
+
+    return (int32_t) ((lin - (corr >> 15) + (FX_Q15_ONE / 2)) >> 15);
+}
+
+/* Scales a pair of 64 bit values down until both fit into 31 bits, keeping their ratio. */
+static void fx_normalize_pair(
+    int64_t*    aA,
+    int64_t*    aB)
+{
+    while (*aA > INT32_MAX / 2 || *aA < -(INT32_MAX / 2) ||
+           *aB > INT32_MAX / 2 || *aB < -(INT32_MAX / 2))
+    {
+        *aA /= 2;
+        *aB /= 2;
+    }
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int32_t fx_atan2_cdeg(
+    int32_t     aY,
+    int32_t     aX)
+{
+    int64_t     absY    = (aY < 0) ? -(int64_t) aY : aY;
+    int64_t     absX    = (aX < 0) ? -(int64_t) aX : aX;
+    int32_t     angle;
+
+    if (0 == aX && 0 == aY)
+    {
+        return 0;
+    }
+
+    if (absX >= absY)
+    {
+        angle   = fx_atan_q15((int32_t) ((absY << 15) / absX));
+    }
+    else
+    {
+        angle   = ORIENT_CDEG_90 - fx_atan_q15((int32_t) ((absX << 15) / absY));
+    }
+
+    /* Back from the first quadrant */
+    if (aX < 0)
+    {
+        angle   = ORIENT_CDEG_180 - angle;
+    }
+    return (aY < 0) ? -angle : angle;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t fx_sqrt(
+    uint64_t    aVal)
+{
+    uint64_t    res     = 0;
+    uint64_t    bit     = 1ULL << 62;
+
+    while (bit > aVal)
+    {
+        bit >>= 2;
+    }
+
+    while (0 != bit)
+    {
+        if (aVal >= res + bit)
+        {
+            aVal   -= res + bit;
+            res     = (res >> 1) + bit;
+        }
+        else
+        {
+            res   >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t) res;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int orientation_fusion_update(
+    OrientationFusion_t*    aFusion,
+    const int32_t           aAccMg[3],
+    const int32_t           aMag[3],
+    Orientation_t*          aOut)
+{
+    int32_t     a[3];
+    int32_t     m[3];
+    int64_t     r2;
+    int64_t     r;
+    int64_t     g;
+    int64_t     by;
+    int64_t     bx;
+
+    for (int i = 0; i < 3; i++)
+    {
+        aFusion->acc[i].update(aAccMg[i], &a[i]);
+        if (NULL != aMag)
+        {
+            aFusion->mag[i].update(aMag[i], &m[i]);
+        }
+        else
+        {
+            m[i]    = aFusion->mag[i].value();
+        }
+    }
+
+    r2  = (int64_t) a[1] * a[1] + (int64_t) a[2] * a[2];
+    r   = fx_sqrt((uint64_t) r2);
+    g   = fx_sqrt((uint64_t) (r2 + (int64_t) a[0] * a[0]));
+    if (g < ORIENT_MIN_GRAVITY_MG)
+    {
+        /* Free fall or a broken read, no usable gravity reference */
+        return -1;
+    }
+
+    aOut->roll  = fx_atan2_cdeg(a[1], a[2]);
+    if (aOut->roll == ORIENT_CDEG_180)
+    {
+        /* An upside-down cover, keep roll in [-18000, 18000) as documented */
+        aOut->roll  = -ORIENT_CDEG_180;
+    }
+    aOut->pitch = fx_atan2_cdeg(-a[0], (int32_t) r);
+
+    /* De-rotate the field into the horizontal plane. With sin/cos of roll and pitch taken from the
+     * gravity vector (sinR = ay/r, cosR = az/r, sinP = -ax/g, cosP = r/g), both terms are scaled
+     * by g*r, which does not change the angle:
+     *   By = (mz*ay - my*az) * g
+     *   Bx = mx*r^2 - ax*(my*ay + mz*az) */
+    by  = ((int64_t) m[2] * a[1] - (int64_t) m[1] * a[2]) * g;
+    bx  = (int64_t) m[0] * r2 - (int64_t) a[0] * ((int64_t) m[1] * a[1] + (int64_t) m[2] * a[2]);
+    fx_normalize_pair(&by, &bx);
+
+    aOut->heading   = fx_atan2_cdeg((int32_t) by, (int32_t) bx);
+    if (aOut->heading < 0)
+    {
+        aOut->heading  += ORIENT_CDEG_360;
+    }
+    return 0;
+}
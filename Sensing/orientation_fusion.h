@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_ORIENTATION_FUSION_H_
+#define SENSING_ORIENTATION_FUSION_H_
+
+#include <stdint.h>
+#include "sensor_filters.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define ORIENT_LPF_SHIFT                    (2)         /* Low-pass alpha = 1/4 on the raw vectors */
+
+#define ORIENT_CDEG_90                      (9000)
+#define ORIENT_CDEG_180                     (18000)
+#define ORIENT_CDEG_360                     (36000)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Cover orientation, all angles in hundredths of a degree.
+ */
+typedef struct
+{
+    int32_t     pitch;      /* [-9000, 9000] */
+    int32_t     roll;       /* [-18000, 18000) */
+    int32_t     heading;    /* [0, 36000), tilt compensated */
+} Orientation_t;
+
+/** Fusion state: low-pass filters on the accelerometer and magnetometer vectors.
+ * Both sensors are expected to share the same right-handed axis orientation.
+ */
+typedef struct
+{
+    EmaFilter<ORIENT_LPF_SHIFT>     acc[3];
+    EmaFilter<ORIENT_LPF_SHIFT>     mag[3];
+} OrientationFusion_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Fixed-point atan2, result in hundredths of a degree in [-18000, 18000].
+ * Maximum error is below 0.1 degree.
+ */
+int32_t fx_atan2_cdeg(
+    int32_t     aY,
+    int32_t     aX);
+
+/** Integer square root, rounded down.
+ */
+uint32_t fx_sqrt(
+    uint64_t    aVal);
+
+/** Filters one accelerometer (mg) and magnetometer (raw LSB) sample and computes the
+ * pitch, roll and tilt-compensated heading. Pass a NULL aMag when no new magnetometer
+ * sample is available, the heading is then computed from the filtered field as it was.
+ *
+ * @return 0 on success, -1 if the acceleration vector is too small to give an attitude.
+ */
+int orientation_fusion_update(
+    OrientationFusion_t*    aFusion,
+    const int32_t           aAccMg[3],
+    const int32_t           aMag[3],
+    Orientation_t*          aOut);
+
+#endif /* SENSING_ORIENTATION_FUSION_H_ */
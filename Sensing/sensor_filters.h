@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_SENSOR_FILTERS_H_
+#define SENSING_SENSOR_FILTERS_H_
+
+#include <stdint.h>
+
+/*
+ * Streaming filter kernels that sit between a driver read and change detection.
+ *
+ * All kernels work on int32_t samples, keep their window in the object itself and never
+ * allocate, so instances are meant to be declared static, one per channel.
+ * Every update() returns true when *aOut holds a new output sample.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Exponential moving average, alpha = 1 / 2^SHIFT, computed in Q8 fixed point.
+ * Inputs must fit in 23 bits.
+ */
+template <int SHIFT>
+class EmaFilter
+{
+public:
+    EmaFilter() : _acc(0), _primed(false) {}
+
+    bool update(int32_t aIn, int32_t* aOut)
+    {
+        int32_t     in  = aIn * (1 << 8);
+
+        if (!_primed)
+        {
+            /* Start from the first sample instead of ramping up from zero. */
+            _acc    = in;
+            _primed = true;
+        }
+        else
+        {
+            _acc   += (in - _acc) >> SHIFT;
+        }
+        *aOut   = (_acc + (1 << 7)) >> 8;
+        return true;
+    }
+
+    /** Current output without feeding a new sample, 0 before the first one. */
+    int32_t value() const
+    {
+        return (_acc + (1 << 7)) >> 8;
+    }
+
+    void reset()
+    {
+        _primed = false;
+    }
+
+private:
+    int32_t     _acc;
+    bool        _primed;
+};
+
+/** Sliding median over the last N samples. Outputs from the first sample on, over the
+ * samples received so far, so start-up is not delayed by N samples.
+ */
+template <int N>
+class MedianFilter
+{
+public:
+    MedianFilter() : _head(0), _count(0) {}
+
+    bool update(int32_t aIn, int32_t* aOut)
+    {
+        int     pos;
+
+        if (_count == N)
+        {
+            /* Drop the oldest sample from the sorted window. */
+            int32_t     oldest  = _ring[_head];
+
+            for (pos = 0; pos < _count - 1 && _sorted[pos] != oldest; pos++)
+            {
+            }
+            for (; pos < _count - 1; pos++)
+            {
+                _sorted[pos]    = _sorted[pos + 1];
+            }
+            _count--;
+        }
+
+        /* Insertion into the sorted window, O(N). */
+        for (pos = _count; pos > 0 && _sorted[pos - 1] > aIn; pos--)
+        {
+            _sorted[pos]    = _sorted[pos - 1];
+        }
+        _sorted[pos]    = aIn;
+        _count++;
+
+        _ring[_head]    = aIn;
+        _head           = (_head + 1) % N;
+
+        *aOut   = _sorted[(_count - 1) / 2];
+        return true;
+    }
+
+    void reset()
+    {
+        _head   = 0;
+        _count  = 0;
+    }
+
+private:
+    int32_t     _ring[N];
+    int32_t     _sorted[N];
+    int         _head;
+    int         _count;
+};
+
+/** Box (moving sum) filter that decimates by N: outputs the mean of every N input samples.
+ */
+template <int N>
+class BoxDecimator
+{
+public:
+    BoxDecimator() : _sum(0), _count(0) {}
+
+    bool update(int32_t aIn, int32_t* aOut)
+    {
+        _sum   += aIn;
+        if (++_count < N)
+        {
+            return false;
+        }
+
+        *aOut   = (int32_t) ((_sum + ((_sum >= 0) ? N / 2 : -(N / 2))) / N);
+        _sum    = 0;
+        _count  = 0;
+        return true;
+    }
+
+    void reset()
+    {
+        _sum    = 0;
+        _count  = 0;
+    }
+
+private:
+    int64_t     _sum;
+    int         _count;
+};
+
+/** Two kernels in series, e.g. FilterChain<MedianFilter<3>, EmaFilter<2> >.
+ */
+template <typename FIRST, typename SECOND>
+class FilterChain
+{
+public:
+    bool update(int32_t aIn, int32_t* aOut)
+    {
+        int32_t     mid;
+
+        return _first.update(aIn, &mid) && _second.update(mid, aOut);
+    }
+
+    void reset()
+    {
+        _first.reset();
+        _second.reset();
+    }
+
+private:
+    FIRST       _first;
+    SECOND      _second;
+};
+
+#endif /* SENSING_SENSOR_FILTERS_H_ */
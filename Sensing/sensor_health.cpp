@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "mbed.h"
+#include "sensor_health.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void sensor_health_init(
+    SensorHealth_t*             aHealth,
+    const SensorHealthDriver_t* aDrivers,
+    uint32_t                    aCount,
+    void*                       aCtx)
+{
+    MBED_ASSERT(aCount <= SENSOR_HEALTH_MAX);
+
+    memset(aHealth, 0, sizeof(*aHealth));
+    aHealth->drivers    = aDrivers;
+    aHealth->count      = aCount;
+    aHealth->ctx        = aCtx;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void sensor_health_record(
+    SensorHealth_t*         aHealth,
+    uint32_t                aIdx,
+    SensorHealthResult_e    aResult,
+    uint32_t                aNowMs)
+{
+    SensorHealthEntry_t*    entry   = &aHealth->entry[aIdx];
+
+    if (SENSOR_HEALTH_OK == aResult)
+    {
+        entry->consecFails  = 0;
+        return;
+    }
+
+    if (SENSOR_HEALTH_TIMEOUT == aResult)
+    {
+        entry->timeouts++;
+    }
+    else
+    {
+        entry->errors++;
+    }
+    entry->consecFails++;
+
+    if (entry->consecFails >= SENSOR_HEALTH_FAIL_THRESHOLD &&
+        sensor_health_usable(aHealth, aIdx))
+    {
+        aHealth->degradedMask  |= (1UL << aIdx);
+        entry->probeIntervalMs  = SENSOR_HEALTH_PROBE_MIN_MS;
+        entry->nextProbeMs      = aNowMs + SENSOR_HEALTH_PROBE_MIN_MS;
+        LOG_WARN("Sensor %s DEGRADED (errors %u, timeouts %u)", aHealth->drivers[aIdx].name,
+                 (unsigned) entry->errors, (unsigned) entry->timeouts);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int sensor_health_check(
+    SensorHealth_t*     aHealth,
+    uint32_t            aIdx,
+    uint32_t            aNowMs)
+{
+    int     result  = 0;
+
+    if (NULL != aHealth->drivers[aIdx].probe)
+    {
+        result  = aHealth->drivers[aIdx].probe(aHealth->ctx);
+    }
+
+    sensor_health_record(aHealth, aIdx, (0 == result) ? SENSOR_HEALTH_OK : SENSOR_HEALTH_ERROR, aNowMs);
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t sensor_health_supervise(
+    SensorHealth_t*     aHealth,
+    uint32_t            aNowMs)
+{
+    uint32_t    recovered   = 0;
+
+    for (uint32_t i = 0; i < aHealth->count; i++)
+    {
+        SensorHealthEntry_t*        entry   = &aHealth->entry[i];
+        const SensorHealthDriver_t* driver  = &aHealth->drivers[i];
+
+        if (sensor_health_usable(aHealth, i) ||
+            (int32_t) (aNowMs - entry->nextProbeMs) < 0)
+        {
+            continue;
+        }
+
+        if (0 == driver->reinit(aHealth->ctx))
+        {
+            aHealth->degradedMask  &= ~(1UL << i);
+            entry->consecFails      = 0;
+            entry->reinits++;
+            recovered              |= (1UL << i);
+            LOG_WARN("Sensor %s recovered after re-init", driver->name);
+        }
+        else
+        {
+            entry->errors++;
+            entry->probeIntervalMs  = (entry->probeIntervalMs >= SENSOR_HEALTH_PROBE_MAX_MS / 2) ?
+                                      SENSOR_HEALTH_PROBE_MAX_MS : (entry->probeIntervalMs * 2);
+            entry->nextProbeMs      = aNowMs + entry->probeIntervalMs;
+            LOG_WARN("Sensor %s re-init failed, next attempt in %u ms", driver->name, (unsigned) entry->probeIntervalMs);
+        }
+    }
+    return recovered;
+}
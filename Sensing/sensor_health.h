@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_SENSOR_HEALTH_H_
+#define SENSING_SENSOR_HEALTH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define SENSOR_HEALTH_MAX                   (8)
+#define SENSOR_HEALTH_FAIL_THRESHOLD        (3)         /* Consecutive failures before a sensor is degraded */
+#define SENSOR_HEALTH_PROBE_MIN_MS          (5000)      /* First re-probe after degrading */
+#define SENSOR_HEALTH_PROBE_MAX_MS          (300000)    /* Re-probe interval doubles up to this */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    SENSOR_HEALTH_OK,
+    SENSOR_HEALTH_ERROR,        /* Bus error or bad identity */
+    SENSOR_HEALTH_TIMEOUT       /* Device answered but data never became ready */
+} SensorHealthResult_e;
+
+/** Driver hooks, both return 0 on success. aCtx is the context given to sensor_health_init().
+ * probe only checks that the device answers and may be NULL when the driver reports its own
+ * errors. reinit brings a single device back to a working state, verifies its identity, and
+ * must not touch the other sensors on the bus.
+ */
+typedef int (*SensorHealthFn_t)(void* aCtx);
+
+typedef struct
+{
+    const char*         name;
+    SensorHealthFn_t    probe;
+    SensorHealthFn_t    reinit;
+} SensorHealthDriver_t;
+
+typedef struct
+{
+    uint32_t    errors;
+    uint32_t    timeouts;
+    uint32_t    reinits;            /* Successful re-initializations */
+    uint16_t    consecFails;
+    uint32_t    nextProbeMs;
+    uint32_t    probeIntervalMs;
+} SensorHealthEntry_t;
+
+typedef struct
+{
+    const SensorHealthDriver_t* drivers;
+    uint32_t                    count;
+    void*                       ctx;
+
+    SensorHealthEntry_t         entry[SENSOR_HEALTH_MAX];
+    uint32_t                    degradedMask;
+} SensorHealth_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Sensor i of the supervisor is aDrivers[i]. All sensors start healthy.
+ */
+void sensor_health_init(
+    SensorHealth_t*             aHealth,
+    const SensorHealthDriver_t* aDrivers,
+    uint32_t                    aCount,
+    void*                       aCtx);
+
+/** Records the outcome of one access to a sensor. SENSOR_HEALTH_FAIL_THRESHOLD consecutive
+ * failures mark it degraded until sensor_health_supervise() brings it back.
+ */
+void sensor_health_record(
+    SensorHealth_t*         aHealth,
+    uint32_t                aIdx,
+    SensorHealthResult_e    aResult,
+    uint32_t                aNowMs);
+
+/** Probes a sensor whose driver has no error path of its own and records the outcome.
+ *
+ * @return 0 if the sensor answered.
+ */
+int sensor_health_check(
+    SensorHealth_t*     aHealth,
+    uint32_t            aIdx,
+    uint32_t            aNowMs);
+
+/** Re-initializes degraded sensors whose re-probe is due, backing off exponentially while
+ * they keep failing.
+ *
+ * @return Mask of the sensors that recovered.
+ */
+uint32_t sensor_health_supervise(
+    SensorHealth_t*     aHealth,
+    uint32_t            aNowMs);
+
+/** True while a sensor is not degraded, degraded sensors should not be read.
+ */
+static inline bool sensor_health_usable(
+    const SensorHealth_t*   aHealth,
+    uint32_t                aIdx)
+{
+    return 0 == (aHealth->degradedMask & (1UL << aIdx));
+}
+
+#endif /* SENSING_SENSOR_HEALTH_H_ */
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include "sensor_power.h"
+#include "platform_clock.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define PWR_TILT_ADDR                       ((uint8_t) (0x30))
+#define PWR_ENV_ADDR                        ((uint8_t) (0xEC))
+#define PWR_LIGHT_ADDR                      ((uint8_t) (0x88))
+#define PWR_MAGN_ADDR                       ((uint8_t) (0x3C))
+
+#define LIS3DH_REG_CTRL1                    (0x20)
+#define BME280_REG_CTRL_HUM                 (0xF2)
+#define BME280_REG_CTRL_MEAS                (0xF4)
+#define BME280_REG_CONFIG                   (0xF5)
+#define OPT3001_REG_CONFIG                  (0x01)
+#define LIS2MDL_REG_CFG_A                   (0x60)
+
+#define BME280_MODE_MASK                    (0x03)
+#define BME280_MODE_FORCED                  (0x01)
+#define BME280_MODE_SLEEP                   (0x00)
+
+#define OPT3001_MODE_MASK                   (0x0600)
+#define OPT3001_MODE_SINGLE                 (0x0200)
+#define OPT3001_MODE_SHUTDOWN               (0x0000)
+
+#define LIS2MDL_MODE_MASK                   (0x03)
+#define LIS2MDL_MODE_SINGLE                 (0x01)
+#define LIS2MDL_MODE_IDLE                   (0x03)
+
+#define VL53L1X_BOOT_MS                     (2)     // 1.2 ms sensor boot (Fig 7 in data sheet)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static int pwr_write8(
+    I2C*        aI2c,
+    uint8_t     aAddr,
+    uint8_t     aReg,
+    uint8_t     aVal)
+{
+    char    buf[2] = { (char) aReg, (char) aVal };
+
+    return aI2c->write(aAddr, buf, sizeof(buf));
+}
+
+static int pwr_write16(
+    I2C*        aI2c,
+    uint8_t     aAddr,
+    uint8_t     aReg,
+    uint16_t    aVal)
+{
+    char    buf[3] = { (char) aReg, (char) (aVal >> 8), (char) (aVal & 0xFF) };
+
+    return aI2c->write(aAddr, buf, sizeof(buf));
+}
+
+static void pwr_dist_on(
+    SensorPower_t*  aPwr)
+{
+    *aPwr->distXshut = 1;
+    platform_sleep_ms(VL53L1X_BOOT_MS);
+    aPwr->dist->setDistanceMode(aPwr->profile->distMode);
+}
+
+/* Writes the idle state of one sensor for the current profile. Continuous settings are written
+ * here once, one-shot ones are armed in sensor_power_wake().
+ */
+static int pwr_apply(
+    SensorPower_t*  aPwr,
+    int             aSensor)
+{
+    const SensorProfile_t*  profile = aPwr->profile;
+    int                     result  = 0;
+
+    switch (aSensor)
+    {
+        case PROFILE_SENSOR_TILT:
+            result |= pwr_write8(aPwr->i2c, PWR_TILT_ADDR, LIS3DH_REG_CTRL1, profile->tiltCtrlReg1Idle);
+            break;
+
+        case PROFILE_SENSOR_ENV:
+            result |= pwr_write8(aPwr->i2c, PWR_ENV_ADDR, BME280_REG_CONFIG, profile->envConfig);
+            result |= pwr_write8(aPwr->i2c, PWR_ENV_ADDR, BME280_REG_CTRL_HUM, profile->envCtrlHum);
+            if (BME280_MODE_FORCED == (profile->envCtrlMeas & BME280_MODE_MASK))
+            {
+                result |= pwr_write8(aPwr->i2c, PWR_ENV_ADDR, BME280_REG_CTRL_MEAS, (profile->envCtrlMeas & ~BME280_MODE_MASK) | BME280_MODE_SLEEP);
+            }
+            else
+            {
+                result |= pwr_write8(aPwr->i2c, PWR_ENV_ADDR, BME280_REG_CTRL_MEAS, profile->envCtrlMeas);
+            }
+            break;
+
+        case PROFILE_SENSOR_LIGHT:
+            if (OPT3001_MODE_SINGLE == (profile->lightConfig & OPT3001_MODE_MASK))
+            {
+                result |= pwr_write16(aPwr->i2c, PWR_LIGHT_ADDR, OPT3001_REG_CONFIG, (profile->lightConfig & ~OPT3001_MODE_MASK) | OPT3001_MODE_SHUTDOWN);
+            }
+            else
+            {
+                result |= pwr_write16(aPwr->i2c, PWR_LIGHT_ADDR, OPT3001_REG_CONFIG, profile->lightConfig);
+            }
+            break;
+
+        case PROFILE_SENSOR_DIST:
+            if (profile->distShutdown)
+            {
+                *aPwr->distXshut = 0;
+            }
+            else
+            {
+                pwr_dist_on(aPwr);
+            }
+            break;
+
+        case PROFILE_SENSOR_MAGN:
+            if (LIS2MDL_MODE_SINGLE == (profile->magnCfgRegA & LIS2MDL_MODE_MASK))
+            {
+                result |= pwr_write8(aPwr->i2c, PWR_MAGN_ADDR, LIS2MDL_REG_CFG_A, (profile->magnCfgRegA & ~LIS2MDL_MODE_MASK) | LIS2MDL_MODE_IDLE);
+            }
+            else
+            {
+                result |= pwr_write8(aPwr->i2c, PWR_MAGN_ADDR, LIS2MDL_REG_CFG_A, profile->magnCfgRegA);
+            }
+            break;
+
+        default:
+            result  = -1;
+            break;
+    }
+    return result;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void sensor_power_init(
+    SensorPower_t*  aPwr,
+    I2C*            aI2c,
+    DigitalOut*     aDistXshut,
+    VL53L1X*        aDist)
+{
+    aPwr->i2c       = aI2c;
+    aPwr->distXshut = aDistXshut;
+    aPwr->dist      = aDist;
+    aPwr->profile   = NULL;
+    aPwr->wakeMs    = 0;
+    aPwr->settleMs  = 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int sensor_power_select(
+    SensorPower_t*  aPwr,
+    int             aProfile)
+{
+    const SensorProfile_t*  profile = sensor_profile_get(aProfile);
+    int                     result  = 0;
+
+    if (NULL == profile)
+    {
+        LOG_ERROR("%s: Invalid sensor profile %d", __func__, aProfile);
+        return -1;
+    }
+    aPwr->profile   = profile;
+
+    for (int i = 0; i < PROFILE_SENSOR_COUNT; i++)
+    {
+        result |= pwr_apply(aPwr, i);
+    }
+
+    LOG_HI("Sensor profile %s selected", profile->name);
+    return (0 == result) ? 0 : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void sensor_power_wake(
+    SensorPower_t*  aPwr)
+{
+    const SensorProfile_t*  profile = aPwr->profile;
+
+    aPwr->settleMs  = 0;
+    for (int i = 0; i < PROFILE_SENSOR_COUNT; i++)
+    {
+        /* The ranging sensor is started by the caller and polled, it needs no settle time here */
+        if (PROFILE_SENSOR_DIST != i && profile->current[i].activeMs > aPwr->settleMs)
+        {
+            aPwr->settleMs  = profile->current[i].activeMs;
+        }
+    }
+
+    if (profile->tiltCtrlReg1 != profile->tiltCtrlReg1Idle)
+    {
+        pwr_write8(aPwr->i2c, PWR_TILT_ADDR, LIS3DH_REG_CTRL1, profile->tiltCtrlReg1);
+    }
+    if (BME280_MODE_FORCED == (profile->envCtrlMeas & BME280_MODE_MASK))
+    {
+        pwr_write8(aPwr->i2c, PWR_ENV_ADDR, BME280_REG_CTRL_MEAS, profile->envCtrlMeas);
+    }
+    if (OPT3001_MODE_SINGLE == (profile->lightConfig & OPT3001_MODE_MASK))
+    {
+        pwr_write16(aPwr->i2c, PWR_LIGHT_ADDR, OPT3001_REG_CONFIG, profile->lightConfig);
+    }
+    if (LIS2MDL_MODE_SINGLE == (profile->magnCfgRegA & LIS2MDL_MODE_MASK))
+    {
+        pwr_write8(aPwr->i2c, PWR_MAGN_ADDR, LIS2MDL_REG_CFG_A, profile->magnCfgRegA);
+    }
+    if (profile->distShutdown)
+    {
+        pwr_dist_on(aPwr);
+    }
+
+    aPwr->wakeMs    = platform_now_ms();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void sensor_power_wait_ready(
+    SensorPower_t*  aPwr)
+{
+    uint32_t    elapsed = platform_now_ms() - aPwr->wakeMs;
+
+    if (elapsed < aPwr->settleMs)
+    {
+        platform_sleep_ms(aPwr->settleMs - elapsed);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void sensor_power_sleep(
+    SensorPower_t*  aPwr)
+{
+    const SensorProfile_t*  profile = aPwr->profile;
+
+    /* BME280, OPT3001 and LIS2MDL drop back to sleep on their own after a one-shot conversion */
+    if (profile->tiltCtrlReg1 != profile->tiltCtrlReg1Idle)
+    {
+        pwr_write8(aPwr->i2c, PWR_TILT_ADDR, LIS3DH_REG_CTRL1, profile->tiltCtrlReg1Idle);
+    }
+    if (profile->distShutdown)
+    {
+        *aPwr->distXshut = 0;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int sensor_power_restore(
+    SensorPower_t*  aPwr,
+    int             aSensor)
+{
+    return (0 == pwr_apply(aPwr, aSensor)) ? 0 : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void sensor_power_reset_dist(
+    SensorPower_t*  aPwr)
+{
+    /* A full power cycle through XSHUT, the other sensors on the bus are not affected */
+    *aPwr->distXshut = 0;
+    platform_sleep_ms(VL53L1X_BOOT_MS);
+    pwr_dist_on(aPwr);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_SENSOR_POWER_H_
+#define SENSING_SENSOR_POWER_H_
+
+#include "mbed.h"
+#include "VL53L1X.h"
+#include "sensor_profiles.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Applies a SensorProfile_t to the manhole sensors. Registers are written over the shared
+ * I2C bus; the VL53L1X is additionally power gated through its XSHUT line.
+ */
+typedef struct
+{
+    I2C*                    i2c;
+    DigitalOut*             distXshut;
+    VL53L1X*                dist;
+
+    const SensorProfile_t*  profile;
+    uint32_t                wakeMs;     /* When the current sample was triggered */
+    uint32_t                settleMs;   /* Conversion time of the slowest one-shot sensor */
+} SensorPower_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void sensor_power_init(
+    SensorPower_t*  aPwr,
+    I2C*            aI2c,
+    DigitalOut*     aDistXshut,
+    VL53L1X*        aDist);
+
+/** Switches all sensors to a profile (SENSOR_PROFILE_*), can be called at any time.
+ *
+ * @return 0 on success, -1 on an unknown profile or an I2C failure.
+ */
+int sensor_power_select(
+    SensorPower_t*  aPwr,
+    int             aProfile);
+
+/** Powers the sensors up and triggers one-shot conversions for the next sample.
+ */
+void sensor_power_wake(
+    SensorPower_t*  aPwr);
+
+/** Blocks until the conversions triggered by sensor_power_wake() are complete. Returns at
+ * once if that time has already passed.
+ */
+void sensor_power_wait_ready(
+    SensorPower_t*  aPwr);
+
+/** Powers the sensors down until the next sensor_power_wake().
+ */
+void sensor_power_sleep(
+    SensorPower_t*  aPwr);
+
+/** Rewrites the idle state of one sensor (PROFILE_SENSOR_*) for the current profile, used after
+ * the sensor was re-initialized on its own.
+ *
+ * @return 0 on success, -1 on an I2C failure.
+ */
+int sensor_power_restore(
+    SensorPower_t*  aPwr,
+    int             aSensor);
+
+/** Power cycles the VL53L1X through XSHUT and leaves it booted with the profile distance mode.
+ * Call sensor_power_restore() afterwards to return it to the profile idle state.
+ */
+void sensor_power_reset_dist(
+    SensorPower_t*  aPwr);
+
+#endif /* SENSING_SENSOR_POWER_H_ */
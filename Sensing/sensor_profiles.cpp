@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stddef.h>
+#include "sensor_profiles.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static const SensorProfile_t profiles[SENSOR_PROFILE_COUNT] =
+{
+    /* FAST: everything converting continuously, as the drivers come up by default */
+    {
+        "FAST", 1000,
+        0x47, 0x47,                 /* LIS3DH 50 Hz normal mode, always on */
+        0x01, 0x27, 0xA0,           /* BME280 normal mode, x1 oversampling, 1 s standby */
+        0xCC10,                     /* OPT3001 continuous, 800 ms conversions */
+        0, false,                   /* VL53L1X short range, ranging continuously */
+        0x80,                       /* LIS2MDL continuous, 10 Hz, high resolution */
+        {
+            /* activeNa,  idleNa,  activeMs */
+            {  0,         11000,   0 },
+            {  0,         3600,    0 },
+            {  0,         1800,    0 },
+            {  0,         18000000,0 },
+            {  0,         137000,  0 },
+        }
+    },
+    /* BALANCED: forced/single-shot conversions once per cycle, ranging sensor shut down */
+    {
+        "BALANCED", 2000,
+        0x2F, 0x2F,                 /* LIS3DH 10 Hz low-power mode, always on */
+        0x01, 0x25, 0x00,           /* BME280 forced mode, x1 oversampling, no filter */
+        0xC210,                     /* OPT3001 single-shot, 100 ms conversion */
+        0, true,                    /* VL53L1X short range, XSHUT between samples */
+        0x91,                       /* LIS2MDL single mode, low power */
+        {
+            {  0,         3000,    0 },
+            {  700000,    100,     9 },
+            {  1800,      300,     110 },
+            {  18000000,  5000,    60 },
+            {  100000,    2000,    10 },
+        }
+    },
+    /* ULTRA_LOW_POWER: as BALANCED, with the accelerometer powered down and a long cycle */
+    {
+        "ULTRA_LOW_POWER", 10000,
+        0x5F, 0x08,                 /* LIS3DH 100 Hz low-power while sampling, power-down otherwise */
+        0x01, 0x25, 0x00,
+        0xC210,
+        0, true,
+        0x91,
+        {
+            {  10000,     500,     20 },
+            {  700000,    100,     9 },
+            {  1800,      300,     110 },
+            {  18000000,  5000,    60 },
+            {  100000,    2000,    10 },
+        }
+    },
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+const SensorProfile_t* sensor_profile_get(
+    int     aProfile)
+{
+    if (aProfile < 0 || aProfile >= SENSOR_PROFILE_COUNT)
+    {
+        return NULL;
+    }
+    return &profiles[aProfile];
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t sensor_profile_current_na(
+    const SensorProfile_t*  aProfile,
+    uint32_t                aPeriodMs)
+{
+    uint64_t    chargeNaMs  = 0;
+
+    if (0 == aPeriodMs)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < PROFILE_SENSOR_COUNT; i++)
+    {
+        const SensorCurrent_t*  cur         = &aProfile->current[i];
+        uint32_t                activeMs    = (cur->activeMs < aPeriodMs) ? cur->activeMs : aPeriodMs;
+
+        chargeNaMs += (uint64_t) cur->activeNa * activeMs +
+                      (uint64_t) cur->idleNa * (aPeriodMs - activeMs);
+    }
+    return (uint32_t) (chargeNaMs / aPeriodMs);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t sensor_profile_battery_hours(
+    const SensorProfile_t*  aProfile,
+    uint32_t                aPeriodMs,
+    uint32_t                aCapacityMah)
+{
+    uint32_t    currentNa   = sensor_profile_current_na(aProfile, aPeriodMs);
+
+    if (0 == currentNa)
+    {
+        return UINT32_MAX;
+    }
+    return (uint32_t) (((uint64_t) aCapacityMah * 1000000) / currentNa);
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_SENSOR_PROFILES_H_
+#define SENSING_SENSOR_PROFILES_H_
+
+#include <stdint.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define SENSOR_PROFILE_FAST                 0
+#define SENSOR_PROFILE_BALANCED             1
+#define SENSOR_PROFILE_ULTRA_LOW_POWER      2
+#define SENSOR_PROFILE_COUNT                3
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Sensors covered by a profile, in the order of SensorProfile_t::current.
+ */
+typedef enum
+{
+    PROFILE_SENSOR_TILT,
+    PROFILE_SENSOR_ENV,
+    PROFILE_SENSOR_LIGHT,
+    PROFILE_SENSOR_DIST,
+    PROFILE_SENSOR_MAGN,
+    PROFILE_SENSOR_COUNT
+} ProfileSensor_e;
+
+/** Expected current of one sensor: activeNa for activeMs of each sample, idleNa otherwise.
+ * Continuous modes have activeMs = 0 and their running current in idleNa.
+ */
+typedef struct
+{
+    uint32_t    activeNa;
+    uint32_t    idleNa;
+    uint16_t    activeMs;
+} SensorCurrent_t;
+
+/** One acquisition profile: register settings for every driver and the current they imply.
+ * Typical datasheet currents, enough to size batteries, not to replace a measurement.
+ */
+typedef struct
+{
+    const char*     name;
+    uint32_t        samplePeriodMs;     /* Minimum acquisition cycle */
+
+    uint8_t         tiltCtrlReg1;       /* LIS3DH CTRL_REG1 while sampling */
+    uint8_t         tiltCtrlReg1Idle;   /* LIS3DH CTRL_REG1 between samples */
+
+    uint8_t         envCtrlHum;         /* BME280 ctrl_hum */
+    uint8_t         envCtrlMeas;        /* BME280 ctrl_meas, forced mode is re-armed on every sample */
+    uint8_t         envConfig;          /* BME280 config */
+
+    uint16_t        lightConfig;        /* OPT3001 configuration, single-shot is re-armed on every sample */
+
+    uint8_t         distMode;           /* VL53L1X distance mode */
+    bool            distShutdown;       /* Hold VL53L1X in XSHUT between samples */
+
+    uint8_t         magnCfgRegA;        /* LIS2MDL CFG_REG_A, single mode is re-armed on every sample */
+
+    SensorCurrent_t current[PROFILE_SENSOR_COUNT];
+} SensorProfile_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Profile table entry, NULL for an unknown profile.
+ */
+const SensorProfile_t* sensor_profile_get(
+    int     aProfile);
+
+/** Expected average current of all sensors in nA, sampling every aPeriodMs.
+ */
+uint32_t sensor_profile_current_na(
+    const SensorProfile_t*  aProfile,
+    uint32_t                aPeriodMs);
+
+/** Expected battery life in hours for the sensors alone.
+ */
+uint32_t sensor_profile_battery_hours(
+    const SensorProfile_t*  aProfile,
+    uint32_t                aPeriodMs,
+    uint32_t                aCapacityMah);
+
+#endif /* SENSING_SENSOR_PROFILES_H_ */
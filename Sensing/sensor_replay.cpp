@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stddef.h>
+#include "sensor_replay.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void sensor_replay_init(
+    SensorReplay_t*         aReplay,
+    const SensorFrame_t*    aFrames,
+    uint32_t                aCount)
+{
+    aReplay->frames = aFrames;
+    aReplay->count  = aCount;
+    aReplay->next   = 0;
+    aReplay->laps   = 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+const SensorFrame_t* sensor_replay_next(
+    SensorReplay_t*         aReplay)
+{
+    const SensorFrame_t*    frame;
+
+    if (0 == aReplay->count)
+    {
+        return NULL;
+    }
+
+    frame   = &aReplay->frames[aReplay->next++];
+    if (aReplay->next >= aReplay->count)
+    {
+        aReplay->next   = 0;
+        aReplay->laps++;
+    }
+    return frame;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSING_SENSOR_REPLAY_H_
+#define SENSING_SENSOR_REPLAY_H_
+
+#include <stdint.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define REPLAY_VALID_TILT                   (0x01)
+#define REPLAY_VALID_ENV                    (0x02)
+#define REPLAY_VALID_LIGHT                  (0x04)
+#define REPLAY_VALID_DIST                   (0x08)
+#define REPLAY_VALID_MAGN                   (0x10)
+#define REPLAY_VALID_ANALOG                 (0x20)
+#define REPLAY_VALID_ALL                    (0x3F)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** One acquisition cycle worth of raw readings, in the units the drivers return. A reading whose
+ * REPLAY_VALID_* bit is clear is treated like a sensor that did not answer.
+ */
+typedef struct
+{
+    int16_t     accMg[3];
+    int16_t     mag[3];             /* Raw LIS2MDL LSB */
+    int32_t     temperature;        /* degC */
+    int32_t     pressure;           /* hPa */
+    int32_t     humidity;           /* %RH */
+    int32_t     light;              /* lux */
+    int32_t     dist;               /* cm */
+    int32_t     batteryMv;
+    int32_t     flexMv;
+    uint8_t     valid;              /* REPLAY_VALID_* */
+} SensorFrame_t;
+
+/** Plays a recorded trace in place of the sensor drivers, one frame per cycle, so the
+ * processing chain sees the same input on every run.
+ */
+typedef struct
+{
+    const SensorFrame_t*    frames;
+    uint32_t                count;
+    uint32_t                next;
+    uint32_t                laps;           /* Completed passes over the trace */
+} SensorReplay_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void sensor_replay_init(
+    SensorReplay_t*         aReplay,
+    const SensorFrame_t*    aFrames,
+    uint32_t                aCount);
+
+/** @return The next frame, starting over at the end of the trace.
+ */
+const SensorFrame_t* sensor_replay_next(
+    SensorReplay_t*         aReplay);
+
+#endif /* SENSING_SENSOR_REPLAY_H_ */
@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "timeseries.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define TS_VARINT_MAX                       (5)     /* Bytes of a 32 bit varint */
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static inline uint32_t ts_zigzag(
+    int32_t     aVal)
+{
+    return ((uint32_t) aVal << 1) ^ (uint32_t) (aVal >> 31);
+}
+
+static inline int32_t ts_unzigzag(
+    uint32_t    aVal)
+{
+    return (int32_t) (aVal >> 1) ^ -(int32_t) (aVal & 1);
+}
+
+/* Encodes into aBuf in order, returns the length. */
+static int ts_varint_encode(
+    uint32_t    aVal,
+    uint8_t     aBuf[TS_VARINT_MAX])
+{
+    int     len = 0;
+
+    while (aVal >= 0x80)
+    {
+        aBuf[len++] = (uint8_t) (aVal | 0x80);
+        aVal      >>= 7;
+    }
+    aBuf[len++] = (uint8_t) aVal;
+    return len;
+}
+
+/* The value column grows down from the end of data[], its bytes are read at decreasing addresses. */
+static inline uint8_t* ts_val_byte(
+    TsBlock_t*  aBlock,
+    int         aPos)
+{
+    return &aBlock->data[TS_BLOCK_DATA - 1 - aPos];
+}
+
+static uint32_t ts_varint_decode_up(
+    const uint8_t*  aData,
+    uint8_t*        aPos)
+{
+    uint32_t    val     = 0;
+    int         shift   = 0;
+    uint8_t     byte;
+
+    do
+    {
+        byte    = aData[(*aPos)++];
+        val    |= (uint32_t) (byte & 0x7F) << shift;
+        shift  += 7;
+    } while (byte & 0x80);
+    return val;
+}
+
+static uint32_t ts_varint_decode_down(
+    const uint8_t*  aData,
+    uint8_t*        aPos)
+{
+    uint32_t    val     = 0;
+    int         shift   = 0;
+    uint8_t     byte;
+
+    do
+    {
+        byte    = aData[TS_BLOCK_DATA - 1 - (*aPos)++];
+        val    |= (uint32_t) (byte & 0x7F) << shift;
+        shift  += 7;
+    } while (byte & 0x80);
+    return val;
+}
+
+/* Unlinks the oldest head block of all channels. Channels with a single block are only
+ * considered when there is nothing else, they lose their whole history then. */
+static uint16_t ts_evict(
+    TimeSeries_t*   aTs)
+{
+    int         victim  = -1;
+    bool        single  = true;
+
+    for (uint32_t i = 0; i < aTs->channelCount; i++)
+    {
+        const TsChannel_t*  chn = &aTs->channel[i];
+        bool                one;
+
+        if (TS_NONE == chn->head)
+        {
+            continue;
+        }
+        one = (chn->head == chn->tail);
+        if (-1 == victim ||
+            (single && !one) ||
+            (single == one && (int32_t) (aTs->blocks[chn->head].t0 - aTs->blocks[aTs->channel[victim].head].t0) < 0))
+        {
+            victim  = i;
+            single  = one;
+        }
+    }
+    if (-1 == victim)
+    {
+        return TS_NONE;
+    }
+
+    TsChannel_t*    chn     = &aTs->channel[victim];
+    uint16_t        block   = chn->head;
+
+    chn->head       = aTs->blocks[block].next;
+    chn->count     -= aTs->blocks[block].count;
+    aTs->evicted   += aTs->blocks[block].count;
+    if (TS_NONE == chn->head)
+    {
+        chn->tail   = TS_NONE;
+    }
+    return block;
+}
+
+static uint16_t ts_alloc(
+    TimeSeries_t*   aTs)
+{
+    uint16_t    block   = aTs->freeList;
+
+    if (TS_NONE != block)
+    {
+        aTs->freeList   = aTs->blocks[block].next;
+    }
+    else
+    {
+        block   = ts_evict(aTs);
+    }
+    return block;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void timeseries_init(
+    TimeSeries_t*   aTs,
+    TsBlock_t*      aBlocks,
+    uint32_t        aBlockCount,
+    uint32_t        aChannels)
+{
+    memset(aTs, 0, sizeof(*aTs));
+    aTs->blocks         = aBlocks;
+    aTs->blockCount     = (uint16_t) ((aBlockCount < TS_NONE) ? aBlockCount : (TS_NONE - 1));
+    aTs->channelCount   = (aChannels < TS_MAX_CHANNELS) ? aChannels : TS_MAX_CHANNELS;
+
+    aTs->freeList       = (0 == aTs->blockCount) ? TS_NONE : 0;
+    for (uint16_t i = 0; i < aTs->blockCount; i++)
+    {
+        aBlocks[i].next = (i + 1 < aTs->blockCount) ? (uint16_t) (i + 1) : TS_NONE;
+    }
+    for (uint32_t i = 0; i < TS_MAX_CHANNELS; i++)
+    {
+        aTs->channel[i].head    = TS_NONE;
+        aTs->channel[i].tail    = TS_NONE;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int timeseries_append(
+    TimeSeries_t*   aTs,
+    uint32_t        aChannel,
+    uint32_t        aTimeMs,
+    int32_t         aValue)
+{
+    TsChannel_t*    chn;
+    TsBlock_t*      block;
+    uint16_t        idx;
+    uint8_t         tsBuf[TS_VARINT_MAX];
+    uint8_t         valBuf[TS_VARINT_MAX];
+    int             tsLen;
+    int             valLen;
+    int32_t         deltaMs;
+
+    if (aChannel >= aTs->channelCount)
+    {
+        return -1;
+    }
+    chn     = &aTs->channel[aChannel];
+
+    if (TS_NONE != chn->tail)
+    {
+        deltaMs = (int32_t) (aTimeMs - chn->lastMs);
+        tsLen   = ts_varint_encode(ts_zigzag(deltaMs - chn->lastDeltaMs), tsBuf);
+        valLen  = ts_varint_encode(ts_zigzag((int32_t) ((uint32_t) aValue - (uint32_t) chn->lastVal)), valBuf);
+        block   = &aTs->blocks[chn->tail];
+
+        if (block->tsUsed + block->valUsed + tsLen + valLen <= TS_BLOCK_DATA)
+        {
+            memcpy(&block->data[block->tsUsed], tsBuf, tsLen);
+            for (int i = 0; i < valLen; i++)
+            {
+                *ts_val_byte(block, block->valUsed + i) = valBuf[i];
+            }
+            block->tsUsed      += tsLen;
+            block->valUsed     += valLen;
+            block->count++;
+
+            chn->lastMs         = aTimeMs;
+            chn->lastVal        = aValue;
+            chn->lastDeltaMs    = deltaMs;
+            chn->count++;
+            return 0;
+        }
+    }
+
+    /* Start a new block with the sample in its header */
+    idx     = ts_alloc(aTs);
+    if (TS_NONE == idx)
+    {
+        return -1;
+    }
+    block           = &aTs->blocks[idx];
+    block->t0       = aTimeMs;
+    block->v0       = aValue;
+    block->next     = TS_NONE;
+    block->count    = 1;
+    block->tsUsed   = 0;
+    block->valUsed  = 0;
+
+    /* Eviction may have emptied this very channel */
+    if (TS_NONE == chn->tail)
+    {
+        chn->head   = idx;
+    }
+    else
+    {
+        aTs->blocks[chn->tail].next = idx;
+    }
+    chn->tail           = idx;
+    chn->lastMs         = aTimeMs;
+    chn->lastVal        = aValue;
+    chn->lastDeltaMs    = 0;
+    chn->count++;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void timeseries_iter_init(
+    TsIter_t*           aIter,
+    const TimeSeries_t* aTs,
+    uint32_t            aChannel,
+    uint32_t            aFromMs)
+{
+    memset(aIter, 0, sizeof(*aIter));
+    aIter->ts       = aTs;
+    aIter->fromMs   = aFromMs;
+    aIter->block    = (aChannel < aTs->channelCount) ? aTs->channel[aChannel].head : TS_NONE;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+bool timeseries_iter_next(
+    TsIter_t*       aIter,
+    TsSample_t*     aSample)
+{
+    const TsBlock_t*    block;
+
+    while (TS_NONE != aIter->block)
+    {
+        block   = &aIter->ts->blocks[aIter->block];
+
+        if (0 == aIter->idx)
+        {
+            /* Skip whole blocks that end before aFromMs */
+            if (TS_NONE != block->next &&
+                (int32_t) (aIter->ts->blocks[block->next].t0 - aIter->fromMs) <= 0)
+            {
+                aIter->block    = block->next;
+                continue;
+            }
+            aIter->timeMs   = block->t0;
+            aIter->value    = block->v0;
+            aIter->deltaMs  = 0;
+            aIter->tsPos    = 0;
+            aIter->valPos   = 0;
+        }
+        else if (aIter->idx < block->count)
+        {
+            aIter->deltaMs += ts_unzigzag(ts_varint_decode_up(block->data, &aIter->tsPos));
+            aIter->timeMs  += (uint32_t) aIter->deltaMs;
+            aIter->value    = (int32_t) ((uint32_t) aIter->value + (uint32_t) ts_unzigzag(ts_varint_decode_down(block->data, &aIter->valPos)));
+        }
+        else
+        {
+            aIter->block    = block->next;
+            aIter->idx      = 0;
+            continue;
+        }
+        aIter->idx++;
+
+        if ((int32_t) (aIter->timeMs - aIter->fromMs) >= 0)
+        {
+            aSample->timeMs = aIter->timeMs;
+            aSample->value  = aIter->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void timeseries_stats(
+    const TimeSeries_t* aTs,
+    uint32_t            aChannel,
+    uint32_t            aFromMs,
+    TsStats_t*          aStats)
+{
+    TsIter_t    iter;
+    TsSample_t  sample;
+    int64_t     sum     = 0;
+
+    memset(aStats, 0, sizeof(*aStats));
+    timeseries_iter_init(&iter, aTs, aChannel, aFromMs);
+    while (timeseries_iter_next(&iter, &sample))
+    {
+        if (0 == aStats->count)
+        {
+            aStats->min     = sample.value;
+            aStats->max     = sample.value;
+            aStats->firstMs = sample.timeMs;
+        }
+        else if (sample.value < aStats->min)
+        {
+            aStats->min     = sample.value;
+        }
+        else if (sample.value > aStats->max)
+        {
+            aStats->max     = sample.value;
+        }
+        aStats->lastMs  = sample.timeMs;
+        sum            += sample.value;
+        aStats->count++;
+    }
+    if (aStats->count)
+    {
+        aStats->mean    = (int32_t) (sum / (int64_t) aStats->count);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void timeseries_usage(
+    const TimeSeries_t* aTs,
+    uint32_t*           aSamples,
+    uint32_t*           aBytes)
+{
+    uint32_t    samples = 0;
+    uint32_t    blocks  = 0;
+
+    for (uint32_t i = 0; i < aTs->channelCount; i++)
+    {
+        samples    += aTs->channel[i].count;
+        for (uint16_t b = aTs->channel[i].head; TS_NONE != b; b = aTs->blocks[b].next)
+        {
+            blocks++;
+        }
+    }
+    *aSamples   = samples;
+    *aBytes     = blocks * sizeof(TsBlock_t);
+}
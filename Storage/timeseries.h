@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STORAGE_TIMESERIES_H_
+#define STORAGE_TIMESERIES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define TS_MAX_CHANNELS                     (16)
+#define TS_BLOCK_DATA                       (114)   /* Encoded bytes per block, the block is 128 bytes in total */
+#define TS_NONE                             (0xFFFF)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** One block of a channel's history. The first sample is kept in the header, the following ones
+ * are encoded in two columns sharing data[]: timestamps as zig-zag varint delta-of-deltas growing
+ * up from the start, values as zig-zag varint deltas growing down from the end. Blocks decode on
+ * their own, so the oldest block can be evicted without touching the rest.
+ */
+typedef struct
+{
+    uint32_t    t0;                 /* Timestamp of the first sample, ms */
+    int32_t     v0;                 /* Value of the first sample */
+    uint16_t    next;               /* Next block of the same channel, TS_NONE at the tail */
+    uint16_t    count;              /* Samples in the block, including the first one */
+    uint8_t     tsUsed;             /* Bytes of the timestamp column */
+    uint8_t     valUsed;            /* Bytes of the value column */
+    uint8_t     data[TS_BLOCK_DATA];
+} TsBlock_t;
+
+typedef struct
+{
+    uint16_t    head;               /* Oldest block, TS_NONE when empty */
+    uint16_t    tail;               /* Block being appended to */
+    uint32_t    lastMs;
+    int32_t     lastVal;
+    int32_t     lastDeltaMs;        /* Timestamp delta of the last sample in the tail block */
+    uint32_t    count;              /* Samples held */
+} TsChannel_t;
+
+/** Fixed-capacity store of (timestamp, value) samples for up to TS_MAX_CHANNELS channels. Blocks
+ * are shared by all channels; when none is free the globally oldest one is evicted. Timestamps
+ * of a channel must not go backwards.
+ */
+typedef struct
+{
+    TsBlock_t*  blocks;
+    uint16_t    blockCount;
+    uint16_t    freeList;
+    uint32_t    channelCount;
+
+    TsChannel_t channel[TS_MAX_CHANNELS];
+    uint32_t    evicted;            /* Samples dropped to make room */
+} TimeSeries_t;
+
+typedef struct
+{
+    uint32_t    timeMs;
+    int32_t     value;
+} TsSample_t;
+
+/** Forward iterator over one channel. It is invalidated by any append to the store.
+ */
+typedef struct
+{
+    const TimeSeries_t* ts;
+    uint32_t            fromMs;
+    uint16_t            block;
+    uint16_t            idx;        /* Next sample in the block */
+    uint8_t             tsPos;
+    uint8_t             valPos;
+    uint32_t            timeMs;
+    int32_t             value;
+    int32_t             deltaMs;
+} TsIter_t;
+
+typedef struct
+{
+    uint32_t    count;
+    int32_t     min;
+    int32_t     max;
+    int32_t     mean;
+    uint32_t    firstMs;
+    uint32_t    lastMs;
+} TsStats_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Binds the block pool and empties the store. aBlockCount should be at least twice aChannels.
+ */
+void timeseries_init(
+    TimeSeries_t*   aTs,
+    TsBlock_t*      aBlocks,
+    uint32_t        aBlockCount,
+    uint32_t        aChannels);
+
+/** Appends a sample, evicting the oldest block of the store if it is full.
+ *
+ * @return 0 on success, -1 on an invalid channel.
+ */
+int timeseries_append(
+    TimeSeries_t*   aTs,
+    uint32_t        aChannel,
+    uint32_t        aTimeMs,
+    int32_t         aValue);
+
+/** Starts an iteration over the samples of a channel taken at or after aFromMs.
+ */
+void timeseries_iter_init(
+    TsIter_t*           aIter,
+    const TimeSeries_t* aTs,
+    uint32_t            aChannel,
+    uint32_t            aFromMs);
+
+/** @return false once the channel is exhausted.
+ */
+bool timeseries_iter_next(
+    TsIter_t*       aIter,
+    TsSample_t*     aSample);
+
+/** Count, min, max and mean of a channel since aFromMs. count is 0 when there is no sample.
+ */
+void timeseries_stats(
+    const TimeSeries_t* aTs,
+    uint32_t            aChannel,
+    uint32_t            aFromMs,
+    TsStats_t*          aStats);
+
+/** Total samples held and bytes of the block pool in use.
+ */
+void timeseries_usage(
+    const TimeSeries_t* aTs,
+    uint32_t*           aSamples,
+    uint32_t*           aBytes);
+
+#endif /* STORAGE_TIMESERIES_H_ */
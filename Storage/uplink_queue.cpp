@@ -0,0 +1,590 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "uplink_queue.h"
+#include "log.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define UPQ_SECTOR_MAGIC                    (0x31515055UL)  /* "UPQ1" */
+#define UPQ_RECORD_MAGIC                    (0xA55AUL)
+
+#define UPQ_SECTOR_HDR                      (16)    /* magic, seq, crc, pad */
+#define UPQ_RECORD_HDR                      (24)    /* magic | len, seq, crc, pad, ack slot */
+#define UPQ_RECORD_ACK                      (16)    /* Offset of the ack slot in the record */
+
+#define UPQ_ALIGN_UP(aLen)                  (((aLen) + UPQ_ALIGN - 1) & ~(uint32_t) (UPQ_ALIGN - 1))
+#define UPQ_CHUNK                           (32)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    UPQ_REC_VALID,
+    UPQ_REC_BAD,                /* Header intact but the payload fails its CRC, skipped */
+    UPQ_REC_END,                /* Erased, no more records in the sector */
+    UPQ_REC_CORRUPT             /* Unreadable header, the rest of the sector is unusable */
+} UpqRecordStatus_e;
+
+typedef struct
+{
+    uint32_t    len;
+    uint32_t    seq;
+    uint32_t    size;           /* Header + aligned payload */
+    bool        acked;
+} UpqRecord_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* CRC-32 (IEEE 802.3), nibble table */
+static uint32_t upq_crc32(
+    uint32_t        aCrc,
+    const uint8_t*  aData,
+    uint32_t        aLen)
+{
+    static const uint32_t   table[16] =
+    {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    aCrc    = ~aCrc;
+    for (uint32_t i = 0; i < aLen; i++)
+    {
+        aCrc    = table[(aCrc ^ aData[i]) & 0x0F] ^ (aCrc >> 4);
+        aCrc    = table[(aCrc ^ (aData[i] >> 4)) & 0x0F] ^ (aCrc >> 4);
+    }
+    return ~aCrc;
+}
+
+static inline uint32_t upq_addr(
+    const UplinkQueue_t*    aQueue,
+    uint32_t                aSector,
+    uint32_t                aOffset)
+{
+    return aQueue->base + aSector * aQueue->sectorSize + aOffset;
+}
+
+static inline uint32_t upq_erased_word(
+    const UplinkQueue_t*    aQueue)
+{
+    return aQueue->erased * 0x01010101UL;
+}
+
+static int upq_sector_seq(
+    UplinkQueue_t*  aQueue,
+    uint32_t        aSector,
+    uint32_t*       aSeq)
+{
+    uint32_t    hdr[UPQ_SECTOR_HDR / 4];
+
+    if (0 != aQueue->flash->read(hdr, upq_addr(aQueue, aSector, 0), sizeof(hdr)) ||
+        UPQ_SECTOR_MAGIC != hdr[0] ||
+        upq_crc32(0, (const uint8_t*) hdr, 8) != hdr[2])
+    {
+        return -1;
+    }
+    *aSeq   = hdr[1];
+    return 0;
+}
+
+static int upq_format_sector(
+    UplinkQueue_t*  aQueue,
+    uint32_t        aSector,
+    uint32_t        aSeq)
+{
+    uint32_t    hdr[UPQ_SECTOR_HDR / 4];
+
+    hdr[0]  = UPQ_SECTOR_MAGIC;
+    hdr[1]  = aSeq;
+    hdr[2]  = upq_crc32(0, (const uint8_t*) hdr, 8);
+    hdr[3]  = upq_erased_word(aQueue);
+
+    if (0 != aQueue->flash->erase(upq_addr(aQueue, aSector, 0), aQueue->sectorSize) ||
+        0 != aQueue->flash->program(hdr, upq_addr(aQueue, aSector, 0), sizeof(hdr)))
+    {
+        LOG_ERROR("%s: Flash erase/program failed at sector %u", __func__, (unsigned) aSector);
+        return -1;
+    }
+    return 0;
+}
+
+/* True if the sector holds nothing but erased bytes from aOffset on. */
+static bool upq_erased_from(
+    UplinkQueue_t*  aQueue,
+    uint32_t        aSector,
+    uint32_t        aOffset)
+{
+    uint8_t     buf[UPQ_CHUNK];
+    uint32_t    len;
+
+    while (aOffset < aQueue->sectorSize)
+    {
+        len = aQueue->sectorSize - aOffset;
+        len = (len < sizeof(buf)) ? len : sizeof(buf);
+        if (0 != aQueue->flash->read(buf, upq_addr(aQueue, aSector, aOffset), len))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < len; i++)
+        {
+            if (aQueue->erased != buf[i])
+            {
+                return false;
+            }
+        }
+        aOffset    += len;
+    }
+    return true;
+}
+
+static UpqRecordStatus_e upq_read_record(
+    UplinkQueue_t*  aQueue,
+    uint32_t        aSector,
+    uint32_t        aOffset,
+    UpqRecord_t*    aRec)
+{
+    uint32_t    hdr[UPQ_RECORD_HDR / 4];
+    uint8_t     buf[UPQ_CHUNK];
+    uint32_t    crc;
+    uint32_t    done;
+    uint32_t    len;
+
+    if (aOffset + UPQ_RECORD_HDR > aQueue->sectorSize)
+    {
+        return UPQ_REC_END;
+    }
+    if (0 != aQueue->flash->read(hdr, upq_addr(aQueue, aSector, aOffset), sizeof(hdr)))
+    {
+        return UPQ_REC_CORRUPT;
+    }
+    if (upq_erased_word(aQueue) == hdr[0])
+    {
+        return UPQ_REC_END;
+    }
+
+    aRec->len   = hdr[0] & 0xFFFF;
+    aRec->seq   = hdr[1];
+    aRec->size  = UPQ_RECORD_HDR + UPQ_ALIGN_UP(aRec->len);
+    aRec->acked = (upq_erased_word(aQueue) != hdr[UPQ_RECORD_ACK / 4]);
+    if (UPQ_RECORD_MAGIC != (hdr[0] >> 16) ||
+        0 == aRec->len ||
+        aOffset + aRec->size > aQueue->sectorSize)
+    {
+        return UPQ_REC_CORRUPT;
+    }
+
+    /* The CRC covers the sequence number and the payload */
+    crc     = upq_crc32(0, (const uint8_t*) &hdr[1], 4);
+    for (done = 0; done < aRec->len; done += len)
+    {
+        len = aRec->len - done;
+        len = (len < sizeof(buf)) ? len : sizeof(buf);
+        if (0 != aQueue->flash->read(buf, upq_addr(aQueue, aSector, aOffset + UPQ_RECORD_HDR + done), len))
+        {
+            return UPQ_REC_CORRUPT;
+        }
+        crc = upq_crc32(crc, buf, len);
+    }
+    return (crc == hdr[2]) ? UPQ_REC_VALID : UPQ_REC_BAD;
+}
+
+/* Sector after aSector that belongs to the log, stops at the head sector. */
+static uint32_t upq_next_sector(
+    UplinkQueue_t*  aQueue,
+    uint32_t        aSector)
+{
+    uint32_t    seq;
+
+    do
+    {
+        aSector = (aSector + 1) % aQueue->sectorCount;
+    } while (aSector != aQueue->headSector &&
+             0 != upq_sector_seq(aQueue, aSector, &seq));
+    return aSector;
+}
+
+/* Moves the head to the oldest sector, dropping whatever it still holds. */
+static int upq_advance_head(
+    UplinkQueue_t*  aQueue)
+{
+    uint32_t            next    = (aQueue->headSector + 1) % aQueue->sectorCount;
+    uint32_t            offset;
+    UpqRecord_t         rec;
+    UpqRecordStatus_e   status;
+
+    /* Records before the tail are delivered, only a tail inside the oldest sector loses data */
+    if (aQueue->tailSector == next)
+    {
+        for (offset = aQueue->tailOffset; aQueue->pending > 0; offset += rec.size)
+        {
+            status  = upq_read_record(aQueue, next, offset, &rec);
+            if (UPQ_REC_END == status || UPQ_REC_CORRUPT == status)
+            {
+                break;
+            }
+            if (UPQ_REC_VALID == status && false == rec.acked)
+            {
+                aQueue->pending--;
+                aQueue->dropped++;
+            }
+        }
+        LOG_WARN("Uplink queue full, %u records dropped so far", (unsigned) aQueue->dropped);
+
+        aQueue->tailSector  = (next + 1) % aQueue->sectorCount;
+        aQueue->tailOffset  = UPQ_SECTOR_HDR;
+        aQueue->peekSize    = 0;
+    }
+
+    if (0 != upq_format_sector(aQueue, next, aQueue->headSeq + 1))
+    {
+        return -1;
+    }
+    aQueue->headSector  = next;
+    aQueue->headOffset  = UPQ_SECTOR_HDR;
+    aQueue->headSeq++;
+
+    if (0 == aQueue->pending)
+    {
+        aQueue->tailSector  = aQueue->headSector;
+        aQueue->tailOffset  = aQueue->headOffset;
+    }
+    return 0;
+}
+
+/* Rebuilds head, tail and counters from flash. */
+static void upq_recover(
+    UplinkQueue_t*  aQueue)
+{
+    bool                haveTail    = false;
+    uint32_t            sector;
+    uint32_t            offset;
+    uint32_t            seq;
+    UpqRecord_t         rec;
+    UpqRecordStatus_e   status;
+
+    aQueue->headOffset  = UPQ_SECTOR_HDR;
+    for (uint32_t k = 1; k <= aQueue->sectorCount; k++)
+    {
+        sector  = (aQueue->headSector + k) % aQueue->sectorCount;
+        if (0 != upq_sector_seq(aQueue, sector, &seq) ||
+            (aQueue->headSeq - seq) >= aQueue->sectorCount)
+        {
+            continue;
+        }
+
+        for (offset = UPQ_SECTOR_HDR; ; offset += rec.size)
+        {
+            status  = upq_read_record(aQueue, sector, offset, &rec);
+            if (UPQ_REC_END == status || UPQ_REC_CORRUPT == status)
+            {
+                /* Anything after the last record of the head sector makes it unusable for writing */
+                if (sector == aQueue->headSector)
+                {
+                    aQueue->headOffset  = (UPQ_REC_END == status && upq_erased_from(aQueue, sector, offset)) ?
+                                          offset : aQueue->sectorSize;
+                }
+                break;
+            }
+            if (UPQ_REC_BAD == status)
+            {
+                aQueue->dropped++;
+                continue;
+            }
+
+            if ((int32_t) (rec.seq + 1 - aQueue->recordSeq) > 0)
+            {
+                aQueue->recordSeq   = rec.seq + 1;
+            }
+            if (false == rec.acked)
+            {
+                if (false == haveTail)
+                {
+                    aQueue->tailSector  = sector;
+                    aQueue->tailOffset  = offset;
+                    haveTail            = true;
+                }
+                aQueue->pending++;
+            }
+        }
+    }
+
+    if (false == haveTail)
+    {
+        aQueue->tailSector  = aQueue->headSector;
+        aQueue->tailOffset  = aQueue->headOffset;
+    }
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int uplink_queue_init(
+    UplinkQueue_t*  aQueue,
+    FlashIAP*       aFlash,
+    uint32_t        aSectors)
+{
+    uint32_t    end;
+    uint32_t    seq;
+    bool        found   = false;
+
+    memset(aQueue, 0, sizeof(*aQueue));
+    aQueue->flash   = aFlash;
+
+    if (0 == aSectors)
+    {
+        LOG_HI("Uplink queue off");
+        return -1;
+    }
+    if (aSectors < 2 ||
+        0 != aFlash->init())
+    {
+        LOG_ERROR("%s: Uplink queue disabled", __func__);
+        return -1;
+    }
+
+    end                 = aFlash->get_flash_start() + aFlash->get_flash_size();
+    aQueue->sectorSize  = aFlash->get_sector_size(end - 1);
+    aQueue->sectorCount = aSectors;
+    aQueue->base        = end - aSectors * aQueue->sectorSize;
+    aQueue->pageSize    = aFlash->get_page_size();
+    aQueue->erased      = aFlash->get_erase_value();
+
+    for (uint32_t i = 0; i < aSectors; i++)
+    {
+        if (aFlash->get_sector_size(upq_addr(aQueue, i, 0)) != aQueue->sectorSize)
+        {
+            LOG_ERROR("%s: Non-uniform sectors in the queue region", __func__);
+            return -1;
+        }
+    }
+#if defined(FLASHIAP_APP_ROM_END_ADDR)
+    if (aQueue->base < FLASHIAP_APP_ROM_END_ADDR)
+    {
+        LOG_ERROR("%s: Queue region 0x%x overlaps the application", __func__, (unsigned) aQueue->base);
+        return -1;
+    }
+#endif
+    if (0 != (UPQ_ALIGN % aQueue->pageSize))
+    {
+        LOG_ERROR("%s: Unsupported flash page size %u", __func__, (unsigned) aQueue->pageSize);
+        return -1;
+    }
+
+    /* The head is the sector with the newest sequence number */
+    for (uint32_t i = 0; i < aSectors; i++)
+    {
+        if (0 == upq_sector_seq(aQueue, i, &seq) &&
+            (false == found || (int32_t) (seq - aQueue->headSeq) > 0))
+        {
+            aQueue->headSector  = i;
+            aQueue->headSeq     = seq;
+            found               = true;
+        }
+    }
+
+    if (found)
+    {
+        upq_recover(aQueue);
+    }
+    else
+    {
+        if (0 != upq_format_sector(aQueue, 0, 1))
+        {
+            return -1;
+        }
+        aQueue->headSector  = 0;
+        aQueue->headSeq     = 1;
+        aQueue->headOffset  = UPQ_SECTOR_HDR;
+        aQueue->tailSector  = 0;
+        aQueue->tailOffset  = UPQ_SECTOR_HDR;
+    }
+
+    aQueue->ready   = true;
+    LOG_HI("Uplink queue: %u x %u bytes at 0x%x, %u pending, %u dropped",
+           (unsigned) aSectors, (unsigned) aQueue->sectorSize, (unsigned) aQueue->base,
+           (unsigned) aQueue->pending, (unsigned) aQueue->dropped);
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int uplink_queue_push(
+    UplinkQueue_t*  aQueue,
+    const void*     aData,
+    uint32_t        aLen)
+{
+    uint32_t    hdr[UPQ_SECTOR_HDR / 4];
+    uint8_t     tail[UPQ_ALIGN];
+    uint32_t    size    = UPQ_RECORD_HDR + UPQ_ALIGN_UP(aLen);
+    uint32_t    whole   = aLen & ~(uint32_t) (UPQ_ALIGN - 1);
+    uint32_t    addr;
+    int         result  = 0;
+
+    if (false == aQueue->ready ||
+        0 == aLen ||
+        aLen > 0xFFFF ||
+        size > aQueue->sectorSize - UPQ_SECTOR_HDR)
+    {
+        return -1;
+    }
+
+    if (aQueue->headOffset + size > aQueue->sectorSize &&
+        0 != upq_advance_head(aQueue))
+    {
+        return -1;
+    }
+
+    /* The header goes first; a reset before the payload is complete leaves a CRC mismatch */
+    hdr[0]  = (UPQ_RECORD_MAGIC << 16) | aLen;
+    hdr[1]  = aQueue->recordSeq;
+    hdr[2]  = upq_crc32(upq_crc32(0, (const uint8_t*) &hdr[1], 4), (const uint8_t*) aData, aLen);
+    hdr[3]  = upq_erased_word(aQueue);
+
+    addr    = upq_addr(aQueue, aQueue->headSector, aQueue->headOffset);
+    result |= aQueue->flash->program(hdr, addr, sizeof(hdr));
+    if (whole)
+    {
+        result |= aQueue->flash->program(aData, addr + UPQ_RECORD_HDR, whole);
+    }
+    if (aLen > whole)
+    {
+        memset(tail, aQueue->erased, sizeof(tail));
+        memcpy(tail, (const uint8_t*) aData + whole, aLen - whole);
+        result |= aQueue->flash->program(tail, addr + UPQ_RECORD_HDR + whole, sizeof(tail));
+    }
+
+    /* The space is consumed even on failure, the record will fail its CRC */
+    aQueue->headOffset += size;
+    aQueue->recordSeq++;
+    if (0 != result)
+    {
+        LOG_ERROR("%s: Flash program failed", __func__);
+        return -1;
+    }
+    aQueue->pending++;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int uplink_queue_peek(
+    UplinkQueue_t*  aQueue,
+    void*           aBuf,
+    uint32_t        aBufLen)
+{
+    UpqRecord_t         rec;
+    UpqRecordStatus_e   status;
+
+    aQueue->peekSize    = 0;
+    while (aQueue->ready && aQueue->pending > 0)
+    {
+        if (aQueue->tailSector == aQueue->headSector &&
+            aQueue->tailOffset >= aQueue->headOffset)
+        {
+            break;
+        }
+
+        status  = upq_read_record(aQueue, aQueue->tailSector, aQueue->tailOffset, &rec);
+        if (UPQ_REC_END == status || UPQ_REC_CORRUPT == status)
+        {
+            if (aQueue->tailSector == aQueue->headSector)
+            {
+                break;
+            }
+            aQueue->tailSector  = upq_next_sector(aQueue, aQueue->tailSector);
+            aQueue->tailOffset  = UPQ_SECTOR_HDR;
+            continue;
+        }
+        if (UPQ_REC_BAD == status || rec.acked)
+        {
+            aQueue->tailOffset += rec.size;
+            continue;
+        }
+
+        /* Also set on failure, so that uplink_queue_skip() can step over the record */
+        aQueue->peekSize    = rec.size;
+        if (rec.len > aBufLen ||
+            0 != aQueue->flash->read(aBuf, upq_addr(aQueue, aQueue->tailSector, aQueue->tailOffset + UPQ_RECORD_HDR), rec.len))
+        {
+            return -1;
+        }
+        return (int) rec.len;
+    }
+
+    /* Nothing left to deliver, whatever the counter said */
+    aQueue->pending     = 0;
+    aQueue->tailSector  = aQueue->headSector;
+    aQueue->tailOffset  = aQueue->headOffset;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int uplink_queue_ack(
+    UplinkQueue_t*  aQueue)
+{
+    uint8_t     ack[UPQ_ALIGN];
+    int         result;
+
+    if (0 == aQueue->peekSize)
+    {
+        return -1;
+    }
+
+    memset(ack, (uint8_t) ~aQueue->erased, sizeof(ack));
+    result  = aQueue->flash->program(ack, upq_addr(aQueue, aQueue->tailSector, aQueue->tailOffset + UPQ_RECORD_ACK), sizeof(ack));
+
+    /* Even if the ack could not be written the record is done for this boot */
+    aQueue->tailOffset += aQueue->peekSize;
+    aQueue->peekSize    = 0;
+    aQueue->pending--;
+    return (0 == result) ? 0 : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int uplink_queue_skip(
+    UplinkQueue_t*  aQueue)
+{
+    if (0 == aQueue->peekSize)
+    {
+        return -1;
+    }
+    aQueue->dropped++;
+    return uplink_queue_ack(aQueue);
+}
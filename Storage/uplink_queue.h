@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STORAGE_UPLINK_QUEUE_H_
+#define STORAGE_UPLINK_QUEUE_H_
+
+#include "mbed.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define UPQ_ALIGN                           (8)     /* Largest supported flash program unit */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Persistent FIFO of uplink payloads in the last sectors of internal flash.
+ *
+ * The region is a ring of sectors written as a log. Each sector starts with a header carrying
+ * its sequence number, followed by records of a header, a CRC-32 over the payload, an ack slot
+ * left erased until delivery, and the payload. Sectors are only erased when the log wraps onto
+ * them, so every sector sees the same number of erase cycles. When the log is full the oldest
+ * sector is erased and its undelivered records are dropped.
+ *
+ * Delivery is at-least-once: a record is acked only after it was sent, a reset between the send
+ * and the ack sends it again. A record torn by a reset fails its CRC and is skipped.
+ */
+typedef struct
+{
+    FlashIAP*   flash;
+    uint32_t    base;
+    uint32_t    sectorSize;
+    uint32_t    sectorCount;
+    uint32_t    pageSize;
+    uint8_t     erased;             /* Erase value of the flash */
+    bool        ready;
+
+    uint32_t    headSector;         /* Sector being written */
+    uint32_t    headOffset;         /* Next free byte in it */
+    uint32_t    headSeq;            /* Sequence number of the head sector */
+    uint32_t    tailSector;         /* Oldest record not delivered yet */
+    uint32_t    tailOffset;
+    uint32_t    recordSeq;          /* Sequence number of the next record */
+    uint32_t    peekSize;           /* Flash size of the record returned by the last peek, 0 = none */
+
+    uint32_t    pending;            /* Records not acked */
+    uint32_t    dropped;            /* Records lost to overflow or corruption */
+} UplinkQueue_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Claims the last aSectors sectors of flash and recovers the queue from them.
+ *
+ * @return 0 on success, -1 when the region is unusable; the queue then stays disabled.
+ */
+int uplink_queue_init(
+    UplinkQueue_t*  aQueue,
+    FlashIAP*       aFlash,
+    uint32_t        aSectors);
+
+/** Appends a payload, erasing the oldest sector when the log is full.
+ *
+ * @return 0 on success, -1 on a disabled queue, an oversized payload or a flash error.
+ */
+int uplink_queue_push(
+    UplinkQueue_t*  aQueue,
+    const void*     aData,
+    uint32_t        aLen);
+
+/** Copies the oldest undelivered payload without removing it.
+ *
+ * @return Payload length, 0 when the queue is empty, -1 if aBuf is too small or the payload
+ *         cannot be read; uplink_queue_skip() then drops it.
+ */
+int uplink_queue_peek(
+    UplinkQueue_t*  aQueue,
+    void*           aBuf,
+    uint32_t        aBufLen);
+
+/** Marks the payload returned by the last uplink_queue_peek() as delivered.
+ */
+int uplink_queue_ack(
+    UplinkQueue_t*  aQueue);
+
+/** Drops the payload the last uplink_queue_peek() stopped at, delivered or not, and counts it
+ * in dropped. For a payload that cannot be sent, so that it does not block the queue.
+ */
+int uplink_queue_skip(
+    UplinkQueue_t*  aQueue);
+
+static inline uint32_t uplink_queue_pending(
+    const UplinkQueue_t*    aQueue)
+{
+    return aQueue->pending;
+}
+
+#endif /* STORAGE_UPLINK_QUEUE_H_ */
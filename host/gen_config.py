@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Riot Micro. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Write the mbed_config.h the host build includes, from mbed_app.json.
+
+Every macro is wrapped in #ifndef so a -D on the make command line (CONFIG=...) wins over the
+value in mbed_app.json, as an override in mbed_app.json would on the target.
+
+usage: gen_config.py mbed_app.json mbed_config.h
+"""
+
+import json
+import sys
+
+
+def macro_value(value):
+    if isinstance(value, bool):
+        return "1" if value else "0"
+    return str(value)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__.strip().splitlines()[-1])
+
+    with open(sys.argv[1]) as f:
+        app = json.load(f)
+
+    macros = []
+    for name, entry in app.get("config", {}).items():
+        if entry.get("value") is None or not entry.get("macro_name"):
+            continue
+        macros.append((entry["macro_name"], macro_value(entry["value"])))
+
+    for key, value in app.get("target_overrides", {}).get("*", {}).items():
+        if key.startswith("target.") or value is None:
+            continue
+        lib, _, param = key.partition(".")
+        name = "MBED_CONF_%s_%s" % (lib.replace("-", "_").upper(), param.replace("-", "_").upper())
+        macros.append((name, macro_value(value)))
+
+    for macro in app.get("macros", []):
+        name, _, value = macro.partition("=")
+        macros.append((name, value or "1"))
+
+    with open(sys.argv[2], "w") as f:
+        f.write("/* Generated by host/gen_config.py from mbed_app.json, do not edit */\n")
+        f.write("#ifndef MBED_CONFIG_H_\n#define MBED_CONFIG_H_\n\n")
+        for name, value in macros:
+            f.write("#ifndef %s\n#define %s %s\n#endif\n" % (name, name, value))
+        f.write("\n#endif /* MBED_CONFIG_H_ */\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Riot Micro. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Write a tls_root_ca.cpp that trusts the certificates of a PEM file instead of those of
+Network/tls_root_ca.cpp, e.g. the CA of a local TLS stand-in (make TLS_CA=ca.pem).
+
+usage: gen_root_ca.py ca.pem tls_root_ca.cpp
+"""
+
+import sys
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__.strip().splitlines()[-1])
+
+    with open(sys.argv[1]) as f:
+        lines = [line.strip() for line in f if line.strip()]
+
+    with open(sys.argv[2], "w") as out:
+        out.write("/* Generated from %s by host/gen_root_ca.py, do not edit */\n\n" % sys.argv[1])
+        out.write("#include \"tls_root_ca.h\"\n\n")
+        out.write("const char tlsRootCaPem[] =\n")
+        for line in lines:
+            out.write("    \"%s\\n\"\n" % line)
+        out.write("    ;\n")
+
+
+if __name__ == "__main__":
+    main()
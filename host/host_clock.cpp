@@ -0,0 +1,513 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The host runs the firmware threads on pthreads, one at a time as on the single core of the
+ * target: a thread runs until it sleeps, waits for flags, spends the time of simulated hardware or
+ * blocks on a real socket, and only then can another one run. Time only moves when no thread runs,
+ * straight to the next wake-up, except while a thread is blocked on a real socket, when it follows
+ * the wall clock.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <pthread.h>
+#include <stdarg.h>
+#include <time.h>
+#include "mbed.h"
+#include "platform_clock.h"
+#include "SEGGER_RTT.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HOST_LOG_LINE_MAX       (1024)
+#define HOST_ESCAPE             ('\x1B')
+#define HOST_THREADS_MAX        (4)             /* main() included */
+#define HOST_WALL_WAIT_MAX_US   (100000)        /* Longest wait for the wall clock before looking again */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint64_t    wakeUs;         /* UINT64_MAX unless waiting for the CPU, 0 once it may have it */
+    uint32_t    flags;
+    uint32_t    waitFlags;
+} HostThread_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static uint64_t hostNowUs;
+static uint64_t hostEndUs   = UINT64_MAX;
+static bool     hostLog     = true;
+static bool     hostCpu     = false;
+static uint64_t hostCpuUs;
+
+/* Recursive, the exit handlers read the clock of the thread that ends the run */
+static pthread_mutex_t      hostClockMutex  = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static pthread_cond_t       hostClockCond   = PTHREAD_COND_INITIALIZER;
+static HostThread_t         hostThreads[HOST_THREADS_MAX]   = { { UINT64_MAX, 0, 0 } };
+static int                  hostThreadCount = 1;
+static int                  hostRunning     = 0;        /* The thread that has the CPU, -1 when none */
+static int                  hostIo          = 0;        /* Threads blocked on a real socket */
+static uint64_t             hostIoWallUs;
+static thread_local int     hostSelf        = 0;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static uint64_t cpu_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static uint64_t wall_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Moves the clock by the CPU time used since the last reading, when host_clock_count_cpu() is on,
+ * and by the wall clock while a thread is blocked on a socket. Called with hostClockMutex held.
+ */
+static void sync_clock(void)
+{
+    uint64_t    now;
+
+    if (hostCpu)
+    {
+        now         = cpu_us();
+        hostNowUs  += now - hostCpuUs;
+        hostCpuUs   = now;
+    }
+    if (hostIo > 0)
+    {
+        now             = wall_us();
+        hostNowUs      += now - hostIoWallUs;
+        hostIoWallUs    = now;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static uint64_t read_clock_us(void)
+{
+    uint64_t    now;
+
+    pthread_mutex_lock(&hostClockMutex);
+    sync_clock();
+    now = hostNowUs;
+    pthread_mutex_unlock(&hostClockMutex);
+    return now;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The earliest wake-up of the threads waiting for the CPU */
+static uint64_t next_wake_us(void)
+{
+    uint64_t    next    = UINT64_MAX;
+
+    for (int i = 0; i < hostThreadCount; i++)
+    {
+        next    = (hostThreads[i].wakeUs < next) ? hostThreads[i].wakeUs : next;
+    }
+    return next;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void wait_wall_us(
+    uint64_t    aUs)
+{
+    struct timespec until;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    aUs             = (aUs < HOST_WALL_WAIT_MAX_US) ? aUs : HOST_WALL_WAIT_MAX_US;
+    until.tv_nsec  += (long) (aUs * 1000);
+    until.tv_sec   += until.tv_nsec / 1000000000;
+    until.tv_nsec  %= 1000000000;
+    pthread_cond_timedwait(&hostClockCond, &hostClockMutex, &until);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Gives the CPU up, until the clock reaches aWakeUs or the thread is woken. With hostClockMutex held. */
+static void release_cpu(
+    uint64_t    aWakeUs)
+{
+    hostThreads[hostSelf].wakeUs    = aWakeUs;
+    hostRunning                     = -1;
+    pthread_cond_broadcast(&hostClockCond);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Waits for the wake-up given to release_cpu() and for the CPU, and moves the clock on when
+ * nothing else can run. With hostClockMutex held.
+ */
+static void take_cpu(void)
+{
+    HostThread_t*   self    = &hostThreads[hostSelf];
+    uint64_t        next;
+
+    while (true)
+    {
+        sync_clock();
+        if (hostNowUs >= hostEndUs)
+        {
+            /* The firmware never returns, the totals are printed by the exit handlers. The other
+             * threads stop at their next look at the clock. */
+            exit(0);
+        }
+        if (hostRunning < 0 && hostNowUs >= self->wakeUs)
+        {
+            break;
+        }
+
+        next    = next_wake_us();
+        if (hostRunning >= 0 || next <= hostNowUs)
+        {
+            pthread_cond_wait(&hostClockCond, &hostClockMutex);
+        }
+        else if (0 == hostIo)
+        {
+            hostNowUs   = next;
+            pthread_cond_broadcast(&hostClockCond);
+        }
+        else
+        {
+            wait_wall_us(next - hostNowUs);
+        }
+    }
+    self->wakeUs    = UINT64_MAX;
+    self->waitFlags = 0;
+    hostRunning     = hostSelf;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void host_clock_init(
+    uint64_t    aEndMs)
+{
+    pthread_mutex_lock(&hostClockMutex);
+    hostNowUs   = 0;
+    hostEndUs   = aEndMs * 1000;
+    pthread_mutex_unlock(&hostClockMutex);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_clock_count_cpu(
+    bool        aCount)
+{
+    pthread_mutex_lock(&hostClockMutex);
+    hostCpu     = aCount;
+    hostCpuUs   = cpu_us();
+    pthread_mutex_unlock(&hostClockMutex);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint64_t host_clock_us(void)
+{
+    return read_clock_us();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_clock_advance_us(
+    uint64_t    aUs)
+{
+    pthread_mutex_lock(&hostClockMutex);
+    sync_clock();
+    release_cpu(hostNowUs + aUs);
+    take_cpu();
+    pthread_mutex_unlock(&hostClockMutex);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_clock_io_begin(void)
+{
+    pthread_mutex_lock(&hostClockMutex);
+    sync_clock();
+    if (0 == hostIo++)
+    {
+        hostIoWallUs    = wall_us();
+    }
+    release_cpu(UINT64_MAX);
+    pthread_mutex_unlock(&hostClockMutex);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_clock_io_end(void)
+{
+    pthread_mutex_lock(&hostClockMutex);
+    sync_clock();
+    hostIo--;
+    hostThreads[hostSelf].wakeUs    = 0;
+    take_cpu();
+    pthread_mutex_unlock(&hostClockMutex);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_log_enable(
+    bool        aEnable)
+{
+    hostLog     = aEnable;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t platform_now_ms(void)
+{
+    return (uint32_t) (read_clock_us() / 1000);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t platform_now_us(void)
+{
+    return (uint32_t) read_clock_us();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void platform_sleep_ms(
+    uint32_t    aMs)
+{
+    host_clock_advance_us(aMs * 1000ULL);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t us_ticker_read(void)
+{
+    return (uint32_t) read_clock_us();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint64_t rtos::Kernel::get_ms_count(void)
+{
+    return read_clock_us() / 1000;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void rtos::ThisThread::sleep_for(
+    uint32_t    aMs)
+{
+    host_clock_advance_us(aMs * 1000ULL);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t rtos::ThisThread::flags_wait_any_for(
+    uint32_t    aFlags,
+    uint32_t    aMs,
+    bool        aClear)
+{
+    HostThread_t*   self    = &hostThreads[hostSelf];
+    uint32_t        flags;
+
+    pthread_mutex_lock(&hostClockMutex);
+    if (0 == (self->flags & aFlags))
+    {
+        sync_clock();
+        self->waitFlags = aFlags;
+        release_cpu(hostNowUs + aMs * 1000ULL);
+        take_cpu();
+    }
+    flags   = self->flags & aFlags;
+    if (aClear)
+    {
+        self->flags    &= ~flags;
+    }
+    pthread_mutex_unlock(&hostClockMutex);
+    return flags;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int rtos::Thread::start(
+    mbed::Callback<void()>  aTask)
+{
+    pthread_t   thread;
+
+    pthread_mutex_lock(&hostClockMutex);
+    if (hostThreadCount >= HOST_THREADS_MAX)
+    {
+        fprintf(stderr, "HOST: no more than %d threads\n", HOST_THREADS_MAX);
+        exit(2);
+    }
+    _task                           = aTask;
+    _slot                           = hostThreadCount++;
+    hostThreads[_slot].wakeUs       = 0;
+    hostThreads[_slot].flags        = 0;
+    hostThreads[_slot].waitFlags    = 0;
+    if (0 != pthread_create(&thread, NULL, run, this))
+    {
+        fprintf(stderr, "HOST: no thread for %s\n", (NULL != _name) ? _name : "the firmware");
+        exit(2);
+    }
+    pthread_detach(thread);
+    pthread_mutex_unlock(&hostClockMutex);
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void* rtos::Thread::run(
+    void*       aThread)
+{
+    Thread*     thread  = (Thread*) aThread;
+
+    hostSelf    = thread->_slot;
+    pthread_mutex_lock(&hostClockMutex);
+    take_cpu();
+    pthread_mutex_unlock(&hostClockMutex);
+
+    thread->_task();
+
+    pthread_mutex_lock(&hostClockMutex);
+    release_cpu(UINT64_MAX);
+    pthread_mutex_unlock(&hostClockMutex);
+    return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int32_t rtos::Thread::flags_set(
+    uint32_t    aFlags)
+{
+    HostThread_t*   thread  = &hostThreads[_slot];
+    int32_t         flags;
+
+    if (_slot < 0)
+    {
+        return -1;
+    }
+    pthread_mutex_lock(&hostClockMutex);
+    thread->flags  |= aFlags;
+    if (0 != (thread->flags & thread->waitFlags))
+    {
+        thread->wakeUs  = 0;
+        pthread_cond_broadcast(&hostClockCond);
+    }
+    flags   = (int32_t) thread->flags;
+    pthread_mutex_unlock(&hostClockMutex);
+    return flags;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void NVIC_SystemReset(void)
+{
+    fprintf(stderr, "HOST: system reset at %u ms\n", platform_now_ms());
+    exit(3);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+size_t mbed_stats_stack_get_each(
+    mbed_stats_stack_t* aStats,
+    size_t              aCount)
+{
+    (void) aStats;
+    (void) aCount;
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+unsigned int SEGGER_RTT_get_ms_elapsed(void)
+{
+    return platform_now_ms();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The log goes to stdout without the RTT colour codes */
+int SEGGER_RTT_printf(
+    unsigned    aBufferIndex,
+    const char* aFormat,
+    ...)
+{
+    char    line[HOST_LOG_LINE_MAX];
+    char*   src;
+    char*   dst;
+    va_list args;
+
+    (void) aBufferIndex;
+    if (false == hostLog)
+    {
+        return 0;
+    }
+
+    va_start(args, aFormat);
+    vsnprintf(line, sizeof(line), aFormat, args);
+    va_end(args);
+
+    for (src = dst = line; '\0' != *src; src++)
+    {
+        if (HOST_ESCAPE == *src)
+        {
+            while ('\0' != src[1] && 'm' != *src)
+            {
+                src++;
+            }
+            continue;
+        }
+        *dst++  = *src;
+    }
+    *dst    = '\0';
+    fputs(line, stdout);
+    return (int) (dst - line);
+}
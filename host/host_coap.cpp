@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* In-process CoAP stand-in for the UPLINK_COAP transport (Network/coap_client.cpp). It takes the
+ * POSTs of any resource, reassembles Block1 transfers and acknowledges confirmable messages with
+ * 2.31 Continue or 2.04 Changed after the latency, like the dweet stand-in answers HTTP. Datagrams
+ * can be lost in either direction, so the retransmissions of the client can be measured.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include "mbed.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define COAP_PAYLOAD_MAX        (4096)
+#define COAP_REPLY_MAX          (32)
+#define COAP_IDLE_TIMEOUT_MS    (30000)     /* recvfrom() without a timeout set */
+#define COAP_SAMPLE_TAG         "{\"t\":"   /* One per report of a batch */
+
+#define COAP_TYPE_CON           (0)
+#define COAP_TYPE_NON           (1)
+#define COAP_TYPE_ACK           (2)
+#define COAP_CODE_POST          (0x02)
+#define COAP_CODE_CHANGED       (0x44)      /* 2.04 */
+#define COAP_CODE_CONTINUE      (0x5F)      /* 2.31 */
+#define COAP_OPT_BLOCK1         (27)
+#define COAP_PAYLOAD_MARKER     (0xFF)
+
+#define BLOCK1_MORE             (0x08)
+#define BLOCK1_SZX(aValue)      ((aValue) & 0x07)
+#define BLOCK1_NUM(aValue)      ((aValue) >> 4)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    datagramsIn;
+    uint32_t    datagramsOut;
+    uint32_t    lost;               /* Either way */
+    uint32_t    duplicates;         /* Retransmissions of a message already taken */
+    uint32_t    confirmable;
+    uint32_t    blocks;
+    uint32_t    payloads;           /* Complete POSTs */
+    uint32_t    samples;
+    uint32_t    bytesIn;
+    uint32_t    bytesOut;
+    uint64_t    latencyUs;          /* First datagram of a payload to its last acknowledgement read */
+    uint64_t    latencyMaxUs;
+} CoapServerStats_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static uint32_t     coapLatencyMs;
+static uint32_t     coapLossPct;
+static uint32_t     coapRandom      = 0x2545F491;
+
+static uint8_t      coapPayload[COAP_PAYLOAD_MAX + 1];
+static uint32_t     coapPayloadLen;
+static uint64_t     coapPayloadStartUs;
+static bool         coapPayloadDone;        /* Complete, the latency counts once its reply is read */
+static int32_t      coapLastMessageId   = -1;
+
+static uint8_t      coapReply[COAP_REPLY_MAX];
+static uint32_t     coapReplyLen;
+static uint64_t     coapReadyUs;            /* When the reply may be read */
+static CoapServerStats_t coapStats;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* xorshift32, the same losses on every run */
+static bool lose(void)
+{
+    coapRandom ^= coapRandom << 13;
+    coapRandom ^= coapRandom >> 17;
+    coapRandom ^= coapRandom << 5;
+    if (coapRandom % 100 < coapLossPct)
+    {
+        coapStats.lost++;
+        return true;
+    }
+    return false;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Payload bytes of a complete POST, counted as reports like the dweet stand-in does */
+static void take_payload(void)
+{
+    uint32_t    samples = 0;
+
+    coapPayload[coapPayloadLen] = '\0';
+    for (const char* tag = strstr((const char*) coapPayload, COAP_SAMPLE_TAG); NULL != tag; tag = strstr(tag + 1, COAP_SAMPLE_TAG))
+    {
+        samples++;
+    }
+    coapStats.payloads++;
+    coapStats.samples  += (samples > 0) ? samples : 1;
+    coapPayloadDone     = true;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Latency of the payload, once its last acknowledgement was read or it was sent non-confirmable */
+static void payload_delivered(void)
+{
+    uint64_t    us  = host_clock_us() - coapPayloadStartUs;
+
+    coapStats.latencyUs    += us;
+    coapStats.latencyMaxUs  = (us > coapStats.latencyMaxUs) ? us : coapStats.latencyMaxUs;
+    coapPayloadDone         = false;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Parses a message of the client.
+ *
+ * @return Offset of the payload, -1 when the message is malformed.
+ */
+static int parse(
+    const uint8_t*  aMsg,
+    uint32_t        aLen,
+    int32_t*        aBlock1)
+{
+    uint32_t    pos     = 4 + (aMsg[0] & 0x0F);
+    uint32_t    number  = 0;
+    uint32_t    delta;
+    uint32_t    len;
+
+    *aBlock1    = -1;
+    while (pos < aLen && COAP_PAYLOAD_MARKER != aMsg[pos])
+    {
+        delta   = aMsg[pos] >> 4;
+        len     = aMsg[pos] & 0x0F;
+        pos++;
+
+        /* The client sends no option needing two extension bytes */
+        if (delta >= 14 || len >= 14)
+        {
+            return -1;
+        }
+        if (13 == delta && pos < aLen)
+        {
+            delta   = 13 + aMsg[pos++];
+        }
+        if (13 == len && pos < aLen)
+        {
+            len     = 13 + aMsg[pos++];
+        }
+        if (pos + len > aLen)
+        {
+            return -1;
+        }
+        number += delta;
+        if (COAP_OPT_BLOCK1 == number && len <= 3)
+        {
+            *aBlock1    = 0;
+            for (uint32_t i = 0; i < len; i++)
+            {
+                *aBlock1    = (*aBlock1 << 8) | aMsg[pos + i];
+            }
+        }
+        pos    += len;
+    }
+    return (pos < aLen) ? (int) pos + 1 : (int) aLen;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Piggybacked acknowledgement with the token of the request and the Block1 option echoed */
+static void acknowledge(
+    const uint8_t*  aMsg,
+    uint32_t        aLen,
+    int32_t         aBlock1)
+{
+    uint32_t    tkl     = aMsg[0] & 0x0F;
+    uint32_t    pos;
+
+    coapReply[0]    = (1 << 6) | (COAP_TYPE_ACK << 4) | tkl;
+    coapReply[1]    = (aBlock1 >= 0 && (aBlock1 & BLOCK1_MORE)) ? COAP_CODE_CONTINUE : COAP_CODE_CHANGED;
+    coapReply[2]    = aMsg[2];
+    coapReply[3]    = aMsg[3];
+    memcpy(&coapReply[4], &aMsg[4], (tkl <= 8 && 4 + tkl <= aLen) ? tkl : 0);
+    pos = 4 + tkl;
+    if (aBlock1 >= 0)
+    {
+        uint32_t    size    = (aBlock1 > 0xFFFF) ? 3 : (aBlock1 > 0xFF) ? 2 : (aBlock1 > 0) ? 1 : 0;
+
+        coapReply[pos++]    = (13 << 4) | size;
+        coapReply[pos++]    = COAP_OPT_BLOCK1 - 13;
+        for (uint32_t i = size; i > 0; i--)
+        {
+            coapReply[pos++]    = (uint8_t) (aBlock1 >> (8 * (i - 1)));
+        }
+    }
+    coapReplyLen    = pos;
+    coapReadyUs     = host_clock_us() + coapLatencyMs * 1000ULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int coap_sendto(
+    const void* aData,
+    uint32_t    aSize)
+{
+    const uint8_t*  msg     = (const uint8_t*) aData;
+    uint32_t        type;
+    int32_t         block1;
+    int             payload;
+    uint32_t        offset;
+    uint32_t        len;
+
+    coapStats.datagramsIn++;
+    coapStats.bytesIn  += aSize;
+    if (aSize < 4 || (msg[0] & 0x0F) > 8 || lose())
+    {
+        return (int) aSize;
+    }
+    type    = (msg[0] >> 4) & 0x03;
+    if (COAP_CODE_POST != msg[1] || (COAP_TYPE_CON != type && COAP_TYPE_NON != type))
+    {
+        /* Empty acknowledgements of the client, nothing else is expected */
+        return (int) aSize;
+    }
+    payload = parse(msg, aSize, &block1);
+    if (payload < 0)
+    {
+        return (int) aSize;
+    }
+
+    /* A retransmission of a message already taken gets its acknowledgement again */
+    if (coapLastMessageId == ((msg[2] << 8) | msg[3]))
+    {
+        coapStats.duplicates++;
+        if (COAP_TYPE_CON == type)
+        {
+            acknowledge(msg, aSize, block1);
+        }
+        return (int) aSize;
+    }
+    coapLastMessageId   = (msg[2] << 8) | msg[3];
+    coapStats.confirmable  += (COAP_TYPE_CON == type) ? 1 : 0;
+
+    /* Block1 places the bytes at NUM * size, without Block1 the payload is all there is */
+    offset  = (block1 >= 0) ? BLOCK1_NUM(block1) << (4 + BLOCK1_SZX(block1)) : 0;
+    len     = aSize - payload;
+    if (0 == offset)
+    {
+        coapPayloadLen      = 0;
+        coapPayloadStartUs  = host_clock_us();
+    }
+    if (offset <= COAP_PAYLOAD_MAX && len <= COAP_PAYLOAD_MAX - offset)
+    {
+        memcpy(coapPayload + offset, msg + payload, len);
+        coapPayloadLen  = offset + len;
+    }
+    if (block1 >= 0)
+    {
+        coapStats.blocks++;
+    }
+    if (block1 < 0 || 0 == (block1 & BLOCK1_MORE))
+    {
+        take_payload();
+    }
+
+    if (COAP_TYPE_CON == type)
+    {
+        acknowledge(msg, aSize, block1);
+    }
+    else if (coapPayloadDone)
+    {
+        payload_delivered();
+    }
+    return (int) aSize;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int coap_recvfrom(
+    void*       aData,
+    uint32_t    aSize,
+    int32_t     aTimeoutMs)
+{
+    uint64_t    timeoutUs   = ((aTimeoutMs >= 0) ? aTimeoutMs : COAP_IDLE_TIMEOUT_MS) * 1000ULL;
+    uint64_t    nowUs       = host_clock_us();
+    uint64_t    waitUs      = (coapReadyUs > nowUs) ? coapReadyUs - nowUs : 0;
+    uint32_t    len;
+
+    if (0 == coapReplyLen || waitUs > timeoutUs)
+    {
+        host_clock_advance_us(timeoutUs);
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    len             = (coapReplyLen < aSize) ? coapReplyLen : aSize;
+    coapReplyLen    = 0;
+    coapStats.datagramsOut++;
+    if (lose())
+    {
+        /* Gone on the way back, the client waits out its timeout */
+        host_clock_advance_us(timeoutUs);
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+    host_clock_advance_us(waitUs);
+    memcpy(aData, coapReply, len);
+    coapStats.bytesOut += len;
+    if (coapPayloadDone)
+    {
+        payload_delivered();
+    }
+    return (int) len;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void coap_report(void)
+{
+    uint32_t    done    = coapStats.payloads;
+
+    fprintf(stderr, "COAP: %u datagrams in, %u out, %u lost, %u duplicates; %u payloads (%u confirmable messages, %u blocks), "
+                    "%u samples, %u bytes in, %u out, %.1f bytes/sample, %.1f ms mean and %.1f ms max per payload\n",
+            coapStats.datagramsIn, coapStats.datagramsOut, coapStats.lost, coapStats.duplicates, done, coapStats.confirmable,
+            coapStats.blocks, coapStats.samples, coapStats.bytesIn, coapStats.bytesOut,
+            coapStats.samples ? (double) coapStats.bytesIn / coapStats.samples : 0.0,
+            done ? coapStats.latencyUs / 1000.0 / done : 0.0, coapStats.latencyMaxUs / 1000.0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static const HostUdpServer_t    coapServer =
+{
+    "coap", coap_sendto, coap_recvfrom, coap_report
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+const HostUdpServer_t* host_coap_server(
+    uint32_t    aLatencyMs,
+    uint32_t    aLossPct)
+{
+    coapLatencyMs   = aLatencyMs;
+    coapLossPct     = aLossPct;
+    return &coapServer;
+}
@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include "mbed.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define DWEET_REQUEST_MAX       (4096)
+#define DWEET_RESPONSE_MAX      (512)
+#define DWEET_IDLE_TIMEOUT_MS   (30000)     /* recv() without a timeout set */
+#define DWEET_SAMPLE_TAG        "{\"t\":"   /* One per report of a POSTed batch */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    connections;
+    uint32_t    requests;
+    uint32_t    posts;
+    uint32_t    samples;
+    uint32_t    notFound;
+    uint32_t    faulted;            /* Requests answered with an injected fault */
+    uint32_t    bytesIn;
+    uint32_t    bytesOut;
+    uint64_t    latencyUs;          /* Connection or first byte of a request to its response read */
+    uint64_t    latencyMaxUs;
+} DweetStats_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static uint32_t     dweetLatencyMs;
+static bool         dweetOpen;
+static bool         dweetCloseAfter;        /* The request asked for Connection: close */
+static char         dweetRequest[DWEET_REQUEST_MAX + 1];
+static uint32_t     dweetRequestLen;
+static char         dweetResponse[DWEET_RESPONSE_MAX];
+static uint32_t     dweetResponseLen;
+static uint32_t     dweetResponseSent;
+static uint64_t     dweetReadyUs;           /* When the response may be read */
+static uint64_t     dweetStartUs;           /* When the request being answered started */
+static bool         dweetStarted;
+static DweetStats_t dweetStats;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Case-insensitive header lookup in the request head */
+static const char* find_header(
+    const char* aHead,
+    const char* aName)
+{
+    size_t      len     = strlen(aName);
+
+    for (const char* line = strstr(aHead, "\r\n"); NULL != line; line = strstr(line + 2, "\r\n"))
+    {
+        if (0 == strncasecmp(line + 2, aName, len) && ':' == line[2 + len])
+        {
+            return line + 3 + len;
+        }
+    }
+    return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Queues a response, to be read once the latency has passed */
+static void respond(
+    const char* aStatus,
+    const char* aBody)
+{
+    dweetResponseLen    = snprintf(dweetResponse, sizeof(dweetResponse),
+                                   "HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n%s\r\n%s",
+                                   aStatus, (unsigned) strlen(aBody), dweetCloseAfter ? "Connection: close\r\n" : "", aBody);
+    dweetResponseSent   = 0;
+    dweetReadyUs        = host_clock_us() + dweetLatencyMs * 1000ULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Answers the request with the fault of host_fault_active() instead, if any.
+ *
+ * @return true when the request was answered.
+ */
+static bool respond_fault(void)
+{
+    char        status[48];
+    char        body[64];
+    uint32_t    arg     = 0;
+    HostFault_e fault   = host_fault_active(&arg);
+
+    switch (fault)
+    {
+        case HOST_FAULT_STATUS:
+            snprintf(status, sizeof(status), "%u %s", (unsigned) arg,
+                     (429 == arg) ? "Too Many Requests" : (503 == arg) ? "Service Unavailable" : "Error");
+            snprintf(body, sizeof(body), "{\"this\":\"failed\",\"with\":%u}", (unsigned) arg);
+            respond(status, body);
+            break;
+        case HOST_FAULT_DROP:
+            /* The request is taken and never answered */
+            dweetResponseLen    = 0;
+            dweetResponseSent   = 0;
+            break;
+        case HOST_FAULT_RESET:
+            respond("200 OK", "{\"this\":\"succeeded\",\"by\":\"dweeting\",\"the\":\"dweet\"}");
+            dweetResponseLen   /= 2;
+            dweetCloseAfter     = true;
+            break;
+        case HOST_FAULT_SLOW:
+            respond("200 OK", "{\"this\":\"succeeded\",\"by\":\"dweeting\",\"the\":\"dweet\"}");
+            dweetReadyUs       += arg * 1000ULL;
+            break;
+        default:
+            return false;
+    }
+    host_fault_hit(fault);
+    dweetStats.faulted++;
+    return true;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Answers the request at the start of dweetRequest once all of it is there, as dweet.io does.
+ *
+ * @return The bytes of the request, 0 while it is incomplete.
+ */
+static uint32_t serve_request(void)
+{
+    char*       headEnd = strstr(dweetRequest, "\r\n\r\n");
+    const char* value;
+    const char* path;
+    uint32_t    bodyLen = 0;
+    uint32_t    total;
+    bool        found;
+    bool        post;
+    char        saved;
+
+    if (NULL == headEnd)
+    {
+        return 0;
+    }
+
+    /* Look for headers in this request only */
+    saved       = headEnd[2];
+    headEnd[2]  = '\0';
+    value   = find_header(dweetRequest, "Content-Length");
+    if (NULL != value)
+    {
+        bodyLen = strtoul(value, NULL, 10);
+    }
+    value   = find_header(dweetRequest, "Connection");
+    dweetCloseAfter = (NULL != value && NULL != strstr(value, "close"));
+    headEnd[2]  = saved;
+
+    total   = (headEnd + 4 - dweetRequest) + bodyLen;
+    if (dweetRequestLen < total)
+    {
+        return 0;
+    }
+
+    post    = (0 == strncmp(dweetRequest, "POST ", 5));
+    path    = strchr(dweetRequest, ' ');
+    found   = (NULL != path) && (0 == strncmp(path + 1, "/dweet/for/", 11) || 0 == strncmp(path + 1, "/dweet/quietly/for/", 19));
+
+    dweetStats.requests++;
+    if (respond_fault())
+    {
+        return total;
+    }
+    if (false == found)
+    {
+        dweetStats.notFound++;
+        respond("404 Not Found", "{\"this\":\"failed\",\"with\":404,\"because\":\"not a dweet\"}");
+        return total;
+    }
+
+    if (post)
+    {
+        dweetStats.posts++;
+        for (const char* tag = strstr(headEnd, DWEET_SAMPLE_TAG); NULL != tag && tag < dweetRequest + total;
+             tag = strstr(tag + 1, DWEET_SAMPLE_TAG))
+        {
+            dweetStats.samples++;
+        }
+    }
+    else
+    {
+        dweetStats.samples++;
+    }
+    respond("200 OK", "{\"this\":\"succeeded\",\"by\":\"dweeting\",\"the\":\"dweet\"}");
+    return total;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int dweet_connect(
+    const char* aIp,
+    uint16_t    aPort)
+{
+    (void) aIp;
+    (void) aPort;
+
+    /* The TCP handshake is a round trip before the request can go, or before the refusal */
+    dweetStartUs        = host_clock_us();
+    dweetStarted        = true;
+    host_clock_advance_us(dweetLatencyMs * 1000ULL);
+    if (HOST_FAULT_REFUSE == host_fault_active(NULL))
+    {
+        host_fault_hit(HOST_FAULT_REFUSE);
+        dweetStarted    = false;
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    dweetOpen           = true;
+    dweetRequestLen     = 0;
+    dweetResponseLen    = 0;
+    dweetResponseSent   = 0;
+    dweetStats.connections++;
+    return NSAPI_ERROR_OK;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int dweet_send(
+    const void* aData,
+    uint32_t    aSize)
+{
+    uint32_t    used;
+
+    if (dweetOpen && HOST_FAULT_REFUSE == host_fault_active(NULL))
+    {
+        /* The server went away, a kept-alive connection is reset by the next request */
+        host_fault_hit(HOST_FAULT_REFUSE);
+        dweetOpen   = false;
+    }
+    if (false == dweetOpen)
+    {
+        return NSAPI_ERROR_CONNECTION_LOST;
+    }
+    if (aSize > DWEET_REQUEST_MAX - dweetRequestLen)
+    {
+        aSize   = DWEET_REQUEST_MAX - dweetRequestLen;
+    }
+    if (false == dweetStarted && aSize > 0)
+    {
+        dweetStartUs    = host_clock_us();
+        dweetStarted    = true;
+    }
+    memcpy(dweetRequest + dweetRequestLen, aData, aSize);
+    dweetRequestLen    += aSize;
+    dweetRequest[dweetRequestLen]   = '\0';
+    dweetStats.bytesIn += aSize;
+
+    /* One request at a time, the next one waits until this response was read */
+    if (dweetResponseSent == dweetResponseLen)
+    {
+        used    = serve_request();
+        if (used > 0)
+        {
+            memmove(dweetRequest, dweetRequest + used, dweetRequestLen - used + 1);
+            dweetRequestLen    -= used;
+        }
+    }
+    return (int) aSize;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int dweet_recv(
+    void*       aData,
+    uint32_t    aSize,
+    int32_t     aTimeoutMs)
+{
+    uint64_t    timeoutUs   = ((aTimeoutMs >= 0) ? aTimeoutMs : DWEET_IDLE_TIMEOUT_MS) * 1000ULL;
+    uint64_t    nowUs       = host_clock_us();
+    uint32_t    len;
+
+    if (dweetResponseSent == dweetResponseLen)
+    {
+        if (false == dweetOpen)
+        {
+            return 0;
+        }
+        host_clock_advance_us(timeoutUs);
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+    if (dweetReadyUs > nowUs)
+    {
+        if (dweetReadyUs - nowUs > timeoutUs)
+        {
+            host_clock_advance_us(timeoutUs);
+            return NSAPI_ERROR_WOULD_BLOCK;
+        }
+        host_clock_advance_us(dweetReadyUs - nowUs);
+    }
+
+    len = dweetResponseLen - dweetResponseSent;
+    len = (len < aSize) ? len : aSize;
+    memcpy(aData, dweetResponse + dweetResponseSent, len);
+    dweetResponseSent  += len;
+    dweetStats.bytesOut += len;
+    if (dweetResponseSent == dweetResponseLen)
+    {
+        uint64_t    us  = host_clock_us() - dweetStartUs;
+
+        dweetStats.latencyUs   += us;
+        dweetStats.latencyMaxUs = (us > dweetStats.latencyMaxUs) ? us : dweetStats.latencyMaxUs;
+        dweetStarted            = false;
+        if (dweetCloseAfter)
+        {
+            dweetOpen   = false;
+        }
+        else if (dweetRequestLen > 0)
+        {
+            dweet_send("", 0);
+        }
+    }
+    return (int) len;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void dweet_close(void)
+{
+    dweetOpen   = false;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void dweet_report(void)
+{
+    fprintf(stderr, "DWEET: %u connections, %u requests (%u POST, %u not found, %u faulted), %u samples, %u bytes in, %u out, "
+                    "%.1f bytes/sample, %.1f ms mean and %.1f ms max per request\n",
+            dweetStats.connections, dweetStats.requests, dweetStats.posts, dweetStats.notFound, dweetStats.faulted, dweetStats.samples,
+            dweetStats.bytesIn, dweetStats.bytesOut, dweetStats.samples ? (double) dweetStats.bytesIn / dweetStats.samples : 0.0,
+            dweetStats.requests ? dweetStats.latencyUs / 1000.0 / dweetStats.requests : 0.0, dweetStats.latencyMaxUs / 1000.0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static const HostTcpServer_t    dweetServer =
+{
+    "dweet", dweet_connect, dweet_send, dweet_recv, dweet_close, dweet_report
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+const HostTcpServer_t* host_dweet_server(
+    uint32_t    aLatencyMs)
+{
+    dweetLatencyMs  = aLatencyMs;
+    return &dweetServer;
+}
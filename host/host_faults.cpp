@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HOST_FAULT_WINDOWS_MAX  (64)
+#define HOST_FAULT_LINE_MAX     (128)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* A fault from startMs until endMs of host time */
+typedef struct
+{
+    uint32_t    startMs;
+    uint32_t    endMs;
+    uint8_t     fault;              /* HostFault_e */
+    uint32_t    arg;
+} HostFaultWindow_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static const char* const    hostFaultNames[HOST_FAULT_COUNT] =
+{
+    "none", "link", "refuse", "status", "drop", "reset", "slow",
+};
+
+static HostFaultWindow_t    hostFaultWindows[HOST_FAULT_WINDOWS_MAX];
+static int                  hostFaultWindowCount;
+static uint32_t             hostFaultHits[HOST_FAULT_COUNT];
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int host_faults_load(
+    const char* aPath)
+{
+    FILE*               file    = fopen(aPath, "r");
+    char                line[HOST_FAULT_LINE_MAX];
+    char                name[16];
+    double              startS;
+    double              endS;
+    unsigned            arg;
+    int                 count;
+    HostFaultWindow_t*  window;
+
+    if (NULL == file)
+    {
+        return -1;
+    }
+
+    hostFaultWindowCount    = 0;
+    while (NULL != fgets(line, sizeof(line), file) && hostFaultWindowCount < HOST_FAULT_WINDOWS_MAX)
+    {
+        if ('#' == line[0] || '\n' == line[0] || '\r' == line[0] || 0 == strncmp(line, "start_s", 7))
+        {
+            continue;
+        }
+        arg     = 0;
+        count   = sscanf(line, "%lf,%lf,%15[a-z],%u", &startS, &endS, name, &arg);
+        window  = &hostFaultWindows[hostFaultWindowCount];
+        window->fault   = HOST_FAULT_NONE;
+        for (int f = HOST_FAULT_NONE + 1; f < HOST_FAULT_COUNT && count >= 3; f++)
+        {
+            if (0 == strcmp(name, hostFaultNames[f]))
+            {
+                window->fault   = (uint8_t) f;
+            }
+        }
+        if (HOST_FAULT_NONE == window->fault)
+        {
+            fprintf(stderr, "HOST: %s: not a fault: %s", aPath, line);
+            continue;
+        }
+        window->startMs = (uint32_t) (startS * 1000);
+        window->endMs   = (uint32_t) (endS * 1000);
+        window->arg     = arg;
+        hostFaultWindowCount++;
+    }
+    fclose(file);
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+HostFault_e host_fault_active(
+    uint32_t*   aArg)
+{
+    uint32_t    nowMs   = (uint32_t) (host_clock_us() / 1000);
+
+    for (int i = 0; i < hostFaultWindowCount; i++)
+    {
+        if (nowMs >= hostFaultWindows[i].startMs && nowMs < hostFaultWindows[i].endMs)
+        {
+            if (NULL != aArg)
+            {
+                *aArg   = hostFaultWindows[i].arg;
+            }
+            return (HostFault_e) hostFaultWindows[i].fault;
+        }
+    }
+    return HOST_FAULT_NONE;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_fault_hit(
+    HostFault_e aFault)
+{
+    hostFaultHits[aFault]++;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_faults_report(void)
+{
+    if (0 == hostFaultWindowCount)
+    {
+        return;
+    }
+    fprintf(stderr, "FAULTS: %d windows,", hostFaultWindowCount);
+    for (int f = HOST_FAULT_NONE + 1; f < HOST_FAULT_COUNT; f++)
+    {
+        fprintf(stderr, " %u %s%s", hostFaultHits[f], hostFaultNames[f], (f + 1 < HOST_FAULT_COUNT) ? "," : "\n");
+    }
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include "mbed.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+/* nRF52840 internal flash */
+#define HOST_FLASH_START        (0x00000000UL)
+#define HOST_FLASH_SIZE         (0x00100000UL)
+#define HOST_FLASH_SECTOR       (4096)
+#define HOST_FLASH_PAGE         (4)
+#define HOST_FLASH_ERASED       (0xFF)
+#define HOST_FLASH_SECTORS      (HOST_FLASH_SIZE / HOST_FLASH_SECTOR)
+
+#define HOST_FLASH_ERASE_US     (85000)     /* nRF52840 page erase */
+#define HOST_FLASH_WORD_US      (41)        /* nRF52840 word write */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    HOST_POWER_ON,
+    HOST_POWER_CUT,         /* The operation in progress is cut short */
+    HOST_POWER_OFF          /* Nothing is written any more */
+} HostPower_e;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static uint8_t  hostFlash[HOST_FLASH_SIZE];
+static bool     hostFlashReady;
+static FILE*    hostFlashFile;
+static uint32_t hostFlashCutIn;             /* Operations until the power cut, 0 = none */
+static bool     hostFlashDead;              /* Power was cut, no more writes until reopened */
+static uint32_t hostFlashErases[HOST_FLASH_SECTORS];
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static bool in_range(
+    uint32_t    aAddr,
+    uint32_t    aSize)
+{
+    return aAddr >= HOST_FLASH_START && aSize <= HOST_FLASH_SIZE && aAddr - HOST_FLASH_START <= HOST_FLASH_SIZE - aSize;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Writes a changed range through to the image file */
+static int write_through(
+    uint32_t    aOffset,
+    uint32_t    aSize)
+{
+    if (NULL == hostFlashFile)
+    {
+        return 0;
+    }
+    if (0 != fseek(hostFlashFile, aOffset, SEEK_SET) ||
+        aSize != fwrite(hostFlash + aOffset, 1, aSize, hostFlashFile) ||
+        0 != fflush(hostFlashFile))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Counts a program or erase towards a power cut */
+static HostPower_e power_state(void)
+{
+    if (hostFlashDead)
+    {
+        return HOST_POWER_OFF;
+    }
+    if (0 != hostFlashCutIn && 0 == --hostFlashCutIn)
+    {
+        hostFlashDead   = true;
+        return HOST_POWER_CUT;
+    }
+    return HOST_POWER_ON;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int host_flash_open(
+    const char* aPath)
+{
+    size_t      got;
+
+    if (NULL != hostFlashFile)
+    {
+        fclose(hostFlashFile);
+        hostFlashFile   = NULL;
+    }
+    memset(hostFlash, HOST_FLASH_ERASED, sizeof(hostFlash));
+    memset(hostFlashErases, 0, sizeof(hostFlashErases));
+    hostFlashReady  = true;
+    hostFlashCutIn  = 0;
+    hostFlashDead   = false;
+    if (NULL == aPath)
+    {
+        return 0;
+    }
+
+    hostFlashFile   = fopen(aPath, "r+b");
+    if (NULL == hostFlashFile)
+    {
+        hostFlashFile   = fopen(aPath, "w+b");
+        return (NULL != hostFlashFile) ? write_through(0, HOST_FLASH_SIZE) : -1;
+    }
+    got = fread(hostFlash, 1, HOST_FLASH_SIZE, hostFlashFile);
+    if (got < HOST_FLASH_SIZE)
+    {
+        /* A shorter image is a flash that was erased beyond it */
+        memset(hostFlash + got, HOST_FLASH_ERASED, HOST_FLASH_SIZE - got);
+        return write_through(got, HOST_FLASH_SIZE - got);
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_flash_power_cut(
+    uint32_t    aOps)
+{
+    hostFlashCutIn  = aOps;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t host_flash_erase_count(
+    uint32_t    aAddr)
+{
+    return in_range(aAddr, 1) ? hostFlashErases[(aAddr - HOST_FLASH_START) / HOST_FLASH_SECTOR] : 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int FlashIAP::init(void)
+{
+    return hostFlashReady ? 0 : host_flash_open(NULL);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int FlashIAP::read(
+    void*       aBuffer,
+    uint32_t    aAddr,
+    uint32_t    aSize)
+{
+    if (false == hostFlashReady || false == in_range(aAddr, aSize))
+    {
+        return -1;
+    }
+    memcpy(aBuffer, hostFlash + (aAddr - HOST_FLASH_START), aSize);
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Programming only clears bits, a byte written twice keeps the zeros of both writes */
+int FlashIAP::program(
+    const void* aBuffer,
+    uint32_t    aAddr,
+    uint32_t    aSize)
+{
+    const uint8_t*  src     = (const uint8_t*) aBuffer;
+    uint32_t        offset  = aAddr - HOST_FLASH_START;
+    uint32_t        done    = aSize;
+    HostPower_e     power;
+
+    if (false == hostFlashReady || false == in_range(aAddr, aSize) ||
+        0 != (offset % HOST_FLASH_PAGE) || 0 != (aSize % HOST_FLASH_PAGE))
+    {
+        return -1;
+    }
+    power   = power_state();
+    if (HOST_POWER_CUT == power)
+    {
+        /* Words are written in order, the cut leaves the first half of them */
+        done    = (aSize / HOST_FLASH_PAGE / 2) * HOST_FLASH_PAGE;
+    }
+    else if (HOST_POWER_OFF == power)
+    {
+        return -1;
+    }
+    for (uint32_t i = 0; i < done; i++)
+    {
+        hostFlash[offset + i]  &= src[i];
+    }
+    host_clock_advance_us((uint64_t) HOST_FLASH_WORD_US * (done / HOST_FLASH_PAGE));
+    return (0 == write_through(offset, done) && HOST_POWER_ON == power) ? 0 : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int FlashIAP::erase(
+    uint32_t    aAddr,
+    uint32_t    aSize)
+{
+    uint32_t    offset  = aAddr - HOST_FLASH_START;
+
+    if (false == hostFlashReady || false == in_range(aAddr, aSize) ||
+        0 != (offset % HOST_FLASH_SECTOR) || 0 != (aSize % HOST_FLASH_SECTOR))
+    {
+        return -1;
+    }
+    switch (power_state())
+    {
+        case HOST_POWER_CUT:
+            /* An interrupted erase leaves the sector neither erased nor as it was */
+            memset(hostFlash + offset, HOST_FLASH_ERASED, aSize / 2);
+            write_through(offset, aSize / 2);
+            return -1;
+        case HOST_POWER_OFF:
+            return -1;
+        default:
+            break;
+    }
+    memset(hostFlash + offset, HOST_FLASH_ERASED, aSize);
+    for (uint32_t i = 0; i < aSize / HOST_FLASH_SECTOR; i++)
+    {
+        hostFlashErases[offset / HOST_FLASH_SECTOR + i]++;
+    }
+    host_clock_advance_us((uint64_t) HOST_FLASH_ERASE_US * (aSize / HOST_FLASH_SECTOR));
+    return write_through(offset, aSize);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t FlashIAP::get_sector_size(
+    uint32_t    aAddr) const
+{
+    return in_range(aAddr, 1) ? HOST_FLASH_SECTOR : 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t FlashIAP::get_page_size(void) const
+{
+    return HOST_FLASH_PAGE;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t FlashIAP::get_flash_start(void) const
+{
+    return HOST_FLASH_START;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t FlashIAP::get_flash_size(void) const
+{
+    return HOST_FLASH_SIZE;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Heap statistics of the host build. As mbed OS does with MBED_HEAP_STATS_ENABLED, malloc, calloc,
+ * realloc and free of the firmware and host objects are wrapped (-Wl,--wrap in host/Makefile) and
+ * every block carries a header with its size. Allocations made inside the C library or a shared
+ * library, e.g. the system mbedTLS, are not seen.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <new>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mbed.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HOST_HEAP_SIGNATURE     (0xdeadbeefUL)      /* As mbed OS marks its blocks */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Put in front of every block, 16 bytes so the block keeps the alignment of malloc */
+typedef struct
+{
+    uint64_t    size;
+    uint64_t    signature;
+} HostHeapHeader_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static pthread_mutex_t      hostHeapMutex   = PTHREAD_MUTEX_INITIALIZER;
+static mbed_stats_heap_t    hostHeapStats;
+static uint32_t             hostHeapAllocs;             /* Since start, alloc_cnt only counts live blocks */
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+extern "C" void* __real_malloc(size_t aSize);
+extern "C" void __real_free(void* aPtr);
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+extern "C" void* __wrap_malloc(
+    size_t      aSize)
+{
+    HostHeapHeader_t*   header  = (HostHeapHeader_t*) __real_malloc(sizeof(HostHeapHeader_t) + aSize);
+
+    pthread_mutex_lock(&hostHeapMutex);
+    if (NULL == header)
+    {
+        hostHeapStats.alloc_fail_cnt++;
+    }
+    else
+    {
+        hostHeapStats.current_size     += (uint32_t) aSize;
+        hostHeapStats.total_size       += (uint32_t) aSize;
+        hostHeapStats.overhead_size    += sizeof(HostHeapHeader_t);
+        hostHeapStats.alloc_cnt++;
+        hostHeapAllocs++;
+        if (hostHeapStats.current_size > hostHeapStats.max_size)
+        {
+            hostHeapStats.max_size  = hostHeapStats.current_size;
+        }
+    }
+    pthread_mutex_unlock(&hostHeapMutex);
+
+    if (NULL == header)
+    {
+        return NULL;
+    }
+    header->size        = aSize;
+    header->signature   = HOST_HEAP_SIGNATURE;
+    return header + 1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+extern "C" void __wrap_free(
+    void*       aPtr)
+{
+    HostHeapHeader_t*   header  = (HostHeapHeader_t*) aPtr - 1;
+
+    if (NULL == aPtr)
+    {
+        return;
+    }
+    if (HOST_HEAP_SIGNATURE != header->signature)
+    {
+        fprintf(stderr, "HOST: free of %p, not a block of the firmware heap\n", aPtr);
+        abort();
+    }
+
+    pthread_mutex_lock(&hostHeapMutex);
+    hostHeapStats.current_size     -= (uint32_t) header->size;
+    hostHeapStats.overhead_size    -= sizeof(HostHeapHeader_t);
+    hostHeapStats.alloc_cnt--;
+    pthread_mutex_unlock(&hostHeapMutex);
+
+    header->signature   = 0;
+    __real_free(header);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+extern "C" void* __wrap_calloc(
+    size_t      aCount,
+    size_t      aSize)
+{
+    void*       ptr;
+
+    if ((0 != aSize) && (aCount > (size_t) -1 / aSize))
+    {
+        pthread_mutex_lock(&hostHeapMutex);
+        hostHeapStats.alloc_fail_cnt++;
+        pthread_mutex_unlock(&hostHeapMutex);
+        return NULL;
+    }
+    ptr = __wrap_malloc(aCount * aSize);
+    if (NULL != ptr)
+    {
+        memset(ptr, 0, aCount * aSize);
+    }
+    return ptr;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A new block and a copy, as mbed OS does with heap statistics on */
+extern "C" void* __wrap_realloc(
+    void*       aPtr,
+    size_t      aSize)
+{
+    void*       ptr;
+
+    if (NULL == aPtr)
+    {
+        return __wrap_malloc(aSize);
+    }
+    if (0 == aSize)
+    {
+        __wrap_free(aPtr);
+        return NULL;
+    }
+    ptr = __wrap_malloc(aSize);
+    if (NULL != ptr)
+    {
+        size_t  oldSize = (size_t) ((HostHeapHeader_t*) aPtr - 1)->size;
+
+        memcpy(ptr, aPtr, (oldSize < aSize) ? oldSize : aSize);
+        __wrap_free(aPtr);
+    }
+    return ptr;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* new and delete go through malloc and free on the target too */
+void* operator new(
+    size_t      aSize)
+{
+    void*       ptr     = __wrap_malloc(aSize ? aSize : 1);
+
+    if (NULL == ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](
+    size_t      aSize)
+{
+    return operator new(aSize);
+}
+
+void operator delete(
+    void*       aPtr) noexcept
+{
+    __wrap_free(aPtr);
+}
+
+void operator delete[](
+    void*       aPtr) noexcept
+{
+    __wrap_free(aPtr);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void mbed_stats_heap_get(
+    mbed_stats_heap_t*  aStats)
+{
+    pthread_mutex_lock(&hostHeapMutex);
+    *aStats = hostHeapStats;
+    pthread_mutex_unlock(&hostHeapMutex);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_heap_report(void)
+{
+    mbed_stats_heap_t   heap;
+
+    mbed_stats_heap_get(&heap);
+    fprintf(stderr, "HEAP: %u bytes in use in %u blocks, %u max, %u allocations of %u bytes in total, %u failed\n",
+            (unsigned) heap.current_size, (unsigned) heap.alloc_cnt, (unsigned) heap.max_size, (unsigned) hostHeapAllocs,
+            (unsigned) heap.total_size, (unsigned) heap.alloc_fail_cnt);
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Runs the firmware on a PC: simulated time, sensors replayed from a trace and the uplink
+ * answered by an in-process dweet stand-in or by a real server such as tools/dweet_standin.py.
+ *
+ *   host/build/rm_host -s 600 -t host/traces/manhole.csv
+ *   host/build/rm_host -s 3600 -c localhost:8080 -q
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HOST_DEFAULT_SECONDS        (600)
+#define HOST_DEFAULT_LATENCY_MS     (300)
+#define HOST_HOST_NAME_MAX          (128)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static struct timespec  hostWallStart;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static void usage(
+    const char* aName)
+{
+    fprintf(stderr, "usage: %s [-s seconds] [-t trace.csv] [-l latency_ms | -c host:port] [-u loss_pct] [-n nat_idle_s] [-f flash.bin] [-F faults.csv] [-L link.csv] [-p] [-q]\n"
+                    "  -s  simulated seconds to run (%d)\n"
+                    "  -t  sensor trace, see host/traces/manhole.csv (a quiet, closed cover)\n"
+                    "  -l  latency of the in-process dweet stand-in (%d ms)\n"
+                    "  -c  send to a real server instead, e.g. tools/dweet_standin.py\n"
+                    "  -n  the in-process MQTT broker resets connections idle for longer, like a carrier NAT (off)\n"
+                    "  -u  datagrams the in-process CoAP stand-in loses each way, in percent (0)\n"
+                    "  -f  keep the flash image in a file, so queued reports survive a restart\n"
+                    "  -F  link and server faults over time, see host/traces/faults_503.csv (none)\n"
+                    "  -L  signal quality over time, see host/traces/link_fade.csv (a good link)\n"
+                    "  -p  count the host CPU time as device time, for latency-bench-cycles\n"
+                    "  -q  no firmware log, only the reports\n",
+            aName, HOST_DEFAULT_SECONDS, HOST_DEFAULT_LATENCY_MS);
+    exit(2);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void report(void)
+{
+    struct timespec now;
+    uint64_t        wallUs;
+    uint64_t        simUs;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    wallUs  = (uint64_t) (now.tv_sec - hostWallStart.tv_sec) * 1000000 + (now.tv_nsec - hostWallStart.tv_nsec) / 1000;
+    simUs   = host_clock_us();
+
+    fflush(stdout);
+    fprintf(stderr, "HOST: %llu s of simulated time in %llu.%03llu ms, %llux real time\n",
+            (unsigned long long) (simUs / 1000000), (unsigned long long) (wallUs / 1000), (unsigned long long) (wallUs % 1000),
+            (unsigned long long) (simUs / (wallUs ? wallUs : 1)));
+    host_sensors_report();
+    host_net_report();
+    host_faults_report();
+    host_heap_report();
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(
+    int     aArgc,
+    char*   aArgv[])
+{
+    const HostTcpServer_t*  server      = NULL;
+    const char*             trace       = NULL;
+    const char*             flash       = NULL;
+    const char*             faults      = NULL;
+    const char*             link        = NULL;
+    unsigned long           seconds     = HOST_DEFAULT_SECONDS;
+    unsigned long           latencyMs   = HOST_DEFAULT_LATENCY_MS;
+    unsigned long           lossPct     = 0;
+    unsigned long           natIdleS    = 0;
+    bool                    countCpu    = false;
+    char                    host[HOST_HOST_NAME_MAX];
+    char*                   port;
+    int                     opt;
+
+    while ((opt = getopt(aArgc, aArgv, "s:t:l:c:u:n:f:F:L:pq")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                seconds = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                trace = optarg;
+                break;
+            case 'l':
+                latencyMs = strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                snprintf(host, sizeof(host), "%s", optarg);
+                port = strrchr(host, ':');
+                if (port == NULL)
+                {
+                    usage(aArgv[0]);
+                }
+                *port++ = '\0';
+                server = host_net_socket_server(host, (uint16_t) strtoul(port, NULL, 10));
+                break;
+            case 'u':
+                lossPct = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                natIdleS = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                flash = optarg;
+                break;
+            case 'F':
+                faults = optarg;
+                break;
+            case 'L':
+                link = optarg;
+                break;
+            case 'p':
+                countCpu = true;
+                break;
+            case 'q':
+                host_log_enable(false);
+                break;
+            default:
+                usage(aArgv[0]);
+        }
+    }
+
+    if ((trace != NULL) && (host_sensors_load(trace) != 0))
+    {
+        fprintf(stderr, "HOST: cannot read the sensor trace %s\n", trace);
+        return 1;
+    }
+    if ((flash != NULL) && (host_flash_open(flash) != 0))
+    {
+        fprintf(stderr, "HOST: cannot open the flash image %s\n", flash);
+        return 1;
+    }
+    if ((faults != NULL) && (host_faults_load(faults) != 0))
+    {
+        fprintf(stderr, "HOST: cannot read the fault schedule %s\n", faults);
+        return 1;
+    }
+    if ((link != NULL) && (host_net_load_link(link) != 0))
+    {
+        fprintf(stderr, "HOST: cannot read the link trace %s\n", link);
+        return 1;
+    }
+
+    if (server == NULL)
+    {
+        server  = host_dweet_server((uint32_t) latencyMs);
+        host_net_route(MBED_APP_CONF_MQTT_PORT, host_mqtt_server((uint32_t) latencyMs, (uint32_t) natIdleS));
+    }
+    host_net_set_server(server);
+    host_net_set_udp_server(host_coap_server((uint32_t) latencyMs, (uint32_t) lossPct));
+    host_clock_init((uint64_t) seconds * 1000);
+    host_clock_count_cpu(countCpu);
+
+    clock_gettime(CLOCK_MONOTONIC, &hostWallStart);
+    atexit(report);
+
+    /* The firmware never returns, the clock ends the run */
+    return firmware_main();
+}
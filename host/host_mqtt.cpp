@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* In-process MQTT broker stand-in for the UPLINK_MQTT transport (Network/mqtt_uplink.cpp). It
+ * answers CONNECT, QoS 1 PUBLISH and PINGREQ after the latency, like the dweet stand-in answers
+ * HTTP. A carrier NAT that forgets idle connections can be simulated, so the keep-alive interval
+ * can be checked against it: the first packet after the mapping expired resets the connection.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include "mbed.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define MQTT_REQUEST_MAX        (1024)
+#define MQTT_RESPONSE_MAX       (64)
+#define MQTT_IDLE_TIMEOUT_MS    (30000)     /* recv() without a timeout set */
+#define MQTT_REPORT_GAP_US      (1000000)   /* Publishes closer than this belong to one report */
+
+#define MQTT_CONNECT            (1)         /* Packet types */
+#define MQTT_PUBLISH            (3)
+#define MQTT_PINGREQ            (12)
+#define MQTT_DISCONNECT         (14)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    connections;
+    uint32_t    sessions;           /* CONNECT packets */
+    uint32_t    natResets;
+    uint32_t    publishes;
+    uint32_t    qos1;
+    uint32_t    pings;
+    uint32_t    reports;            /* Bursts of publishes, the broker cannot tell reports apart */
+    uint32_t    bytesIn;
+    uint32_t    bytesOut;
+    uint64_t    connectUs;          /* Connection to CONNACK read */
+    uint64_t    ackUs;              /* QoS 1 PUBLISH to PUBACK read */
+    uint64_t    ackMaxUs;
+} MqttStats_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static uint32_t     mqttLatencyMs;
+static uint32_t     mqttNatIdleS;
+static bool         mqttOpen;
+static uint64_t     mqttLastUs;             /* Last packet either way, for the NAT */
+static uint64_t     mqttLastPublishUs;
+static bool         mqttReported;           /* A publish was seen, mqttLastPublishUs is valid */
+
+static uint8_t      mqttRequest[MQTT_REQUEST_MAX];
+static uint32_t     mqttRequestLen;
+static uint8_t      mqttResponse[MQTT_RESPONSE_MAX];
+static uint32_t     mqttResponseLen;
+static uint32_t     mqttResponseSent;
+static uint64_t     mqttReadyUs;            /* When the response may be read */
+static uint64_t     mqttStartUs;            /* When the exchange being answered started */
+static uint64_t*    mqttLatency;            /* Where its latency goes once the response was read */
+static MqttStats_t  mqttStats;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* True when the NAT has forgotten the connection; it then resets it */
+static bool nat_expired(void)
+{
+    if (mqttOpen && mqttNatIdleS > 0 && host_clock_us() - mqttLastUs > mqttNatIdleS * 1000000ULL)
+    {
+        mqttStats.natResets++;
+        mqttOpen    = false;
+    }
+    mqttLastUs  = host_clock_us();
+    return (false == mqttOpen);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Queues a response, to be read once the latency has passed */
+static void respond(
+    uint8_t     aType,
+    uint8_t     aLen,
+    uint8_t     aIdHigh,
+    uint8_t     aIdLow,
+    uint64_t*   aLatency)
+{
+    uint8_t*    out = mqttResponse + mqttResponseLen;
+
+    if (mqttResponseLen + 4 > sizeof(mqttResponse))
+    {
+        return;
+    }
+    out[0]  = aType;
+    out[1]  = aLen;
+    out[2]  = aIdHigh;
+    out[3]  = aIdLow;
+    mqttResponseLen    += 2 + aLen;
+    mqttReadyUs         = host_clock_us() + mqttLatencyMs * 1000ULL;
+    mqttLatency         = aLatency;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Answers the packet at the start of mqttRequest once all of it is there.
+ *
+ * @return The bytes of the packet, 0 while it is incomplete.
+ */
+static uint32_t serve_packet(void)
+{
+    uint32_t    remaining   = 0;
+    uint32_t    pos         = 1;
+    uint32_t    topicLen;
+    uint8_t     type;
+    uint8_t     qos;
+
+    do
+    {
+        if (pos >= mqttRequestLen || pos > 4)
+        {
+            return 0;
+        }
+        remaining  |= (mqttRequest[pos] & 0x7F) << (7 * (pos - 1));
+    }
+    while (mqttRequest[pos++] & 0x80);
+    if (pos + remaining > mqttRequestLen)
+    {
+        return 0;
+    }
+
+    type    = mqttRequest[0] >> 4;
+    switch (type)
+    {
+        case MQTT_CONNECT:
+            mqttStats.sessions++;
+            respond(0x20, 2, 0, 0, &mqttStats.connectUs);
+            break;
+
+        case MQTT_PUBLISH:
+            qos = (mqttRequest[0] >> 1) & 0x03;
+            mqttStats.publishes++;
+            if (false == mqttReported || host_clock_us() - mqttLastPublishUs > MQTT_REPORT_GAP_US)
+            {
+                mqttStats.reports++;
+            }
+            mqttLastPublishUs   = host_clock_us();
+            mqttReported        = true;
+            if (qos > 0 && remaining >= 4)
+            {
+                topicLen    = (mqttRequest[pos] << 8) | mqttRequest[pos + 1];
+                if (2 + topicLen + 2 <= remaining)
+                {
+                    mqttStats.qos1++;
+                    respond(0x40, 2, mqttRequest[pos + 2 + topicLen], mqttRequest[pos + 3 + topicLen], &mqttStats.ackUs);
+                }
+            }
+            break;
+
+        case MQTT_PINGREQ:
+            mqttStats.pings++;
+            respond(0xD0, 0, 0, 0, NULL);
+            break;
+
+        case MQTT_DISCONNECT:
+            mqttOpen    = false;
+            break;
+
+        default:
+            break;
+    }
+    return pos + remaining;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int mqtt_connect(
+    const char* aIp,
+    uint16_t    aPort)
+{
+    (void) aIp;
+    (void) aPort;
+
+    /* The TCP handshake is a round trip before CONNECT can go */
+    mqttStartUs         = host_clock_us();
+    host_clock_advance_us(mqttLatencyMs * 1000ULL);
+    mqttOpen            = true;
+    mqttLastUs          = host_clock_us();
+    mqttRequestLen      = 0;
+    mqttResponseLen     = 0;
+    mqttResponseSent    = 0;
+    mqttStats.connections++;
+    return NSAPI_ERROR_OK;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int mqtt_send(
+    const void* aData,
+    uint32_t    aSize)
+{
+    uint32_t    used;
+
+    if (nat_expired())
+    {
+        return NSAPI_ERROR_CONNECTION_LOST;
+    }
+    if (aSize > MQTT_REQUEST_MAX - mqttRequestLen)
+    {
+        aSize   = MQTT_REQUEST_MAX - mqttRequestLen;
+    }
+    if (0 == mqttRequestLen && MQTT_CONNECT != (((const uint8_t*) aData)[0] >> 4))
+    {
+        mqttStartUs = host_clock_us();
+    }
+    memcpy(mqttRequest + mqttRequestLen, aData, aSize);
+    mqttRequestLen     += aSize;
+    mqttStats.bytesIn  += aSize;
+
+    while ((used = serve_packet()) > 0)
+    {
+        memmove(mqttRequest, mqttRequest + used, mqttRequestLen - used);
+        mqttRequestLen -= used;
+    }
+    return (int) aSize;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int mqtt_recv(
+    void*       aData,
+    uint32_t    aSize,
+    int32_t     aTimeoutMs)
+{
+    uint64_t    timeoutUs   = ((aTimeoutMs >= 0) ? aTimeoutMs : MQTT_IDLE_TIMEOUT_MS) * 1000ULL;
+    uint64_t    nowUs       = host_clock_us();
+    uint64_t    waitUs      = (mqttReadyUs > nowUs) ? mqttReadyUs - nowUs : 0;
+    uint32_t    len;
+
+    if (false == mqttOpen)
+    {
+        return 0;
+    }
+    if (mqttResponseSent == mqttResponseLen || waitUs > timeoutUs)
+    {
+        host_clock_advance_us(timeoutUs);
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+    host_clock_advance_us(waitUs);
+    if (nat_expired())
+    {
+        return 0;
+    }
+
+    len = mqttResponseLen - mqttResponseSent;
+    len = (len < aSize) ? len : aSize;
+    memcpy(aData, mqttResponse + mqttResponseSent, len);
+    mqttResponseSent   += len;
+    mqttStats.bytesOut += len;
+    if (mqttResponseSent == mqttResponseLen)
+    {
+        if (NULL != mqttLatency)
+        {
+            uint64_t    us  = host_clock_us() - mqttStartUs;
+
+            *mqttLatency   += us;
+            if (&mqttStats.ackUs == mqttLatency && us > mqttStats.ackMaxUs)
+            {
+                mqttStats.ackMaxUs  = us;
+            }
+        }
+        mqttResponseLen     = 0;
+        mqttResponseSent    = 0;
+        mqttLatency         = NULL;
+    }
+    return (int) len;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void mqtt_close(void)
+{
+    mqttOpen    = false;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void mqtt_report(void)
+{
+    fprintf(stderr, "MQTT: %u connections (%u sessions, %u reset by the NAT), %u publishes (%u QoS 1), %u pings, %u reports (bursts), "
+                    "%u bytes in, %u out, %.1f bytes/report, %.1f ms per session setup, %.1f ms mean and %.1f ms max per QoS 1 publish\n",
+            mqttStats.connections, mqttStats.sessions, mqttStats.natResets, mqttStats.publishes, mqttStats.qos1, mqttStats.pings,
+            mqttStats.reports, mqttStats.bytesIn, mqttStats.bytesOut,
+            mqttStats.reports ? (double) (mqttStats.bytesIn + mqttStats.bytesOut) / mqttStats.reports : 0.0,
+            mqttStats.sessions ? mqttStats.connectUs / 1000.0 / mqttStats.sessions : 0.0,
+            mqttStats.qos1 ? mqttStats.ackUs / 1000.0 / mqttStats.qos1 : 0.0, mqttStats.ackMaxUs / 1000.0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static const HostTcpServer_t    mqttServer =
+{
+    "mqtt", mqtt_connect, mqtt_send, mqtt_recv, mqtt_close, mqtt_report
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+const HostTcpServer_t* host_mqtt_server(
+    uint32_t    aLatencyMs,
+    uint32_t    aNatIdleS)
+{
+    mqttLatencyMs   = aLatencyMs;
+    mqttNatIdleS    = aNatIdleS;
+    return &mqttServer;
+}
@@ -0,0 +1,611 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "mbed.h"
+#include "CellularContext.h"
+#include "AT_CellularDevice.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HOST_SERVER_IP          "10.0.0.1"  /* Every name resolves to it */
+#define HOST_RSSI_DBM           (-71)
+#define HOST_RSRP_DBM           (-88)
+#define HOST_RSRQ_DB            (-9)
+#define HOST_ROUTE_MAX          (4)
+#define HOST_LINK_ROWS_MAX      (4096)
+#define HOST_LINK_LINE_MAX      (128)
+#define HOST_LINK_UNKNOWN       (-32768)    /* An empty cell, the modem does not report it */
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    lookups;
+    uint32_t    connects;
+    uint32_t    connectFailures;
+    uint32_t    bytesSent;
+    uint32_t    bytesReceived;
+    uint32_t    udpSent;
+    uint32_t    udpReceived;
+} HostNetStats_t;
+
+/* Signal quality from tMs on, until the next row of the link trace */
+typedef struct
+{
+    uint32_t    tMs;
+    int16_t     rssiDbm;
+    int16_t     rsrpDbm;
+    int16_t     rsrqDb;
+} HostLinkRow_t;
+
+/* Connections to one port that go to another server */
+typedef struct
+{
+    uint16_t                port;
+    const HostTcpServer_t*  server;
+    uint32_t                connects;
+} HostRoute_t;
+
+/* The modem of the board, attached from the start */
+class HostCellularContext : public CellularContext
+{
+public:
+    virtual CellularDevice* get_device(void) { return &_device; }
+
+private:
+    AT_CellularDevice   _device;
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static const HostTcpServer_t*   hostServer;
+static HostRoute_t              hostRoutes[HOST_ROUTE_MAX];
+static const HostTcpServer_t*   hostConnServer;         /* Server of the open connection */
+static const HostUdpServer_t*   hostUdpServer;
+static HostNetStats_t           hostNetStats;
+
+/* Link trace of host_net_load_link(), one row of the defaults without one */
+static HostLinkRow_t            hostLinkRows[HOST_LINK_ROWS_MAX] = { { 0, HOST_RSSI_DBM, HOST_RSRP_DBM, HOST_RSRQ_DB } };
+static int                      hostLinkRowCount    = 1;
+static int                      hostLinkRowIdx;
+static uint32_t                 hostLinkQueries;
+
+/* Real socket to a server on the host or the LAN */
+static char                     socketHost[64];
+static char                     socketPort[8];
+static int                      socketFd    = -1;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* The row of the link trace at the host time */
+static const HostLinkRow_t* link_row(void)
+{
+    uint32_t    nowMs   = (uint32_t) (host_clock_us() / 1000);
+
+    hostLinkQueries++;
+    while (hostLinkRowIdx + 1 < hostLinkRowCount && hostLinkRows[hostLinkRowIdx + 1].tMs <= nowMs)
+    {
+        hostLinkRowIdx++;
+    }
+    return &hostLinkRows[hostLinkRowIdx];
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The value of a cell of the link trace, HOST_LINK_UNKNOWN when empty */
+static int16_t link_cell(
+    char**      aCursor)
+{
+    char*       cell    = *aCursor;
+    char*       end;
+    long        value;
+
+    if (NULL == cell)
+    {
+        return HOST_LINK_UNKNOWN;
+    }
+    *aCursor    = strchr(cell, ',');
+    if (NULL != *aCursor)
+    {
+        *(*aCursor)++   = '\0';
+    }
+    value   = strtol(cell, &end, 10);
+    return (end == cell) ? HOST_LINK_UNKNOWN : (int16_t) value;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void socket_close(void)
+{
+    if (socketFd >= 0)
+    {
+        close(socketFd);
+        socketFd    = -1;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int socket_connect(
+    const char* aIp,
+    uint16_t    aPort)
+{
+    struct addrinfo     hints;
+    struct addrinfo*    addr;
+    int                 one     = 1;
+    int                 result  = NSAPI_ERROR_NO_CONNECTION;
+
+    (void) aIp;
+    (void) aPort;
+    socket_close();
+    host_clock_io_begin();
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family     = AF_INET;
+    hints.ai_socktype   = SOCK_STREAM;
+    if (0 != getaddrinfo(socketHost, socketPort, &hints, &addr))
+    {
+        host_clock_io_end();
+        return NSAPI_ERROR_DNS_FAILURE;
+    }
+    socketFd    = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (socketFd >= 0 && 0 == connect(socketFd, addr->ai_addr, addr->ai_addrlen))
+    {
+        setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        result  = NSAPI_ERROR_OK;
+    }
+    else
+    {
+        socket_close();
+    }
+    freeaddrinfo(addr);
+    host_clock_io_end();
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int socket_send(
+    const void* aData,
+    uint32_t    aSize)
+{
+    ssize_t     sent;
+
+    if (socketFd < 0)
+    {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    host_clock_io_begin();
+    sent    = send(socketFd, aData, aSize, MSG_NOSIGNAL);
+    host_clock_io_end();
+    return (sent < 0) ? NSAPI_ERROR_CONNECTION_LOST : (int) sent;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int socket_recv(
+    void*       aData,
+    uint32_t    aSize,
+    int32_t     aTimeoutMs)
+{
+    struct timeval  timeout = { 0, 0 };
+    ssize_t         got;
+    int             error;
+
+    if (socketFd < 0)
+    {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    if (aTimeoutMs >= 0)
+    {
+        timeout.tv_sec  = aTimeoutMs / 1000;
+        timeout.tv_usec = (aTimeoutMs % 1000) * 1000 + (0 == aTimeoutMs);
+    }
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    host_clock_io_begin();
+    got     = recv(socketFd, aData, aSize, 0);
+    error   = errno;
+    host_clock_io_end();
+    if (got < 0)
+    {
+        return (EAGAIN == error || EWOULDBLOCK == error) ? NSAPI_ERROR_WOULD_BLOCK : NSAPI_ERROR_CONNECTION_LOST;
+    }
+    return (int) got;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static const HostTcpServer_t    socketServer =
+{
+    "socket", socket_connect, socket_send, socket_recv, socket_close, NULL
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+void host_net_set_server(
+    const HostTcpServer_t*  aServer)
+{
+    hostServer  = aServer;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_net_route(
+    uint16_t                aPort,
+    const HostTcpServer_t*  aServer)
+{
+    for (int i = 0; i < HOST_ROUTE_MAX; i++)
+    {
+        if (NULL == hostRoutes[i].server || aPort == hostRoutes[i].port)
+        {
+            hostRoutes[i].port      = aPort;
+            hostRoutes[i].server    = aServer;
+            return;
+        }
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_net_set_udp_server(
+    const HostUdpServer_t*  aServer)
+{
+    hostUdpServer   = aServer;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int host_net_load_link(
+    const char* aPath)
+{
+    FILE*           file    = fopen(aPath, "r");
+    char            line[HOST_LINK_LINE_MAX];
+    char*           cursor;
+    HostLinkRow_t*  row;
+
+    if (NULL == file)
+    {
+        return -1;
+    }
+
+    hostLinkRowCount    = 0;
+    hostLinkRowIdx      = 0;
+    while (NULL != fgets(line, sizeof(line), file) && hostLinkRowCount < HOST_LINK_ROWS_MAX)
+    {
+        if ('#' == line[0] || '\n' == line[0] || '\r' == line[0] || 0 == strncmp(line, "t_s", 3))
+        {
+            continue;
+        }
+        line[strcspn(line, "\r\n")]   = '\0';
+        cursor  = strchr(line, ',');
+        if (NULL != cursor)
+        {
+            *cursor++   = '\0';
+        }
+        row             = &hostLinkRows[hostLinkRowCount++];
+        row->tMs        = (uint32_t) (atof(line) * 1000);
+        row->rssiDbm    = link_cell(&cursor);
+        row->rsrpDbm    = link_cell(&cursor);
+        row->rsrqDb     = link_cell(&cursor);
+    }
+    fclose(file);
+    if (0 == hostLinkRowCount)
+    {
+        /* Nothing to replay, keep a link that never changes */
+        hostLinkRows[hostLinkRowCount++] = { 0, HOST_RSSI_DBM, HOST_RSRP_DBM, HOST_RSRQ_DB };
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_net_report(void)
+{
+    uint32_t    routed  = 0;
+
+    fprintf(stderr, "NET: %u lookups, %u connections (%u failed), %u bytes sent, %u received, %u datagrams sent, %u received\n",
+            hostNetStats.lookups, hostNetStats.connects, hostNetStats.connectFailures,
+            hostNetStats.bytesSent, hostNetStats.bytesReceived, hostNetStats.udpSent, hostNetStats.udpReceived);
+    if (hostLinkRowCount > 1)
+    {
+        fprintf(stderr, "LINK: %u signal quality queries, row %d of %d of the link trace at the end\n",
+                hostLinkQueries, hostLinkRowIdx + 1, hostLinkRowCount);
+    }
+    for (int i = 0; i < HOST_ROUTE_MAX; i++)
+    {
+        routed += hostRoutes[i].connects;
+        if (NULL != hostRoutes[i].server && NULL != hostRoutes[i].server->report && hostRoutes[i].connects > 0)
+        {
+            hostRoutes[i].server->report();
+        }
+    }
+    if (NULL != hostServer && NULL != hostServer->report && hostNetStats.connects > routed)
+    {
+        hostServer->report();
+    }
+    if (NULL != hostUdpServer && NULL != hostUdpServer->report && hostNetStats.udpSent > 0)
+    {
+        hostUdpServer->report();
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+const HostTcpServer_t* host_net_socket_server(
+    const char* aHost,
+    uint16_t    aPort)
+{
+    snprintf(socketHost, sizeof(socketHost), "%s", aHost);
+    snprintf(socketPort, sizeof(socketPort), "%u", aPort);
+    return &socketServer;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+CellularContext* CellularContext::get_default_instance(void)
+{
+    static HostCellularContext  context;
+
+    return &context;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int NetworkInterface::get_connection_status(void)
+{
+    return (HOST_FAULT_LINK == host_fault_active(NULL)) ? NSAPI_STATUS_DISCONNECTED : NSAPI_STATUS_GLOBAL_UP;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Whether a lookup, connection or datagram is refused by a link fault, counted if so */
+static bool link_down(void)
+{
+    if (HOST_FAULT_LINK != host_fault_active(NULL))
+    {
+        return false;
+    }
+    host_fault_hit(HOST_FAULT_LINK);
+    return true;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_error_t NetworkInterface::gethostbyname(
+    const char*     aHost,
+    SocketAddress*  aAddress,
+    nsapi_version_t aVersion,
+    const char*     aIface)
+{
+    (void) aHost;
+    (void) aVersion;
+    (void) aIface;
+    hostNetStats.lookups++;
+    if (link_down())
+    {
+        return NSAPI_ERROR_DNS_FAILURE;
+    }
+    aAddress->set_ip_address(HOST_SERVER_IP);
+    return NSAPI_ERROR_OK;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_error_t CellularNetwork::get_signal_quality(
+    int&        aRssi,
+    int*        aBer)
+{
+    const HostLinkRow_t*    row = link_row();
+
+    aRssi   = (HOST_LINK_UNKNOWN != row->rssiDbm) ? row->rssiDbm : (int) CellularNetwork::SignalQualityUnknown;
+    if (NULL != aBer)
+    {
+        *aBer   = 0;
+    }
+    return NSAPI_ERROR_OK;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_error_t CellularNetwork::get_extended_signal_quality(
+    int&        aRxlev,
+    int&        aBer,
+    int&        aRscp,
+    int&        aEcno,
+    int&        aRsrq,
+    int&        aRsrp)
+{
+    const HostLinkRow_t*    row = link_row();
+
+    /* 3GPP TS 27.007 +CESQ indexes, 255 when unknown */
+    aRxlev  = aBer = aRscp = aEcno = 255;
+    aRsrp   = (HOST_LINK_UNKNOWN != row->rsrpDbm) ? row->rsrpDbm + 141 : 255;
+    aRsrq   = (HOST_LINK_UNKNOWN != row->rsrqDb) ? row->rsrqDb * 2 + 40 : 255;
+    return NSAPI_ERROR_OK;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_error_t TCPSocket::connect(
+    const SocketAddress&    aAddress)
+{
+    int         result;
+
+    if (false == _open)
+    {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    if (_connected)
+    {
+        return NSAPI_ERROR_IS_CONNECTED;
+    }
+    if (link_down())
+    {
+        hostNetStats.connects++;
+        hostNetStats.connectFailures++;
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    hostConnServer  = hostServer;
+    for (int i = 0; i < HOST_ROUTE_MAX; i++)
+    {
+        if (NULL != hostRoutes[i].server && aAddress.get_port() == hostRoutes[i].port)
+        {
+            hostConnServer  = hostRoutes[i].server;
+            hostRoutes[i].connects++;
+        }
+    }
+    result  = (NULL != hostConnServer) ? hostConnServer->connect(aAddress.get_ip_address(), aAddress.get_port()) : NSAPI_ERROR_NO_CONNECTION;
+    hostNetStats.connects++;
+    if (NSAPI_ERROR_OK != result)
+    {
+        hostNetStats.connectFailures++;
+        return result;
+    }
+    _connected  = true;
+    return NSAPI_ERROR_OK;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_size_or_error_t TCPSocket::send(
+    const void* aData,
+    size_t      aSize)
+{
+    int         result;
+
+    if (false == _connected)
+    {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    if (link_down())
+    {
+        return NSAPI_ERROR_CONNECTION_LOST;
+    }
+    result  = hostConnServer->send(aData, aSize);
+    if (result > 0)
+    {
+        hostNetStats.bytesSent += result;
+    }
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_size_or_error_t TCPSocket::recv(
+    void*       aData,
+    size_t      aSize)
+{
+    int         result;
+
+    if (false == _connected)
+    {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    if (link_down())
+    {
+        return NSAPI_ERROR_CONNECTION_LOST;
+    }
+    result  = hostConnServer->recv(aData, aSize, _timeoutMs);
+    if (result > 0)
+    {
+        hostNetStats.bytesReceived += result;
+    }
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_error_t TCPSocket::close(void)
+{
+    if (_connected)
+    {
+        hostConnServer->close();
+        _connected  = false;
+    }
+    return InternetSocket::close();
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Without a UDP server datagrams are lost */
+nsapi_size_or_error_t UDPSocket::sendto(
+    const SocketAddress&    aAddress,
+    const void*             aData,
+    size_t                  aSize)
+{
+    (void) aAddress;
+    if (link_down())
+    {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    hostNetStats.udpSent++;
+    return (NULL != hostUdpServer) ? hostUdpServer->sendto(aData, aSize) : (int) aSize;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_size_or_error_t UDPSocket::recvfrom(
+    SocketAddress*  aAddress,
+    void*           aData,
+    size_t          aSize)
+{
+    int     result;
+
+    (void) aAddress;
+    if (NULL == hostUdpServer)
+    {
+        host_clock_advance_us((_timeoutMs > 0) ? _timeoutMs * 1000ULL : 0);
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+    result  = hostUdpServer->recvfrom(aData, aSize, _timeoutMs);
+    if (result > 0)
+    {
+        hostNetStats.udpReceived++;
+    }
+    return result;
+}
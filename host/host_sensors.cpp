@@ -0,0 +1,698 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include "mbed.h"
+#include "LIS3DH.h"
+#include "BME280.h"
+#include "OPT3001.h"
+#include "VL53L1X.h"
+#include "LIS2MDLSensor.h"
+#include "analog_monitor.h"
+#include "platform_clock.h"
+#include "host_sim.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HOST_TRACE_ROWS_MAX     (8192)
+#define HOST_TRACE_LINE_MAX     (512)
+#define HOST_TRACE_COLUMNS_MAX  (32)
+
+#define HOST_I2C_BITS_PER_BYTE  (9)         /* 8 data bits and the ACK */
+#define HOST_VL53L1X_ADDR       (0x52)      /* The driver has no address parameter */
+#define HOST_VL53L1X_ID         (0xEACC)
+#define HOST_DIST_RANGING_MS    (50)        /* VL53L1X timing budget */
+#define HOST_BATTERY_DIVIDER    (2)         /* 1:2 divider in front of A0 */
+
+#define HOST_PRESENT(aSensor)   (1U << (aSensor))
+#define HOST_PRESENT_ALL        ((1U << HOST_SENSOR_COUNT) - 1)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    HOST_SENSOR_TILT,
+    HOST_SENSOR_ENV,
+    HOST_SENSOR_LIGHT,
+    HOST_SENSOR_DIST,
+    HOST_SENSOR_MAGN,
+    HOST_SENSOR_COUNT
+} HostSensor_e;
+
+/** What every sensor reads from tMs until the next frame.
+ */
+typedef struct
+{
+    uint32_t    tMs;
+    float       accMg[3];
+    float       temperature;        /* degC */
+    float       pressure;           /* hPa */
+    float       humidity;           /* %RH */
+    float       lux;
+    float       distCm;
+    float       mag[3];             /* LIS2MDL LSB */
+    float       batteryMv;
+    float       flexMv;
+    uint32_t    present;            /* HOST_PRESENT() of the sensors that answer */
+} HostFrame_t;
+
+/** A column of the trace file and the frame field it fills.
+ */
+typedef struct
+{
+    const char* name;
+    size_t      offset;
+    int         sensor;             /* HostSensor_e the column belongs to, -1 for none */
+} HostColumn_t;
+
+/** A simulated I2C device. Writes set the register pointer and store the bytes after it, reads
+ * return the identity at its register and else what was written.
+ */
+typedef struct
+{
+    const char* name;
+    uint8_t     addr;               /* 8-bit */
+    uint8_t     sensor;             /* HostSensor_e */
+    uint8_t     regBytes;           /* Register address width */
+    uint16_t    idReg;
+    uint8_t     id[2];
+    uint8_t     idLen;
+    uint16_t    pointer;
+    uint8_t     regs[256];
+    uint32_t    transfers;
+    uint32_t    bytes;
+    uint32_t    nacks;
+    uint64_t    busUs;
+} HostI2cDevice_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HOST_COLUMN(aName, aField, aSensor)     { aName, offsetof(HostFrame_t, aField), aSensor }
+
+static const HostColumn_t   hostColumns[] =
+{
+    HOST_COLUMN("acc_x_mg",     accMg[0],       HOST_SENSOR_TILT),
+    HOST_COLUMN("acc_y_mg",     accMg[1],       HOST_SENSOR_TILT),
+    HOST_COLUMN("acc_z_mg",     accMg[2],       HOST_SENSOR_TILT),
+    HOST_COLUMN("temp_c",       temperature,    HOST_SENSOR_ENV),
+    HOST_COLUMN("press_hpa",    pressure,       HOST_SENSOR_ENV),
+    HOST_COLUMN("hum_pct",      humidity,       HOST_SENSOR_ENV),
+    HOST_COLUMN("lux",          lux,            HOST_SENSOR_LIGHT),
+    HOST_COLUMN("dist_cm",      distCm,         HOST_SENSOR_DIST),
+    HOST_COLUMN("mag_x",        mag[0],         HOST_SENSOR_MAGN),
+    HOST_COLUMN("mag_y",        mag[1],         HOST_SENSOR_MAGN),
+    HOST_COLUMN("mag_z",        mag[2],         HOST_SENSOR_MAGN),
+    HOST_COLUMN("battery_mv",   batteryMv,      -1),
+    HOST_COLUMN("flex_mv",      flexMv,         -1),
+};
+
+#define HOST_COLUMN_COUNT   ((int) (sizeof(hostColumns) / sizeof(hostColumns[0])))
+
+/* A closed cover in a dry manhole, used without a trace and for columns a trace leaves out */
+static const HostFrame_t    hostQuietFrame =
+{
+    0, { 0, 0, 1000 }, 21, 1013, 45, 5, 120, { 200, 0, -400 }, 3900, 1000, HOST_PRESENT_ALL
+};
+
+static HostFrame_t          hostFrames[HOST_TRACE_ROWS_MAX] = { hostQuietFrame };
+static uint32_t             hostFrameCount  = 1;
+static uint32_t             hostFrameIdx;
+
+static HostI2cDevice_t      hostI2cDevices[] =
+{
+    { "LIS3DH",     0x30, HOST_SENSOR_TILT,  1, 0x0F,   { 0x33 },       1 },
+    { "BME280",     0xEC, HOST_SENSOR_ENV,   1, 0xD0,   { 0x60 },       1 },
+    { "OPT3001",    0x88, HOST_SENSOR_LIGHT, 1, 0x7F,   { 0x30, 0x01 }, 2 },
+    { "VL53L1X",    0x52, HOST_SENSOR_DIST,  2, 0x010F, { 0xEA, 0xCC }, 2 },
+    { "LIS2MDL",    0x3C, HOST_SENSOR_MAGN,  1, 0x4F,   { 0x40 },       1 },
+};
+
+#define HOST_I2C_DEVICE_COUNT   ((int) (sizeof(hostI2cDevices) / sizeof(hostI2cDevices[0])))
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* The frame in force now, time only moves forward */
+static const HostFrame_t* frame_now(void)
+{
+    uint32_t    nowMs   = platform_now_ms();
+
+    while (hostFrameIdx + 1 < hostFrameCount && hostFrames[hostFrameIdx + 1].tMs <= nowMs)
+    {
+        hostFrameIdx++;
+    }
+    return &hostFrames[hostFrameIdx];
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static bool sensor_present(
+    int         aSensor)
+{
+    return 0 != (frame_now()->present & HOST_PRESENT(aSensor));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static HostI2cDevice_t* i2c_device(
+    int         aAddr)
+{
+    for (int i = 0; i < HOST_I2C_DEVICE_COUNT; i++)
+    {
+        if (hostI2cDevices[i].addr == (aAddr & 0xFE))
+        {
+            return &hostI2cDevices[i];
+        }
+    }
+    return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * One transfer on the bus: start, address, aLength bytes, stop. A device that is not there, or
+ * whose sensor does not answer in the trace, NACKs its address.
+ *
+ * @return 0, or -1 on a NACK.
+ */
+static int i2c_transfer(
+    int         aHz,
+    int         aAddr,
+    bool        aRead,
+    char*       aData,
+    int         aLength)
+{
+    HostI2cDevice_t*    dev     = i2c_device(aAddr);
+    bool                ack     = (NULL != dev) && sensor_present(dev->sensor);
+    uint32_t            bits    = 2 + HOST_I2C_BITS_PER_BYTE * (1 + (ack ? aLength : 0));
+    uint64_t            busUs   = (bits * 1000000ULL + aHz - 1) / aHz;
+
+    host_clock_advance_us(busUs);
+    if (NULL == dev)
+    {
+        return -1;
+    }
+    dev->busUs += busUs;
+    if (false == ack)
+    {
+        dev->nacks++;
+        return -1;
+    }
+    dev->transfers++;
+    dev->bytes += aLength;
+
+    for (int i = 0; i < aLength; i++)
+    {
+        if (aRead)
+        {
+            uint16_t    idOffset    = dev->pointer - dev->idReg;
+
+            aData[i]    = (idOffset < dev->idLen) ? dev->id[idOffset] : dev->regs[dev->pointer & 0xFF];
+            dev->pointer++;
+        }
+        else if (i < dev->regBytes)
+        {
+            dev->pointer    = (i == 0) ? (uint8_t) aData[i] : ((dev->pointer << 8) | (uint8_t) aData[i]);
+        }
+        else
+        {
+            dev->regs[dev->pointer++ & 0xFF]    = aData[i];
+        }
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Register read as the drivers do it: the register address, then a repeated start and the data */
+static int read_regs(
+    I2C&        aI2c,
+    int         aAddr,
+    uint16_t    aReg,
+    char*       aData,
+    int         aLength)
+{
+    HostI2cDevice_t*    dev     = i2c_device(aAddr);
+    char                reg[2]  = { (char) (aReg >> 8), (char) aReg };
+    bool                wide    = (NULL != dev) && (2 == dev->regBytes);
+
+    if (0 != aI2c.write(aAddr, wide ? reg : reg + 1, wide ? 2 : 1, true))
+    {
+        return -1;
+    }
+    return aI2c.read(aAddr, aData, aLength);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Splits a CSV line in place, an empty cell gives an empty string */
+static int split_line(
+    char*       aLine,
+    char**      aCells,
+    int         aMax)
+{
+    int         count   = 0;
+
+    aLine[strcspn(aLine, "\r\n")]   = '\0';
+    while (count < aMax)
+    {
+        aCells[count++] = aLine;
+        aLine   = strchr(aLine, ',');
+        if (NULL == aLine)
+        {
+            break;
+        }
+        *aLine++    = '\0';
+    }
+    for (int i = 0; i < count; i++)
+    {
+        while (' ' == *aCells[i])
+        {
+            aCells[i]++;
+        }
+    }
+    return count;
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int host_sensors_load(
+    const char* aPath)
+{
+    FILE*       file    = fopen(aPath, "r");
+    char        line[HOST_TRACE_LINE_MAX];
+    char*       cells[HOST_TRACE_COLUMNS_MAX];
+    int         column[HOST_TRACE_COLUMNS_MAX];
+    int         columns = 0;
+    int         count;
+    HostFrame_t* frame;
+
+    if (NULL == file)
+    {
+        return -1;
+    }
+
+    hostFrameCount  = 0;
+    hostFrameIdx    = 0;
+    while (NULL != fgets(line, sizeof(line), file) && hostFrameCount < HOST_TRACE_ROWS_MAX)
+    {
+        if ('#' == line[0] || '\n' == line[0] || '\r' == line[0])
+        {
+            continue;
+        }
+        count   = split_line(line, cells, HOST_TRACE_COLUMNS_MAX);
+
+        /* The header names the columns, in any order after t_s */
+        if (0 == columns)
+        {
+            columns = count;
+            for (int i = 0; i < count; i++)
+            {
+                column[i]   = -1;
+                for (int c = 0; c < HOST_COLUMN_COUNT; c++)
+                {
+                    if (0 == strcmp(cells[i], hostColumns[c].name))
+                    {
+                        column[i]   = c;
+                    }
+                }
+                if (i > 0 && column[i] < 0)
+                {
+                    fprintf(stderr, "HOST: %s: unknown column %s\n", aPath, cells[i]);
+                }
+            }
+            continue;
+        }
+
+        frame   = &hostFrames[hostFrameCount++];
+        *frame  = hostQuietFrame;
+        frame->tMs  = (uint32_t) (atof(cells[0]) * 1000);
+        for (int i = 1; i < count && i < columns; i++)
+        {
+            if (column[i] < 0)
+            {
+                continue;
+            }
+            if ('\0' == cells[i][0])
+            {
+                if (hostColumns[column[i]].sensor >= 0)
+                {
+                    frame->present &= ~HOST_PRESENT(hostColumns[column[i]].sensor);
+                }
+                continue;
+            }
+            *(float*) ((char*) frame + hostColumns[column[i]].offset) = (float) atof(cells[i]);
+        }
+    }
+    fclose(file);
+
+    if (0 == hostFrameCount)
+    {
+        hostFrames[hostFrameCount++]    = hostQuietFrame;
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void host_sensors_report(void)
+{
+    for (int i = 0; i < HOST_I2C_DEVICE_COUNT; i++)
+    {
+        HostI2cDevice_t*    dev = &hostI2cDevices[i];
+
+        fprintf(stderr, "I2C: %-8s 0x%02X: %u transfers, %u bytes, %u NACKs, %.1f ms on the bus\n", dev->name, dev->addr,
+                dev->transfers, dev->bytes, dev->nacks, dev->busUs / 1000.0);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int I2C::read(
+    int         aAddress,
+    char*       aData,
+    int         aLength,
+    bool        aRepeated)
+{
+    (void) aRepeated;
+    return i2c_transfer(_hz, aAddress, true, aData, aLength);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int I2C::write(
+    int         aAddress,
+    const char* aData,
+    int         aLength,
+    bool        aRepeated)
+{
+    char        data[64];
+
+    (void) aRepeated;
+    if (aLength > (int) sizeof(data))
+    {
+        return -1;
+    }
+    memcpy(data, aData, aLength);
+    return i2c_transfer(_hz, aAddress, false, data, aLength);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A0 sees the battery through the divider, A2 the flex input; ADC full scale as the nRF52 SAADC */
+unsigned short AnalogIn::read_u16(void)
+{
+    const HostFrame_t*  frame   = frame_now();
+    float               mv      = (A0 == _pin) ? frame->batteryMv / HOST_BATTERY_DIVIDER : frame->flexMv;
+    float               code    = mv * 65536.0f / ANALOG_ADC_FULL_SCALE_MV;
+
+    host_clock_advance_us(40);     /* One SAADC conversion with 40 us acquisition */
+    return (code < 0) ? 0 : (code > 65535) ? 65535 : (unsigned short) code;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+LIS3DH::LIS3DH(
+    I2C&        aI2c,
+    uint8_t     aAddr,
+    uint8_t     aDataRate,
+    uint8_t     aFullScale) :
+    _i2c(aI2c),
+    _addr(aAddr)
+{
+    (void) aDataRate;
+    (void) aFullScale;
+}
+
+uint8_t LIS3DH::read_id(void)
+{
+    return read_reg(0x0F);
+}
+
+uint8_t LIS3DH::data_ready(void)
+{
+    char        status;
+
+    return (0 == _i2c.write(_addr, "\x27", 1, true) && 0 == _i2c.read(_addr, &status, 1)) ? 1 : 0;
+}
+
+void LIS3DH::read_data(float* aDst)
+{
+    read_mg_data(aDst);
+    for (int i = 0; i < 3; i++)
+    {
+        aDst[i] /= 1000.0f;
+    }
+}
+
+void LIS3DH::read_mg_data(float* aDst)
+{
+    char        raw[6];
+
+    _i2c.write(_addr, "\xA8", 1, true);     /* OUT_X_L with auto-increment */
+    _i2c.read(_addr, raw, sizeof(raw));
+    memcpy(aDst, frame_now()->accMg, sizeof(frame_now()->accMg));
+}
+
+uint8_t LIS3DH::read_reg(uint8_t aReg)
+{
+    char        value   = 0;
+
+    _i2c.write(_addr, (const char*) &aReg, 1, true);
+    _i2c.read(_addr, &value, 1);
+    return (uint8_t) value;
+}
+
+void LIS3DH::write_reg(uint8_t aReg, uint8_t aValue)
+{
+    char        data[2] = { (char) aReg, (char) aValue };
+
+    _i2c.write(_addr, data, sizeof(data));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+BME280::BME280(
+    I2C&        aI2c,
+    char        aSlaveAdr) :
+    _i2c(aI2c),
+    _addr(aSlaveAdr)
+{
+}
+
+void BME280::initialize(void)
+{
+    char        calib[33];
+
+    read_regs(_i2c, (uint8_t) _addr, 0x88, calib, 26);
+    read_regs(_i2c, (uint8_t) _addr, 0xE1, calib, 7);
+}
+
+float BME280::getTemperature(void)
+{
+    char        raw[3];
+
+    read_regs(_i2c, (uint8_t) _addr, 0xFA, raw, sizeof(raw));
+    return frame_now()->temperature;
+}
+
+float BME280::getPressure(void)
+{
+    char        raw[3];
+
+    read_regs(_i2c, (uint8_t) _addr, 0xF7, raw, sizeof(raw));
+    return frame_now()->pressure;
+}
+
+float BME280::getHumidity(void)
+{
+    char        raw[2];
+
+    read_regs(_i2c, (uint8_t) _addr, 0xFD, raw, sizeof(raw));
+    return frame_now()->humidity;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+OPT3001::OPT3001(
+    PinName     aSda,
+    PinName     aScl,
+    int         aAddr) :
+    _i2c(aSda, aScl),
+    _addr(aAddr)
+{
+}
+
+int OPT3001::readSensor(void)
+{
+    char        raw[2];
+
+    read_regs(_i2c, _addr, 0x00, raw, sizeof(raw));
+    return (int) frame_now()->lux;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+VL53L1X::VL53L1X(
+    PinName     aSda,
+    PinName     aScl) :
+    _i2c(aSda, aScl),
+    _mode(0),
+    _startMs(0)
+{
+}
+
+bool VL53L1X::begin(void)
+{
+    return HOST_VL53L1X_ID == getSensorID();
+}
+
+void VL53L1X::softReset(void)
+{
+    _i2c.write(HOST_VL53L1X_ADDR, "\x00\x00\x00", 3);
+}
+
+uint16_t VL53L1X::getSensorID(void)
+{
+    char        id[2]   = { 0, 0 };
+
+    read_regs(_i2c, HOST_VL53L1X_ADDR, 0x010F, id, sizeof(id));
+    return ((uint8_t) id[0] << 8) | (uint8_t) id[1];
+}
+
+void VL53L1X::setDistanceMode(uint8_t aMode)
+{
+    _mode   = aMode;
+    _i2c.write(HOST_VL53L1X_ADDR, "\x00\x4B\x00", 3);
+}
+
+void VL53L1X::startMeasurement(uint8_t aOffset)
+{
+    (void) aOffset;
+    _i2c.write(HOST_VL53L1X_ADDR, "\x00\x87\x40", 3);
+    _startMs    = platform_now_ms();
+}
+
+bool VL53L1X::newDataReady(void)
+{
+    char        status;
+
+    return 0 == read_regs(_i2c, HOST_VL53L1X_ADDR, 0x0031, &status, 1) &&
+           (int32_t) (platform_now_ms() - _startMs) >= HOST_DIST_RANGING_MS;
+}
+
+uint16_t VL53L1X::getDistance(void)
+{
+    char        raw[2];
+
+    read_regs(_i2c, HOST_VL53L1X_ADDR, 0x0096, raw, sizeof(raw));
+    return (uint16_t) (frame_now()->distCm * 10);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+LIS2MDLSensor::LIS2MDLSensor(
+    DevI2C*     aI2c,
+    uint8_t     aAddr) :
+    _i2c(aI2c),
+    _addr(aAddr)
+{
+}
+
+int LIS2MDLSensor::init(void* aInit)
+{
+    (void) aInit;
+    return _i2c->write(_addr, "\x60\x00", 2);      /* CFG_REG_A */
+}
+
+int LIS2MDLSensor::read_id(uint8_t* aId)
+{
+    char        id  = 0;
+    int         result;
+
+    result  = _i2c->write(_addr, "\x4F", 1, true) | _i2c->read(_addr, &id, 1);
+    *aId    = (uint8_t) id;
+    return (0 == result) ? 0 : 1;
+}
+
+int LIS2MDLSensor::enable(void)
+{
+    return (0 == _i2c->write(_addr, "\x60\x00", 2)) ? 0 : 1;
+}
+
+int LIS2MDLSensor::disable(void)
+{
+    return (0 == _i2c->write(_addr, "\x60\x03", 2)) ? 0 : 1;
+}
+
+int LIS2MDLSensor::get_m_axes(int32_t* aMilliGauss)
+{
+    int16_t     raw[3];
+
+    if (0 != get_m_axes_raw(raw))
+    {
+        return 1;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        aMilliGauss[i]  = raw[i] * 3 / 2;
+    }
+    return 0;
+}
+
+int LIS2MDLSensor::get_m_axes_raw(int16_t* aRaw)
+{
+    char        raw[6];
+
+    if (0 != _i2c->write(_addr, "\x68", 1, true) || 0 != _i2c->read(_addr, raw, sizeof(raw)))
+    {
+        return 1;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        aRaw[i] = (int16_t) frame_now()->mag[i];
+    }
+    return 0;
+}
+
+int LIS2MDLSensor::set_m_odr(float aOdr)
+{
+    (void) aOdr;
+    return 0;
+}
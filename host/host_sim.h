@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_HOST_SIM_H_
+#define HOST_HOST_SIM_H_
+
+#include <stdint.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** A server the TCP socket of the firmware talks to, one connection at a time. Each call may
+ * move the host clock by the time the server takes.
+ */
+typedef struct
+{
+    const char* name;
+
+    /** @return 0, or a negative NSAPI error */
+    int (*connect)(
+        const char*     aIp,
+        uint16_t        aPort);
+
+    /** @return The bytes taken, or a negative NSAPI error */
+    int (*send)(
+        const void*     aData,
+        uint32_t        aSize);
+
+    /** @return The bytes received, 0 when the server closed the connection, NSAPI_ERROR_WOULD_BLOCK
+     *          when nothing came within aTimeoutMs (-1 = the server answers or closes for sure).
+     */
+    int (*recv)(
+        void*           aData,
+        uint32_t        aSize,
+        int32_t         aTimeoutMs);
+
+    void (*close)(void);
+
+    /** Prints the totals of the run, NULL when there are none */
+    void (*report)(void);
+} HostTcpServer_t;
+
+/** A server the UDP socket of the firmware talks to. Each call may move the host clock. */
+typedef struct
+{
+    const char* name;
+
+    /** @return The bytes taken, or a negative NSAPI error */
+    int (*sendto)(
+        const void*     aData,
+        uint32_t        aSize);
+
+    /** @return The bytes of the next datagram, or NSAPI_ERROR_WOULD_BLOCK when nothing came within
+     *          aTimeoutMs (-1 = no timeout).
+     */
+    int (*recvfrom)(
+        void*           aData,
+        uint32_t        aSize,
+        int32_t         aTimeoutMs);
+
+    /** Prints the totals of the run, NULL when there are none */
+    void (*report)(void);
+} HostUdpServer_t;
+
+/** What the network does wrong during a window of a fault schedule, see host_faults_load() */
+typedef enum
+{
+    HOST_FAULT_NONE,
+    HOST_FAULT_LINK,                /* No cellular link: no lookups, connections or datagrams */
+    HOST_FAULT_REFUSE,              /* The server refuses connections */
+    HOST_FAULT_STATUS,              /* The server answers with the status of the window, e.g. 503 */
+    HOST_FAULT_DROP,                /* The server never answers */
+    HOST_FAULT_RESET,               /* The server closes the connection halfway through the response */
+    HOST_FAULT_SLOW,                /* The server takes the milliseconds of the window longer */
+    HOST_FAULT_COUNT
+} HostFault_e;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* main() of main.cpp, renamed by host/Makefile */
+int firmware_main(void);
+
+/* --- Clock, host_clock.cpp --- */
+
+/** Time only moves when the firmware sleeps or waits and when the simulated hardware takes time,
+ * so a run takes as long as the CPU needs for it. The run ends when the clock passes aEndMs.
+ */
+void host_clock_init(
+    uint64_t    aEndMs);
+
+uint64_t host_clock_us(void);
+
+/** The calling thread spends aUs, e.g. on a bus transfer, and the other threads run meanwhile */
+void host_clock_advance_us(
+    uint64_t    aUs);
+
+/** Around a call that blocks on a real socket: the other threads run, and the clock follows the
+ * wall clock until the call returns.
+ */
+void host_clock_io_begin(void);
+
+void host_clock_io_end(void);
+
+/** Also moves the clock by the host CPU time of the firmware and the simulation, so the timing of
+ * code that neither sleeps nor touches the hardware is not 0. Runs are then not repeatable.
+ */
+void host_clock_count_cpu(
+    bool        aCount);
+
+/** Whether the firmware log goes to stdout */
+void host_log_enable(
+    bool        aEnable);
+
+/* --- Sensors, host_sensors.cpp --- */
+
+/** Loads a CSV sensor trace, see host/traces/manhole.csv. Without one, every sensor reads a quiet,
+ * closed cover.
+ *
+ * @return 0, or -1 when the file cannot be read.
+ */
+int host_sensors_load(
+    const char* aPath);
+
+void host_sensors_report(void);
+
+/* --- Network, host_net.cpp --- */
+
+void host_net_set_server(
+    const HostTcpServer_t*  aServer);
+
+/** Connections to aPort go to aServer instead of the one of host_net_set_server() */
+void host_net_route(
+    uint16_t                aPort,
+    const HostTcpServer_t*  aServer);
+
+/** The server of the UDP socket, NULL loses every datagram */
+void host_net_set_udp_server(
+    const HostUdpServer_t*  aServer);
+
+/** Loads a trace of the signal quality the modem reports, rows of t_s,rssi_dbm,rsrp_dbm,rsrq_db
+ * where an empty cell is a value the modem does not report, see host/traces/link_fade.csv.
+ * Without one the link stays at RSSI -71 dBm, RSRP -88 dBm and RSRQ -9 dB.
+ *
+ * @return 0, or -1 when the file cannot be read.
+ */
+int host_net_load_link(
+    const char* aPath);
+
+void host_net_report(void);
+
+/** A real TCP connection to aHost:aPort, e.g. tools/dweet_standin.py, whatever address the
+ * firmware asks for. The time each call takes is added to the host clock.
+ */
+const HostTcpServer_t* host_net_socket_server(
+    const char* aHost,
+    uint16_t    aPort);
+
+/* --- Dweet stand-in, host_dweet.cpp --- */
+
+/** Answers /dweet/for/<thing> in-process, after aLatencyMs of host time per request */
+const HostTcpServer_t* host_dweet_server(
+    uint32_t    aLatencyMs);
+
+/* --- CoAP stand-in, host_coap.cpp --- */
+
+/** Acknowledges CoAP POSTs in-process after aLatencyMs of host time, and loses aLossPct percent of
+ * the datagrams each way.
+ */
+const HostUdpServer_t* host_coap_server(
+    uint32_t    aLatencyMs,
+    uint32_t    aLossPct);
+
+/* --- MQTT broker stand-in, host_mqtt.cpp --- */
+
+/** Answers CONNECT, QoS 1 PUBLISH and PINGREQ in-process after aLatencyMs of host time. A
+ * connection idle for more than aNatIdleS is reset by the next packet, 0 = never.
+ */
+const HostTcpServer_t* host_mqtt_server(
+    uint32_t    aLatencyMs,
+    uint32_t    aNatIdleS);
+
+/* --- Faults, host_faults.cpp --- */
+
+/** Loads a fault schedule, rows of start_s,end_s,fault[,arg] with the fault named as in
+ * host_faults.cpp, see host/traces/faults_503.csv. The in-process servers and host_net.cpp
+ * inject whatever fault is active at the host time.
+ *
+ * @return 0, or -1 when the file cannot be read.
+ */
+int host_faults_load(
+    const char* aPath);
+
+/** @return The fault active now, with the arg of its window in aArg when not NULL */
+HostFault_e host_fault_active(
+    uint32_t*   aArg);
+
+/** Counts one operation the active fault changed */
+void host_fault_hit(
+    HostFault_e aFault);
+
+void host_faults_report(void);
+
+/* --- Heap, host_heap.cpp --- */
+
+/** Prints the heap use of the run, what mbed_stats_heap_get() gives the firmware */
+void host_heap_report(void);
+
+/* --- Flash, host_flash.cpp --- */
+
+/** Keeps the flash image in aPath, so the uplink queue survives a restart. NULL keeps it in RAM.
+ *
+ * @return 0, or -1 when the file cannot be opened.
+ */
+int host_flash_open(
+    const char* aPath);
+
+/** Cuts the power during the aOps-th program or erase from now: that operation is left half done
+ * and the flash takes no more writes until host_flash_open() loads the image again, as after a
+ * reset. 0 = never.
+ */
+void host_flash_power_cut(
+    uint32_t    aOps);
+
+/** @return Erase cycles of the sector holding aAddr since host_flash_open() */
+uint32_t host_flash_erase_count(
+    uint32_t    aAddr);
+
+#endif /* HOST_HOST_SIM_H_ */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* mbedTLS for host builds without it: nothing can be set up, so tls_conn_init() fails and the
+ * firmware runs as on a target without an entropy source. make TLS=1 links mbedTLS instead.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <string.h>
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/platform_util.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define TLS_OFF_ERROR       (-0x0034)   /* MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED */
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+extern "C" {
+
+void mbedtls_platform_zeroize(void* aBuf, size_t aLen) { memset(aBuf, 0, aLen); }
+
+void mbedtls_entropy_init(mbedtls_entropy_context* aCtx) { (void) aCtx; }
+int mbedtls_entropy_func(void* aData, unsigned char* aOutput, size_t aLen) { (void) aData; (void) aOutput; (void) aLen; return TLS_OFF_ERROR; }
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* aCtx) { (void) aCtx; }
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* aCtx, int (*aEntropy)(void*, unsigned char*, size_t), void* aEntropyCtx,
+                          const unsigned char* aCustom, size_t aLen) { (void) aCtx; (void) aEntropy; (void) aEntropyCtx; (void) aCustom; (void) aLen; return TLS_OFF_ERROR; }
+int mbedtls_ctr_drbg_random(void* aRng, unsigned char* aOutput, size_t aLen) { (void) aRng; (void) aOutput; (void) aLen; return TLS_OFF_ERROR; }
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt* aCrt) { (void) aCrt; }
+int mbedtls_x509_crt_parse(mbedtls_x509_crt* aChain, const unsigned char* aBuf, size_t aLen) { (void) aChain; (void) aBuf; (void) aLen; return TLS_OFF_ERROR; }
+
+void mbedtls_ssl_init(mbedtls_ssl_context* aSsl) { (void) aSsl; }
+void mbedtls_ssl_config_init(mbedtls_ssl_config* aConf) { (void) aConf; }
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* aConf, int aEndpoint, int aTransport, int aPreset) { (void) aConf; (void) aEndpoint; (void) aTransport; (void) aPreset; return TLS_OFF_ERROR; }
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* aConf, int aAuthmode) { (void) aConf; (void) aAuthmode; }
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config* aConf, mbedtls_x509_crt* aCaChain, void* aCaCrl) { (void) aConf; (void) aCaChain; (void) aCaCrl; }
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* aConf, int (*aRng)(void*, unsigned char*, size_t), void* aRngCtx) { (void) aConf; (void) aRng; (void) aRngCtx; }
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* aConf, int aUseTickets) { (void) aConf; (void) aUseTickets; }
+int mbedtls_ssl_setup(mbedtls_ssl_context* aSsl, const mbedtls_ssl_config* aConf) { (void) aSsl; (void) aConf; return TLS_OFF_ERROR; }
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* aSsl, const char* aHostname) { (void) aSsl; (void) aHostname; return TLS_OFF_ERROR; }
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* aSsl, void* aBio, mbedtls_ssl_send_t* aSend, mbedtls_ssl_recv_t* aRecv,
+                         mbedtls_ssl_recv_timeout_t* aRecvTimeout) { (void) aSsl; (void) aBio; (void) aSend; (void) aRecv; (void) aRecvTimeout; }
+int mbedtls_ssl_session_reset(mbedtls_ssl_context* aSsl) { (void) aSsl; return TLS_OFF_ERROR; }
+void mbedtls_ssl_session_init(mbedtls_ssl_session* aSession) { memset(aSession, 0, sizeof(*aSession)); }
+void mbedtls_ssl_session_free(mbedtls_ssl_session* aSession) { (void) aSession; }
+int mbedtls_ssl_set_session(mbedtls_ssl_context* aSsl, const mbedtls_ssl_session* aSession) { (void) aSsl; (void) aSession; return TLS_OFF_ERROR; }
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* aSsl, mbedtls_ssl_session* aSession) { (void) aSsl; (void) aSession; return TLS_OFF_ERROR; }
+int mbedtls_ssl_handshake(mbedtls_ssl_context* aSsl) { (void) aSsl; return TLS_OFF_ERROR; }
+uint32_t mbedtls_ssl_get_verify_result(const mbedtls_ssl_context* aSsl) { (void) aSsl; return (uint32_t) -1; }
+const char* mbedtls_ssl_get_ciphersuite(const mbedtls_ssl_context* aSsl) { (void) aSsl; return "none"; }
+int mbedtls_ssl_write(mbedtls_ssl_context* aSsl, const unsigned char* aBuf, size_t aLen) { (void) aSsl; (void) aBuf; (void) aLen; return TLS_OFF_ERROR; }
+int mbedtls_ssl_read(mbedtls_ssl_context* aSsl, unsigned char* aBuf, size_t aLen) { (void) aSsl; (void) aBuf; (void) aLen; return TLS_OFF_ERROR; }
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* aSsl) { (void) aSsl; return TLS_OFF_ERROR; }
+
+}
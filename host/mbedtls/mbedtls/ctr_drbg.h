@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_MBEDTLS_CTR_DRBG_H_
+#define HOST_MBEDTLS_CTR_DRBG_H_
+
+#include <stddef.h>
+
+extern "C" {
+
+typedef struct
+{
+    alignas(16) unsigned char   opaque[4096];
+} mbedtls_ctr_drbg_context;
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context* aCtx);
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context* aCtx, int (*aEntropy)(void*, unsigned char*, size_t), void* aEntropyCtx,
+                          const unsigned char* aCustom, size_t aLen);
+int mbedtls_ctr_drbg_random(void* aRng, unsigned char* aOutput, size_t aLen);
+
+}
+
+#endif /* HOST_MBEDTLS_CTR_DRBG_H_ */
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_MBEDTLS_NET_SOCKETS_H_
+#define HOST_MBEDTLS_NET_SOCKETS_H_
+
+#define MBEDTLS_ERR_NET_RECV_FAILED     (-0x004C)
+#define MBEDTLS_ERR_NET_SEND_FAILED     (-0x004E)
+
+#endif /* HOST_MBEDTLS_NET_SOCKETS_H_ */
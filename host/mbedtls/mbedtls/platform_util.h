@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_MBEDTLS_PLATFORM_UTIL_H_
+#define HOST_MBEDTLS_PLATFORM_UTIL_H_
+
+#include <stddef.h>
+
+extern "C" void mbedtls_platform_zeroize(void* aBuf, size_t aLen);
+
+#endif /* HOST_MBEDTLS_PLATFORM_UTIL_H_ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The mbedTLS 2.28 API used by Network/tls_conn.cpp, for hosts without the mbedTLS headers. The
+ * structures are laid out as in 2.28 up to the last field the firmware reads and padded beyond,
+ * so the same objects link with host/host_tls_off.cpp or with the 2.28 libraries (make TLS=1).
+ */
+
+#ifndef HOST_MBEDTLS_SSL_H_
+#define HOST_MBEDTLS_SSL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "mbedtls/x509_crt.h"
+
+#define MBEDTLS_SSL_SESSION_TICKETS
+
+#define MBEDTLS_ERR_SSL_WANT_READ               (-0x6900)
+#define MBEDTLS_ERR_SSL_WANT_WRITE              (-0x6880)
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY       (-0x7880)
+#define MBEDTLS_ERR_SSL_CONN_EOF                (-0x7280)
+
+#define MBEDTLS_SSL_IS_CLIENT                   (0)
+#define MBEDTLS_SSL_TRANSPORT_STREAM            (0)
+#define MBEDTLS_SSL_PRESET_DEFAULT              (0)
+#define MBEDTLS_SSL_VERIFY_REQUIRED             (2)
+#define MBEDTLS_SSL_SESSION_TICKETS_ENABLED     (1)
+
+extern "C" {
+
+typedef struct mbedtls_ssl_session
+{
+    unsigned char   mfl_code;
+    time_t          start;
+    int             ciphersuite;
+    int             compression;
+    size_t          id_len;
+    unsigned char   id[32];
+    unsigned char   master[48];
+    alignas(16) unsigned char   opaque[1024];
+} mbedtls_ssl_session;
+
+typedef struct
+{
+    alignas(16) unsigned char   opaque[8192];
+} mbedtls_ssl_config;
+
+typedef struct
+{
+    alignas(16) unsigned char   opaque[8192];
+} mbedtls_ssl_context;
+
+typedef int mbedtls_ssl_send_t(void* aCtx, const unsigned char* aBuf, size_t aLen);
+typedef int mbedtls_ssl_recv_t(void* aCtx, unsigned char* aBuf, size_t aLen);
+typedef int mbedtls_ssl_recv_timeout_t(void* aCtx, unsigned char* aBuf, size_t aLen, uint32_t aTimeout);
+
+void mbedtls_ssl_init(mbedtls_ssl_context* aSsl);
+void mbedtls_ssl_config_init(mbedtls_ssl_config* aConf);
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config* aConf, int aEndpoint, int aTransport, int aPreset);
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config* aConf, int aAuthmode);
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config* aConf, mbedtls_x509_crt* aCaChain, void* aCaCrl);
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config* aConf, int (*aRng)(void*, unsigned char*, size_t), void* aRngCtx);
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config* aConf, int aUseTickets);
+int mbedtls_ssl_setup(mbedtls_ssl_context* aSsl, const mbedtls_ssl_config* aConf);
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context* aSsl, const char* aHostname);
+void mbedtls_ssl_set_bio(mbedtls_ssl_context* aSsl, void* aBio, mbedtls_ssl_send_t* aSend, mbedtls_ssl_recv_t* aRecv,
+                         mbedtls_ssl_recv_timeout_t* aRecvTimeout);
+int mbedtls_ssl_session_reset(mbedtls_ssl_context* aSsl);
+void mbedtls_ssl_session_init(mbedtls_ssl_session* aSession);
+void mbedtls_ssl_session_free(mbedtls_ssl_session* aSession);
+int mbedtls_ssl_set_session(mbedtls_ssl_context* aSsl, const mbedtls_ssl_session* aSession);
+int mbedtls_ssl_get_session(const mbedtls_ssl_context* aSsl, mbedtls_ssl_session* aSession);
+int mbedtls_ssl_handshake(mbedtls_ssl_context* aSsl);
+uint32_t mbedtls_ssl_get_verify_result(const mbedtls_ssl_context* aSsl);
+const char* mbedtls_ssl_get_ciphersuite(const mbedtls_ssl_context* aSsl);
+int mbedtls_ssl_write(mbedtls_ssl_context* aSsl, const unsigned char* aBuf, size_t aLen);
+int mbedtls_ssl_read(mbedtls_ssl_context* aSsl, unsigned char* aBuf, size_t aLen);
+int mbedtls_ssl_close_notify(mbedtls_ssl_context* aSsl);
+
+}
+
+#endif /* HOST_MBEDTLS_SSL_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_STUBS_CELLULAR_CONTEXT_H_
+#define HOST_STUBS_CELLULAR_CONTEXT_H_
+
+#include "mbed.h"
+#include "CellularNetwork.h"
+
+typedef int cellular_connection_status_t;
+
+enum
+{
+    CellularDeviceReady = 1,
+    CellularSIMStatusChanged,
+    CellularRegistrationStatusChanged,
+    CellularRegistrationTypeChanged,
+    CellularCellIDChanged,
+    CellularRadioAccessTechnologyChanged,
+    CellularAttachNetwork,
+    CellularActivatePDPContext,
+    CellularSignalQuality,
+    CellularStateRetryEvent,
+    CellularDeviceTimeout
+};
+
+typedef struct
+{
+    nsapi_error_t   error;
+    int             status_data;
+    bool            final_try;
+} cell_callback_data_t;
+
+class ATHandler
+{
+public:
+    void at_cmd_discard(const char* aCmd, const char* aCmdChr, const char* aFormat = "", ...) { (void) aCmd; (void) aCmdChr; (void) aFormat; }
+};
+
+class CellularDevice
+{
+public:
+    CellularNetwork* open_network(void* aFileHandle = NULL) { (void) aFileHandle; return &_network; }
+
+private:
+    CellularNetwork _network;
+};
+
+/* Attached and up from the start, status callbacks never come */
+class CellularContext : public NetworkInterface
+{
+public:
+    static CellularContext* get_default_instance(void);
+    virtual CellularDevice* get_device(void) = 0;
+};
+
+#endif /* HOST_STUBS_CELLULAR_CONTEXT_H_ */
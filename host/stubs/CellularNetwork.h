@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_STUBS_CELLULAR_NETWORK_H_
+#define HOST_STUBS_CELLULAR_NETWORK_H_
+
+#include "mbed.h"
+
+/* Signal quality of the simulated modem, host/host_net.cpp */
+class CellularNetwork
+{
+public:
+    enum { SignalQualityUnknown = 99 };
+
+    /* dBm, as the RM7100 +CSQ handling gives it */
+    nsapi_error_t get_signal_quality(int& aRssi, int* aBer = NULL);
+
+    /* 3GPP TS 27.007 +CESQ indexes, 255 when unknown */
+    nsapi_error_t get_extended_signal_quality(int& aRxlev, int& aBer, int& aRscp, int& aEcno, int& aRsrq, int& aRsrp);
+};
+
+#endif /* HOST_STUBS_CELLULAR_NETWORK_H_ */
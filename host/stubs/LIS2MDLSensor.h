@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_STUBS_LIS2MDL_SENSOR_H_
+#define HOST_STUBS_LIS2MDL_SENSOR_H_
+
+#include "mbed.h"
+
+class DevI2C : public I2C
+{
+public:
+    DevI2C(PinName aSda, PinName aScl) : I2C(aSda, aScl) {}
+};
+
+/* Magnetometer of host/host_sensors.cpp, reads the mag_* columns in LSB */
+class LIS2MDLSensor
+{
+public:
+    LIS2MDLSensor(DevI2C* aI2c, uint8_t aAddr = 0x3C);
+    int init(void* aInit);
+    int read_id(uint8_t* aId);
+    int enable(void);
+    int disable(void);
+    int get_m_axes(int32_t* aMilliGauss);
+    int get_m_axes_raw(int16_t* aRaw);
+    int set_m_odr(float aOdr);
+
+private:
+    DevI2C*     _i2c;
+    uint8_t     _addr;
+};
+
+#endif /* HOST_STUBS_LIS2MDL_SENSOR_H_ */
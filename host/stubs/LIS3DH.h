@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_STUBS_LIS3DH_H_
+#define HOST_STUBS_LIS3DH_H_
+
+#include "mbed.h"
+
+#define I_AM_LIS3DH             (0x33)
+
+#define LIS3DH_DR_NR_LP_1HZ     (1)
+#define LIS3DH_DR_NR_LP_10HZ    (2)
+#define LIS3DH_DR_NR_LP_25HZ    (3)
+#define LIS3DH_DR_NR_LP_50HZ    (4)
+#define LIS3DH_DR_NR_LP_100HZ   (5)
+#define LIS3DH_DR_LP_1R6KHZ     (8)
+#define LIS3DH_FS_2G            (0)
+#define LIS3DH_FS_8G            (2)
+
+/* Accelerometer of host/host_sensors.cpp, reads the acc_*_mg columns of the trace */
+class LIS3DH
+{
+public:
+    LIS3DH(I2C& aI2c, uint8_t aAddr, uint8_t aDataRate = LIS3DH_DR_NR_LP_50HZ, uint8_t aFullScale = LIS3DH_FS_8G);
+    uint8_t read_id(void);
+    uint8_t data_ready(void);
+    void read_data(float* aDst);
+    void read_mg_data(float* aDst);
+    uint8_t read_reg(uint8_t aReg);
+    void write_reg(uint8_t aReg, uint8_t aValue);
+
+private:
+    I2C&        _i2c;
+    uint8_t     _addr;
+};
+
+#endif /* HOST_STUBS_LIS3DH_H_ */
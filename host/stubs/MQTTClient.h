@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_STUBS_MQTT_CLIENT_H_
+#define HOST_STUBS_MQTT_CLIENT_H_
+
+#include <string.h>
+#include <stdint.h>
+
+/* The MQTT::Client of the Paho embedded library in Cayenne-MQTT-mbed, as far as
+ * Network/mqtt_uplink.cpp uses it. Packets are real MQTT 3.1, so a broker stand-in sees the bytes
+ * the device sends; only CONNACK, PUBACK and PINGRESP are understood on the way back.
+ */
+
+typedef struct
+{
+    char*   cstring;
+} MQTTString;
+
+typedef struct
+{
+    int             MQTTVersion;
+    MQTTString      clientID;
+    unsigned short  keepAliveInterval;
+    unsigned char   cleansession;
+    unsigned char   willFlag;
+    MQTTString      username;
+    MQTTString      password;
+} MQTTPacket_connectData;
+
+#define MQTTPacket_connectData_initializer  { 3, { NULL }, 60, 1, 0, { NULL }, { NULL } }
+
+namespace MQTT
+{
+
+enum QoS { QOS0, QOS1, QOS2 };
+
+enum returnCode { BUFFER_OVERFLOW = -2, FAILURE = -1, SUCCESS = 0 };
+
+#define MQTT_PACKET_CONNACK     (2)
+#define MQTT_PACKET_PUBACK      (4)
+#define MQTT_PACKET_PINGRESP    (13)
+
+struct Message
+{
+    enum QoS        qos;
+    bool            retained;
+    bool            dup;
+    unsigned short  id;
+    void*           payload;
+    size_t          payloadlen;
+};
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS> class Client
+{
+public:
+    Client(Network& aNetwork, unsigned int aCommandTimeoutMs = 30000) :
+        _net(aNetwork), _timeoutMs(aCommandTimeoutMs), _connected(false), _packetId(0), _keepAliveS(60), _pingOutstanding(false)
+    {
+    }
+
+    int connect(MQTTPacket_connectData& aOptions)
+    {
+        const char* user    = aOptions.username.cstring;
+        const char* pass    = aOptions.password.cstring;
+        int         len;
+
+        if (_connected)
+        {
+            return FAILURE;
+        }
+        _keepAliveS = aOptions.keepAliveInterval;
+        len = header(0x10, 12 + 2 + strlen(aOptions.clientID.cstring) + (user ? 2 + strlen(user) : 0) + (pass ? 2 + strlen(pass) : 0));
+        put_string(len, "MQIsdp");
+        _buf[len++] = 3;
+        _buf[len++] = (aOptions.cleansession ? 0x02 : 0) | (user ? 0x80 : 0) | (pass ? 0x40 : 0);
+        _buf[len++] = _keepAliveS >> 8;
+        _buf[len++] = _keepAliveS & 0xFF;
+        put_string(len, aOptions.clientID.cstring);
+        if (user)
+        {
+            put_string(len, user);
+        }
+        if (pass)
+        {
+            put_string(len, pass);
+        }
+        if (SUCCESS != send_packet(len) || MQTT_PACKET_CONNACK != read_packet(_timeoutMs))
+        {
+            return FAILURE;
+        }
+        _connected          = true;
+        _pingOutstanding    = false;
+        return SUCCESS;
+    }
+
+    int publish(const char* aTopic, Message& aMessage)
+    {
+        int remaining   = 2 + strlen(aTopic) + (aMessage.qos ? 2 : 0) + aMessage.payloadlen;
+        int len;
+        int type;
+
+        if (false == _connected)
+        {
+            return FAILURE;
+        }
+        if (remaining > MAX_MQTT_PACKET_SIZE)
+        {
+            return BUFFER_OVERFLOW;
+        }
+        len = header(0x30 | (aMessage.qos << 1) | (aMessage.retained ? 1 : 0), remaining);
+        put_string(len, aTopic);
+        if (aMessage.qos)
+        {
+            _packetId++;
+            _buf[len++] = _packetId >> 8;
+            _buf[len++] = _packetId & 0xFF;
+        }
+        memcpy(_buf + len, aMessage.payload, aMessage.payloadlen);
+        len += aMessage.payloadlen;
+        if (SUCCESS != send_packet(len))
+        {
+            return FAILURE;
+        }
+        if (aMessage.qos)
+        {
+            do
+            {
+                type = read_packet(_timeoutMs);
+            } while (MQTT_PACKET_PINGRESP == type);
+            return (MQTT_PACKET_PUBACK == type) ? SUCCESS : FAILURE;
+        }
+        return SUCCESS;
+    }
+
+    int yield(unsigned long aTimeoutMs = 1000L)
+    {
+        int type    = read_packet(aTimeoutMs);
+
+        if (-2 == type)
+        {
+            return FAILURE;
+        }
+        if (MQTT_PACKET_PINGRESP == type)
+        {
+            _pingOutstanding    = false;
+        }
+        if (_keepAliveS && _lastSent.expired())
+        {
+            if (_pingOutstanding || SUCCESS != send_packet(header(0xC0, 0)))
+            {
+                return FAILURE;
+            }
+            _pingOutstanding    = true;
+        }
+        return SUCCESS;
+    }
+
+    bool isConnected(void)
+    {
+        return _connected;
+    }
+
+    int disconnect(void)
+    {
+        _connected  = false;
+        return send_packet(header(0xE0, 0));
+    }
+
+private:
+    int header(unsigned char aType, int aRemaining)
+    {
+        int len = 0;
+
+        _buf[len++] = aType;
+        do
+        {
+            unsigned char digit = aRemaining % 128;
+
+            aRemaining /= 128;
+            _buf[len++] = digit | (aRemaining ? 0x80 : 0);
+        } while (aRemaining);
+        return len;
+    }
+
+    void put_string(int& aLen, const char* aString)
+    {
+        size_t  len = (NULL != aString) ? strlen(aString) : 0;
+
+        _buf[aLen++] = len >> 8;
+        _buf[aLen++] = len & 0xFF;
+        memcpy(_buf + aLen, aString, len);
+        aLen += len;
+    }
+
+    /* @return The packet type, -1 when nothing came, -2 for a broken packet */
+    int read_packet(int aTimeoutMs)
+    {
+        unsigned char   fixed[2];
+
+        if (1 != _net.read(fixed, 1, aTimeoutMs))
+        {
+            return -1;
+        }
+        if (1 != _net.read(fixed + 1, 1, aTimeoutMs) ||
+            (fixed[1] && fixed[1] != _net.read(_buf, fixed[1], aTimeoutMs)))
+        {
+            return -2;
+        }
+        return fixed[0] >> 4;
+    }
+
+    int send_packet(int aLen)
+    {
+        if (aLen != _net.write(_buf, aLen, _timeoutMs))
+        {
+            return FAILURE;
+        }
+        _lastSent.countdown(_keepAliveS);
+        return SUCCESS;
+    }
+
+    Network&        _net;
+    int             _timeoutMs;
+    bool            _connected;
+    unsigned short  _packetId;
+    unsigned int    _keepAliveS;
+    bool            _pingOutstanding;
+    Timer           _lastSent;
+    unsigned char   _buf[MAX_MQTT_PACKET_SIZE + 16];
+};
+
+} /* namespace MQTT */
+
+#endif /* HOST_STUBS_MQTT_CLIENT_H_ */
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_STUBS_MQTT_TIMER_H_
+#define HOST_STUBS_MQTT_TIMER_H_
+
+#include "platform_clock.h"
+
+/* Countdown on the host clock, as MQTTTimer of Cayenne-MQTT-mbed */
+class MQTTTimer
+{
+public:
+    MQTTTimer() : _endMs(0) {}
+    MQTTTimer(int aMs) { countdown_ms(aMs); }
+    bool expired(void) { return (int32_t) (_endMs - platform_now_ms()) <= 0; }
+    void countdown_ms(unsigned long aMs) { _endMs = platform_now_ms() + aMs; }
+    void countdown(int aSeconds) { countdown_ms(aSeconds * 1000UL); }
+    int left_ms(void) { int32_t left = (int32_t) (_endMs - platform_now_ms()); return (left > 0) ? left : 0; }
+
+private:
+    uint32_t    _endMs;
+};
+
+#endif /* HOST_STUBS_MQTT_TIMER_H_ */
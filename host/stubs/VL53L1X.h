@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_STUBS_VL53L1X_H_
+#define HOST_STUBS_VL53L1X_H_
+
+#include "mbed.h"
+
+/* Distance sensor of host/host_sensors.cpp, reads the dist_cm column. A ranging takes the timing
+ * budget of the distance mode, and never ends while the trace has no distance.
+ */
+class VL53L1X
+{
+public:
+    VL53L1X(PinName aSda, PinName aScl);
+    bool begin(void);
+    void softReset(void);
+    uint16_t getSensorID(void);
+    void setDistanceMode(uint8_t aMode);
+    void startMeasurement(uint8_t aOffset = 0);
+    bool newDataReady(void);
+    uint16_t getDistance(void);
+
+private:
+    I2C         _i2c;
+    uint8_t     _mode;
+    uint32_t    _startMs;
+};
+
+#endif /* HOST_STUBS_VL53L1X_H_ */
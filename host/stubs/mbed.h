@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* The part of the mbed OS 5.13 API the firmware uses, for the host build. Time, pins, the I2C
+ * bus, the flash and the sockets are implemented in host/host_*.cpp; the RTOS is single threaded
+ * and everything else does nothing.
+ */
+
+#ifndef HOST_STUBS_MBED_H_
+#define HOST_STUBS_MBED_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define MBED_ASSERT(aExpr)                  do { if (!(aExpr)) { fprintf(stderr, "%s:%d: assertion %s failed\n", __FILE__, __LINE__, #aExpr); abort(); } } while (0)
+#define MBED_STATIC_ASSERT(aExpr, aMsg)     static_assert(aExpr, aMsg)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Pins of the RM7100 board, only A0 and A2 have to tell themselves apart */
+typedef enum
+{
+    P0_3, P0_6, P0_7, P0_8, P0_9, P0_10, P0_22,
+    MDMCHEN, MDMREMAP, MDMRST,
+    I2C_SDA0, I2C_SCL0,
+    A0, A2,
+    NC = -1
+} PinName;
+
+/* --- Platform --- */
+
+typedef struct
+{
+    uint32_t    current_size;
+    uint32_t    max_size;
+    uint32_t    total_size;
+    uint32_t    reserved_size;
+    uint32_t    alloc_cnt;
+    uint32_t    alloc_fail_cnt;
+    uint32_t    overhead_size;
+} mbed_stats_heap_t;
+
+typedef struct
+{
+    uint32_t    thread_id;
+    uint32_t    max_size;
+    uint32_t    reserved_size;
+    uint32_t    stack_cnt;
+} mbed_stats_stack_t;
+
+typedef void*   osThreadId_t;
+
+typedef enum
+{
+    osPriorityLow,
+    osPriorityBelowNormal,
+    osPriorityNormal,
+    osPriorityAboveNormal,
+    osPriorityHigh
+} osPriority;
+
+namespace mbed
+{
+
+template<typename F> class Callback;
+
+/* Holds a plain function, which is all the firmware hands to threads and interrupts */
+template<typename R, typename... A> class Callback<R(A...)>
+{
+public:
+    Callback() : _fn(NULL) {}
+    Callback(R (*aFn)(A...)) : _fn(aFn) {}
+    R operator()(A... aArgs) const { return _fn(aArgs...); }
+    explicit operator bool() const { return NULL != _fn; }
+
+private:
+    R (*_fn)(A...);
+};
+
+template<typename R, typename... A> Callback<R(A...)> callback(R (*aFn)(A...))
+{
+    return Callback<R(A...)>(aFn);
+}
+
+/* --- Drivers --- */
+
+class DigitalOut
+{
+public:
+    DigitalOut(PinName aPin, int aValue = 0) : _pin(aPin), _value(aValue) {}
+    void write(int aValue) { _value = aValue; }
+    int read() { return _value; }
+    DigitalOut& operator=(int aValue) { write(aValue); return *this; }
+    DigitalOut& operator=(DigitalOut& aOther) { write(aOther.read()); return *this; }
+    operator int() { return read(); }
+
+private:
+    PinName _pin;
+    int     _value;
+};
+
+/* Reads the voltage host/host_sensors.cpp gives the pin */
+class AnalogIn
+{
+public:
+    AnalogIn(PinName aPin) : _pin(aPin) {}
+    unsigned short read_u16(void);
+    float read(void) { return read_u16() / 65535.0f; }
+
+private:
+    PinName _pin;
+};
+
+/* A bus of the simulated sensors in host/host_sensors.cpp, transfers take the time they would at
+ * the set frequency. Addresses are 8-bit, 0 is success and anything else a NACK, as in mbed.
+ */
+class I2C
+{
+public:
+    I2C(PinName aSda, PinName aScl) : _hz(100000) { (void) aSda; (void) aScl; }
+    void frequency(int aHz) { _hz = aHz; }
+    int read(int aAddress, char* aData, int aLength, bool aRepeated = false);
+    int write(int aAddress, const char* aData, int aLength, bool aRepeated = false);
+    void start(void) {}
+    void stop(void) {}
+
+private:
+    int     _hz;
+};
+
+/* NOR flash image kept in RAM, or in a file given with -f so it survives a restart. Programming
+ * can only clear bits and has to be page aligned, like the nRF52 flash.
+ */
+class FlashIAP
+{
+public:
+    int init(void);
+    int deinit(void) { return 0; }
+    int read(void* aBuffer, uint32_t aAddr, uint32_t aSize);
+    int program(const void* aBuffer, uint32_t aAddr, uint32_t aSize);
+    int erase(uint32_t aAddr, uint32_t aSize);
+    uint32_t get_sector_size(uint32_t aAddr) const;
+    uint32_t get_page_size(void) const;
+    uint32_t get_flash_start(void) const;
+    uint32_t get_flash_size(void) const;
+    uint8_t get_erase_value(void) const { return 0xFF; }
+};
+
+} /* namespace mbed */
+
+using namespace mbed;
+
+/* --- RTOS --- */
+
+namespace rtos
+{
+
+namespace Kernel
+{
+    uint64_t get_ms_count(void);
+}
+
+namespace ThisThread
+{
+    void sleep_for(uint32_t aMs);
+    uint32_t flags_wait_any_for(uint32_t aFlags, uint32_t aMs, bool aClear = true);
+}
+
+/* Only one thread runs at a time, see host_clock.cpp, and the firmware holds no mutex across a wait */
+class Mutex
+{
+public:
+    void lock(void) {}
+    void unlock(void) {}
+};
+
+/* A pthread, scheduled by host_clock.cpp. The priority and the stack size are not used. */
+class Thread
+{
+public:
+    Thread(osPriority aPriority = osPriorityNormal, uint32_t aStackSize = 0, unsigned char* aStackMem = NULL, const char* aName = NULL)
+        : _name(aName), _slot(-1)
+    {
+        (void) aPriority; (void) aStackSize; (void) aStackMem;
+    }
+    int start(mbed::Callback<void()> aTask);
+    int32_t flags_set(uint32_t aFlags);
+    int join(void) { return 0; }
+
+private:
+    static void* run(void* aThread);
+
+    mbed::Callback<void()>  _task;
+    const char*             _name;
+    int                     _slot;
+};
+
+} /* namespace rtos */
+
+using namespace rtos;
+
+/* --- Network --- */
+
+enum nsapi_error
+{
+    NSAPI_ERROR_OK                  =  0,
+    NSAPI_ERROR_WOULD_BLOCK         = -3001,
+    NSAPI_ERROR_UNSUPPORTED         = -3002,
+    NSAPI_ERROR_PARAMETER           = -3003,
+    NSAPI_ERROR_NO_CONNECTION       = -3004,
+    NSAPI_ERROR_NO_SOCKET           = -3005,
+    NSAPI_ERROR_NO_ADDRESS          = -3006,
+    NSAPI_ERROR_NO_MEMORY           = -3007,
+    NSAPI_ERROR_NO_SSID             = -3008,
+    NSAPI_ERROR_DNS_FAILURE         = -3009,
+    NSAPI_ERROR_DHCP_FAILURE        = -3010,
+    NSAPI_ERROR_AUTH_FAILURE        = -3011,
+    NSAPI_ERROR_DEVICE_ERROR        = -3012,
+    NSAPI_ERROR_IN_PROGRESS         = -3013,
+    NSAPI_ERROR_ALREADY             = -3014,
+    NSAPI_ERROR_IS_CONNECTED        = -3015,
+    NSAPI_ERROR_CONNECTION_LOST     = -3016,
+    NSAPI_ERROR_CONNECTION_TIMEOUT  = -3017
+};
+
+typedef int         nsapi_error_t;
+typedef int         nsapi_size_or_error_t;
+typedef unsigned    nsapi_event_t;
+
+enum nsapi_connection_status
+{
+    NSAPI_STATUS_LOCAL_UP,
+    NSAPI_STATUS_GLOBAL_UP,
+    NSAPI_STATUS_DISCONNECTED,
+    NSAPI_STATUS_CONNECTING
+};
+
+enum { NSAPI_EVENT_CONNECTION_STATUS_CHANGE = 0 };
+
+enum nsapi_version_t
+{
+    NSAPI_UNSPEC,
+    NSAPI_IPv4
+};
+
+class SocketAddress
+{
+public:
+    SocketAddress(const char* aIp = NULL, uint16_t aPort = 0) : _port(aPort) { set_ip_address(aIp); }
+    bool set_ip_address(const char* aIp) { snprintf(_ip, sizeof(_ip), "%s", (NULL != aIp) ? aIp : ""); return true; }
+    const char* get_ip_address() const { return _ip; }
+    void set_port(uint16_t aPort) { _port = aPort; }
+    uint16_t get_port() const { return _port; }
+    operator bool() const { return '\0' != _ip[0]; }
+
+private:
+    char        _ip[16];
+    uint16_t    _port;
+};
+
+/* Up unless host/host_net.cpp takes the link down */
+class NetworkInterface
+{
+public:
+    virtual ~NetworkInterface() {}
+    virtual nsapi_error_t connect(void) { return NSAPI_ERROR_OK; }
+    virtual nsapi_error_t disconnect(void) { return NSAPI_ERROR_OK; }
+    virtual int get_connection_status(void);
+    virtual const char* get_ip_address(void) { return "10.0.0.7"; }
+    virtual nsapi_error_t gethostbyname(const char* aHost, SocketAddress* aAddress, nsapi_version_t aVersion = NSAPI_UNSPEC, const char* aIface = NULL);
+    void attach(void (*aCallback)(nsapi_event_t, intptr_t)) { (void) aCallback; }
+    void set_default_parameters(void) {}
+};
+
+class InternetSocket
+{
+public:
+    InternetSocket() : _timeoutMs(-1), _open(false) {}
+    virtual ~InternetSocket() {}
+    nsapi_error_t open(NetworkInterface* aIface) { (void) aIface; _open = true; return NSAPI_ERROR_OK; }
+    virtual nsapi_error_t close(void) { _open = false; return NSAPI_ERROR_OK; }
+    void set_timeout(int aTimeoutMs) { _timeoutMs = aTimeoutMs; }
+    void set_blocking(bool aBlocking) { _timeoutMs = aBlocking ? -1 : 0; }
+
+protected:
+    int     _timeoutMs;
+    bool    _open;
+};
+
+/* Talks to the server chosen in host/host_main.cpp, one connection at a time */
+class TCPSocket : public InternetSocket
+{
+public:
+    virtual ~TCPSocket() { close(); }
+    nsapi_error_t connect(const SocketAddress& aAddress);
+    nsapi_size_or_error_t send(const void* aData, size_t aSize);
+    nsapi_size_or_error_t recv(void* aData, size_t aSize);
+    virtual nsapi_error_t close(void);
+
+private:
+    bool    _connected = false;
+};
+
+class UDPSocket : public InternetSocket
+{
+public:
+    nsapi_size_or_error_t sendto(const SocketAddress& aAddress, const void* aData, size_t aSize);
+    nsapi_size_or_error_t recvfrom(SocketAddress* aAddress, void* aData, size_t aSize);
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+uint32_t us_ticker_read(void);
+
+void NVIC_SystemReset(void);
+
+void mbed_stats_heap_get(mbed_stats_heap_t* aStats);
+size_t mbed_stats_stack_get_each(mbed_stats_stack_t* aStats, size_t aCount);
+
+inline const char* osThreadGetName(osThreadId_t aId) { (void) aId; return "main"; }
+
+/* One thread, so a critical section has nothing to keep out */
+inline void core_util_critical_section_enter(void) {}
+inline void core_util_critical_section_exit(void) {}
+
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t* aPtr)
+{
+    return __atomic_load_n(aPtr, __ATOMIC_SEQ_CST);
+}
+
+inline void core_util_atomic_store_u32(volatile uint32_t* aPtr, uint32_t aValue)
+{
+    __atomic_store_n(aPtr, aValue, __ATOMIC_SEQ_CST);
+}
+
+inline bool core_util_atomic_cas_u32(volatile uint32_t* aPtr, uint32_t* aExpected, uint32_t aDesired)
+{
+    return __atomic_compare_exchange_n(aPtr, aExpected, aDesired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+inline uint32_t core_util_atomic_incr_u32(volatile uint32_t* aPtr, uint32_t aDelta)
+{
+    return __atomic_add_fetch(aPtr, aDelta, __ATOMIC_SEQ_CST);
+}
+
+inline uint32_t core_util_atomic_decr_u32(volatile uint32_t* aPtr, uint32_t aDelta)
+{
+    return __atomic_sub_fetch(aPtr, aDelta, __ATOMIC_SEQ_CST);
+}
+
+/* mbed-trace, the firmware log goes through SEGGER_RTT_printf() */
+inline void mbed_trace_init(void) {}
+inline void mbed_trace_free(void) {}
+inline void mbed_trace_prefix_function_set(char* (*aFn)(size_t)) { (void) aFn; }
+inline void mbed_trace_mutex_wait_function_set(void (*aFn)(void)) { (void) aFn; }
+inline void mbed_trace_mutex_release_function_set(void (*aFn)(void)) { (void) aFn; }
+inline void mbed_trace_cmdprint_function_set(void (*aFn)(const char*)) { (void) aFn; }
+inline void mbed_trace_print_function_set(void (*aFn)(const char*)) { (void) aFn; }
+
+namespace mbed_cellular_trace
+{
+    inline void mutex_wait_function_set(void (*aFn)(void)) { (void) aFn; }
+    inline void mutex_release_function_set(void (*aFn)(void)) { (void) aFn; }
+}
+
+#endif /* HOST_STUBS_MBED_H_ */
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Replays traces through the change-detection engine and through the update_sensor_params() it
+ * replaced, and compares the send decisions report by report. With the thresholds of the old
+ * function the decisions must be identical; CD_FLAG_REPORT_INITIAL may only add the first report
+ * of a channel whose first reading is inside its deadband.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "change_detect.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define CALC_ABSOLUTE_DIFF(a, b)        (((a) > (b)) ? ((a) - (b)) : ((b) - (a)))
+
+#define CHANNELS                        (11)
+#define GROUPS                          (5)
+
+#define SAMPLE_PERIOD_MS                (2000)
+#define SAMPLES_PER_REPORT              (5)
+#define RANDOM_SAMPLES                  (200000)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* One sensor as update_sensor_params() saw it */
+typedef struct
+{
+    int         first;
+    int         count;
+    int         threshold;
+    int         valOld[3];
+    int         valSend[3];
+    bool        isSendUpdate;
+} LegacySensor_t;
+
+typedef struct
+{
+    int         reports;        /* Reports that carried at least one sensor */
+    int         sensorReports;  /* Sensors carried, summed over the reports */
+    int         differences;    /* Reports where the engine and the old function disagree */
+    int         initialOnly;    /* Differences that are the engine reporting a first reading */
+} Comparison_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* The thresholds update_sensor_params() had hard-coded: DISCARD_SENSOR_FLUCT for the environment,
+ * 8 for tilt, 10 for light, distance and the magnetometer.
+ */
+static const LegacySensor_t legacySensors[GROUPS] =
+{
+    { 0, 3, 1 },        /* BME280 temperature, pressure, humidity */
+    { 3, 3, 8 },        /* LIS3DH X, Y, Z in mg */
+    { 6, 1, 10 },       /* OPT3001 lux */
+    { 7, 1, 10 },       /* VL53L1X cm */
+    { 8, 3, 10 },       /* LIS2MDL X, Y, Z */
+};
+
+static const char*  traceColumns[CHANNELS] =
+{
+    "temp_c", "press_hpa", "hum_pct", "acc_x_mg", "acc_y_mg", "acc_z_mg", "lux", "dist_cm", "mag_x", "mag_y", "mag_z"
+};
+
+/* Noise added to the recorded trace, so the deadbands have something to reject */
+static const int    traceNoise[CHANNELS] = { 1, 1, 2, 12, 12, 12, 15, 8, 12, 12, 12 };
+
+static ChangeDetectChannel_t    table[CHANNELS];
+static ChangeDetect_t           engine;
+static LegacySensor_t           legacy[GROUPS];
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* update_sensor_params() of the baseline firmware, for any of its sensors */
+static void legacy_update(
+    LegacySensor_t* aSensor,
+    const int32_t   aVal[])
+{
+    const int32_t*  valNew  = &aVal[aSensor->first];
+    bool            exceed  = false;
+    bool            bigger  = false;
+
+    for (int i = 0; i < aSensor->count; i++)
+    {
+        exceed |= CALC_ABSOLUTE_DIFF(valNew[i], aSensor->valOld[i]) > aSensor->threshold;
+        bigger |= CALC_ABSOLUTE_DIFF(valNew[i], aSensor->valOld[i]) > CALC_ABSOLUTE_DIFF(aSensor->valOld[i], aSensor->valSend[i]);
+    }
+
+    if (exceed)
+    {
+        if ((false == aSensor->isSendUpdate) || bigger)
+        {
+            memcpy(aSensor->valSend, valNew, aSensor->count * sizeof(int));
+        }
+        aSensor->isSendUpdate   = true;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void setup(
+    uint8_t     aFlags)
+{
+    memcpy(legacy, legacySensors, sizeof(legacy));
+
+    for (int g = 0; g < GROUPS; g++)
+    {
+        for (int i = 0; i < legacy[g].count; i++)
+        {
+            ChangeDetectChannel_t*  channel = &table[legacy[g].first + i];
+
+            memset(channel, 0, sizeof(*channel));
+            channel->channel        = legacy[g].first + i;
+            channel->group          = (uint8_t) g;
+            channel->flags          = aFlags;
+            channel->absDeadband    = legacy[g].threshold;
+        }
+    }
+    TEST_CHECK(change_detect_init(&engine, table, CHANNELS, 0) == 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Feeds one sample vector to both, and compares them when a report is due */
+static void step(
+    Comparison_t*   aCmp,
+    const int32_t   aVal[],
+    uint32_t        aValid,
+    uint32_t        aNowMs,
+    bool            aReport)
+{
+    uint32_t    legacyMask  = 0;
+    uint32_t    due;
+    bool        same        = true;
+    bool        initial     = true;
+
+    change_detect_process(&engine, aVal, aValid);
+    for (int g = 0; g < GROUPS; g++)
+    {
+        if (aValid & (1UL << legacy[g].first))
+        {
+            legacy_update(&legacy[g], aVal);
+        }
+    }
+
+    if (!aReport)
+    {
+        return;
+    }
+
+    due = change_detect_due(&engine, aNowMs);
+    for (int g = 0; g < GROUPS; g++)
+    {
+        uint32_t    groupMask   = ((1UL << legacy[g].count) - 1) << legacy[g].first;
+
+        if (legacy[g].isSendUpdate)
+        {
+            legacyMask |= groupMask;
+            for (int i = 0; i < legacy[g].count; i++)
+            {
+                same   &= !(due & (1UL << (legacy[g].first + i))) ||
+                          (change_detect_value(&engine, legacy[g].first + i) == legacy[g].valSend[i]);
+            }
+        }
+        else if (due & groupMask)
+        {
+            /* The old function could only miss a first reading within the threshold of 0 */
+            for (int i = 0; i < legacy[g].count; i++)
+            {
+                initial    &= (legacy[g].valOld[i] == 0) && (legacy[g].valSend[i] == 0);
+            }
+        }
+    }
+
+    if ((due != legacyMask) || !same)
+    {
+        aCmp->differences++;
+        aCmp->initialOnly  += (same && ((due & legacyMask) == legacyMask) && initial) ? 1 : 0;
+    }
+    if (due != 0)
+    {
+        aCmp->reports++;
+    }
+    for (int g = 0; g < GROUPS; g++)
+    {
+        aCmp->sensorReports    += (due & (1UL << legacy[g].first)) ? 1 : 0;
+        if (legacy[g].isSendUpdate)
+        {
+            memcpy(legacy[g].valOld, legacy[g].valSend, sizeof(legacy[g].valOld));
+            legacy[g].isSendUpdate  = false;
+        }
+    }
+    change_detect_commit(&engine, due, aNowMs);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static Comparison_t replay_trace(
+    const TestTrace_t*  aTrace,
+    uint8_t             aFlags)
+{
+    Comparison_t    cmp         = {};
+    int             column[CHANNELS];
+    int             sample      = 0;
+
+    setup(aFlags);
+    test_seed(26);
+    for (int i = 0; i < CHANNELS; i++)
+    {
+        column[i]   = test_trace_column(aTrace, traceColumns[i]);
+        TEST_CHECK(column[i] > 0);
+    }
+
+    for (uint32_t nowMs = 0; nowMs <= (uint32_t) (test_trace_end(aTrace) * 1000) + 60000; nowMs += SAMPLE_PERIOD_MS)
+    {
+        int32_t     val[CHANNELS];
+        uint32_t    valid   = 0;
+
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            float   value   = test_trace_at(aTrace, column[i], nowMs / 1000.0f);
+            int32_t noise   = (int32_t) (test_rand() % (2 * traceNoise[i] + 1)) - traceNoise[i];
+
+            val[i]  = isnan(value) ? 0 : (int32_t) value + noise;
+            valid  |= isnan(value) ? 0 : (1UL << i);
+        }
+        step(&cmp, val, valid, nowMs, (++sample % SAMPLES_PER_REPORT) == 0);
+    }
+    return cmp;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static Comparison_t replay_random(
+    uint8_t     aFlags)
+{
+    Comparison_t    cmp     = {};
+    int32_t         base[CHANNELS];
+
+    setup(aFlags);
+    test_seed(1);
+    for (int i = 0; i < CHANNELS; i++)
+    {
+        base[i] = (int32_t) (test_rand() % 2001) - 1000;
+    }
+
+    for (int sample = 1; sample <= RANDOM_SAMPLES; sample++)
+    {
+        int32_t     val[CHANNELS];
+
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            base[i]    += (int32_t) (test_rand() % 7) - 3;
+            val[i]      = base[i] + (int32_t) (test_rand() % 21) - 10;
+        }
+        step(&cmp, val, (1UL << CHANNELS) - 1, (uint32_t) sample * SAMPLE_PERIOD_MS, (sample % SAMPLES_PER_REPORT) == 0);
+    }
+    return cmp;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void print(
+    const char*         aName,
+    const Comparison_t* aCmp)
+{
+    printf("  %-32s %6d reports, %6d sensor updates, %d differences (%d first readings)\n",
+           aName, aCmp->reports, aCmp->sensorReports, aCmp->differences, aCmp->initialOnly);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(
+    int     aArgc,
+    char*   aArgv[])
+{
+    static TestTrace_t  trace;
+    const char*         path    = (aArgc > 1) ? aArgv[1] : TEST_TRACE_DEFAULT;
+    Comparison_t        cmp;
+
+    TEST_CHECK(test_trace_load(&trace, path) == 0);
+
+    /* The thresholds of the old function, nothing else: identical decisions */
+    cmp = replay_trace(&trace, 0);
+    print(path, &cmp);
+    TEST_CHECK(cmp.reports > 0);
+    TEST_CHECK(cmp.differences == 0);
+
+    cmp = replay_random(0);
+    print("random walk", &cmp);
+    TEST_CHECK(cmp.reports > 0);
+    TEST_CHECK(cmp.differences == 0);
+
+    /* The first reading of every sensor is reported even inside the deadband */
+    cmp = replay_trace(&trace, CD_FLAG_REPORT_INITIAL);
+    print("with CD_FLAG_REPORT_INITIAL", &cmp);
+    TEST_CHECK(cmp.differences == cmp.initialOnly);
+    TEST_CHECK(cmp.initialOnly <= GROUPS);
+
+    return test_result("change_detect_test");
+}
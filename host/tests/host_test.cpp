@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define TEST_LINE_MAX           (512)
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int testChecks;
+int testFailures;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static uint32_t testRandState   = 1;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int test_result(
+    const char* aName)
+{
+    printf("%s: %s, %d checks, %d failed\n", aName, (testFailures == 0) ? "PASS" : "FAIL", testChecks, testFailures);
+    return (testFailures == 0) ? 0 : 1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+void test_seed(
+    uint32_t    aSeed)
+{
+    testRandState   = (aSeed != 0) ? aSeed : 1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint32_t test_rand(void)
+{
+    /* xorshift32 */
+    testRandState  ^= testRandState << 13;
+    testRandState  ^= testRandState >> 17;
+    testRandState  ^= testRandState << 5;
+    return testRandState;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint64_t test_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+uint64_t test_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return test_now_ns();
+#endif
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+const char* test_cycles_unit(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return "TSC cycles";
+#else
+    return "ns";
+#endif
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int test_trace_load(
+    TestTrace_t*    aTrace,
+    const char*     aPath)
+{
+    FILE*   file;
+    char    line[TEST_LINE_MAX];
+    bool    header  = true;
+
+    file    = fopen(aPath, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    memset(aTrace, 0, sizeof(*aTrace));
+    while ((fgets(line, sizeof(line), file) != NULL) && (aTrace->rows < TEST_TRACE_ROWS))
+    {
+        char*   cell    = line;
+        int     column  = 0;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if ((line[0] == '#') || (line[0] == '\0'))
+        {
+            continue;
+        }
+
+        /* Split on every comma, so an empty cell keeps its column */
+        while ((cell != NULL) && (column < TEST_TRACE_COLUMNS))
+        {
+            char*   next    = strchr(cell, ',');
+
+            if (next != NULL)
+            {
+                *next++ = '\0';
+            }
+            if (header)
+            {
+                snprintf(aTrace->name[column], TEST_TRACE_NAME_MAX, "%.*s", TEST_TRACE_NAME_MAX - 1, cell);
+            }
+            else
+            {
+                aTrace->value[aTrace->rows][column] = (cell[0] != '\0') ? strtof(cell, NULL) : NAN;
+            }
+            column++;
+            cell    = next;
+        }
+
+        if (header)
+        {
+            aTrace->columns = column;
+            header          = false;
+        }
+        else
+        {
+            aTrace->rows++;
+        }
+    }
+    fclose(file);
+
+    return ((aTrace->rows > 0) && (strcmp(aTrace->name[0], "t_s") == 0)) ? 0 : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int test_trace_column(
+    const TestTrace_t*  aTrace,
+    const char*         aName)
+{
+    for (int i = 0; i < aTrace->columns; i++)
+    {
+        if (strcmp(aTrace->name[i], aName) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+float test_trace_at(
+    const TestTrace_t*  aTrace,
+    int                 aColumn,
+    float               aTimeS)
+{
+    int     row = 0;
+
+    while ((row + 1 < aTrace->rows) && (aTrace->value[row + 1][0] <= aTimeS))
+    {
+        row++;
+    }
+    return aTrace->value[row][aColumn];
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+float test_trace_end(
+    const TestTrace_t*  aTrace)
+{
+    return aTrace->value[aTrace->rows - 1][0];
+}
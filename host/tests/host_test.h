@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HOST_TESTS_HOST_TEST_H_
+#define HOST_TESTS_HOST_TEST_H_
+
+/* Helpers shared by the host tests in this directory, run with make -C host test. A test is one
+ * program that exits non-zero when a check failed. Measurements are printed, never checked.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define TEST_CHECK(aCond)                                                                           \
+    do                                                                                              \
+    {                                                                                               \
+        testChecks++;                                                                               \
+        if (!(aCond))                                                                               \
+        {                                                                                           \
+            testFailures++;                                                                         \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #aCond);              \
+        }                                                                                           \
+    } while (0)
+
+#define TEST_TRACE_COLUMNS                  (16)
+#define TEST_TRACE_ROWS                     (1024)
+#define TEST_TRACE_NAME_MAX                 (16)
+
+#define TEST_TRACE_DEFAULT                  "traces/manhole.csv"
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** A CSV trace as in host/traces: a t_s column, then one column per signal. A row holds from its
+ * time until the next one. Empty cells are NaN.
+ */
+typedef struct
+{
+    int     columns;
+    int     rows;
+    char    name[TEST_TRACE_COLUMNS][TEST_TRACE_NAME_MAX];
+    float   value[TEST_TRACE_ROWS][TEST_TRACE_COLUMNS];
+} TestTrace_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   V A R I A B L E   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+extern int  testChecks;
+extern int  testFailures;
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E C L A R A T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/** Prints the outcome of the test.
+ *
+ * @return The exit code of the test.
+ */
+int test_result(
+    const char* aName);
+
+/** Reproducible pseudo-random numbers, the same on every host */
+void test_seed(
+    uint32_t    aSeed);
+
+uint32_t test_rand(void);
+
+/** A CPU cycle counter where the host has one, nanoseconds otherwise, see test_cycles_unit() */
+uint64_t test_cycles(void);
+
+const char* test_cycles_unit(void);
+
+uint64_t test_now_ns(void);
+
+/** @return 0, or -1 when the file cannot be read or is not a trace. */
+int test_trace_load(
+    TestTrace_t*    aTrace,
+    const char*     aPath);
+
+/** @return The index of a column, or -1. Column 0 is t_s. */
+int test_trace_column(
+    const TestTrace_t*  aTrace,
+    const char*         aName);
+
+/** @return The value of a column at aTimeS, NaN when the cell is empty. */
+float test_trace_at(
+    const TestTrace_t*  aTrace,
+    int                 aColumn,
+    float               aTimeS);
+
+/** @return The time of the last row. */
+float test_trace_end(
+    const TestTrace_t*  aTrace);
+
+#endif /* HOST_TESTS_HOST_TEST_H_ */
@@ -0,0 +1,472 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Feeds Network/http_parser.cpp known responses whole, split at every point and byte by byte,
+ * mutation-fuzzes it from the same responses, and prints its cost per dweet response.
+ *
+ *   build/tests/http_parser_test [iterations]      fuzz iterations, see "make fuzz"
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "http_parser.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define FUZZ_ITERATIONS_DEFAULT         (200000)
+#define FUZZ_INPUT_MAX                  (6000)      /* Past HTTP_PARSER_HEAD_MAX */
+#define FUZZ_CUTS_MAX                   (4)
+#define BENCH_RESPONSES                 (200000)
+
+#define END_ERROR                       (-1)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* What feeding a response left */
+typedef struct
+{
+    int         used;               /* Bytes taken, -1 on error */
+    uint8_t     state;
+    int         status;
+    uint32_t    bodyBytes;
+    bool        close;
+} Outcome_t;
+
+typedef struct
+{
+    const char* name;
+    const char* text;
+    int         used;               /* Bytes taken, -1 when malformed, 0 = all of them */
+    uint8_t     state;              /* After the feed */
+    int         status;
+    uint32_t    bodyBytes;
+    bool        close;
+} Case_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+#define DWEET_BODY  "{\"this\":\"succeeded\",\"by\":\"dweeting\",\"the\":\"dweet\",\"with\":{\"thing\":\"RM7100_DEMO\"," \
+                    "\"created\":\"2019-06-11T10:12:13.141Z\",\"content\":{\"TEMPERATURE\":23,\"PRESSURE\":1013}}}"
+
+static const char   dweetResponse[]     =
+    "HTTP/1.1 200 OK\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 163\r\n"
+    "Date: Tue, 11 Jun 2019 10:12:13 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    DWEET_BODY;
+
+static const char   dweetChunked[]      =
+    "HTTP/1.1 200 OK\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Content-Type: application/json\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Date: Tue, 11 Jun 2019 10:12:13 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "42\r\n" "{\"this\":\"succeeded\",\"by\":\"dweeting\",\"the\":\"dweet\",\"with\":{\"thing\":" "\r\n"
+    "61;ext=1\r\n" "\"RM7100_DEMO\",\"created\":\"2019-06-11T10:12:13.141Z\",\"content\":{\"TEMPERATURE\":23,\"PRESSURE\":1013}}}" "\r\n"
+    "0\r\n"
+    "\r\n";
+
+static const Case_t cases[] =
+{
+    { "dweet",              dweetResponse,                                                          0,  HTTP_PARSER_DONE, 200, 163, false },
+    { "dweet chunked",      dweetChunked,                                                           0,  HTTP_PARSER_DONE, 200, 163, false },
+    { "interim 100",        "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 201 Created\r\nContent-Length: 2\r\n\r\n{}",
+                                                                                                    0,  HTTP_PARSER_DONE, 201, 2,   false },
+    { "204 pipelined",      "HTTP/1.1 204 No Content\r\n\r\nHTTP/1.1 200 OK\r\n",                   27, HTTP_PARSER_DONE, 204, 0,   false },
+    { "length pipelined",   "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nabcHTTP/1.1",              41, HTTP_PARSER_DONE, 200, 3,   false },
+    { "1.0 until close",    "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\nhello",             0,  HTTP_PARSER_UNTIL_CLOSE, 200, 5, true },
+    { "connection close",   "HTTP/1.1 200 OK\r\nConnection: keep-alive, Close\r\nContent-Length: 0\r\n\r\n",
+                                                                                                    0,  HTTP_PARSER_DONE, 200, 0,   true },
+    { "server error",       "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 5\r\nRetry-After: 1\r\n\r\nbusy!",
+                                                                                                    0,  HTTP_PARSER_DONE, 503, 5,   false },
+    { "bare LF",            "HTTP/1.1 404 Not Found\nContent-Length: 4\n\nnope",                    0,  HTTP_PARSER_DONE, 404, 4,   false },
+    { "leading line break", "\r\nHTTP/1.1 200 OK\r\ncontent-length:  1 \r\n\r\nx",                 0,  HTTP_PARSER_DONE, 200, 1,   false },
+    { "gzip, chunked",      "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, chunked\r\n\r\n1\r\nx\r\n0\r\nX-Trailer: 1\r\n\r\n",
+                                                                                                    0,  HTTP_PARSER_DONE, 200, 1,   false },
+    { "chunked, gzip",      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked, gzip\r\n\r\nzz",        0,  HTTP_PARSER_UNTIL_CLOSE, 200, 2, true },
+    { "encoding wins",      "HTTP/1.1 200 OK\r\nContent-Length: 100\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nab\r\n0\r\n\r\n",
+                                                                                                    0,  HTTP_PARSER_DONE, 200, 2,   false },
+    { "same length twice",  "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nContent-Length: 2\r\n\r\nab",  0,  HTTP_PARSER_DONE, 200, 2,   false },
+    { "long header",        "HTTP/1.1 200 OK\r\nSet-Cookie: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n"
+                            "Content-Length: 1\r\n\r\nx",                                           0,  HTTP_PARSER_DONE, 200, 1,   false },
+    { "head only",          "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n12345",                   0,  HTTP_PARSER_BODY, 200, 5,   false },
+    { "switching",          "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n\r\n\x81\x05", 56, HTTP_PARSER_DONE, 101, 0, true },
+
+    { "HTTP/2",             "HTTP/2 200 OK\r\n\r\n",                                                -1 },
+    { "status 099",         "HTTP/1.1 099 Odd\r\n\r\n",                                             -1 },
+    { "status letters",     "HTTP/1.1 2x0 OK\r\n\r\n",                                              -1 },
+    { "two lengths",        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nContent-Length: 3\r\n\r\nab",  -1 },
+    { "length not a number","HTTP/1.1 200 OK\r\nContent-Length: two\r\n\r\nab",                     -1 },
+    { "length trailing",    "HTTP/1.1 200 OK\r\nContent-Length: 2x\r\n\r\nab",                      -1 },
+    { "length overflow",    "HTTP/1.1 200 OK\r\nContent-Length: 99999999999\r\n\r\n",               -1 },
+    { "chunk size letters", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",          -1 },
+    { "chunk size digits",  "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10000000\r\n",    -1 },
+    { "chunk no CRLF",      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nxy\r\n",     -1 },
+};
+
+#define CASE_COUNT                      ((int) (sizeof(cases) / sizeof(cases[0])))
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Feeds aData in pieces ending at the aCutCount offsets of aCuts and at aLen, as recv() would */
+static Outcome_t feed(
+    const char*     aData,
+    uint32_t        aLen,
+    const uint32_t* aCuts,
+    int             aCutCount)
+{
+    HttpParser_t    parser;
+    Outcome_t       outcome;
+    uint32_t        from    = 0;
+    int             used    = 0;
+
+    http_parser_init(&parser);
+    for (int i = 0; i <= aCutCount; i++)
+    {
+        uint32_t    to      = (i < aCutCount) ? aCuts[i] : aLen;
+        int         result  = http_parser_feed(&parser, aData + from, to - from);
+
+        if (result < 0)
+        {
+            used    = END_ERROR;
+            break;
+        }
+        TEST_CHECK(result <= (int) (to - from));
+        used   += result;
+        if (result < (int) (to - from))
+        {
+            /* The response ended, nothing more is taken */
+            TEST_CHECK(parser.state == HTTP_PARSER_DONE);
+            TEST_CHECK(http_parser_feed(&parser, aData + from + result, to - from - result) == 0);
+            break;
+        }
+        from    = to;
+    }
+
+    TEST_CHECK(parser.state <= HTTP_PARSER_ERROR);
+    TEST_CHECK(parser.lineLen <= HTTP_PARSER_LINE_MAX);
+    TEST_CHECK(parser.headBytes <= HTTP_PARSER_HEAD_MAX + 1);
+    if (http_parser_head_done(&parser))
+    {
+        TEST_CHECK(parser.status >= 101);
+    }
+    if (HTTP_PARSER_DONE == parser.state && false == parser.chunked && parser.contentLength >= 0 && 101 != parser.status &&
+        204 != parser.status && 304 != parser.status)
+    {
+        TEST_CHECK(parser.bodyBytes == (uint32_t) parser.contentLength || parser.encoded);
+    }
+
+    outcome.used        = used;
+    outcome.state       = parser.state;
+    outcome.status      = parser.status;
+    outcome.bodyBytes   = parser.bodyBytes;
+    outcome.close       = parser.close;
+    return outcome;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static bool same(
+    const Outcome_t*    aA,
+    const Outcome_t*    aB)
+{
+    return aA->used == aB->used && aA->state == aB->state && aA->status == aB->status &&
+           aA->bodyBytes == aB->bodyBytes && aA->close == aB->close;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Byte by byte, as the slowest link delivers it */
+static Outcome_t feed_bytes(
+    const char*     aData,
+    uint32_t        aLen)
+{
+    static uint32_t cuts[FUZZ_INPUT_MAX];
+
+    for (uint32_t i = 0; i + 1 < aLen; i++)
+    {
+        cuts[i] = i + 1;
+    }
+    return feed(aData, aLen, cuts, (aLen > 0) ? (int) aLen - 1 : 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_cases(void)
+{
+    int     failed  = 0;
+
+    for (int c = 0; c < CASE_COUNT; c++)
+    {
+        const Case_t*   test    = &cases[c];
+        uint32_t        len     = strlen(test->text);
+        Outcome_t       whole   = feed(test->text, len, NULL, 0);
+        Outcome_t       bytes   = feed_bytes(test->text, len);
+        bool            ok;
+
+        if (test->used < 0)
+        {
+            ok  = (END_ERROR == whole.used);
+        }
+        else
+        {
+            ok  = whole.used == ((0 == test->used) ? (int) len : test->used) && whole.state == test->state &&
+                  whole.status == test->status && whole.bodyBytes == test->bodyBytes && whole.close == test->close;
+        }
+        ok &= same(&whole, &bytes);
+        for (uint32_t cut = 1; cut < len; cut++)
+        {
+            Outcome_t   split   = feed(test->text, len, &cut, 1);
+
+            ok &= same(&whole, &split);
+        }
+        if (false == ok)
+        {
+            printf("  case \"%s\": used %d, state %u, status %d, body %u, close %d\n", test->name, whole.used, whole.state,
+                   whole.status, whole.bodyBytes, whole.close);
+            failed++;
+        }
+        TEST_CHECK(ok);
+    }
+    printf("  %d responses, whole, split at every byte and byte by byte: %d failed\n", CASE_COUNT, failed);
+
+    /* A body cut short by the close is not a response, one delimited by it is */
+    {
+        HttpParser_t    parser;
+
+        http_parser_init(&parser);
+        http_parser_feed(&parser, "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n12345", 44);
+        TEST_CHECK(http_parser_finish(&parser) == -1);
+
+        http_parser_init(&parser);
+        http_parser_feed(&parser, "HTTP/1.0 200 OK\r\n\r\nhello", 24);
+        TEST_CHECK(http_parser_finish(&parser) == 0);
+        TEST_CHECK(parser.bodyBytes == 5);
+    }
+
+    /* A head larger than HTTP_PARSER_HEAD_MAX is refused, a NUL anywhere in it too */
+    {
+        static char huge[HTTP_PARSER_HEAD_MAX + 100];
+        uint32_t    len;
+
+        len = sprintf(huge, "HTTP/1.1 200 OK\r\n");
+        while (len < HTTP_PARSER_HEAD_MAX)
+        {
+            len    += sprintf(huge + len, "X-Pad: 0123456789\r\n");
+        }
+        len    += sprintf(huge + len, "\r\n");
+        TEST_CHECK(feed(huge, len, NULL, 0).used == END_ERROR);
+        TEST_CHECK(feed("HTTP/1.1 200 OK\r\nX: \0\r\n\r\n", 24, NULL, 0).used == END_ERROR);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* One random edit of aBuf, among those that break parsers: bytes, line breaks, digits, framing */
+static uint32_t mutate(
+    char*       aBuf,
+    uint32_t    aLen)
+{
+    static const char* const    tokens[] =
+    {
+        "\r\n", "\n", "\r", "\r\n\r\n", "0", "9", "ffffff", "fffffff", ";", ":", " ", "\t", ",", "chunked",
+        "Content-Length: ", "Transfer-Encoding: chunked\r\n", "Connection: close\r\n", "HTTP/1.1 100 Continue\r\n\r\n",
+        "4294967296", "2147483647", "\0",
+    };
+    uint32_t    pos     = (aLen > 0) ? test_rand() % (aLen + 1) : 0;
+    uint32_t    count;
+
+    switch (test_rand() % 6)
+    {
+        case 0:
+            if (pos < aLen)
+            {
+                aBuf[pos]  ^= (char) (1 << (test_rand() % 8));
+            }
+            break;
+        case 1:
+            if (pos < aLen)
+            {
+                aBuf[pos]   = (char) test_rand();
+            }
+            break;
+        case 2:
+            count   = 1 + test_rand() % 16;
+            count   = (pos + count > aLen) ? aLen - pos : count;
+            memmove(aBuf + pos, aBuf + pos + count, aLen - pos - count);
+            aLen   -= count;
+            break;
+        case 3:
+        case 4:
+        {
+            const char* token   = tokens[test_rand() % (sizeof(tokens) / sizeof(tokens[0]))];
+            uint32_t    len     = ('\0' == *token) ? 1 : strlen(token);
+
+            if (aLen + len <= FUZZ_INPUT_MAX)
+            {
+                memmove(aBuf + pos + len, aBuf + pos, aLen - pos);
+                memcpy(aBuf + pos, token, len);
+                aLen   += len;
+            }
+            break;
+        }
+        default:
+            /* A repeated stretch, e.g. a header or a chunk */
+            count   = 1 + test_rand() % 64;
+            count   = (pos + count > aLen) ? aLen - pos : count;
+            if (aLen + count <= FUZZ_INPUT_MAX)
+            {
+                memmove(aBuf + pos + count, aBuf + pos, aLen - pos);
+                aLen   += count;
+            }
+            break;
+    }
+    return aLen;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void fuzz(
+    uint32_t    aIterations)
+{
+    static char input[FUZZ_INPUT_MAX];
+    uint32_t    outcomes[HTTP_PARSER_ERROR + 1] = { 0 };
+    uint32_t    mismatches                      = 0;
+
+    for (uint32_t i = 0; i < aIterations; i++)
+    {
+        const Case_t*   seed    = &cases[test_rand() % CASE_COUNT];
+        uint32_t        len     = strlen(seed->text);
+        uint32_t        cuts[FUZZ_CUTS_MAX];
+        int             cutCount;
+        Outcome_t       whole;
+        Outcome_t       split;
+
+        memcpy(input, seed->text, len);
+        for (uint32_t edits = 1 + test_rand() % 8; edits > 0; edits--)
+        {
+            len = mutate(input, len);
+        }
+
+        cutCount    = (len > 1) ? (int) (test_rand() % (FUZZ_CUTS_MAX + 1)) : 0;
+        for (int c = 0; c < cutCount; c++)
+        {
+            cuts[c] = 1 + test_rand() % (len - 1);
+        }
+        for (int c = 1; c < cutCount; c++)
+        {
+            for (int d = c; d > 0 && cuts[d - 1] > cuts[d]; d--)
+            {
+                uint32_t    swap    = cuts[d];
+
+                cuts[d]         = cuts[d - 1];
+                cuts[d - 1]     = swap;
+            }
+        }
+
+        whole   = feed(input, len, NULL, 0);
+        split   = feed(input, len, cuts, cutCount);
+        mismatches += !same(&whole, &split);
+        if (0 == i % 64)
+        {
+            split       = feed_bytes(input, len);
+            mismatches += !same(&whole, &split);
+        }
+        outcomes[whole.state]++;
+    }
+
+    printf("  %u mutated responses: %u done, %u until close, %u incomplete, %u malformed; %u split feeds ended differently\n",
+           aIterations, outcomes[HTTP_PARSER_DONE], outcomes[HTTP_PARSER_UNTIL_CLOSE],
+           aIterations - outcomes[HTTP_PARSER_DONE] - outcomes[HTTP_PARSER_UNTIL_CLOSE] - outcomes[HTTP_PARSER_ERROR],
+           outcomes[HTTP_PARSER_ERROR], mismatches);
+    TEST_CHECK(mismatches == 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void bench(
+    const char* aName,
+    const char* aResponse)
+{
+    HttpParser_t    parser;
+    uint32_t        len     = strlen(aResponse);
+    uint64_t        startNs = test_now_ns();
+    uint64_t        start   = test_cycles();
+    uint64_t        cycles;
+    uint64_t        ns;
+    uint32_t        sum     = 0;
+
+    for (int i = 0; i < BENCH_RESPONSES; i++)
+    {
+        http_parser_init(&parser);
+        sum    += http_parser_feed(&parser, aResponse, len) + parser.bodyBytes;
+    }
+    cycles  = test_cycles() - start;
+    ns      = test_now_ns() - startNs;
+    printf("  %-14s %3u bytes: %.0f %s, %.2f us per response (checksum %u)\n", aName, len, (double) cycles / BENCH_RESPONSES,
+           test_cycles_unit(), ns / 1000.0 / BENCH_RESPONSES, sum);
+    TEST_CHECK(parser.state == HTTP_PARSER_DONE);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(
+    int     aArgc,
+    char*   aArgv[])
+{
+    uint32_t    iterations  = (aArgc > 1) ? strtoul(aArgv[1], NULL, 10) : FUZZ_ITERATIONS_DEFAULT;
+
+    test_seed(7);
+
+    check_cases();
+    fuzz(iterations);
+    bench("dweet", dweetResponse);
+    bench("dweet chunked", dweetChunked);
+
+    return test_result("http_parser_test");
+}
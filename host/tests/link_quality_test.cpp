@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Feeds Network/link_quality.cpp steady, fading and noisy signals through a CellularNetwork that
+ * answers from a script, then replays the signal traces of host/traces through it the way the
+ * manhole demo samples them, and prints when the coverage level changed.
+ *
+ *   build/tests/link_quality_test [link.csv ...]      traces/link_*.csv by default
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "link_quality.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define PERIOD_MS                       (60000)     /* link-quality-period-s */
+#define NOISE_SAMPLES                   (1000)
+#define UNKNOWN                         (LINK_QUALITY_UNKNOWN)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* What the modem answers next, UNKNOWN for a value it does not report */
+static LinkSample_t         modem;
+static bool                 modemAnswers;
+static uint32_t             modemQueries;
+
+static const char* const    defaultTraces[] =
+{
+    "traces/link_fade.csv", "traces/link_edge.csv", "traces/link_rssi_only.csv",
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* One sample through link_quality_update(), steady for aCount samples */
+static bool feed(
+    LinkQuality_t*  aLink,
+    int             aRsrpDbm,
+    int             aCount)
+{
+    LinkSample_t    sample  = { UNKNOWN, (int16_t) aRsrpDbm, UNKNOWN };
+    bool            changed = false;
+
+    for (int i = 0; i < aCount; i++)
+    {
+        changed |= link_quality_update(aLink, &sample);
+    }
+    return changed;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_levels(void)
+{
+    LinkQuality_t   link;
+    LinkSample_t    rssiOnly    = { -97, UNKNOWN, UNKNOWN };
+    LinkSample_t    none        = { UNKNOWN, UNKNOWN, UNKNOWN };
+
+    /* Steady signals settle on their level, the first sample is taken as it is */
+    link_quality_init(&link, NULL, 0);
+    TEST_CHECK(false == feed(&link, -90, 1) && link.level == LINK_LEVEL_GOOD);
+    link_quality_init(&link, NULL, 0);
+    TEST_CHECK(feed(&link, -105, 1) && link.level == LINK_LEVEL_FAIR);
+    link_quality_init(&link, NULL, 0);
+    TEST_CHECK(feed(&link, -115, 1) && link.level == LINK_LEVEL_POOR);
+
+    /* Moving up takes LINK_HYSTERESIS_DB more than the threshold */
+    TEST_CHECK(false == feed(&link, LINK_RSRP_POOR_DBM + LINK_HYSTERESIS_DB - 1, 20) && link.level == LINK_LEVEL_POOR);
+    TEST_CHECK(feed(&link, LINK_RSRP_POOR_DBM + LINK_HYSTERESIS_DB, 20) && link.level == LINK_LEVEL_FAIR);
+    TEST_CHECK(false == feed(&link, LINK_RSRP_FAIR_DBM + LINK_HYSTERESIS_DB - 1, 20) && link.level == LINK_LEVEL_FAIR);
+    TEST_CHECK(feed(&link, LINK_RSRP_FAIR_DBM + LINK_HYSTERESIS_DB, 20) && link.level == LINK_LEVEL_GOOD);
+
+    /* Moving down does not */
+    TEST_CHECK(feed(&link, LINK_RSRP_FAIR_DBM - 1, 20) && link.level == LINK_LEVEL_FAIR);
+    TEST_CHECK(false == feed(&link, LINK_RSRP_FAIR_DBM - 1, 20));
+    TEST_CHECK(feed(&link, LINK_RSRP_POOR_DBM - 1, 20) && link.level == LINK_LEVEL_POOR);
+
+    /* A single fade is smoothed away */
+    link_quality_init(&link, NULL, 0);
+    feed(&link, -88, 5);
+    TEST_CHECK(false == feed(&link, -110, 1) && link.level == LINK_LEVEL_GOOD);
+    TEST_CHECK(false == feed(&link, -88, 1));
+
+    /* Without RSRP the RSSI thresholds apply, and the smoothing starts over on the other scale */
+    link_quality_init(&link, NULL, 0);
+    feed(&link, -88, 5);
+    TEST_CHECK(link_quality_update(&link, &rssiOnly) && link.level == LINK_LEVEL_POOR && false == link.byRsrp);
+    TEST_CHECK(link.metric16 == rssiOnly.rssiDbm * 16);
+    TEST_CHECK(false == link_quality_update(&link, &none) && link.samples == 6);
+    TEST_CHECK(link.last.rssiDbm == rssiOnly.rssiDbm);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* RSRP a dB or two either side of a threshold, the level must not follow the noise */
+static void check_noise(void)
+{
+    LinkQuality_t   link;
+
+    for (int threshold = 0; threshold < 2; threshold++)
+    {
+        int     centre  = threshold ? LINK_RSRP_POOR_DBM : LINK_RSRP_FAIR_DBM;
+
+        test_seed(11 + threshold);
+        link_quality_init(&link, NULL, 0);
+        for (int i = 0; i < NOISE_SAMPLES; i++)
+        {
+            feed(&link, centre - 2 + (int) (test_rand() % 5), 1);
+        }
+        printf("  RSRP %d dBm +-2 dB, %d samples: %u level changes\n", centre, NOISE_SAMPLES, link.changes);
+        TEST_CHECK(link.changes <= 2);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Sampling through the modem: the period, +CSQ and +CESQ conversions, and no answer */
+static void check_poll(void)
+{
+    CellularNetwork network;
+    LinkQuality_t   link;
+
+    link_quality_init(&link, &network, PERIOD_MS);
+    modem           = { -80, -95, -10 };
+    modemAnswers    = true;
+    modemQueries    = 0;
+
+    TEST_CHECK(false == link_quality_poll(&link, 5000) && link.samples == 1);
+    TEST_CHECK(link.last.rssiDbm == -80 && link.last.rsrpDbm == -95 && link.last.rsrqDb == -10);
+    TEST_CHECK(false == link_quality_poll(&link, 5000 + PERIOD_MS - 1) && link.samples == 1);
+    modem.rsrpDbm   = -120;
+    TEST_CHECK(link_quality_poll(&link, 5000 + PERIOD_MS) && link.samples == 2 && link.level == LINK_LEVEL_FAIR);
+    TEST_CHECK(modemQueries == 4);
+
+    /* CESQ 255: no RSRP, the RSSI decides */
+    modem           = { -99, UNKNOWN, UNKNOWN };
+    link_quality_poll(&link, 5000 + 2 * PERIOD_MS);
+    TEST_CHECK(link.last.rsrpDbm == UNKNOWN && link.last.rsrqDb == UNKNOWN && false == link.byRsrp);
+    TEST_CHECK(link.level == LINK_LEVEL_POOR);
+
+    /* Neither: a failure, the last sample and the level stay */
+    modem           = { UNKNOWN, UNKNOWN, UNKNOWN };
+    TEST_CHECK(false == link_quality_poll(&link, 5000 + 3 * PERIOD_MS));
+    modemAnswers    = false;
+    TEST_CHECK(false == link_quality_poll(&link, 5000 + 4 * PERIOD_MS));
+    TEST_CHECK(link.failures == 2 && link.samples == 3 && link.last.rssiDbm == -99 && link.level == LINK_LEVEL_POOR);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Samples a trace every PERIOD_MS as uplink_poll() does, the level changes are printed */
+static void replay(
+    const char* aPath)
+{
+    static TestTrace_t  trace;
+    CellularNetwork     network;
+    LinkQuality_t       link;
+    int                 columns[3];
+    uint32_t            secondsAt[LINK_LEVEL_COUNT] = { 0 };
+    char                changes[256]    = "";
+    size_t              len             = 0;
+    uint32_t            endMs;
+
+    TEST_CHECK(test_trace_load(&trace, aPath) == 0);
+    columns[0]  = test_trace_column(&trace, "rssi_dbm");
+    columns[1]  = test_trace_column(&trace, "rsrp_dbm");
+    columns[2]  = test_trace_column(&trace, "rsrq_db");
+    TEST_CHECK(columns[0] > 0 && columns[1] > 0 && columns[2] > 0);
+    if (testFailures > 0)
+    {
+        return;
+    }
+
+    link_quality_init(&link, &network, PERIOD_MS);
+    modemAnswers    = true;
+    endMs           = (uint32_t) (test_trace_end(&trace) * 1000) + 2 * PERIOD_MS;
+    for (uint32_t nowMs = 0; nowMs < endMs; nowMs += 1000)
+    {
+        float   rssi    = test_trace_at(&trace, columns[0], nowMs / 1000.0f);
+        float   rsrp    = test_trace_at(&trace, columns[1], nowMs / 1000.0f);
+        float   rsrq    = test_trace_at(&trace, columns[2], nowMs / 1000.0f);
+
+        modem.rssiDbm   = isnan(rssi) ? UNKNOWN : (int16_t) rssi;
+        modem.rsrpDbm   = isnan(rsrp) ? UNKNOWN : (int16_t) rsrp;
+        modem.rsrqDb    = isnan(rsrq) ? UNKNOWN : (int16_t) rsrq;
+        if (link_quality_poll(&link, nowMs) && len < sizeof(changes) - 32)
+        {
+            len += snprintf(changes + len, sizeof(changes) - len, " %u s %s,", (unsigned) (nowMs / 1000), link_level_name(link.level));
+        }
+        secondsAt[link.level]++;
+    }
+
+    printf("  %s: %u samples, changes at%s then %u s good, %u s fair, %u s poor in all\n", aPath, link.samples,
+           (len > 0) ? changes : " none,",
+           secondsAt[LINK_LEVEL_GOOD], secondsAt[LINK_LEVEL_FAIR], secondsAt[LINK_LEVEL_POOR]);
+    TEST_CHECK(link.failures == 0);
+    /* Every trace ends where it started or holds its level, and never flaps */
+    TEST_CHECK(link.changes <= 4);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* The modem of the test, answering with what the script put in modem */
+nsapi_error_t CellularNetwork::get_signal_quality(
+    int&        aRssi,
+    int*        aBer)
+{
+    (void) aBer;
+    modemQueries++;
+    aRssi   = (UNKNOWN != modem.rssiDbm) ? modem.rssiDbm : (int) SignalQualityUnknown;
+    return modemAnswers ? NSAPI_ERROR_OK : NSAPI_ERROR_DEVICE_ERROR;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+nsapi_error_t CellularNetwork::get_extended_signal_quality(
+    int&        aRxlev,
+    int&        aBer,
+    int&        aRscp,
+    int&        aEcno,
+    int&        aRsrq,
+    int&        aRsrp)
+{
+    modemQueries++;
+    aRxlev  = aBer = aRscp = aEcno = 255;
+    aRsrp   = (UNKNOWN != modem.rsrpDbm) ? modem.rsrpDbm + 141 : 255;
+    aRsrq   = (UNKNOWN != modem.rsrqDb) ? modem.rsrqDb * 2 + 40 : 255;
+    return modemAnswers ? NSAPI_ERROR_OK : NSAPI_ERROR_DEVICE_ERROR;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+int main(
+    int     aArgc,
+    char*   aArgv[])
+{
+    check_levels();
+    check_noise();
+    check_poll();
+
+    if (aArgc > 1)
+    {
+        for (int i = 1; i < aArgc; i++)
+        {
+            replay(aArgv[i]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < sizeof(defaultTraces) / sizeof(defaultTraces[0]); i++)
+        {
+            replay(defaultTraces[i]);
+        }
+    }
+
+    return test_result("link_quality_test");
+}
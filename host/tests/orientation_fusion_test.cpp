@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks the fixed-point atan2, square root and orientation fusion against double precision, and
+ * prints their cost. Attitudes are generated with the rotation sequence of Freescale AN4248, the
+ * one Sensing/orientation_fusion.cpp inverts.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include "orientation_fusion.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define DEG_TO_RAD(aDeg)                ((aDeg) * M_PI / 180.0)
+#define RAD_TO_CDEG(aRad)               ((aRad) * 18000.0 / M_PI)
+
+#define ATAN2_SAMPLES                   (2000000)
+#define ATAN2_MAX_ERROR_CDEG            (10.0)      /* The 0.1 degree of the header */
+
+#define ATTITUDES                       (20000)
+#define GRAVITY_MG                      (1000.0)
+#define FIELD_LSB                       (500.0)     /* 50 uT at the 1.5 mG/LSB of the LIS2MDL */
+#define FIELD_DIP_DEG                   (60.0)
+#define PITCH_ROLL_MAX_ERROR_CDEG       (50.0)
+#define HEADING_MAX_ERROR_CDEG          (100.0)
+#define HEADING_MIN_COS_PITCH           (0.2)       /* Heading is undefined with the cover on its edge */
+
+#define BENCH_ROUNDS                    (1000000)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static volatile int64_t benchSink;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static int32_t random_in(
+    int32_t     aMin,
+    int32_t     aMax)
+{
+    return aMin + (int32_t) (test_rand() % (uint32_t) (aMax - aMin + 1));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* |a - b| between two angles in hundredths of a degree, across the wrap */
+static double angle_error(
+    double  aA,
+    double  aB)
+{
+    double  diff    = fmod(fabs(aA - aB), 36000.0);
+
+    return (diff > 18000.0) ? 36000.0 - diff : diff;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_atan2(void)
+{
+    static const int32_t    edges[][2] =
+    {
+        { 0, 1 }, { 1, 0 }, { 0, -1 }, { -1, 0 }, { 1, 1 }, { -1, -1 },
+        { INT32_MAX, 1 }, { 1, INT32_MAX }, { -INT32_MAX, -INT32_MAX }, { INT32_MAX, -INT32_MAX },
+    };
+    double  worst   = 0;
+
+    test_seed(28);
+    for (int i = 0; i < ATAN2_SAMPLES; i++)
+    {
+        int32_t     y   = random_in(-100000, 100000);
+        int32_t     x   = random_in(-100000, 100000);
+
+        worst   = fmax(worst, angle_error(fx_atan2_cdeg(y, x), RAD_TO_CDEG(atan2((double) y, (double) x))));
+    }
+    for (unsigned i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+    {
+        worst   = fmax(worst, angle_error(fx_atan2_cdeg(edges[i][0], edges[i][1]), RAD_TO_CDEG(atan2((double) edges[i][0], edges[i][1]))));
+    }
+
+    printf("  fx_atan2_cdeg: largest error %.2f cdeg\n", worst);
+    TEST_CHECK(worst < ATAN2_MAX_ERROR_CDEG);
+    TEST_CHECK(fx_atan2_cdeg(0, 0) == 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_sqrt(void)
+{
+    int     wrong   = 0;
+
+    for (uint64_t v = 0; v < (1ULL << 20); v++)
+    {
+        wrong  += (fx_sqrt(v) != (uint32_t) sqrtl((long double) v)) ? 1 : 0;
+    }
+    test_seed(2828);
+    for (int i = 0; i < 100000; i++)
+    {
+        uint64_t    root    = test_rand();
+        uint64_t    square  = root * root;
+
+        /* Either side of a perfect square, where truncation errors show */
+        wrong  += (fx_sqrt(square) != root) ? 1 : 0;
+        wrong  += ((square > 0) && (fx_sqrt(square - 1) != root - 1)) ? 1 : 0;
+    }
+    wrong  += (fx_sqrt(UINT64_MAX) != UINT32_MAX) ? 1 : 0;
+
+    TEST_CHECK(wrong == 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Body-frame gravity (mg) and field (LSB) of a cover at pitch, roll and heading, AN4248 eq. 9:
+ * v_body = Rx(roll) * Ry(pitch) * Rz(heading) * v_earth, with x north, y east and z down.
+ */
+static void attitude_to_sensors(
+    double  aPitch,
+    double  aRoll,
+    double  aHeading,
+    int32_t aAcc[3],
+    int32_t aMag[3])
+{
+    const double    earthField[3]   = { FIELD_LSB * cos(DEG_TO_RAD(FIELD_DIP_DEG)), 0, FIELD_LSB * sin(DEG_TO_RAD(FIELD_DIP_DEG)) };
+    const double    earthGravity[3] = { 0, 0, GRAVITY_MG };
+    const double    sp  = sin(aPitch);
+    const double    cp  = cos(aPitch);
+    const double    sr  = sin(aRoll);
+    const double    cr  = cos(aRoll);
+    const double    sh  = sin(aHeading);
+    const double    ch  = cos(aHeading);
+    const double    rotation[3][3]  =
+    {
+        { cp * ch,                      cp * sh,                        -sp },
+        { sr * sp * ch - cr * sh,       sr * sp * sh + cr * ch,         sr * cp },
+        { cr * sp * ch + sr * sh,       cr * sp * sh - sr * ch,         cr * cp },
+    };
+
+    for (int i = 0; i < 3; i++)
+    {
+        double  g   = 0;
+        double  b   = 0;
+
+        for (int j = 0; j < 3; j++)
+        {
+            g  += rotation[i][j] * earthGravity[j];
+            b  += rotation[i][j] * earthField[j];
+        }
+        aAcc[i] = (int32_t) lround(g);
+        aMag[i] = (int32_t) lround(b);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_fusion(void)
+{
+    double  worst[3]    = { 0, 0, 0 };
+    double  squares[3]  = { 0, 0, 0 };
+    int     headings    = 0;
+
+    test_seed(2800);
+    for (int i = 0; i < ATTITUDES; i++)
+    {
+        double              pitch   = DEG_TO_RAD(random_in(-8000, 8000) / 100.0);
+        double              roll    = DEG_TO_RAD(random_in(-17900, 17900) / 100.0);
+        double              heading = DEG_TO_RAD(random_in(0, 35999) / 100.0);
+        OrientationFusion_t fusion;
+        Orientation_t       out;
+        int32_t             acc[3];
+        int32_t             mag[3];
+        double              error[3];
+
+        /* A new filter starts from its first sample, so one update gives the attitude */
+        attitude_to_sensors(pitch, roll, heading, acc, mag);
+        TEST_CHECK(orientation_fusion_update(&fusion, acc, mag, &out) == 0);
+
+        TEST_CHECK((out.roll >= -ORIENT_CDEG_180) && (out.roll < ORIENT_CDEG_180));
+        error[0]    = angle_error(out.pitch, RAD_TO_CDEG(pitch));
+        error[1]    = angle_error(out.roll, RAD_TO_CDEG(roll));
+        error[2]    = angle_error(out.heading, RAD_TO_CDEG(heading));
+        for (int k = 0; k < 3; k++)
+        {
+            if ((k < 2) || (cos(pitch) > HEADING_MIN_COS_PITCH))
+            {
+                worst[k]    = fmax(worst[k], error[k]);
+                squares[k] += error[k] * error[k];
+            }
+        }
+        headings   += (cos(pitch) > HEADING_MIN_COS_PITCH) ? 1 : 0;
+    }
+
+    printf("  fusion against double over %d attitudes, largest (rms) error in cdeg: pitch %.1f (%.1f), roll %.1f (%.1f), heading %.1f (%.1f)\n",
+           ATTITUDES, worst[0], sqrt(squares[0] / ATTITUDES), worst[1], sqrt(squares[1] / ATTITUDES),
+           worst[2], sqrt(squares[2] / headings));
+    TEST_CHECK(worst[0] < PITCH_ROLL_MAX_ERROR_CDEG);
+    TEST_CHECK(worst[1] < PITCH_ROLL_MAX_ERROR_CDEG);
+    TEST_CHECK(worst[2] < HEADING_MAX_ERROR_CDEG);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_fusion_hold(void)
+{
+    OrientationFusion_t fusion;
+    Orientation_t       first;
+    Orientation_t       held;
+    int32_t             acc[3];
+    int32_t             mag[3];
+    int32_t             other[3];
+
+    /* Without a new magnetometer sample the heading filter must not move */
+    attitude_to_sensors(DEG_TO_RAD(10), DEG_TO_RAD(-20), DEG_TO_RAD(135), acc, mag);
+    attitude_to_sensors(DEG_TO_RAD(10), DEG_TO_RAD(-20), DEG_TO_RAD(300), acc, other);
+    TEST_CHECK(orientation_fusion_update(&fusion, acc, mag, &first) == 0);
+    for (int i = 0; i < 20; i++)
+    {
+        TEST_CHECK(orientation_fusion_update(&fusion, acc, NULL, &held) == 0);
+    }
+    TEST_CHECK(held.heading == first.heading);
+
+    /* New samples do move it */
+    for (int i = 0; i < 40; i++)
+    {
+        TEST_CHECK(orientation_fusion_update(&fusion, acc, other, &held) == 0);
+    }
+    TEST_CHECK(angle_error(held.heading, 30000) < HEADING_MAX_ERROR_CDEG);
+
+    /* No gravity, no attitude */
+    acc[0]  = 0;
+    acc[1]  = 0;
+    acc[2]  = 0;
+    TEST_CHECK(orientation_fusion_update(&fusion, acc, mag, &held) == 0);
+    for (int i = 0; i < 40; i++)
+    {
+        orientation_fusion_update(&fusion, acc, mag, &held);
+    }
+    TEST_CHECK(orientation_fusion_update(&fusion, acc, mag, &held) == -1);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_fusion_upside_down(void)
+{
+    OrientationFusion_t fusion;
+    Orientation_t       out;
+    int32_t             acc[3];
+    int32_t             mag[3];
+
+    /* Gravity straight up the z axis is a roll of exactly 180 degrees, reported as -180 */
+    attitude_to_sensors(0, M_PI, DEG_TO_RAD(90), acc, mag);
+    TEST_CHECK((acc[1] == 0) && (acc[2] < 0));
+    TEST_CHECK(orientation_fusion_update(&fusion, acc, mag, &out) == 0);
+    TEST_CHECK(out.roll == -ORIENT_CDEG_180);
+    TEST_CHECK(out.pitch == 0);
+    TEST_CHECK(angle_error(out.heading, 9000) < HEADING_MAX_ERROR_CDEG);
+
+    /* Either side of it stays continuous across the wrap */
+    attitude_to_sensors(0, DEG_TO_RAD(179.5), 0, acc, mag);
+    TEST_CHECK(orientation_fusion_update(&fusion, acc, mag, &out) == 0);
+    TEST_CHECK(angle_error(out.roll, 17950) < PITCH_ROLL_MAX_ERROR_CDEG);
+    attitude_to_sensors(0, DEG_TO_RAD(-179.5), 0, acc, mag);
+    TEST_CHECK(orientation_fusion_update(&fusion, acc, mag, &out) == 0);
+    TEST_CHECK(angle_error(out.roll, -17950) < PITCH_ROLL_MAX_ERROR_CDEG);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void bench(void)
+{
+    static int32_t      acc[256][3];
+    static int32_t      mag[256][3];
+    OrientationFusion_t fusion;
+    Orientation_t       out;
+    int64_t             sum     = 0;
+    uint64_t            start;
+    uint64_t            atan2Cycles;
+    uint64_t            sqrtCycles;
+    uint64_t            fusionCycles;
+
+    test_seed(282);
+    for (int i = 0; i < 256; i++)
+    {
+        attitude_to_sensors(DEG_TO_RAD(random_in(-80, 80)), DEG_TO_RAD(random_in(-179, 179)), DEG_TO_RAD(random_in(0, 359)), acc[i], mag[i]);
+    }
+
+    start       = test_cycles();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        sum    += fx_atan2_cdeg(mag[i & 255][1], mag[i & 255][0]);
+    }
+    atan2Cycles = test_cycles() - start;
+
+    start       = test_cycles();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        sum    += fx_sqrt((uint64_t) (uint32_t) acc[i & 255][2] * (uint32_t) (i + 1));
+    }
+    sqrtCycles  = test_cycles() - start;
+
+    start       = test_cycles();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        orientation_fusion_update(&fusion, acc[i & 255], mag[i & 255], &out);
+        sum    += out.heading;
+    }
+    fusionCycles    = test_cycles() - start;
+    benchSink       = sum;
+
+    printf("  fx_atan2_cdeg %.1f, fx_sqrt %.1f, orientation_fusion_update %.1f %s/call\n", (double) atan2Cycles / BENCH_ROUNDS,
+           (double) sqrtCycles / BENCH_ROUNDS, (double) fusionCycles / BENCH_ROUNDS, test_cycles_unit());
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(void)
+{
+    check_atan2();
+    check_sqrt();
+    check_fusion();
+    check_fusion_hold();
+    check_fusion_upside_down();
+    bench();
+
+    return test_result("orientation_fusion_test");
+}
@@ -0,0 +1,507 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Round-trips reports through the Cayenne LPP and CBOR encoders of Network/report_codec.cpp and
+ * independent decoders, checks that a report that does not fit fails without writing past the
+ * buffer, and prints bytes per report and encode cost against the text report of dweet.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "report_codec.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define REPORTS                         (20000)
+#define BENCH_REPORTS                   (200000)
+#define REPORT_VALUES                   (10)        /* A periodic report of the manhole demo */
+#define REPORT_TEXT_MAX                 (400)
+#define REPORT_BINARY_MAX               (128)
+#define DECODED_MAX                     (64)
+#define GUARD                           (0xA5)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    channel;
+    double      value;              /* LPP: physical units of the type; CBOR: the integer */
+} Decoded_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* reportChannels of main.cpp for DEMO_DWEET_MANHOLE, with the MANHOLE_CHN_* numbers */
+static const ReportChannel_t    channels[] =
+{
+    { "TEMPERATURE",         2,  REPORT_KIND_TEMPERATURE },
+    { "HUMIDITY",            3,  REPORT_KIND_HUMIDITY },
+    { "PRESSURE",            4,  REPORT_KIND_PRESSURE },
+    { "LIGHT",               8,  REPORT_KIND_ILLUMINANCE },
+    { "DISTANCE",            9,  REPORT_KIND_DISTANCE_CM },
+    { "RSSI",                10, REPORT_KIND_ANALOG },
+    { "RSRP",                26, REPORT_KIND_ANALOG },
+    { "RSRQ",                27, REPORT_KIND_ANALOG },
+    { "PITCH",               14, REPORT_KIND_ANALOG },
+    { "ROLL",                15, REPORT_KIND_ANALOG },
+    { "HEADING",             16, REPORT_KIND_DIRECTION },
+    { "BATTERY",             17, REPORT_KIND_VOLTAGE_MV },
+    { "FLEX",                18, REPORT_KIND_VOLTAGE_MV },
+    { "EVT_LATENCY",         19, REPORT_KIND_ANALOG_MILLI },
+    { "DEGRADED",            20, REPORT_KIND_DIGITAL },
+    { "EVT_COVER_TILT",      21, REPORT_KIND_DIGITAL },
+    { "EVT_FLOOD",           22, REPORT_KIND_DIGITAL },
+    { "EVT_LIGHT_INGRESS",   23, REPORT_KIND_DIGITAL },
+    { "EVT_MAG_DISTURBANCE", 24, REPORT_KIND_DIGITAL },
+    { "QUEUED",              25, REPORT_KIND_DIGITAL },
+};
+
+#define CHANNEL_COUNT                   ((uint32_t) (sizeof(channels) / sizeof(channels[0])))
+
+/* The values of a periodic report, in the order main.cpp writes them, and their usual range */
+static const struct
+{
+    const char* key;
+    int32_t     min;
+    int32_t     max;
+} periodic[REPORT_VALUES] =
+{
+    { "TEMPERATURE",    -20,    45 },
+    { "HUMIDITY",       10,     100 },
+    { "PRESSURE",       950,    1050 },
+    { "LIGHT",          0,      2000 },
+    { "DISTANCE",       20,     300 },
+    { "RSSI",           -113,   -51 },
+    { "PITCH",          -90,    90 },
+    { "ROLL",           -180,   180 },
+    { "HEADING",        0,      359 },
+    { "BATTERY",        3000,   4200 },
+};
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static int32_t rand_range(
+    int32_t     aMin,
+    int32_t     aMax)
+{
+    return aMin + (int32_t) (test_rand() % (uint32_t) (aMax - aMin + 1));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static const ReportChannel_t* find_channel(
+    const char* aKey)
+{
+    for (uint32_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if (0 == strcmp(channels[i].key, aKey))
+        {
+            return &channels[i];
+        }
+    }
+    return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int32_t clamp(
+    int32_t     aValue,
+    int32_t     aMin,
+    int32_t     aMax)
+{
+    return (aValue < aMin) ? aMin : ((aValue > aMax) ? aMax : aValue);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The value an LPP decoder should show for aValue of the text report, in the units of the LPP type */
+static double lpp_expected(
+    uint8_t     aKind,
+    int32_t     aValue)
+{
+    switch (aKind)
+    {
+        case REPORT_KIND_DIGITAL:       return clamp(aValue, 0, 255);
+        case REPORT_KIND_ANALOG:        return clamp(aValue, -327, 327);
+        case REPORT_KIND_ANALOG_MILLI:  return clamp(aValue / 10, -32768, 32767) * 0.01;
+        case REPORT_KIND_TEMPERATURE:   return clamp(aValue, -3276, 3276);
+        case REPORT_KIND_HUMIDITY:      return clamp(aValue, 0, 127);
+        case REPORT_KIND_PRESSURE:      return clamp(aValue, 0, 6553);
+        case REPORT_KIND_ILLUMINANCE:   return clamp(aValue, 0, 65535);
+        case REPORT_KIND_VOLTAGE_MV:    return clamp(aValue / 10, 0, 65535) * 0.01;
+        case REPORT_KIND_DISTANCE_CM:   return clamp(aValue, 0, INT32_MAX / 10) * 0.01;
+        case REPORT_KIND_DIRECTION:     return clamp(aValue, 0, 65535);
+        default:                        return NAN;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Cayenne LPP as the Cayenne documentation and the extended type list define it.
+ *
+ * @return Values decoded, -1 for an unknown type or a truncated value.
+ */
+static int lpp_decode(
+    const uint8_t*  aBuf,
+    int             aLen,
+    Decoded_t*      aOut)
+{
+    int     count   = 0;
+    int     pos     = 0;
+
+    while (pos < aLen)
+    {
+        uint32_t    bytes;
+        bool        isSigned    = false;
+        double      scale;
+        uint32_t    raw         = 0;
+
+        if (pos + 2 > aLen || count == DECODED_MAX)
+        {
+            return -1;
+        }
+        switch (aBuf[pos + 1])
+        {
+            case 0:     bytes = 1; scale = 1;                       break;  /* Digital input */
+            case 2:     bytes = 2; scale = 0.01; isSigned = true;   break;  /* Analog input */
+            case 101:   bytes = 2; scale = 1;                       break;  /* Illuminance, lux */
+            case 103:   bytes = 2; scale = 0.1; isSigned = true;    break;  /* Temperature, degC */
+            case 104:   bytes = 1; scale = 0.5;                     break;  /* Humidity, % */
+            case 115:   bytes = 2; scale = 0.1;                     break;  /* Barometer, hPa */
+            case 116:   bytes = 2; scale = 0.01;                    break;  /* Voltage, V */
+            case 130:   bytes = 4; scale = 0.001;                   break;  /* Distance, m */
+            case 132:   bytes = 2; scale = 1;                       break;  /* Direction, deg */
+            default:    return -1;
+        }
+        if (pos + 2 + (int) bytes > aLen)
+        {
+            return -1;
+        }
+        for (uint32_t i = 0; i < bytes; i++)
+        {
+            raw = (raw << 8) | aBuf[pos + 2 + i];
+        }
+        aOut[count].channel = aBuf[pos];
+        aOut[count].value   = (isSigned && 2 == bytes) ? (int16_t) raw * scale : raw * scale;
+        count++;
+        pos    += 2 + bytes;
+    }
+    return count;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* One CBOR head, -1 when it is truncated or not major type aMajor */
+static int cbor_item(
+    const uint8_t*  aBuf,
+    int             aLen,
+    int*            aPos,
+    uint8_t*        aMajor,
+    uint64_t*       aArg)
+{
+    uint8_t     info;
+    uint32_t    bytes;
+
+    if (*aPos >= aLen)
+    {
+        return -1;
+    }
+    *aMajor = aBuf[*aPos] >> 5;
+    info    = aBuf[*aPos] & 0x1F;
+    (*aPos)++;
+    if (info < 24)
+    {
+        *aArg   = info;
+        return 0;
+    }
+    if (info > 27)
+    {
+        return -1;
+    }
+    bytes   = 1u << (info - 24);
+    if (*aPos + (int) bytes > aLen)
+    {
+        return -1;
+    }
+    *aArg   = 0;
+    for (uint32_t i = 0; i < bytes; i++)
+    {
+        *aArg   = (*aArg << 8) | aBuf[(*aPos)++];
+    }
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A map of unsigned keys to integers, @return Entries decoded, -1 when it is anything else */
+static int cbor_decode(
+    const uint8_t*  aBuf,
+    int             aLen,
+    Decoded_t*      aOut)
+{
+    int         pos     = 0;
+    uint8_t     major;
+    uint64_t    entries;
+    uint64_t    arg;
+
+    if (0 != cbor_item(aBuf, aLen, &pos, &major, &entries) || 5 != major || entries > DECODED_MAX)
+    {
+        return -1;
+    }
+    for (uint64_t i = 0; i < entries; i++)
+    {
+        if (0 != cbor_item(aBuf, aLen, &pos, &major, &arg) || 0 != major)
+        {
+            return -1;
+        }
+        aOut[i].channel = (uint32_t) arg;
+        if (0 != cbor_item(aBuf, aLen, &pos, &major, &arg) || major > 1)
+        {
+            return -1;
+        }
+        aOut[i].value   = (0 == major) ? (double) arg : -1.0 - (double) arg;
+    }
+    return (pos == aLen) ? (int) entries : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A text report of random values, as main.cpp writes it; aValues gets the values in order */
+static int make_report(
+    char*       aText,
+    int32_t     aValues[REPORT_VALUES],
+    bool        aWide)
+{
+    int     len = 0;
+
+    for (int i = 0; i < REPORT_VALUES; i++)
+    {
+        aValues[i]  = aWide ? rand_range(-100000, 100000) : rand_range(periodic[i].min, periodic[i].max);
+        len        += sprintf(aText + len, "%s=%d&", periodic[i].key, (int) aValues[i]);
+    }
+    /* Keys without a channel are skipped */
+    len    += sprintf(aText + len, "ORIENTATION_X=%d", (int) rand_range(-1000, 1000));
+    return len;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_round_trips(
+    bool        aWide)
+{
+    char        text[REPORT_TEXT_MAX];
+    uint8_t     buf[REPORT_BINARY_MAX];
+    Decoded_t   decoded[DECODED_MAX];
+    int32_t     values[REPORT_VALUES];
+    uint32_t    lppMismatch     = 0;
+    uint32_t    cborMismatch    = 0;
+
+    for (int r = 0; r < REPORTS; r++)
+    {
+        int     len;
+        int     count;
+
+        make_report(text, values, aWide);
+
+        len     = report_encode_text(&reportFormatLpp, channels, CHANNEL_COUNT, text, buf, sizeof(buf));
+        count   = lpp_decode(buf, len, decoded);
+        TEST_CHECK(count == REPORT_VALUES);
+        for (int i = 0; i < count && i < REPORT_VALUES; i++)
+        {
+            const ReportChannel_t*  channel = find_channel(periodic[i].key);
+            double                  expect  = lpp_expected(channel->kind, values[i]);
+
+            lppMismatch    += (decoded[i].channel != channel->channel || fabs(decoded[i].value - expect) > 1e-6 * (1 + fabs(expect)));
+        }
+
+        len     = report_encode_text(&reportFormatCbor, channels, CHANNEL_COUNT, text, buf, sizeof(buf));
+        count   = cbor_decode(buf, len, decoded);
+        TEST_CHECK(count == REPORT_VALUES);
+        for (int i = 0; i < count && i < REPORT_VALUES; i++)
+        {
+            cborMismatch   += (decoded[i].channel != find_channel(periodic[i].key)->channel || decoded[i].value != values[i]);
+        }
+    }
+    printf("  %d %s reports: %u LPP and %u CBOR values decoded differently\n", REPORTS, aWide ? "out of range" : "typical",
+           lppMismatch, cborMismatch);
+    TEST_CHECK(lppMismatch == 0);
+    TEST_CHECK(cborMismatch == 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Maps of more than 23 entries need a longer head, and every integer width has to come back */
+static void check_cbor_widths(void)
+{
+    static const int32_t    edges[] =
+    {
+        0, 1, 23, 24, 255, 256, 65535, 65536, INT32_MAX, -1, -24, -25, -256, -257, -65536, -65537, INT32_MIN
+    };
+    ReportEncoder_t         encoder;
+    ReportChannel_t         channel = { "X", 0, REPORT_KIND_ANALOG };
+    uint8_t                 buf[512];
+    Decoded_t               decoded[DECODED_MAX];
+    int32_t                 values[40];
+    int                     len;
+
+    for (int entries = 0; entries < 40; entries++)
+    {
+        TEST_CHECK(report_encoder_begin(&encoder, &reportFormatCbor, buf, sizeof(buf)) == 0);
+        for (int i = 0; i < entries; i++)
+        {
+            channel.channel = (uint8_t) (i * 6);
+            values[i]       = edges[(i + entries) % (sizeof(edges) / sizeof(edges[0]))];
+            TEST_CHECK(report_encoder_add(&encoder, &channel, values[i]) == 0);
+        }
+        len = report_encoder_end(&encoder);
+        TEST_CHECK(cbor_decode(buf, len, decoded) == entries);
+        for (int i = 0; i < entries; i++)
+        {
+            TEST_CHECK(decoded[i].channel == (uint32_t) (i * 6) && decoded[i].value == values[i]);
+        }
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Every buffer shorter than the report fails, and nothing is written past it */
+static void check_overflow(
+    const ReportFormat_t*   aFormat)
+{
+    char        text[REPORT_TEXT_MAX];
+    uint8_t     buf[REPORT_BINARY_MAX + 8];
+    int32_t     values[REPORT_VALUES];
+    int         full;
+
+    for (int r = 0; r < 200; r++)
+    {
+        make_report(text, values, (r & 1) != 0);
+        full    = report_encode_text(aFormat, channels, CHANNEL_COUNT, text, buf, REPORT_BINARY_MAX);
+        TEST_CHECK(full > 0);
+        for (int size = 0; size < full; size++)
+        {
+            bool    intact  = true;
+
+            memset(buf, GUARD, sizeof(buf));
+            TEST_CHECK(report_encode_text(aFormat, channels, CHANNEL_COUNT, text, buf, size) == -1);
+            for (uint32_t i = size; i < sizeof(buf); i++)
+            {
+                intact &= (GUARD == buf[i]);
+            }
+            TEST_CHECK(intact);
+        }
+        TEST_CHECK(report_encode_text(aFormat, channels, CHANNEL_COUNT, text, buf, full) == full);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void bench(void)
+{
+    static char     texts[64][REPORT_TEXT_MAX];
+    static int32_t  values[64][REPORT_VALUES];
+    char            text[REPORT_TEXT_MAX];
+    uint8_t         buf[REPORT_BINARY_MAX];
+    uint64_t        bytes[3]    = { 0, 0, 0 };
+    uint64_t        cycles[3];
+    uint64_t        start;
+    uint32_t        sum         = 0;
+
+    for (int i = 0; i < 64; i++)
+    {
+        make_report(texts[i], values[i], false);
+        bytes[0]   += strstr(texts[i], "ORIENTATION_X=") - texts[i];
+        bytes[1]   += report_encode_text(&reportFormatLpp, channels, CHANNEL_COUNT, texts[i], buf, sizeof(buf));
+        bytes[2]   += report_encode_text(&reportFormatCbor, channels, CHANNEL_COUNT, texts[i], buf, sizeof(buf));
+    }
+
+    /* The text report as main.cpp writes it */
+    start   = test_cycles();
+    for (int r = 0; r < BENCH_REPORTS; r++)
+    {
+        const int32_t*  v   = values[r & 63];
+        int             len = 0;
+
+        for (int i = 0; i < REPORT_VALUES; i++)
+        {
+            len    += sprintf(text + len, "%s=%d&", periodic[i].key, (int) v[i]);
+        }
+        sum    += len + text[len / 2];
+    }
+    cycles[0]   = test_cycles() - start;
+
+    for (int f = 1; f < 3; f++)
+    {
+        const ReportFormat_t*   format  = (1 == f) ? &reportFormatLpp : &reportFormatCbor;
+
+        start   = test_cycles();
+        for (int r = 0; r < BENCH_REPORTS; r++)
+        {
+            sum    += report_encode_text(format, channels, CHANNEL_COUNT, texts[r & 63], buf, sizeof(buf)) + buf[3];
+        }
+        cycles[f]   = test_cycles() - start;
+    }
+
+    printf("  %d-value report: text %.1f bytes, %.0f %s to print; LPP %.1f bytes, CBOR %.1f bytes, %.0f and %.0f %s to encode "
+           "from the text (checksum %u)\n",
+           REPORT_VALUES, bytes[0] / 64.0, (double) cycles[0] / BENCH_REPORTS, test_cycles_unit(), bytes[1] / 64.0, bytes[2] / 64.0,
+           (double) cycles[1] / BENCH_REPORTS, (double) cycles[2] / BENCH_REPORTS, test_cycles_unit(), sum);
+    TEST_CHECK(bytes[1] < bytes[0] / 2);
+    TEST_CHECK(bytes[2] < bytes[1]);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(void)
+{
+    test_seed(42);
+
+    check_round_trips(false);
+    check_round_trips(true);
+    check_cbor_widths();
+    check_overflow(&reportFormatLpp);
+    check_overflow(&reportFormatCbor);
+    bench();
+
+    return test_result("report_codec_test");
+}
@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks Network/report_ring.cpp: order across the wrap of the slots and of the counters, a
+ * drop of the oldest report while the consumer is copying it, the coalescing of reports that
+ * find the ring full, and a producer and a consumer thread racing on a small ring.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mbed.h"
+#include "host_test.h"
+
+/* The ring is built into this test with its compare-and-swap routed through ring_cas(), so a
+ * test can run the producer between the copy of a report and the consumer taking it. */
+static bool ring_cas(volatile uint32_t* aPtr, uint32_t* aExpected, uint32_t aDesired);
+#define core_util_atomic_cas_u32        ring_cas
+#include "report_ring.cpp"
+#undef core_util_atomic_cas_u32
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define SLOT_SIZE                       (64)
+#define SLOT_COUNT                      (4)
+#define REPORT_MAX                      (SLOT_SIZE - 1)
+
+#define RACE_SLOT_COUNT                 (4)
+#define RACE_REPORTS                    (2000000)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* A ring with its storage */
+typedef struct
+{
+    ReportRing_t        ring;
+    ReportRingSlot_t    slots[SLOT_COUNT];
+    char                data[SLOT_COUNT * SLOT_SIZE];
+    char                staging[2 * SLOT_SIZE];
+} TestRing_t;
+
+/* What the consumer thread of the race saw */
+typedef struct
+{
+    ReportRing_t*   ring;
+    volatile bool   done;
+    uint32_t        popped;
+    uint32_t        torn;               /* Reports that do not match their sequence number */
+    uint32_t        reordered;
+    uint32_t        lastSeq;
+} RaceConsumer_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Run once by the next ring_cas(), before the swap */
+static void                 (*casHook)(void);
+static ReportRing_t*        casHookRing;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static bool ring_cas(
+    volatile uint32_t*  aPtr,
+    uint32_t*           aExpected,
+    uint32_t            aDesired)
+{
+    void    (*hook)(void)   = casHook;
+
+    if (NULL != hook)
+    {
+        casHook = NULL;
+        hook();
+    }
+    return __atomic_compare_exchange_n(aPtr, aExpected, aDesired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void test_ring_init(
+    TestRing_t*         aRing,
+    ReportRingPolicy_e  aPolicy)
+{
+    memset(aRing, 0, sizeof(*aRing));
+    report_ring_init(&aRing->ring, aRing->slots, aRing->data, SLOT_SIZE, SLOT_COUNT, aPolicy,
+                     (REPORT_RING_COALESCE == aPolicy) ? aRing->staging : NULL);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A report whose content and length follow from aSeq, so a torn copy shows */
+static void race_report(
+    char*       aBuf,
+    uint32_t    aSeq)
+{
+    int     len = sprintf(aBuf, "SEQ=%u&PAD=", (unsigned) aSeq);
+    int     pad = (int) (aSeq % (REPORT_MAX - 24));
+
+    memset(aBuf + len, 'a' + (char) (aSeq % 26), pad);
+    aBuf[len + pad] = '\0';
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_wrap(void)
+{
+    TestRing_t  ring;
+    char        report[SLOT_SIZE];
+    char        expected[SLOT_SIZE];
+    char        longReport[SLOT_SIZE + 1];
+    bool        urgent;
+    uint32_t    timeMs;
+    uint32_t    next    = 0;
+
+    /* Ten times round the slots, with the ring anywhere from empty to full */
+    test_ring_init(&ring, REPORT_RING_DROP_OLDEST);
+    for (uint32_t seq = 0; seq < 10 * SLOT_COUNT; seq++)
+    {
+        race_report(report, seq);
+        TEST_CHECK(report_ring_push(&ring.ring, report, 0 == seq % 3, seq * 1000) == 0);
+        while ((ring.ring.head - ring.ring.tail) > seq % SLOT_COUNT)
+        {
+            race_report(expected, next);
+            TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == (int) strlen(expected));
+            TEST_CHECK(0 == strcmp(report, expected));
+            TEST_CHECK(urgent == (0 == next % 3) && timeMs == next * 1000);
+            next++;
+        }
+    }
+    while (report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0)
+    {
+        race_report(expected, next++);
+        TEST_CHECK(0 == strcmp(report, expected));
+    }
+    TEST_CHECK(next == 10 * SLOT_COUNT);
+    TEST_CHECK(ring.ring.pushed == next && ring.ring.popped == next && ring.ring.dropped == 0);
+
+    /* The counters wrap at 2^32, the free space is still head - tail */
+    test_ring_init(&ring, REPORT_RING_DROP_OLDEST);
+    ring.ring.head  = 0xFFFFFFFE;
+    ring.ring.tail  = 0xFFFFFFFE;
+    for (uint32_t seq = 0; seq < SLOT_COUNT; seq++)
+    {
+        race_report(report, seq);
+        TEST_CHECK(report_ring_push(&ring.ring, report, false, 0) == 0);
+    }
+    TEST_CHECK(ring.ring.head == 2);
+    TEST_CHECK(report_ring_push(&ring.ring, "FULL=1", false, 0) == 1);
+    TEST_CHECK(ring.ring.dropped == 1);
+    for (uint32_t seq = 1; seq < SLOT_COUNT; seq++)
+    {
+        race_report(expected, seq);
+        TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+        TEST_CHECK(0 == strcmp(report, expected));
+    }
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == 6);
+    TEST_CHECK(0 == strcmp(report, "FULL=1"));
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == -1);
+
+    /* A report that does not fit a slot with its terminator is refused, a short buffer gets a
+     * truncated copy */
+    memset(longReport, 'x', SLOT_SIZE);
+    longReport[SLOT_SIZE]   = '\0';
+    TEST_CHECK(report_ring_push(&ring.ring, longReport, false, 0) == -1);
+    TEST_CHECK(report_ring_push(&ring.ring, longReport + 1, false, 0) == 0);
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == REPORT_MAX);
+    TEST_CHECK(report_ring_push(&ring.ring, "A=12345", false, 0) == 0);
+    TEST_CHECK(report_ring_pop(&ring.ring, report, 4, &urgent, &timeMs) == 3);
+    TEST_CHECK(0 == strcmp(report, "A=1"));
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The producer, while the consumer holds its copy of report 0 */
+static void push_over_oldest(void)
+{
+    TEST_CHECK(report_ring_push(casHookRing, "LATE=1&PAD=bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb", true, 4000) == 1);
+}
+
+static void check_drop_while_copying(void)
+{
+    TestRing_t  ring;
+    char        report[SLOT_SIZE];
+    char        expected[SLOT_SIZE];
+    bool        urgent;
+    uint32_t    timeMs;
+
+    test_ring_init(&ring, REPORT_RING_DROP_OLDEST);
+    for (uint32_t seq = 0; seq < SLOT_COUNT; seq++)
+    {
+        race_report(report, seq);
+        TEST_CHECK(report_ring_push(&ring.ring, report, false, seq * 1000) == 0);
+    }
+
+    /* The consumer copies report 0, then the producer drops it and writes the new report into
+     * its slot before the consumer can take it: the copy is thrown away and report 1 is next */
+    casHook     = push_over_oldest;
+    casHookRing = &ring.ring;
+    race_report(expected, 1);
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == (int) strlen(expected));
+    TEST_CHECK(0 == strcmp(report, expected) && 1000 == timeMs && !urgent);
+    TEST_CHECK(NULL == casHook);
+    TEST_CHECK(ring.ring.dropped == 1 && ring.ring.discarded == 1 && ring.ring.popped == 1);
+
+    for (uint32_t seq = 2; seq < SLOT_COUNT; seq++)
+    {
+        race_report(expected, seq);
+        TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+        TEST_CHECK(0 == strcmp(report, expected));
+    }
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+    TEST_CHECK(0 == strncmp(report, "LATE=1&", 7) && urgent && 4000 == timeMs);
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == -1);
+    TEST_CHECK(ring.ring.pushed == SLOT_COUNT + 1 && ring.ring.popped == SLOT_COUNT);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The consumer takes the oldest report just before the producer would drop it */
+static void pop_oldest(void)
+{
+    char        report[SLOT_SIZE];
+    bool        urgent;
+    uint32_t    timeMs;
+
+    TEST_CHECK(report_ring_pop(casHookRing, report, sizeof(report), &urgent, &timeMs) >= 0);
+    TEST_CHECK(0 == strcmp(report, "N=0"));
+}
+
+static void check_pop_while_dropping(void)
+{
+    TestRing_t  ring;
+    char        report[SLOT_SIZE];
+    bool        urgent;
+    uint32_t    timeMs;
+
+    test_ring_init(&ring, REPORT_RING_DROP_OLDEST);
+    for (uint32_t seq = 0; seq < SLOT_COUNT; seq++)
+    {
+        sprintf(report, "N=%u", (unsigned) seq);
+        report_ring_push(&ring.ring, report, false, 0);
+    }
+
+    /* The drop loses its CAS, there is room anyway and nothing is dropped */
+    casHook     = pop_oldest;
+    casHookRing = &ring.ring;
+    TEST_CHECK(report_ring_push(&ring.ring, "N=4", false, 0) == 1);
+    TEST_CHECK(ring.ring.dropped == 0 && ring.ring.popped == 1 && ring.ring.pushed == SLOT_COUNT + 1);
+    for (uint32_t seq = 1; seq <= SLOT_COUNT; seq++)
+    {
+        char    expected[8];
+
+        sprintf(expected, "N=%u", (unsigned) seq);
+        TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+        TEST_CHECK(0 == strcmp(report, expected));
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_coalesce(void)
+{
+    TestRing_t  ring;
+    char        report[SLOT_SIZE];
+    char        longReport[SLOT_SIZE];
+    bool        urgent;
+    uint32_t    timeMs;
+
+    test_ring_init(&ring, REPORT_RING_COALESCE);
+    for (uint32_t seq = 0; seq < SLOT_COUNT; seq++)
+    {
+        sprintf(report, "N=%u", (unsigned) seq);
+        TEST_CHECK(report_ring_push(&ring.ring, report, false, seq) == 0);
+    }
+
+    /* Nothing is dropped, reports that find the ring full are merged per key */
+    TEST_CHECK(report_ring_push(&ring.ring, "A=1&B=2", false, 100) == 1);
+    TEST_CHECK(0 == strcmp(ring.ring.staging, "A=1&B=2"));
+    TEST_CHECK(report_ring_push(&ring.ring, "B=33&C=4", false, 200) == 1);
+    TEST_CHECK(0 == strcmp(ring.ring.staging, "A=1&B=33&C=4"));
+    TEST_CHECK(report_ring_push(&ring.ring, "B=5&EVT=OPEN", true, 300) == 1);
+    TEST_CHECK(0 == strcmp(ring.ring.staging, "A=1&B=5&C=4&EVT=OPEN"));
+    TEST_CHECK(ring.ring.coalesced == 3 && ring.ring.dropped == 0);
+    TEST_CHECK(ring.ring.stagingSlot.urgent && 100 == ring.ring.stagingSlot.timeMs);
+
+    /* A merge that does not fit loses the new report and leaves the staged one as it was */
+    memset(longReport, 'x', REPORT_MAX);
+    memcpy(longReport, "D=", 2);
+    longReport[REPORT_MAX - 20] = '\0';
+    TEST_CHECK(report_ring_push(&ring.ring, longReport, false, 400) == 1);
+    TEST_CHECK(ring.ring.dropped == 1 && ring.ring.coalesced == 3);
+    TEST_CHECK(0 == strcmp(ring.ring.staging, "A=1&B=5&C=4&EVT=OPEN"));
+
+    /* flush() does nothing while the ring is full */
+    report_ring_flush(&ring.ring);
+    TEST_CHECK(0 == strcmp(ring.ring.staging, "A=1&B=5&C=4&EVT=OPEN"));
+
+    /* Once there is room the staged report goes in behind the others, urgent as one of its parts */
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+    TEST_CHECK(0 == strcmp(report, "N=0"));
+    report_ring_flush(&ring.ring);
+    TEST_CHECK('\0' == ring.ring.staging[0]);
+    report_ring_flush(&ring.ring);
+    TEST_CHECK(ring.ring.head - ring.ring.tail == SLOT_COUNT);
+    for (uint32_t seq = 1; seq < SLOT_COUNT; seq++)
+    {
+        TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+        TEST_CHECK(!urgent && timeMs == seq);
+    }
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == 20);
+    TEST_CHECK(0 == strcmp(report, "A=1&B=5&C=4&EVT=OPEN") && urgent && 100 == timeMs);
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == -1);
+
+    /* A push with room sends the staged report first, so the order of the values holds */
+    for (uint32_t seq = 0; seq < SLOT_COUNT; seq++)
+    {
+        report_ring_push(&ring.ring, "N=9", false, 0);
+    }
+    TEST_CHECK(report_ring_push(&ring.ring, "B=6", false, 500) == 1);
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+    TEST_CHECK(report_ring_push(&ring.ring, "B=7", false, 600) == 1);
+    TEST_CHECK(0 == strcmp(ring.ring.staging, "B=7"));
+    for (uint32_t seq = 1; seq < SLOT_COUNT; seq++)
+    {
+        TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+    }
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+    TEST_CHECK(0 == strcmp(report, "B=6"));
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) == -1);
+    report_ring_flush(&ring.ring);
+    TEST_CHECK(report_ring_pop(&ring.ring, report, sizeof(report), &urgent, &timeMs) >= 0);
+    TEST_CHECK(0 == strcmp(report, "B=7") && 600 == timeMs);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void* race_consume(
+    void*       aArg)
+{
+    RaceConsumer_t* consumer    = (RaceConsumer_t*) aArg;
+    char            report[SLOT_SIZE];
+    char            expected[SLOT_SIZE];
+    bool            urgent;
+    uint32_t        timeMs;
+    bool            last        = false;
+
+    while (!last)
+    {
+        last    = consumer->done;
+        while (report_ring_pop(consumer->ring, report, sizeof(report), &urgent, &timeMs) >= 0)
+        {
+            race_report(expected, timeMs);
+            consumer->torn         += (0 != strcmp(report, expected)) ? 1 : 0;
+            consumer->reordered    += (consumer->popped > 0 && timeMs <= consumer->lastSeq) ? 1 : 0;
+            consumer->lastSeq       = timeMs;
+            consumer->popped++;
+        }
+    }
+    return NULL;
+}
+
+/* The real thing: one thread pushes as fast as it can, the other pops, on a ring that is full
+ * most of the time, so drops and discarded copies happen on their own */
+static void check_race(void)
+{
+    static ReportRingSlot_t slots[RACE_SLOT_COUNT];
+    static char             data[RACE_SLOT_COUNT * SLOT_SIZE];
+    ReportRing_t            ring;
+    RaceConsumer_t          consumer;
+    pthread_t               thread;
+    char                    report[SLOT_SIZE];
+    uint64_t                start;
+
+    report_ring_init(&ring, slots, data, SLOT_SIZE, RACE_SLOT_COUNT, REPORT_RING_DROP_OLDEST, NULL);
+    memset(&consumer, 0, sizeof(consumer));
+    consumer.ring   = &ring;
+
+    start   = test_now_ns();
+    TEST_CHECK(pthread_create(&thread, NULL, race_consume, &consumer) == 0);
+    for (uint32_t seq = 0; seq < RACE_REPORTS; seq++)
+    {
+        race_report(report, seq);
+        report_ring_push(&ring, report, false, seq);
+    }
+    consumer.done   = true;
+    pthread_join(thread, NULL);
+
+    printf("  %u reports through %u slots from two threads in %.0f ms: %u popped, %u dropped, %u copies discarded\n",
+           (unsigned) RACE_REPORTS, (unsigned) RACE_SLOT_COUNT, (test_now_ns() - start) / 1e6, (unsigned) consumer.popped,
+           (unsigned) ring.dropped, (unsigned) ring.discarded);
+    TEST_CHECK(consumer.torn == 0);
+    TEST_CHECK(consumer.reordered == 0);
+    TEST_CHECK(ring.pushed == RACE_REPORTS);
+    TEST_CHECK(consumer.popped == ring.popped);
+    TEST_CHECK(ring.popped + ring.dropped == RACE_REPORTS);
+    TEST_CHECK(consumer.lastSeq == RACE_REPORTS - 1);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(void)
+{
+    check_wrap();
+    check_drop_while_copying();
+    check_pop_while_dropping();
+    check_coalesce();
+    check_race();
+
+    return test_result("report_ring_test");
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks the filter kernels against plain references, prints their cost per sample, and replays
+ * a noisy host/traces/manhole.csv through change detection with and without the filter stage of
+ * main.cpp to count the uplinks it saves.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "change_detect.h"
+#include "sensor_filters.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define BENCH_SAMPLES                   (1000000)
+
+#define CHANNELS                        (5)
+#define CHN_TEMPERATURE                 (0)
+#define CHN_PRESSURE                    (1)
+#define CHN_HUMIDITY                    (2)
+#define CHN_LIGHT                       (3)
+#define CHN_DIST                        (4)
+
+#define SAMPLE_PERIOD_MS                (2000)
+#define SAMPLES_PER_REPORT              (5)
+#define SPIKE_PER_MILLE                 (20)    /* Glitches of the light and distance sensors */
+#define SPIKE_SIZE                      (200)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    int         reports;
+    int         channelReports[CHANNELS];
+    int32_t     distAfterFlood;     /* Distance reported last while the trace holds the water at 70 cm */
+} Replay_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* The deadbands main.cpp uses for these channels */
+static const ChangeDetectChannel_t  channels[CHANNELS] =
+{
+    { CHN_TEMPERATURE,  0, CD_FLAG_REPORT_INITIAL, 0, 1,  0, 0, 0 },
+    { CHN_PRESSURE,     0, CD_FLAG_REPORT_INITIAL, 0, 1,  0, 0, 0 },
+    { CHN_HUMIDITY,     0, CD_FLAG_REPORT_INITIAL, 0, 1,  0, 0, 0 },
+    { CHN_LIGHT,        1, CD_FLAG_REPORT_INITIAL, 0, 10, 0, 0, 0 },
+    { CHN_DIST,         2, CD_FLAG_REPORT_INITIAL, 0, 10, 0, 0, 0 },
+};
+
+static const char*  traceColumns[CHANNELS]  = { "temp_c", "press_hpa", "hum_pct", "lux", "dist_cm" };
+static const int    traceNoise[CHANNELS]    = { 1, 1, 2, 15, 8 };
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static int compare_int32(
+    const void* aA,
+    const void* aB)
+{
+    int32_t     a   = *(const int32_t*) aA;
+    int32_t     b   = *(const int32_t*) aB;
+
+    return (a > b) - (a < b);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+template <int N>
+static void check_median(void)
+{
+    MedianFilter<N> filter;
+    int32_t         history[N];
+    int             mismatches  = 0;
+
+    test_seed(N);
+    for (int i = 0; i < 20000; i++)
+    {
+        int32_t     in      = (int32_t) (test_rand() % 2001) - 1000;
+        int         count   = (i + 1 < N) ? i + 1 : N;
+        int32_t     window[N];
+        int32_t     out;
+
+        history[i % N]  = in;
+        for (int k = 0; k < count; k++)
+        {
+            window[k]   = history[(i - k) % N];
+        }
+        qsort(window, count, sizeof(int32_t), compare_int32);
+
+        TEST_CHECK(filter.update(in, &out));
+        mismatches     += (out != window[(count - 1) / 2]) ? 1 : 0;
+    }
+    TEST_CHECK(mismatches == 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+template <int SHIFT>
+static void check_ema(void)
+{
+    EmaFilter<SHIFT>    filter;
+    double              reference   = 0;
+    double              worst       = 0;
+
+    test_seed(100 + SHIFT);
+    for (int i = 0; i < 20000; i++)
+    {
+        int32_t     in  = (int32_t) (test_rand() % 20001) - 10000;
+        int32_t     out;
+
+        reference   = (i == 0) ? in : reference + (in - reference) / (1 << SHIFT);
+        filter.update(in, &out);
+        worst       = fmax(worst, fabs(out - reference));
+    }
+    /* Q8 keeps the truncation of every step below 1/256, it adds up to less than one count */
+    TEST_CHECK(worst < 1.0);
+    printf("  EmaFilter<%d>: largest error against double %.3f\n", SHIFT, worst);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+template <int N>
+static void check_decimator(void)
+{
+    BoxDecimator<N> filter;
+    int64_t         sum     = 0;
+    int             outputs = 0;
+
+    test_seed(200 + N);
+    for (int i = 1; i <= 1000 * N; i++)
+    {
+        int32_t     in  = (int32_t) (test_rand() % 20001) - 10000;
+        int32_t     out;
+        bool        ready;
+
+        sum    += in;
+        ready   = filter.update(in, &out);
+        TEST_CHECK(ready == ((i % N) == 0));
+        if (ready)
+        {
+            TEST_CHECK(out == (int32_t) lround((double) sum / N));
+            sum     = 0;
+            outputs++;
+        }
+    }
+    TEST_CHECK(outputs == 1000);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+template <typename FILTER>
+static void bench(
+    const char* aName)
+{
+    static int32_t  input[4096];
+    FILTER          filter;
+    int64_t         sum     = 0;
+    uint64_t        start;
+    uint64_t        cycles;
+
+    test_seed(7);
+    for (unsigned i = 0; i < sizeof(input) / sizeof(input[0]); i++)
+    {
+        input[i]    = (int32_t) (test_rand() % 2001) - 1000;
+    }
+
+    start   = test_cycles();
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        int32_t     out;
+
+        if (filter.update(input[i & 4095], &out))
+        {
+            sum    += out;
+        }
+    }
+    cycles  = test_cycles() - start;
+
+    printf("  %-44s %6.1f %s/sample (checksum %lld)\n", aName, (double) cycles / BENCH_SAMPLES, test_cycles_unit(), (long long) sum);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The filter stage of main.cpp: a decimator leaves its channel out until it has an output */
+template <typename FILTER>
+static void filter_channel(
+    FILTER&     aFilter,
+    int         aIdx,
+    int32_t     aVal[],
+    uint32_t*   aValid)
+{
+    if ((*aValid & (1UL << aIdx)) && (false == aFilter.update(aVal[aIdx], &aVal[aIdx])))
+    {
+        *aValid    &= ~(1UL << aIdx);
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static Replay_t replay(
+    const TestTrace_t*  aTrace,
+    bool                aFiltered)
+{
+    BoxDecimator<4>                             envFilter[3];
+    FilterChain<MedianFilter<3>, EmaFilter<1> > lightFilter;
+    MedianFilter<5>                             distFilter;
+    ChangeDetect_t                              cd;
+    Replay_t                                    result  = {};
+    int                                         column[CHANNELS];
+    int                                         sample  = 0;
+
+    TEST_CHECK(change_detect_init(&cd, channels, CHANNELS, 0) == 0);
+    for (int i = 0; i < CHANNELS; i++)
+    {
+        column[i]   = test_trace_column(aTrace, traceColumns[i]);
+        TEST_CHECK(column[i] > 0);
+    }
+
+    /* Same noise and glitches for both runs */
+    test_seed(27);
+    for (uint32_t nowMs = 0; nowMs <= (uint32_t) (test_trace_end(aTrace) * 1000) + 60000; nowMs += SAMPLE_PERIOD_MS)
+    {
+        int32_t     val[CHANNELS];
+        uint32_t    valid   = 0;
+        uint32_t    due;
+
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            float   value   = test_trace_at(aTrace, column[i], nowMs / 1000.0f);
+            int32_t noise   = (int32_t) (test_rand() % (2 * traceNoise[i] + 1)) - traceNoise[i];
+            bool    spike   = (i >= CHN_LIGHT) && ((test_rand() % 1000) < SPIKE_PER_MILLE);
+
+            val[i]  = isnan(value) ? 0 : (int32_t) value + noise + (spike ? SPIKE_SIZE : 0);
+            valid  |= isnan(value) ? 0 : (1UL << i);
+        }
+
+        if (aFiltered)
+        {
+            filter_channel(envFilter[0], CHN_TEMPERATURE, val, &valid);
+            filter_channel(envFilter[1], CHN_PRESSURE, val, &valid);
+            filter_channel(envFilter[2], CHN_HUMIDITY, val, &valid);
+            filter_channel(lightFilter, CHN_LIGHT, val, &valid);
+            filter_channel(distFilter, CHN_DIST, val, &valid);
+        }
+        change_detect_process(&cd, val, valid);
+
+        if ((++sample % SAMPLES_PER_REPORT) != 0)
+        {
+            continue;
+        }
+        due = change_detect_due(&cd, nowMs);
+        if (due != 0)
+        {
+            result.reports++;
+        }
+        for (int i = 0; i < CHANNELS; i++)
+        {
+            result.channelReports[i]   += (due & (1UL << i)) ? 1 : 0;
+        }
+        if ((due & (1UL << CHN_DIST)) && (nowMs <= 270000))
+        {
+            result.distAfterFlood   = change_detect_value(&cd, CHN_DIST);
+        }
+        change_detect_commit(&cd, due, nowMs);
+    }
+    return result;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void print(
+    const char*     aName,
+    const Replay_t* aReplay)
+{
+    printf("  %-12s %3d reports: temperature %d, pressure %d, humidity %d, light %d, distance %d\n", aName, aReplay->reports,
+           aReplay->channelReports[CHN_TEMPERATURE], aReplay->channelReports[CHN_PRESSURE], aReplay->channelReports[CHN_HUMIDITY],
+           aReplay->channelReports[CHN_LIGHT], aReplay->channelReports[CHN_DIST]);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(
+    int     aArgc,
+    char*   aArgv[])
+{
+    static TestTrace_t  trace;
+    const char*         path    = (aArgc > 1) ? aArgv[1] : TEST_TRACE_DEFAULT;
+    Replay_t            raw;
+    Replay_t            filtered;
+
+    check_median<3>();
+    check_median<5>();
+    check_median<7>();
+    check_ema<1>();
+    check_ema<2>();
+    check_ema<4>();
+    check_decimator<2>();
+    check_decimator<4>();
+
+    bench<EmaFilter<2> >("EmaFilter<2>");
+    bench<MedianFilter<3> >("MedianFilter<3>");
+    bench<MedianFilter<5> >("MedianFilter<5>");
+    bench<BoxDecimator<4> >("BoxDecimator<4>");
+    bench<FilterChain<MedianFilter<3>, EmaFilter<1> > >("FilterChain<MedianFilter<3>, EmaFilter<1>>");
+
+    TEST_CHECK(test_trace_load(&trace, path) == 0);
+    raw         = replay(&trace, false);
+    filtered    = replay(&trace, true);
+    print("unfiltered", &raw);
+    print("filtered", &filtered);
+    printf("  %d fewer uplinks (%.0f%%)\n", raw.reports - filtered.reports,
+           raw.reports ? 100.0 * (raw.reports - filtered.reports) / raw.reports : 0.0);
+
+    TEST_CHECK(filtered.reports < raw.reports);
+    TEST_CHECK(filtered.channelReports[CHN_DIST] < raw.channelReports[CHN_DIST]);
+    TEST_CHECK(filtered.channelReports[CHN_LIGHT] < raw.channelReports[CHN_LIGHT]);
+    /* The filters must not hide the rising water */
+    TEST_CHECK(abs(filtered.distAfterFlood - 70) <= 10);
+
+    return test_result("sensor_filters_test");
+}
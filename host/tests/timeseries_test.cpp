@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks that the time-series store gives back what was appended, across evictions and a wrap of
+ * the millisecond clock, and prints bytes per sample for typical signals and the append and scan
+ * throughput.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "timeseries.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define HISTORY_BLOCKS                  (32)        /* As in main.cpp, 4 KB */
+#define CHANNELS                        (11)
+#define SAMPLES                         (4000)
+#define SAMPLE_PERIOD_MS                (2000)
+
+#define BENCH_APPENDS                   (2000000)
+#define BENCH_SCANS                     (2000)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef enum
+{
+    SIGNAL_CONSTANT,        /* A closed cover */
+    SIGNAL_SLOW,            /* Temperature, battery */
+    SIGNAL_NOISY,           /* Unfiltered light */
+    SIGNAL_JUMPS,           /* Noise with rare full-scale jumps */
+    SIGNAL_COUNT
+} Signal_e;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static const char*  signalNames[SIGNAL_COUNT] = { "constant", "slow drift", "noise +/-50", "noise and jumps" };
+
+static TsBlock_t    blocks[HISTORY_BLOCKS];
+static TimeSeries_t history;
+static TsSample_t   reference[CHANNELS][SAMPLES];
+
+static volatile int64_t benchSink;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static int32_t next_value(
+    Signal_e    aSignal,
+    int32_t     aLast)
+{
+    switch (aSignal)
+    {
+        case SIGNAL_CONSTANT:
+            return aLast;
+        case SIGNAL_SLOW:
+            return aLast + (((test_rand() % 10) == 0) ? (int32_t) (test_rand() % 3) - 1 : 0);
+        case SIGNAL_NOISY:
+            return 400 + (int32_t) (test_rand() % 101) - 50;
+        default:
+            return ((test_rand() % 500) == 0) ? (int32_t) test_rand() : aLast + (int32_t) (test_rand() % 7) - 3;
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Fills every channel with aSignal, sampled every 2 s with some jitter, from aStartMs */
+static void fill(
+    Signal_e    aSignal,
+    uint32_t    aStartMs)
+{
+    uint32_t    timeMs  = aStartMs;
+    int32_t     value[CHANNELS];
+
+    timeseries_init(&history, blocks, HISTORY_BLOCKS, CHANNELS);
+    test_seed(33 + aSignal);
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        value[c]    = (int32_t) (test_rand() % 2001) - 1000;
+    }
+
+    for (int n = 0; n < SAMPLES; n++)
+    {
+        timeMs += SAMPLE_PERIOD_MS + (((test_rand() % 3) == 0) ? test_rand() % 50 : 0);
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            value[c]            = next_value(aSignal, value[c]);
+            reference[c][n]     = { timeMs, value[c] };
+            TEST_CHECK(timeseries_append(&history, c, timeMs, value[c]) == 0);
+        }
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* The store must hold the newest samples of every channel, unchanged and in order */
+static void check_contents(void)
+{
+    uint32_t    held    = 0;
+
+    for (int c = 0; c < CHANNELS; c++)
+    {
+        const TsSample_t*   expect  = &reference[c][SAMPLES - history.channel[c].count];
+        TsIter_t            iter;
+        TsSample_t          sample;
+        TsStats_t           stats;
+        uint32_t            count   = 0;
+        int32_t             min     = INT32_MAX;
+        int32_t             max     = INT32_MIN;
+        int64_t             sum     = 0;
+        bool                same    = true;
+
+        held   += history.channel[c].count;
+        TEST_CHECK(history.channel[c].count > 0);
+
+        timeseries_iter_init(&iter, &history, c, expect[0].timeMs);
+        while (timeseries_iter_next(&iter, &sample))
+        {
+            same   &= (count < history.channel[c].count) &&
+                      (sample.timeMs == expect[count].timeMs) && (sample.value == expect[count].value);
+            min     = (sample.value < min) ? sample.value : min;
+            max     = (sample.value > max) ? sample.value : max;
+            sum    += sample.value;
+            count++;
+        }
+        TEST_CHECK(same);
+        TEST_CHECK(count == history.channel[c].count);
+
+        timeseries_stats(&history, c, expect[0].timeMs, &stats);
+        TEST_CHECK(stats.count == count);
+        TEST_CHECK((stats.min == min) && (stats.max == max));
+        TEST_CHECK(abs(stats.mean - (int32_t) (sum / (int64_t) count)) <= 1);
+        TEST_CHECK(stats.lastMs == reference[c][SAMPLES - 1].timeMs);
+
+        /* Only the samples from aFromMs on */
+        count   = 0;
+        timeseries_iter_init(&iter, &history, c, reference[c][SAMPLES - 10].timeMs);
+        while (timeseries_iter_next(&iter, &sample))
+        {
+            TEST_CHECK(sample.timeMs == reference[c][SAMPLES - 10 + count].timeMs);
+            count++;
+        }
+        TEST_CHECK(count == 10);
+    }
+    TEST_CHECK(held + history.evicted == CHANNELS * SAMPLES);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void bench(void)
+{
+    uint64_t    start;
+    uint64_t    appendNs;
+    uint64_t    scanNs;
+    uint64_t    scanned     = 0;
+    uint32_t    timeMs      = 0;
+    int64_t     sum         = 0;
+
+    timeseries_init(&history, blocks, HISTORY_BLOCKS, CHANNELS);
+    test_seed(3333);
+
+    start   = test_now_ns();
+    for (int n = 0; n < BENCH_APPENDS; n++)
+    {
+        timeMs += (n % CHANNELS == 0) ? SAMPLE_PERIOD_MS : 0;
+        timeseries_append(&history, n % CHANNELS, timeMs, (int32_t) (n & 63));
+    }
+    appendNs    = test_now_ns() - start;
+
+    start   = test_now_ns();
+    for (int r = 0; r < BENCH_SCANS; r++)
+    {
+        for (int c = 0; c < CHANNELS; c++)
+        {
+            TsIter_t    iter;
+            TsSample_t  sample;
+
+            timeseries_iter_init(&iter, &history, c, 0);
+            while (timeseries_iter_next(&iter, &sample))
+            {
+                sum    += sample.value;
+                scanned++;
+            }
+        }
+    }
+    scanNs      = test_now_ns() - start;
+    benchSink   = sum;
+
+    printf("  append %.1f ns/sample (%.1f M samples/s), scan %.1f ns/sample (%.1f M samples/s)\n",
+           (double) appendNs / BENCH_APPENDS, BENCH_APPENDS * 1000.0 / appendNs,
+           (double) scanNs / scanned, scanned * 1000.0 / scanNs);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(void)
+{
+    uint32_t    samples;
+    uint32_t    bytes;
+    uint32_t    encoded;
+
+    printf("  %d channels in %u bytes, a sample every %d ms:\n", CHANNELS, (unsigned) sizeof(blocks), SAMPLE_PERIOD_MS);
+    for (int s = 0; s < SIGNAL_COUNT; s++)
+    {
+        /* Start just before the millisecond clock wraps */
+        fill((Signal_e) s, 0xFFFF0000UL);
+        check_contents();
+
+        /* The pool holds a part-filled tail block per channel, the encoding alone is smaller */
+        timeseries_usage(&history, &samples, &bytes);
+        encoded = 0;
+        for (int b = 0; b < HISTORY_BLOCKS; b++)
+        {
+            encoded    += blocks[b].tsUsed + blocks[b].valUsed;
+        }
+        printf("  %-16s %5u samples held, %.2f bytes/sample of the pool, %.2f encoded, %u evicted\n", signalNames[s], samples,
+               (double) bytes / samples, (double) encoded / samples, history.evicted);
+        if (s <= SIGNAL_SLOW)
+        {
+            /* Thousands of samples in a few KB */
+            TEST_CHECK(samples >= 1000);
+        }
+    }
+
+    timeseries_init(&history, blocks, HISTORY_BLOCKS, CHANNELS);
+    TEST_CHECK(timeseries_append(&history, CHANNELS, 0, 0) == -1);
+    TEST_CHECK(timeseries_append(&history, TS_MAX_CHANNELS, 0, 0) == -1);
+
+    bench();
+
+    return test_result("timeseries_test");
+}
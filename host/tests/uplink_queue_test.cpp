@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Runs the uplink queue on the file-backed flash of the host build (host/host_flash.cpp):
+ * - crash consistency: the power is cut at every flash operation of a push/deliver workload in
+ *   turn, the queue is recovered from the image file as after a reset and drained, and nothing
+ *   pushed and not delivered may be lost, corrupted, reordered or sent twice more than once;
+ * - a record bigger than the drain buffer is skipped and does not block the queue;
+ * - wear levelling and drain throughput, in host time and in simulated flash time.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mbed.h"
+#include "uplink_queue.h"
+#include "host_sim.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define QUEUE_SECTORS                   (8)         /* uplink-queue-sectors in mbed_app.json */
+#define PAYLOAD_MAX                     (400)       /* The drain buffer of main.cpp is about this size */
+#define PAYLOAD_HDR                     (6)         /* seq, len */
+
+#define WORKLOAD_PUSHES                 (400)       /* Wraps the 32 KB region */
+#define WEAR_RECORDS                    (20000)
+#define DRAIN_RECORDS                   (200)
+#define DRAIN_PAYLOAD                   (120)
+
+/*****************************************************************************************************************************************************
+ *
+ * T Y P E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+typedef struct
+{
+    uint32_t    pushed;         /* Pushes that returned 0 */
+    uint32_t    attempted;      /* Pushes started, the last one may be torn */
+    uint32_t    acked;          /* Records acked before the cut, in order from seq 0 */
+    bool        cut;            /* The workload saw the power cut */
+    bool        ackCut;         /* The cut hit the ack of record 'acked', which may count as done */
+} Workload_t;
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+static FlashIAP         flash;
+static UplinkQueue_t    queue;
+static char             imagePath[] = "/tmp/uplink_queue_test.XXXXXX";
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* Payloads carry their sequence number and length, and a pattern derived from both */
+static uint32_t make_payload(
+    uint8_t     aBuf[PAYLOAD_MAX],
+    uint32_t    aSeq,
+    uint32_t    aLen)
+{
+    memcpy(aBuf, &aSeq, 4);
+    aBuf[4] = (uint8_t) aLen;
+    aBuf[5] = (uint8_t) (aLen >> 8);
+    for (uint32_t i = PAYLOAD_HDR; i < aLen; i++)
+    {
+        aBuf[i] = (uint8_t) (aSeq * 31 + i);
+    }
+    return aLen;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* @return The sequence number of an intact payload, -1 otherwise */
+static int64_t check_payload(
+    const uint8_t*  aBuf,
+    int             aLen)
+{
+    uint8_t     expect[PAYLOAD_MAX];
+    uint32_t    seq;
+
+    if (aLen < PAYLOAD_HDR)
+    {
+        return -1;
+    }
+    memcpy(&seq, aBuf, 4);
+    if ((uint32_t) aLen != (uint32_t) (aBuf[4] | (aBuf[5] << 8)))
+    {
+        return -1;
+    }
+    make_payload(expect, seq, (uint32_t) aLen);
+    return (0 == memcmp(expect, aBuf, aLen)) ? (int64_t) seq : -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Boots from the image file, as after a reset */
+static int reboot(void)
+{
+    TEST_CHECK(host_flash_open(imagePath) == 0);
+    return uplink_queue_init(&queue, &flash, QUEUE_SECTORS);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* Pushes records of varying size and delivers two of every three, until the power goes */
+static Workload_t run_workload(
+    uint32_t    aCutAt)
+{
+    Workload_t  work    = {};
+    uint8_t     buf[PAYLOAD_MAX];
+
+    host_flash_power_cut(aCutAt);
+    if (0 != uplink_queue_init(&queue, &flash, QUEUE_SECTORS))
+    {
+        work.cut    = true;
+        return work;
+    }
+
+    for (uint32_t seq = 0; seq < WORKLOAD_PUSHES; seq++)
+    {
+        uint32_t    len = make_payload(buf, seq, PAYLOAD_HDR + (seq * 37) % 150);
+
+        work.attempted++;
+        if (0 != uplink_queue_push(&queue, buf, len))
+        {
+            work.cut    = true;
+            return work;
+        }
+        work.pushed++;
+
+        if ((seq % 3) != 2)
+        {
+            int     got = uplink_queue_peek(&queue, buf, sizeof(buf));
+
+            TEST_CHECK(check_payload(buf, got) == (int64_t) work.acked);
+            if (0 != uplink_queue_ack(&queue))
+            {
+                work.cut    = true;
+                work.ackCut = true;
+                return work;
+            }
+            work.acked++;
+        }
+    }
+    return work;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_crash_consistency(void)
+{
+    Workload_t  full;
+    uint32_t    ops         = 0;
+    uint32_t    cuts        = 0;
+    uint32_t    redelivered = 0;
+    uint32_t    tornKept    = 0;
+    uint32_t    lost        = 0;
+    uint32_t    corrupt     = 0;
+    uint32_t    disorder    = 0;
+
+    /* Cut after 1, 2, ... flash operations until the workload runs to the end */
+    for (uint32_t cutAt = 1; ; cutAt++)
+    {
+        Workload_t  work;
+        uint8_t     buf[PAYLOAD_MAX];
+        int64_t     last        = -1;
+        uint32_t    delivered   = 0;
+        bool        sawAckCut   = false;
+        int         got;
+
+        /* A blank flash for every run */
+        unlink(imagePath);
+        TEST_CHECK(host_flash_open(imagePath) == 0);
+        work    = run_workload(cutAt);
+        if (false == work.cut)
+        {
+            full    = work;
+            ops     = cutAt - 1;
+            break;
+        }
+        cuts++;
+
+        if (0 != reboot())
+        {
+            /* Only a cut while formatting the blank region can leave nothing to recover */
+            TEST_CHECK(work.pushed == 0);
+            continue;
+        }
+
+        /* Every record pushed and not acked must come out once, intact and in order. A torn ack
+         * may or may not have taken, the record acked last may come again, a torn push may come
+         * or not.
+         */
+        while ((got = uplink_queue_peek(&queue, buf, sizeof(buf))) > 0)
+        {
+            int64_t seq = check_payload(buf, got);
+
+            if (seq < 0)
+            {
+                corrupt++;
+            }
+            else if (seq <= last)
+            {
+                disorder++;
+            }
+            else
+            {
+                if ((uint32_t) seq < work.acked)
+                {
+                    redelivered    += ((uint32_t) seq == work.acked - 1) ? 1 : 1000;
+                }
+                else if ((uint32_t) seq >= work.pushed)
+                {
+                    tornKept       += ((uint32_t) seq == work.pushed) ? 1 : 1000;
+                }
+                else
+                {
+                    sawAckCut  |= ((uint32_t) seq == work.acked);
+                    delivered++;
+                }
+                last    = seq;
+            }
+            TEST_CHECK(uplink_queue_ack(&queue) == 0);
+        }
+        if (work.ackCut && !sawAckCut)
+        {
+            work.acked++;
+        }
+        lost   += (work.pushed - work.acked) - delivered;
+
+        /* The recovered queue takes and gives new records */
+        make_payload(buf, 100000, 64);
+        TEST_CHECK(uplink_queue_push(&queue, buf, 64) == 0);
+        TEST_CHECK(uplink_queue_peek(&queue, buf, sizeof(buf)) == 64);
+        TEST_CHECK(check_payload(buf, 64) == 100000);
+        TEST_CHECK(uplink_queue_ack(&queue) == 0);
+        TEST_CHECK(uplink_queue_pending(&queue) == 0);
+    }
+
+    printf("  %u power cuts over the %u flash operations of %u pushes and %u deliveries:\n"
+           "    %u records lost, %u corrupt, %u out of order, %u delivered twice, %u cut pushes found complete\n",
+           cuts, ops, full.pushed, full.acked, lost, corrupt, disorder, redelivered, tornKept);
+    TEST_CHECK(cuts == ops);
+    TEST_CHECK(full.pushed == WORKLOAD_PUSHES);
+    TEST_CHECK(lost == 0);
+    TEST_CHECK(corrupt == 0);
+    TEST_CHECK(disorder == 0);
+    TEST_CHECK(redelivered < 1000 && tornKept < 1000);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A record that does not fit the drain buffer is skipped, not peeked forever */
+static void check_skip(void)
+{
+    uint8_t     big[600];
+    uint8_t     buf[PAYLOAD_MAX];
+
+    unlink(imagePath);
+    TEST_CHECK(reboot() == 0);
+
+    memset(big, 0x5A, sizeof(big));
+    TEST_CHECK(uplink_queue_push(&queue, big, 599) == 0);
+    TEST_CHECK(uplink_queue_push(&queue, buf, make_payload(buf, 7, 100)) == 0);
+    TEST_CHECK(uplink_queue_pending(&queue) == 2);
+
+    TEST_CHECK(uplink_queue_peek(&queue, buf, sizeof(buf)) == -1);
+    TEST_CHECK(uplink_queue_skip(&queue) == 0);
+    TEST_CHECK(uplink_queue_pending(&queue) == 1);
+    TEST_CHECK(queue.dropped == 1);
+
+    TEST_CHECK(uplink_queue_peek(&queue, buf, sizeof(buf)) == 100);
+    TEST_CHECK(check_payload(buf, 100) == 7);
+    TEST_CHECK(uplink_queue_ack(&queue) == 0);
+    TEST_CHECK(uplink_queue_pending(&queue) == 0);
+
+    /* The skip is on flash, the record does not come back after a reset */
+    TEST_CHECK(reboot() == 0);
+    TEST_CHECK(uplink_queue_pending(&queue) == 0);
+    TEST_CHECK(uplink_queue_peek(&queue, buf, sizeof(buf)) == 0);
+
+    /* Nothing peeked, nothing to skip */
+    TEST_CHECK(uplink_queue_skip(&queue) == -1);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_wear_and_drain(void)
+{
+    uint8_t     buf[PAYLOAD_MAX];
+    uint32_t    fewest  = UINT32_MAX;
+    uint32_t    most    = 0;
+    uint64_t    startNs;
+    uint64_t    startUs;
+    uint64_t    pushNs;
+    uint64_t    pushUs;
+    uint64_t    drainNs;
+    uint64_t    drainUs;
+    uint32_t    drained = 0;
+
+    unlink(imagePath);
+    TEST_CHECK(reboot() == 0);
+    for (uint32_t seq = 0; seq < WEAR_RECORDS; seq++)
+    {
+        TEST_CHECK(uplink_queue_push(&queue, buf, make_payload(buf, seq, DRAIN_PAYLOAD)) == 0);
+        TEST_CHECK(uplink_queue_peek(&queue, buf, sizeof(buf)) == DRAIN_PAYLOAD);
+        TEST_CHECK(uplink_queue_ack(&queue) == 0);
+    }
+    for (uint32_t i = 0; i < QUEUE_SECTORS; i++)
+    {
+        uint32_t    erases  = host_flash_erase_count(queue.base + i * queue.sectorSize);
+
+        fewest  = (erases < fewest) ? erases : fewest;
+        most    = (erases > most) ? erases : most;
+    }
+    printf("  %u records through %u sectors: %u to %u erases per sector\n", WEAR_RECORDS, QUEUE_SECTORS, fewest, most);
+    TEST_CHECK(most - fewest <= 1);
+
+    /* A backlog of an outage, then the drain once the link is back */
+    startNs = test_now_ns();
+    startUs = host_clock_us();
+    for (uint32_t seq = 0; seq < DRAIN_RECORDS; seq++)
+    {
+        TEST_CHECK(uplink_queue_push(&queue, buf, make_payload(buf, seq, DRAIN_PAYLOAD)) == 0);
+    }
+    pushNs  = test_now_ns() - startNs;
+    pushUs  = host_clock_us() - startUs;
+
+    startNs = test_now_ns();
+    startUs = host_clock_us();
+    while (uplink_queue_peek(&queue, buf, sizeof(buf)) > 0)
+    {
+        TEST_CHECK(check_payload(buf, DRAIN_PAYLOAD) == (int64_t) drained);
+        TEST_CHECK(uplink_queue_ack(&queue) == 0);
+        drained++;
+    }
+    drainNs = test_now_ns() - startNs;
+    drainUs = host_clock_us() - startUs;
+
+    printf("  %u records of %u bytes: push %.1f us each on the host, %.0f us of flash time; drain %.1f us, %.0f us of flash time\n",
+           DRAIN_RECORDS, DRAIN_PAYLOAD, pushNs / 1000.0 / DRAIN_RECORDS, (double) pushUs / DRAIN_RECORDS,
+           drainNs / 1000.0 / DRAIN_RECORDS, (double) drainUs / DRAIN_RECORDS);
+    TEST_CHECK(drained == DRAIN_RECORDS);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(void)
+{
+    int     fd  = mkstemp(imagePath);
+
+    TEST_CHECK(fd >= 0);
+    close(fd);
+
+    check_crash_consistency();
+    check_skip();
+    check_wear_and_drain();
+
+    unlink(imagePath);
+    return test_result("uplink_queue_test");
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2019 Riot Micro. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Checks the backoff bounds, the circuit breaker and the reset escalation of
+ * Network/uplink_retry.cpp, and prints how spread out a fleet that lost the same server
+ * comes back once it returns.
+ */
+
+/*****************************************************************************************************************************************************
+ *
+ * I N C L U D E S
+ *
+ ****************************************************************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "uplink_retry.h"
+#include "host_test.h"
+
+/*****************************************************************************************************************************************************
+ *
+ * M A C R O S
+ *
+ ****************************************************************************************************************************************************/
+
+#define DRAWS                           (2000)
+#define FLEET                           (1000)
+#define FLEET_OUTAGE_MS                 (600000)    /* The server is down for 10 minutes */
+#define FLEET_TICK_MS                   (1000)      /* Devices report every second, as DWEET_UPDATE_MS */
+#define FLEET_SECONDS                   (1800)
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   V A R I A B L E   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* mbed_app.json */
+static const UplinkRetryConfig_t    config  = { 5000, 300000, 6, 900000, 4 };
+
+/*****************************************************************************************************************************************************
+ *
+ * L O C A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+/* The n-th failure in a row waits between half and all of min(cap, base << (n - 1)) */
+static void check_backoff(void)
+{
+    for (uint32_t n = 1; n <= 10; n++)
+    {
+        uint32_t    delayMs = config.baseMs << (n - 1);
+        uint32_t    lowMs   = 0xFFFFFFFF;
+        uint32_t    highMs  = 0;
+        uint64_t    sumMs   = 0;
+
+        delayMs = (delayMs < config.capMs) ? delayMs : config.capMs;
+        for (int d = 0; d < DRAWS; d++)
+        {
+            UplinkRetryConfig_t noBreaker   = config;
+            UplinkRetry_t       retry;
+            uint32_t            waitMs;
+
+            noBreaker.openAfter = 0;
+            uplink_retry_init(&retry, &noBreaker);
+            for (uint32_t f = 0; f < n; f++)
+            {
+                TEST_CHECK(uplink_retry_failure(&retry, 1000, false) == UPLINK_RETRY_WAIT);
+            }
+            waitMs  = uplink_retry_wait_ms(&retry, 1000);
+            lowMs   = (waitMs < lowMs) ? waitMs : lowMs;
+            highMs  = (waitMs > highMs) ? waitMs : highMs;
+            sumMs  += waitMs;
+
+            TEST_CHECK(false == uplink_retry_allow(&retry, 1000 + waitMs - 1));
+            TEST_CHECK(uplink_retry_allow(&retry, 1000 + waitMs));
+            TEST_CHECK(retry.stats.deferred == 1 && retry.stats.attempts == 1);
+        }
+        TEST_CHECK(lowMs >= delayMs / 2 && highMs <= delayMs);
+        /* The draws cover the range, a fixed backoff would bring devices back together */
+        TEST_CHECK(highMs - lowMs > (delayMs / 2) * 9 / 10);
+        if (1 == n || 7 == n || 10 == n)
+        {
+            printf("  failure %2u: %6u to %6u ms, %6u ms mean\n", n, lowMs, highMs, (unsigned) (sumMs / DRAWS));
+        }
+    }
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_breaker(void)
+{
+    UplinkRetry_t   retry;
+    uint32_t        nowMs   = 0xFFFFF000;   /* The ms counter wraps during the test */
+    uint32_t        waitMs;
+
+    uplink_retry_init(&retry, &config);
+    for (uint32_t f = 1; f < config.openAfter; f++)
+    {
+        TEST_CHECK(uplink_retry_allow(&retry, nowMs));
+        uplink_retry_failure(&retry, nowMs, false);
+        TEST_CHECK(retry.state == UPLINK_RETRY_CLOSED);
+        nowMs  += uplink_retry_wait_ms(&retry, nowMs);
+    }
+
+    /* The failure that opens it parks sending for openMs and up to a tenth more */
+    TEST_CHECK(uplink_retry_allow(&retry, nowMs));
+    uplink_retry_failure(&retry, nowMs, false);
+    waitMs  = uplink_retry_wait_ms(&retry, nowMs);
+    TEST_CHECK(retry.state == UPLINK_RETRY_OPEN && retry.stats.opens == 1);
+    TEST_CHECK(waitMs >= config.openMs && waitMs <= config.openMs + config.openMs / 10);
+    TEST_CHECK(false == uplink_retry_allow(&retry, nowMs + waitMs - 1));
+
+    /* One probe, nothing else until its outcome is in */
+    nowMs  += waitMs;
+    TEST_CHECK(uplink_retry_allow(&retry, nowMs));
+    TEST_CHECK(retry.state == UPLINK_RETRY_HALF_OPEN && retry.stats.probes == 1);
+    TEST_CHECK(false == uplink_retry_allow(&retry, nowMs + 3600000));
+
+    /* A failed probe parks it again, without counting another opening */
+    uplink_retry_failure(&retry, nowMs, false);
+    waitMs  = uplink_retry_wait_ms(&retry, nowMs);
+    TEST_CHECK(retry.state == UPLINK_RETRY_OPEN && retry.stats.opens == 1);
+    TEST_CHECK(waitMs >= config.openMs && waitMs <= config.openMs + config.openMs / 10);
+
+    /* A good probe closes it, the next failure starts from the base backoff */
+    nowMs  += waitMs;
+    TEST_CHECK(uplink_retry_allow(&retry, nowMs));
+    uplink_retry_success(&retry);
+    TEST_CHECK(retry.state == UPLINK_RETRY_CLOSED && retry.failuresInRow == 0);
+    TEST_CHECK(uplink_retry_allow(&retry, nowMs) && uplink_retry_wait_ms(&retry, nowMs) == 0);
+    uplink_retry_failure(&retry, nowMs, false);
+    TEST_CHECK(uplink_retry_wait_ms(&retry, nowMs) <= config.baseMs);
+    TEST_CHECK(retry.stats.failures == config.openAfter + 2);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void check_reset(void)
+{
+    UplinkRetryConfig_t never   = config;
+    UplinkRetry_t       retry;
+    int                 resets  = 0;
+
+    /* A server that keeps failing behind a working link never calls for a reset */
+    uplink_retry_init(&retry, &config);
+    for (int f = 0; f < 100; f++)
+    {
+        resets += (UPLINK_RETRY_RESET == uplink_retry_failure(&retry, 0, false));
+    }
+    TEST_CHECK(resets == 0 && retry.stats.linkFailures == 0);
+
+    /* resetAfter link failures in a row do, a server failure in between starts the run again */
+    uplink_retry_init(&retry, &config);
+    for (uint32_t f = 1; f < config.resetAfter; f++)
+    {
+        TEST_CHECK(uplink_retry_failure(&retry, 0, true) == UPLINK_RETRY_WAIT);
+    }
+    TEST_CHECK(uplink_retry_failure(&retry, 0, false) == UPLINK_RETRY_WAIT);
+    for (uint32_t f = 1; f < config.resetAfter; f++)
+    {
+        TEST_CHECK(uplink_retry_failure(&retry, 0, true) == UPLINK_RETRY_WAIT);
+    }
+    TEST_CHECK(uplink_retry_failure(&retry, 0, true) == UPLINK_RETRY_RESET);
+    TEST_CHECK(retry.stats.linkFailures == 2 * config.resetAfter - 1);
+
+    /* A success also ends the run */
+    uplink_retry_init(&retry, &config);
+    for (uint32_t f = 1; f < config.resetAfter; f++)
+    {
+        uplink_retry_failure(&retry, 0, true);
+    }
+    uplink_retry_success(&retry);
+    TEST_CHECK(uplink_retry_failure(&retry, 0, true) == UPLINK_RETRY_WAIT);
+
+    /* 0 turns the reset and the breaker off */
+    never.openAfter     = 0;
+    never.resetAfter    = 0;
+    uplink_retry_init(&retry, &never);
+    for (int f = 0; f < 100; f++)
+    {
+        resets += (UPLINK_RETRY_RESET == uplink_retry_failure(&retry, 0, true));
+    }
+    TEST_CHECK(resets == 0 && retry.state == UPLINK_RETRY_CLOSED);
+    TEST_CHECK(uplink_retry_wait_ms(&retry, 0) <= config.capMs);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/* A fleet reporting every second loses the server for FLEET_OUTAGE_MS: how many attempts it
+ * makes meanwhile, and how many devices hit the server in the busiest second once it is back.
+ */
+static void check_fleet(void)
+{
+    static UplinkRetry_t    fleet[FLEET];
+    static uint32_t         perSecond[FLEET_SECONDS];
+    uint32_t                outageAttempts  = 0;
+    uint32_t                peak            = 0;
+    uint32_t                peakS           = 0;
+    uint32_t                recovered       = 0;
+    uint32_t                lastS           = 0;
+
+    for (int d = 0; d < FLEET; d++)
+    {
+        uplink_retry_init(&fleet[d], &config);
+    }
+    for (uint32_t s = 0; s < FLEET_SECONDS; s++)
+    {
+        uint32_t    nowMs   = s * FLEET_TICK_MS;
+        bool        down    = nowMs < FLEET_OUTAGE_MS;
+
+        for (int d = 0; d < FLEET; d++)
+        {
+            bool    wasFailing  = fleet[d].failuresInRow > 0;
+
+            if (false == uplink_retry_allow(&fleet[d], nowMs))
+            {
+                continue;
+            }
+            if (down)
+            {
+                outageAttempts++;
+                uplink_retry_failure(&fleet[d], nowMs, false);
+            }
+            else
+            {
+                if (wasFailing)
+                {
+                    perSecond[s]++;
+                    recovered++;
+                    lastS   = s;
+                }
+                uplink_retry_success(&fleet[d]);
+            }
+        }
+    }
+    for (uint32_t s = 0; s < FLEET_SECONDS; s++)
+    {
+        if (perSecond[s] > peak)
+        {
+            peak    = perSecond[s];
+            peakS   = s;
+        }
+    }
+
+    printf("  %u devices, %u s outage: %.1f attempts each instead of %u, back within %u s of the server, "
+           "at most %u in one second (%u s after)\n",
+           FLEET, FLEET_OUTAGE_MS / 1000, (double) outageAttempts / FLEET, FLEET_OUTAGE_MS / FLEET_TICK_MS,
+           lastS - FLEET_OUTAGE_MS / 1000, peak, peakS - FLEET_OUTAGE_MS / 1000);
+    TEST_CHECK(recovered == FLEET);
+    TEST_CHECK(outageAttempts <= FLEET * (config.openAfter + 1));
+    TEST_CHECK(peak < FLEET / 10);
+}
+
+/*****************************************************************************************************************************************************
+ *
+ * G L O B A L   F U N C T I O N   D E F I N I T I O N S
+ *
+ ****************************************************************************************************************************************************/
+
+int main(void)
+{
+    srand(7);
+
+    check_backoff();
+    check_breaker();
+    check_reset();
+    check_fleet();
+
+    return test_result("uplink_retry_test");
+}
@@ -31,8 +31,33 @@
 #include "OPT3001.h"            /*Light sensor*/
 #include "VL53L1X.h"            /*Distance sensor*/
 #include "LIS2MDLSensor.h"      /*Magnetic sensor*/
+#include "change_detect.h"
+#include "sensor_filters.h"
+#include "orientation_fusion.h"
+#include "event_detect.h"
+#include "sensor_power.h"
+#include "analog_monitor.h"
+#include "sensor_health.h"
+#include "timeseries.h"
+#include "sensor_replay.h"
+#include "stage_bench.h"
 #endif
 
+#include "uplink_queue.h"
+#include "dns_cache.h"
+#include "http_conn.h"
+#include "uplink_batch.h"
+#include "coap_client.h"
+#include "mqtt_uplink.h"
+#include "report_codec.h"
+#include "report_ring.h"
+#include "uplink_retry.h"
+#include "link_quality.h"
+#include "uplink_timing.h"
+#include "tls_conn.h"
+#include "tls_root_ca.h"
+#include "platform_clock.h"
+
 #include "SEGGER_RTT.h"
 
 /*****************************************************************************************************************************************************
@@ -52,6 +77,17 @@
 #define DEMO_DWEET_SIGNAL       1
 #define DEMO_DWEET_MANHOLE      2
 
+#define UPLINK_HTTP             0
+#define UPLINK_COAP             1
+#define UPLINK_MQTT             2
+
+#define REPORT_FORMAT_TEXT      0
+#define REPORT_FORMAT_LPP       1
+#define REPORT_FORMAT_CBOR      2
+
+#define UPLINK_OVERFLOW_DROP_OLDEST 0   // Same order as ReportRingPolicy_e
+#define UPLINK_OVERFLOW_COALESCE    1
+
 #define LIVE_NETWORK
 
 #define LED_ON      (0)
@@ -74,48 +110,179 @@
   #define MANHOLE_CHN_MAG_X_OUT             (11)
   #define MANHOLE_CHN_MAG_Y_OUT             (12)
   #define MANHOLE_CHN_MAG_Z_OUT             (13)
-
-  #define ENV_IDX_TEMPERATURE               (0)
-  #define ENV_IDX_PRESSURE                  (1)
-  #define ENV_IDX_HUMIDITY                  (2)
+  #define MANHOLE_CHN_PITCH_OUT             (14)
+  #define MANHOLE_CHN_ROLL_OUT              (15)
+  #define MANHOLE_CHN_HEADING_OUT           (16)
+  #define MANHOLE_CHN_BATTERY_OUT           (17)
+  #define MANHOLE_CHN_FLEX_OUT              (18)
+  #define MANHOLE_CHN_EVT_LATENCY_OUT       (19)
+  #define MANHOLE_CHN_DEGRADED_OUT          (20)
+  #define MANHOLE_CHN_EVENT_OUT(aEvent)     (21 + (aEvent))     // One channel per MANHOLE_EVT_*
+  #define MANHOLE_CHN_QUEUED_OUT            (25)
+  #define MANHOLE_CHN_RSRP_OUT              (26)
+  #define MANHOLE_CHN_RSRQ_OUT              (27)
 
   #define TILT_IDX_X                        (0)
   #define TILT_IDX_Y                        (1)
   #define TILT_IDX_Z                        (2)
 
+  /* Change-detection channel table indexes, in uplink order */
+  #define CHN_IDX_TEMPERATURE               (0)
+  #define CHN_IDX_PRESSURE                  (1)
+  #define CHN_IDX_HUMIDITY                  (2)
+  #define CHN_IDX_PITCH                     (3)
+  #define CHN_IDX_ROLL                      (4)
+  #define CHN_IDX_HEADING                   (5)
+  #define CHN_IDX_LIGHT                     (6)
+  #define CHN_IDX_DIST                      (7)
+  #define CHN_IDX_BATTERY                   (8)
+  #define CHN_IDX_FLEX                      (9)
+  #define CHN_IDX_COUNT                     (10)    // Reported channels
+  #define CHN_IDX_FIELD                     (10)    // Magnetic field magnitude, event input only
+  #define CHN_IDX_TOTAL                     (11)
+
+  #define CHN_MASK(aIdx)                    (1UL << (aIdx))
+  #define CHN_MASK_ENV                      (CHN_MASK(CHN_IDX_TEMPERATURE) | CHN_MASK(CHN_IDX_PRESSURE) | CHN_MASK(CHN_IDX_HUMIDITY))
+  #define CHN_MASK_TILT                     (CHN_MASK(CHN_IDX_PITCH) | CHN_MASK(CHN_IDX_ROLL))
+  #define CHN_MASK_ORIENTATION              (CHN_MASK_TILT | CHN_MASK(CHN_IDX_HEADING))
+  #define CHN_MASK_ANALOG                   (CHN_MASK(CHN_IDX_BATTERY) | CHN_MASK(CHN_IDX_FLEX))
+
+  #define MANHOLE_EVT_COVER_TILT            (0)
+  #define MANHOLE_EVT_FLOOD                 (1)
+  #define MANHOLE_EVT_LIGHT_INGRESS         (2)
+  #define MANHOLE_EVT_MAG_DISTURBANCE       (3)
+  #define MANHOLE_EVT_COUNT                 (4)
+
+  #define COVER_TILT_EVT_TRIGGER            (10)    // degrees
+  #define COVER_TILT_EVT_RELEASE            (5)
+  #define FLOOD_EVT_TRIGGER                 (20)    // cm closer than the baseline
+  #define FLOOD_EVT_RELEASE                 (10)
+  #define LIGHT_EVT_TRIGGER                 (50)    // lux above the baseline
+  #define LIGHT_EVT_RELEASE                 (20)
+  #define MAG_EVT_TRIGGER                   (100)   // LSB of field magnitude (1.5 mG/LSB)
+  #define MAG_EVT_RELEASE                   (50)
+
+  #define CDEG_TO_DEG(a)                    (((a) >= 0) ? ((a) + 50) / 100 : ((a) - 50) / 100)
+
   #define I2C_TILT_SENSOR_ADDR              ((uint8_t) (0x30))
   #define I2C_ENV_SENSOR_ADDR               ((uint8_t) (0xEC))
   #define I2C_LIGHT_SENSOR_ADDR             ((uint8_t) (0x88))
   #define I2C_DIST_SENSOR_ADDR              ((uint8_t) (0x52))
   #define I2C_MAGN_SENSOR_ADDR              ((uint8_t) (0x3C))
 
+  #define BME280_REG_CHIP_ID                (0xD0)
+  #define BME280_CHIP_ID                    (0x60)
+  #define OPT3001_REG_DEVICE_ID             (0x7F)
+  #define OPT3001_DEVICE_ID                 (0x3001)
+  #define VL53L1X_SENSOR_ID                 (0xEACC)
+  #define LIS2MDL_WHO_AM_I                  (0x40)
+
+  #define HISTORY_BLOCKS                    (32)    // 128 bytes each
+  #define SENSOR_HEALTH_COUNT               (SENSOR_MAGNT_LIS2MDL + 1)  // I2C sensors, same order as PROFILE_SENSOR_*
+
   #define DIST_SENSOR_WAIT_STEP             (100) // ms
   #define DIST_SENSOR_WAIT_MAX              (3000)
 
   #define DISCARD_SENSOR_FLUCT              (1)
+  #define TILT_SENSOR_DEADBAND              (2)     // degrees
+  #define HEADING_DEADBAND                  (5)     // degrees
+  #define LIGHT_SENSOR_DEADBAND             (10)
+  #define DIST_SENSOR_DEADBAND              (10)
+  #define BATTERY_DEADBAND_MV               (50)
+  #define BATTERY_HEARTBEAT_MS              (3600 * 1000)
+  #define FLEX_DEADBAND_MV                  (50)
+
+  #define BATTERY_DIVIDER_FULL_SCALE_MV     (2 * ANALOG_ADC_FULL_SCALE_MV)  // 1:2 divider in front of A0
+  #define BATTERY_LOW_MV                    (3300)  // Below: ultra-low-power profile and slower reporting
+  #define BATTERY_OK_MV                     (3500)  // Above: back to the configured profile
+  #define BATTERY_LOW_REPORT_FACTOR         (4)
 
   #define DWEET_UPDATE_MS                   (1000)
-  #define SENSOR_TIME_RESOLUTION            (100)
+
+#if MBED_APP_CONF_LATENCY_BENCH_CYCLES
+  #define BENCH_LAP()                       stage_bench_lap(&stageBench)
+  #define BENCH_MARK(aStage)                stage_bench_mark(&stageBench, (aStage))
+#else
+  #define BENCH_LAP()
+  #define BENCH_MARK(aStage)
+#endif
 #endif
 
 #if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_SIGNAL) || (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
-  #define MSG_LEN                           (500)
-  #define SERVER_NAME                       "www.dweet.io"
+  #define MSG_LEN                           (520)
+  #define SERVER_NAME                       MBED_APP_CONF_DWEET_SERVER
+  #define SERVER_PORT                       (MBED_APP_CONF_DWEET_PORT)
+  #define DWEET_PATH                        "/dweet/for/" MBED_APP_CONF_DWEET_PAGE
+  #define HTTP_IDLE_CLOSE_MS                (50000) // Below the usual 60 s server keep-alive timeout
+  #define DNS_TTL_MS                        (MBED_APP_CONF_DNS_TTL_S * 1000UL)
+  #define STACK_STATS_THREADS               (8)     // Threads logged with stack-stats
+
+  #define UPLINK_DRAIN_BATCH                (8)     // Queued reports sent after each successful one
+  #define UPLINK_QUEUED_TAG                 "&QUEUED=1"
+  #define UPLINK_QUEUED_JSON                ",\"queued\":1}"
+  #define UPLINK_IS_BATCH(aPayload)         ('{' == (aPayload)[0])  // JSON batch, otherwise a query string
+  #define UPLINK_BATCH_BYTES                (1024)  // Request body of a batch
+  #define UPLINK_REPORT_BYTES               (MSG_LEN - 100)
+
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+  #if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+    #error "uplink-batch-samples must be 0 with UPLINK_MQTT, values are published one per channel"
+  #endif
+  #define UPLINK_PAYLOAD_MAX                (UPLINK_BATCH_BYTES)
+#else
+  #define UPLINK_PAYLOAD_MAX                (UPLINK_REPORT_BYTES)
 #endif
 
-#define CALC_ABSOLUTE_DIFF(a, b)            ((a) > (b) ? (a) - (b) : (b) - (a))
+#if (MBED_APP_CONF_REPORT_FORMAT != REPORT_FORMAT_TEXT)
+  #if (MBED_APP_CONF_UPLINK_TRANSPORT != UPLINK_COAP)
+    #error "report-format REPORT_FORMAT_LPP and REPORT_FORMAT_CBOR need uplink-transport UPLINK_COAP"
+  #endif
+  #if (MBED_APP_CONF_REPORT_FORMAT == REPORT_FORMAT_LPP)
+    #define REPORT_BINARY_FORMAT            (&reportFormatLpp)
+  #else
+    #define REPORT_BINARY_FORMAT            (&reportFormatCbor)
+  #endif
+  #define REPORT_BINARY_MAX                 (128)   // At most 6 bytes per value
+#endif
 
-#define UPDATE_SENSOR_READS(a, b) \
-{ \
-    a[0]    = b[0]; \
-    a[1]    = b[1]; \
-    a[2]    = b[2]; \
-}
+#if MBED_APP_CONF_UPLINK_TLS
+  #if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_COAP)
+    #error "uplink-tls needs uplink-transport UPLINK_HTTP, CoAP would need DTLS"
+  #endif
+  #if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+    #error "uplink-tls needs uplink-transport UPLINK_HTTP, the MQTT uplink has no TLS"
+  #endif
+  #define UPLINK_TLS_HOST                   SERVER_NAME
+#endif
+
+#if MBED_APP_CONF_UPLINK_TIMING_PERIOD_S && (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_HTTP)
+  #define UPLINK_TIMING                     (1)
+  #define UPLINK_TIMING_PERIOD_MS           (MBED_APP_CONF_UPLINK_TIMING_PERIOD_S * 1000UL)
+  #define UPLINK_TIMING_PERCENT             (90)    // Percentile sent as telemetry
+#else
+  #define UPLINK_TIMING                     (0)
+#endif
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE) && MBED_APP_CONF_UPLINK_THREAD_QUEUE
+  #define UPLINK_THREADED                   (1)
+#if MBED_APP_CONF_UPLINK_TLS
+  #define UPLINK_THREAD_STACK               (8192)      // Full handshake: ECDHE and X.509 chain verification
+#else
+  #define UPLINK_THREAD_STACK               (4096)
+#endif
+  #define UPLINK_THREAD_FLAG                (1UL << 0)  // A report was queued
+  #define UPLINK_THREAD_POLL_MS             (1000)      // Batch age and MQTT keep-alive checks
+  #define UPLINK_HANDOFF                    "queued"
+#else
+  #define UPLINK_THREADED                   (0)
+  #define UPLINK_HANDOFF                    "sent"
+#endif
+#endif
 
 #define SYSTEM_RECOVERY() \
 { \
     LOG_ERROR("SYSTEM RESET..."); \
-    ThisThread::sleep_for(2000); \
+    platform_sleep_ms(2000); \
     NVIC_SystemReset(); \
 }
 
@@ -161,9 +328,67 @@ typedef enum
     SENSOR_ENVIRO_BME280,   /*Atmospheric sensor*/
     SENSOR_LIGHT_OPT3001,   /*Light sensor*/
     SENSOR_DIST_VL53L1X,    /*Distance sensor*/
-    SENSOR_MAGNT_LIS2MDL    /*Magnetic sensor*/
+    SENSOR_MAGNT_LIS2MDL,   /*Magnetic sensor*/
+    SENSOR_ANALOG_BATTERY,  /*Battery voltage*/
+    SENSOR_ANALOG_FLEX      /*Flex analog input*/
 } SensorSelect_e;
 
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+/** Sensor drivers as seen by the health supervisor hooks.
+ */
+typedef struct
+{
+    I2C*            i2c;
+    LIS3DH*         tilt;
+    BME280*         env;
+    VL53L1X*        dist;
+    LIS2MDLSensor*  magn;
+} ManholeSensors_t;
+
+/** Stages of one acquisition cycle timed by the latency benchmark, in loop order.
+ */
+typedef enum
+{
+    BENCH_WAKE,             /*Sensor wake-up, LED blink and conversion wait*/
+    BENCH_TILT,
+    BENCH_ENV,
+    BENCH_LIGHT,
+    BENCH_DIST,
+    BENCH_MAGN,
+    BENCH_ANALOG,           /*Sensor power-down, battery and flex*/
+    BENCH_FUSE,             /*Battery check, field magnitude and orientation*/
+    BENCH_FILTER,           /*Filters and history*/
+    BENCH_DETECT,           /*Change and event detection*/
+    BENCH_EVENT_SEND,
+    BENCH_PAYLOAD,          /*Periodic report build*/
+    BENCH_SEND,             /*Periodic report uplink, including queued reports*/
+    BENCH_SUPERVISE,
+    BENCH_CYCLE,            /*Whole cycle without the idle sleep*/
+    BENCH_STAGE_COUNT
+} BenchStage_e;
+
+/** Reporting at one link level, as factors of the configured interval and batch.
+ */
+typedef struct
+{
+    uint8_t     intervalFactor;
+    uint8_t     batchFactor;
+} LinkPolicy_t;
+#endif
+
+/** What the uplink found out about the link, for the periodic report. The uplink updates it under
+ * a critical section and the acquisition loop takes a copy, so a report never mixes two signal
+ * samples or two timing windows.
+ */
+typedef struct
+{
+    LinkSample_t    link;                           // Last signal sample
+    uint32_t        linkSamples;
+    uint8_t         linkLevel;                      // LinkLevel_e
+    int32_t         phaseMs[UPLINK_PHASE_COUNT];    // Percentile of each uplink phase over the last window, -1 when it did not run
+    uint32_t        timingWindows;
+} UplinkStatus_t;
+
 
 /*****************************************************************************************************************************************************
  *
@@ -198,6 +423,283 @@ AnalogIn   flexAnalog(A2);
 
 NetworkInterface*   interface   = NULL;
 
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_SIGNAL) || (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+/* Reports that could not be sent, kept in flash across resets. */
+static FlashIAP         flashIap;
+static UplinkQueue_t    uplinkQueue;
+
+/* When to try again after a failure, and when to stop trying for a while. */
+static const UplinkRetryConfig_t uplinkRetryConfig =
+{
+    MBED_APP_CONF_UPLINK_RETRY_BASE_MS,
+    MBED_APP_CONF_UPLINK_RETRY_CAP_S * 1000UL,
+    MBED_APP_CONF_UPLINK_BREAKER_FAILURES,
+    MBED_APP_CONF_UPLINK_BREAKER_OPEN_S * 1000UL,
+    MBED_APP_CONF_UPLINK_LINK_RESET_FAILURES,
+};
+static UplinkRetry_t    uplinkRetry;
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+/* Signal quality of the cellular link. At the cell edge every report costs many times the
+ * energy and air time, so a poorer link reports less often and packs more into each request. */
+static LinkQuality_t    linkQuality;
+
+static const LinkPolicy_t linkPolicy[LINK_LEVEL_COUNT] =
+{
+    /* interval, batch */
+    { 1,         1 },       // LINK_LEVEL_GOOD
+    { 2,         2 },       // LINK_LEVEL_FAIR
+    { 4,         4 },       // LINK_LEVEL_POOR
+};
+
+/* Time from the sample that raised the last event to its report being delivered, set by the
+ * uplink and sent with the next periodic report. EVT_LATENCY_NONE when there is nothing new. */
+#define EVT_LATENCY_NONE    (0xFFFFFFFFUL)
+static volatile uint32_t    eventLatencyMs  = EVT_LATENCY_NONE;
+#endif
+
+/* Server addresses and the connection to the dweet server, kept across reports. */
+static DnsCache_t       dnsCache;
+#if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_COAP)
+static CoapClient_t     coapClient;
+#elif (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+static MqttUplink_t     mqttUplink;
+#else
+static HttpConn_t       dweetConn;
+#endif
+#if MBED_APP_CONF_UPLINK_TLS
+static TlsConn_t        uplinkTls;
+#endif
+
+/* Shared between the uplink and the acquisition loop, see uplink_status_get(). */
+static UplinkStatus_t   uplinkStatus;
+
+#if UPLINK_TIMING
+/* Report keys of the uplink phase percentiles, sent once uplinkStatus.timingWindows moves on. */
+static const char* const    uplinkPhaseKeys[UPLINK_PHASE_COUNT] = { "DNS_MS", "CONNECT_MS", "TLS_MS", "SEND_MS", "RECV_MS", "CLOSE_MS" };
+static uint32_t             uplinkTimingMs;
+#endif
+
+/* Every buffer of the uplink path, sized at build time so nothing is allocated per report.
+ * Reports are built one at a time, the event and the periodic report share one buffer. */
+typedef struct
+{
+    char        report[UPLINK_REPORT_BYTES];                                // Report being built
+    char        backlog[UPLINK_PAYLOAD_MAX + sizeof(UPLINK_QUEUED_JSON)];   // Queued report being resent
+#if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_HTTP)
+    char        message[MSG_LEN];                                           // HTTP request, then response
+#endif
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+    char        batch[UPLINK_BATCH_BYTES];                                  // Reports waiting to go out together
+#endif
+#if UPLINK_THREADED
+    char        ring[MBED_APP_CONF_UPLINK_THREAD_QUEUE][UPLINK_REPORT_BYTES];  // Reports waiting for the uplink thread
+    char        pending[UPLINK_REPORT_BYTES];                               // Report the uplink thread is sending
+#if (MBED_APP_CONF_UPLINK_OVERFLOW == UPLINK_OVERFLOW_COALESCE)
+    char        staging[2][UPLINK_REPORT_BYTES];                            // Reports merged while the ring is full, and its copy
+#endif
+#endif
+} UplinkBuffers_t;
+
+static UplinkBuffers_t  uplinkBuffers;
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+/* The longest event report has every channel with the longest name and value and every event,
+ * the NUL takes the place of the last '&'. */
+MBED_STATIC_ASSERT(CHN_IDX_COUNT * (sizeof("ORIENTATION_X=-2147483648&") - 1) +
+                   MANHOLE_EVT_COUNT * (sizeof("EVT_MAG_DISTURBANCE=1&") - 1) <= UPLINK_REPORT_BYTES,
+                   "Longest report does not fit in UPLINK_REPORT_BYTES");
+/* The longest periodic report has every channel, every cleared event, the event latency, the
+ * degraded sensors and the signal quality at the ends of the modem ranges. */
+MBED_STATIC_ASSERT(CHN_IDX_COUNT * (sizeof("ORIENTATION_X=-2147483648&") - 1) +
+                   MANHOLE_EVT_COUNT * (sizeof("EVT_MAG_DISTURBANCE=0&") - 1) +
+                   sizeof("EVT_LATENCY=4294967295&DEGRADED=4294967295&RSSI=-113&RSRP=-141&RSRQ=-20") <= UPLINK_REPORT_BYTES,
+                   "Longest periodic report does not fit in UPLINK_REPORT_BYTES");
+#endif
+
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+static UplinkBatch_t    uplinkBatch;
+#endif
+
+#if UPLINK_THREADED
+MBED_STATIC_ASSERT((MBED_APP_CONF_UPLINK_THREAD_QUEUE & (MBED_APP_CONF_UPLINK_THREAD_QUEUE - 1)) == 0,
+                   "uplink-thread-queue must be a power of two");
+
+/* The acquisition loop only queues reports, sending them is up to the uplink thread. */
+static ReportRingSlot_t reportRingSlots[MBED_APP_CONF_UPLINK_THREAD_QUEUE];
+static ReportRing_t     reportRing;
+static rtos::Thread     uplinkThread(osPriorityBelowNormal, UPLINK_THREAD_STACK, NULL, "uplink");
+#endif
+
+#if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+/* Cayenne channel, data type and QoS of each report key. Events are published acknowledged. */
+static const MqttChannel_t mqttChannels[] =
+{
+    /* key,                channel,                                            type,             unit,   qos */
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+    { "TEMPERATURE",         MANHOLE_CHN_TEMPERATURE_OUT,                        "temp",           "c",    0 },
+    { "HUMIDITY",            MANHOLE_CHN_HUMIDITY_OUT,                           "rel_hum",        "p",    0 },
+    { "PRESSURE",            MANHOLE_CHN_PRESSURE_OUT,                           "bp",             "hpa",  0 },
+    { "LIGHT",               MANHOLE_CHN_LIGHT_OUT,                              "lum",            "lux",  0 },
+    { "DISTANCE",            MANHOLE_CHN_DIST_OUT,                               "prox",           "cm",   0 },
+    { "RSSI",                MANHOLE_CHN_RSSI_OUT,                               "rssi",           "dbm",  0 },
+    { "RSRP",                MANHOLE_CHN_RSRP_OUT,                               "rssi",           "dbm",  0 },
+    { "RSRQ",                MANHOLE_CHN_RSRQ_OUT,                               "analog_sensor",  "null", 0 },
+    { "PITCH",               MANHOLE_CHN_PITCH_OUT,                              "analog_sensor",  "null", 0 },
+    { "ROLL",                MANHOLE_CHN_ROLL_OUT,                               "analog_sensor",  "null", 0 },
+    { "HEADING",             MANHOLE_CHN_HEADING_OUT,                            "analog_sensor",  "null", 0 },
+    { "BATTERY",             MANHOLE_CHN_BATTERY_OUT,                            "voltage",        "mv",   0 },
+    { "FLEX",                MANHOLE_CHN_FLEX_OUT,                               "voltage",        "mv",   0 },
+    { "EVT_LATENCY",         MANHOLE_CHN_EVT_LATENCY_OUT,                        "analog_sensor",  "null", 0 },
+    { "DEGRADED",            MANHOLE_CHN_DEGRADED_OUT,                           "analog_sensor",  "null", 1 },
+    { "EVT_COVER_TILT",      MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_COVER_TILT),      "digital_sensor", "d",    1 },
+    { "EVT_FLOOD",           MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_FLOOD),           "digital_sensor", "d",    1 },
+    { "EVT_LIGHT_INGRESS",   MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_LIGHT_INGRESS),   "digital_sensor", "d",    1 },
+    { "EVT_MAG_DISTURBANCE", MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_MAG_DISTURBANCE), "digital_sensor", "d",    1 },
+#else
+    { "Signal",              1,                                                  "analog_sensor",  "null", 0 },
+#endif
+};
+#endif
+
+#if (MBED_APP_CONF_REPORT_FORMAT != REPORT_FORMAT_TEXT)
+/* Channel and kind of each report key in the binary report formats. */
+static const ReportChannel_t reportChannels[] =
+{
+    /* key,                channel,                                            kind */
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+    { "TEMPERATURE",         MANHOLE_CHN_TEMPERATURE_OUT,                        REPORT_KIND_TEMPERATURE },
+    { "HUMIDITY",            MANHOLE_CHN_HUMIDITY_OUT,                           REPORT_KIND_HUMIDITY },
+    { "PRESSURE",            MANHOLE_CHN_PRESSURE_OUT,                           REPORT_KIND_PRESSURE },
+    { "LIGHT",               MANHOLE_CHN_LIGHT_OUT,                              REPORT_KIND_ILLUMINANCE },
+    { "DISTANCE",            MANHOLE_CHN_DIST_OUT,                               REPORT_KIND_DISTANCE_CM },
+    { "RSSI",                MANHOLE_CHN_RSSI_OUT,                               REPORT_KIND_ANALOG },
+    { "RSRP",                MANHOLE_CHN_RSRP_OUT,                               REPORT_KIND_ANALOG },
+    { "RSRQ",                MANHOLE_CHN_RSRQ_OUT,                               REPORT_KIND_ANALOG },
+    { "PITCH",               MANHOLE_CHN_PITCH_OUT,                              REPORT_KIND_ANALOG },
+    { "ROLL",                MANHOLE_CHN_ROLL_OUT,                               REPORT_KIND_ANALOG },
+    { "HEADING",             MANHOLE_CHN_HEADING_OUT,                            REPORT_KIND_DIRECTION },
+    { "BATTERY",             MANHOLE_CHN_BATTERY_OUT,                            REPORT_KIND_VOLTAGE_MV },
+    { "FLEX",                MANHOLE_CHN_FLEX_OUT,                               REPORT_KIND_VOLTAGE_MV },
+    { "EVT_LATENCY",         MANHOLE_CHN_EVT_LATENCY_OUT,                        REPORT_KIND_ANALOG_MILLI },
+    { "DEGRADED",            MANHOLE_CHN_DEGRADED_OUT,                           REPORT_KIND_DIGITAL },
+    { "EVT_COVER_TILT",      MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_COVER_TILT),      REPORT_KIND_DIGITAL },
+    { "EVT_FLOOD",           MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_FLOOD),           REPORT_KIND_DIGITAL },
+    { "EVT_LIGHT_INGRESS",   MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_LIGHT_INGRESS),   REPORT_KIND_DIGITAL },
+    { "EVT_MAG_DISTURBANCE", MANHOLE_CHN_EVENT_OUT(MANHOLE_EVT_MAG_DISTURBANCE), REPORT_KIND_DIGITAL },
+    { "QUEUED",              MANHOLE_CHN_QUEUED_OUT,                             REPORT_KIND_DIGITAL },
+#else
+    { "Signal",              1,                                                  REPORT_KIND_ANALOG },
+    { "QUEUED",              2,                                                  REPORT_KIND_DIGITAL },
+#endif
+};
+#endif
+#endif
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+/* Change-detection table: deadbands, report intervals and grouping per uplink channel. */
+static const ChangeDetectChannel_t manholeChannels[CHN_IDX_COUNT] =
+{
+    /* channel,                      group,                 flags,                  rel, abs deadband,           hyst, min, max */
+    { MANHOLE_CHN_TEMPERATURE_OUT,   SENSOR_ENVIRO_BME280,  CD_FLAG_REPORT_INITIAL, 0,   DISCARD_SENSOR_FLUCT,   0,    0,   0 },
+    { MANHOLE_CHN_PRESSURE_OUT,      SENSOR_ENVIRO_BME280,  CD_FLAG_REPORT_INITIAL, 0,   DISCARD_SENSOR_FLUCT,   0,    0,   0 },
+    { MANHOLE_CHN_HUMIDITY_OUT,      SENSOR_ENVIRO_BME280,  CD_FLAG_REPORT_INITIAL, 0,   DISCARD_SENSOR_FLUCT,   0,    0,   0 },
+    { MANHOLE_CHN_PITCH_OUT,         SENSOR_TILT_LIS3DH,    0,                      0,   TILT_SENSOR_DEADBAND,   0,    0,   0 },
+    { MANHOLE_CHN_ROLL_OUT,          SENSOR_TILT_LIS3DH,    CD_FLAG_ANGLE,          0,   TILT_SENSOR_DEADBAND,   0,    0,   0 },
+    { MANHOLE_CHN_HEADING_OUT,       SENSOR_MAGNT_LIS2MDL,  CD_FLAG_REPORT_INITIAL | CD_FLAG_ANGLE, 0, HEADING_DEADBAND, 0, 0, 0 },
+    { MANHOLE_CHN_LIGHT_OUT,         SENSOR_LIGHT_OPT3001,  CD_FLAG_REPORT_INITIAL, 0,   LIGHT_SENSOR_DEADBAND,  0,    0,   0 },
+    { MANHOLE_CHN_DIST_OUT,          SENSOR_DIST_VL53L1X,   CD_FLAG_REPORT_INITIAL, 0,   DIST_SENSOR_DEADBAND,   0,    0,   0 },
+    { MANHOLE_CHN_BATTERY_OUT,       SENSOR_ANALOG_BATTERY, CD_FLAG_REPORT_INITIAL, 0,   BATTERY_DEADBAND_MV,    0,    0,   BATTERY_HEARTBEAT_MS },
+    { MANHOLE_CHN_FLEX_OUT,          SENSOR_ANALOG_FLEX,    CD_FLAG_REPORT_INITIAL, 0,   FLEX_DEADBAND_MV,       0,    0,   0 },
+};
+
+static ChangeDetect_t   changeDetect;
+
+#if MBED_APP_CONF_SENSOR_FILTER
+/* Per-channel filter stage between driver reads and change detection. */
+static BoxDecimator<4>                                  envFilter[3];
+static FilterChain<MedianFilter<3>, EmaFilter<1> >      lightFilter;
+static MedianFilter<5>                                  distFilter;
+#endif
+
+/* Event rules over the filtered channels; raised events are sent right away. */
+static const EventRule_t manholeEventRules[] =
+{
+    /* event,                        input,          type,                      debounce, baseline shift, trigger,                release */
+    { MANHOLE_EVT_COVER_TILT,        CHN_IDX_PITCH,  EVT_RULE_ANGLE_DEVIATION,  1,        0,              COVER_TILT_EVT_TRIGGER, COVER_TILT_EVT_RELEASE },
+    { MANHOLE_EVT_COVER_TILT,        CHN_IDX_ROLL,   EVT_RULE_ANGLE_DEVIATION,  1,        0,              COVER_TILT_EVT_TRIGGER, COVER_TILT_EVT_RELEASE },
+    { MANHOLE_EVT_FLOOD,             CHN_IDX_DIST,   EVT_RULE_DROP,             2,        6,              FLOOD_EVT_TRIGGER,      FLOOD_EVT_RELEASE },
+    { MANHOLE_EVT_LIGHT_INGRESS,     CHN_IDX_LIGHT,  EVT_RULE_RISE,             1,        4,              LIGHT_EVT_TRIGGER,      LIGHT_EVT_RELEASE },
+    { MANHOLE_EVT_MAG_DISTURBANCE,   CHN_IDX_FIELD,  EVT_RULE_DEVIATION,        2,        5,              MAG_EVT_TRIGGER,        MAG_EVT_RELEASE },
+};
+
+#define EVT_RULE_COUNT  ((int) (sizeof(manholeEventRules) / sizeof(manholeEventRules[0])))
+
+static EventDetect_t    eventDetect;
+
+/* Per-sensor operating modes of the selected acquisition profile. */
+static SensorPower_t    sensorPower;
+
+/* Battery and flex ADC inputs. */
+static const AnalogCal_t    batteryCal  = { BATTERY_DIVIDER_FULL_SCALE_MV, 0 };
+static const AnalogCal_t    flexCal     = { ANALOG_ADC_FULL_SCALE_MV, 0 };
+static AnalogMonitor_t      analogMon;
+
+/* Accelerometer + magnetometer fusion, low-passes both vectors itself. */
+static OrientationFusion_t  orientFusion;
+
+/* Per-sensor error counts and in-place re-initialization. */
+static ManholeSensors_t     manholeSensors;
+static SensorHealth_t       sensorHealth;
+
+/* Every sample of every channel, oldest evicted first. */
+static TsBlock_t            historyBlocks[HISTORY_BLOCKS];
+static TimeSeries_t         history;
+
+#if MBED_APP_CONF_SENSOR_REPLAY
+  #define REPLAY_QUIET      { 0, 0, 1000 }, { 200, 0, -400 }, 21, 1013, 45, 5, 120, 3900, 1000, REPLAY_VALID_ALL
+
+/* Replayed instead of the sensors: a quiet cover, a lift, a rising water level and a magnet held close. */
+static const SensorFrame_t  replayTrace[] =
+{
+    /* acc mg,              mag,                temp, hPa,  %RH, lux, cm,  battery, flex, valid */
+    { REPLAY_QUIET },
+    { REPLAY_QUIET },
+    { REPLAY_QUIET },
+    { REPLAY_QUIET },
+    { { 0, 500, 866 },      { 200, 0, -400 },   21,   1013, 45,  400, 120, 3900,    1000, REPLAY_VALID_ALL },
+    { { 0, 707, 707 },      { 200, 0, -400 },   21,   1013, 45,  800, 120, 3900,    1000, REPLAY_VALID_ALL },
+    { { 0, 500, 866 },      { 200, 0, -400 },   21,   1013, 45,  400, 120, 3900,    1000, REPLAY_VALID_ALL },
+    { REPLAY_QUIET },
+    { REPLAY_QUIET },
+    { { 0, 0, 1000 },       { 200, 0, -400 },   20,   1013, 60,  5,   100, 3900,    1000, REPLAY_VALID_ALL },
+    { { 0, 0, 1000 },       { 200, 0, -400 },   19,   1013, 75,  5,   80,  3900,    1000, REPLAY_VALID_ALL },
+    { { 0, 0, 1000 },       { 200, 0, -400 },   19,   1013, 85,  5,   70,  3890,    1000, REPLAY_VALID_ALL },
+    { { 0, 0, 1000 },       { 200, 0, -400 },   19,   1013, 85,  5,   70,  3890,    1000, REPLAY_VALID_ALL & ~REPLAY_VALID_DIST },
+    { { 0, 0, 1000 },       { 200, 0, -400 },   20,   1013, 60,  5,   120, 3890,    1000, REPLAY_VALID_ALL },
+    { { 0, 0, 1000 },       { 600, 300, -900 }, 21,   1013, 45,  5,   120, 3890,    1000, REPLAY_VALID_ALL },
+    { { 0, 0, 1000 },       { 600, 300, -900 }, 21,   1013, 45,  5,   120, 3890,    1000, REPLAY_VALID_ALL },
+    { { 0, 0, 1000 },       { 600, 300, -900 }, 21,   1013, 45,  5,   120, 3890,    1000, REPLAY_VALID_ALL },
+    { REPLAY_QUIET },
+    { REPLAY_QUIET },
+    { REPLAY_QUIET },
+};
+
+static SensorReplay_t       sensorReplay;
+#endif
+
+#if MBED_APP_CONF_LATENCY_BENCH_CYCLES
+/* Per-stage latency benchmark, same order as BenchStage_e. */
+static const char* const    benchStageNames[BENCH_STAGE_COUNT] =
+{
+    "WAKE", "TILT", "ENV", "LIGHT", "DIST", "MAGN", "ANALOG", "FUSE",
+    "FILTER", "DETECT", "EVENT_SEND", "PAYLOAD", "SEND", "SUPERVISE", "CYCLE"
+};
+static uint32_t             benchSamplesUs[BENCH_STAGE_COUNT * MBED_APP_CONF_LATENCY_BENCH_CYCLES];
+static StageBench_t         stageBench;
+#endif
+#endif
+
 /*****************************************************************************************************************************************************
  *
  * L O C A L   F U N C T I O N   D E F I N I T I O N S
@@ -220,7 +722,7 @@ static char time_st[50];
 
 static char* trace_time(size_t ss)
 {
-    snprintf(time_st, 49, "[%08llums]", Kernel::get_ms_count());
+    snprintf(time_st, 49, "[%08llums]", (unsigned long long) Kernel::get_ms_count());
     return time_st;
 }
 
@@ -372,397 +874,1000 @@ void blink_led(
     for (int i = 0; i < aCount; i++)
     {
         ledsPtr[0] = ledsPtr[1] = LED_ON;
-        ThisThread::sleep_for(200);
+        platform_sleep_ms(200);
         ledsPtr[0] = ledsPtr[1] = LED_OFF;
-        ThisThread::sleep_for(400);
+        platform_sleep_ms(400);
     }
 }
 
 /* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_SIGNAL)
-int send_dweet_signal(const char *key, int val)
+#if defined(LIVE_NETWORK) && ((MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_SIGNAL) || (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE))
+/**
+ * Logs heap use, the high-water mark covers everything allocated since reset. The uplink path
+ * allocates nothing per report, so it should not move once the network is up.
+ */
+static void log_heap_stats(const char* aWhen)
 {
-    TCPSocket   socket;
+#if MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t   heap;
 
-    int result;
-    int bytes;
-    int retValue    = 0;
+    mbed_stats_heap_get(&heap);
+    LOG_HI("Heap %s: %u bytes in use, %u max, %u allocations, %u failed", aWhen,
+           (unsigned) heap.current_size, (unsigned) heap.max_size, (unsigned) heap.alloc_cnt, (unsigned) heap.alloc_fail_cnt);
+#else
+    (void) aWhen;
+#endif
+}
 
-    char*   message     = (char*) malloc(MSG_LEN);
-    char*   response    = (char*) malloc(MSG_LEN);
-    if (NULL == message ||
-        NULL == response)
-    {
-        LOG_HI("ERROR: Failed to allocate buffer(s)");
-        retValue    = -1;
-        goto FuncExit;
-    }
-    memset(message, 0, MSG_LEN);
-    memset(response, 0, MSG_LEN);
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-    socket.set_timeout(30000);
+/**
+ * Logs the deepest stack use of every thread, to check UPLINK_THREAD_STACK against a TLS handshake.
+ */
+static void log_stack_stats(void)
+{
+#if MBED_STACK_STATS_ENABLED
+    mbed_stats_stack_t  stack[STACK_STATS_THREADS];
+    int                 count   = mbed_stats_stack_get_each(stack, STACK_STATS_THREADS);
 
-    /* create the socket */
-    LOG_HI("socket.open...");
-    result  = socket.open(interface);
-    if (result < 0)
+    for (int i = 0; i < count; i++)
     {
-        LOG_WARN("Failed to open TCP Socket ... error = %d", result);
-        retValue    = -1;
-        goto FuncExit;
+        LOG_HI("Stack of %s: %u of %u bytes used", osThreadGetName((osThreadId_t) (uintptr_t) stack[i].thread_id),
+               (unsigned) stack[i].max_size, (unsigned) stack[i].reserved_size);
     }
+#endif
+}
 
-    /* connect the socket */
-    LOG_HI("socket.connect...");
-    result  = socket.connect(SERVER_NAME, 80);
-    if (result < 0)
-    {
-        LOG_WARN("Failed to connect with %s ... error = %d", SERVER_NAME, result);
-        retValue    = -1;
-        goto FuncExit;
-    }
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-    // compose GET message buffer
-    bytes = snprintf(message, MSG_LEN, "GET /dweet/for/" MBED_APP_CONF_DWEET_PAGE "?%s=%d HTTP/1.1\nHost: dweet.io\r\nConnection: close\r\n\r\n", key, val);
-    message[bytes] = 0;
+/* FNV-1a of the address given by the network, to seed rand() */
+static uint32_t ip_hash(const char* aIp)
+{
+    uint32_t    hash    = 2166136261UL;
 
-    LOG_HI("socket.send...");
-    result  = socket.send(message, strlen(message));
-    if (result < 0)
+    while (NULL != aIp && '\0' != *aIp)
     {
-        LOG_WARN("Failed to send HTTP request ... error = %d", result);
-        retValue    = -1;
-        goto FuncExit;
+        hash    = (hash ^ (uint8_t) *aIp++) * 16777619UL;
     }
+    return hash;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-    /* receive the response */
-    memset(response, 0, MSG_LEN);
+/**
+ * Sends one report or JSON batch over the transport selected by uplink-transport. Over HTTP a
+ * report is the query string of a GET to the dweet page and a batch is POSTed. Over CoAP both
+ * are POSTed to coap-server, as text/plain and application/json, or a report in the binary
+ * report-format. Over MQTT each value of a report is published to its Cayenne channel.
+ *
+ * @return 0 when the server took the report, or refused it for good with an HTTP 4xx status.
+ */
+static int uplink_transport_send(char* aPayload)
+{
+#if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_COAP)
+#if (MBED_APP_CONF_REPORT_FORMAT != REPORT_FORMAT_TEXT)
+    uint8_t encoded[REPORT_BINARY_MAX];
+    int     len;
 
-    LOG_HI("socket.recv...");
-    result  = socket.recv(response, MSG_LEN - 1);
-    if (result < 0)
+    if (false == UPLINK_IS_BATCH(aPayload))
     {
-        LOG_WARN("Failed to receive HTTP response, error = %d", result);
-        retValue    = -1;
-        goto FuncExit;
+        len = report_encode_text(REPORT_BINARY_FORMAT, reportChannels, sizeof(reportChannels) / sizeof(reportChannels[0]),
+                                 aPayload, encoded, sizeof(encoded));
+        if (len >= 0)
+        {
+            return coap_client_post(&coapClient, encoded, len, REPORT_BINARY_FORMAT->coapFormat);
+        }
+        LOG_WARN("Report does not fit in %u bytes as %s, sent as text", (unsigned) sizeof(encoded), REPORT_BINARY_FORMAT->name);
     }
-    // LOG_HI("Socket received: %s", response);
+#endif
+    return coap_client_post(&coapClient, (const uint8_t*) aPayload, strlen(aPayload),
+                            UPLINK_IS_BATCH(aPayload) ? COAP_FORMAT_JSON : COAP_FORMAT_TEXT);
+#elif (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+    return mqtt_uplink_publish(&mqttUplink, aPayload);
+#else
+    char*   message     = uplinkBuffers.message;
+    int     result;
 
-FuncExit:
-    LOG_HI("socket.close...");
-    socket.close();
-    if (NULL != message)
+    if (UPLINK_IS_BATCH(aPayload))
     {
-        free((void*) message);
+        result  = http_conn_post(&dweetConn, DWEET_PATH, "application/json", aPayload, strlen(aPayload), message, MSG_LEN);
     }
-    if (NULL != response)
+    else
     {
-        free((void*) response);
+        result  = http_conn_get(&dweetConn, DWEET_PATH, aPayload, message, MSG_LEN);
     }
-    return retValue;
-}
-#endif /*#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_SIGNAL)*/
-
-#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
-char* manhole_channel_enum(int aChannel)
-{
-    char*   enum_string = NULL;
-
-    switch(aChannel)
+    if (result >= 400 && result < 500 && 408 != result && 429 != result)
     {
-        case MANHOLE_CHN_HEARTBEAT_OUT:
-            enum_string = (char*) "HEARTBEAT";
-            break;
-        case MANHOLE_CHN_TEMPERATURE_OUT:
-            enum_string = (char*) "TEMPERATURE";
-            break;
-        case MANHOLE_CHN_HUMIDITY_OUT:
-            enum_string = (char*) "HUMIDITY";
-            break;
-        case MANHOLE_CHN_PRESSURE_OUT:
-            enum_string = (char*) "PRESSURE";
-            break;
-        case MANHOLE_CHN_ORIENTATION_X_OUT:
-            enum_string = (char*) "ORIENTATION_X";
-            break;
-        case MANHOLE_CHN_ORIENTATION_Y_OUT:
-            enum_string = (char*) "ORIENTATION_Y";
-            break;
-        case MANHOLE_CHN_ORIENTATION_Z_OUT:
-            enum_string = (char*) "ORIENTATION_Z";
-            break;
-        case MANHOLE_CHN_LIGHT_OUT:
-            enum_string = (char*) "LIGHT";
-            break;
-        case MANHOLE_CHN_DIST_OUT:
-            enum_string = (char*) "DISTANCE";
-            break;
-        case MANHOLE_CHN_RSSI_OUT:
-            enum_string = (char*) "RSSI";
-            break;
-        case MANHOLE_CHN_MAG_X_OUT:
-            enum_string = (char*) "MAG_X";
-            break;
-        case MANHOLE_CHN_MAG_Y_OUT:
-            enum_string = (char*) "MAG_Y";
-            break;
-        case MANHOLE_CHN_MAG_Z_OUT:
-            enum_string = (char*) "MAG_Z";
-            break;
-        default:
-            LOG_ERROR("%s: Invalid channel (%d) selection", __func__, aChannel);
-            break;
+        /* Sending it again would be refused again, and hold up the reports queued behind it */
+        LOG_WARN("Report refused by the server (HTTP %d), dropped", result);
+        return 0;
     }
 
-    return enum_string;
+    return (result >= 200 && result < 300) ? 0 : -1;
+#endif
 }
 
-int sendSensorReadings(char* readings)
-{
-    TCPSocket   socket;
-
-    int result;
-    int bytes;
-    int retValue    = 0;
-    char*   message     = (char*) malloc(MSG_LEN);
-    char*   response    = (char*) malloc(MSG_LEN);
-
-    static bool resolved = 0;
-    static SocketAddress addr_resolved;
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-    if (NULL == message ||
-        NULL == response)
-    {
-        LOG_HI("ERROR: Failed to allocate buffer(s)");
-        retValue    = -1;
-        goto FuncExit;
-    }
-    memset(message, 0, MSG_LEN);
-    memset(response, 0, MSG_LEN);
+/**
+ * Copies what the uplink found out about the link. The uplink may run on its own thread, so the
+ * copy is taken in one piece.
+ */
+static void uplink_status_get(UplinkStatus_t* aStatus)
+{
+    core_util_critical_section_enter();
+    *aStatus    = uplinkStatus;
+    core_util_critical_section_exit();
+}
 
-    socket.set_timeout(30000);
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-    if (!resolved)
-    {
-        LOG_HI("Resolve addresee...");
-        result = interface->gethostbyname(SERVER_NAME, &addr_resolved);
-        if (result < 0)
-        {
-            LOG_WARN("Failed to resolve address with error = %d", result);
-            retValue    = -1;
-            goto FuncExit2;
-        }
-        addr_resolved.set_port(80);
-        resolved = 1;
-    }
+#if UPLINK_TIMING
+/**
+ * Every UPLINK_TIMING_PERIOD_MS the phase histograms of the dweet connection are printed over RTT
+ * and their percentiles kept for the next periodic report, then a new window starts.
+ */
+static void uplink_timing_poll(void)
+{
+    UplinkTiming_t* timing  = &dweetConn.timing;
+    int32_t         phaseMs[UPLINK_PHASE_COUNT];
 
-    /* create the socket */
-    LOG_HI("socket.open...");
-    result  = socket.open(interface);
-    if (result < 0)
+    if ((platform_now_ms() - uplinkTimingMs) < UPLINK_TIMING_PERIOD_MS)
     {
-        LOG_WARN("Failed to open TCP Socket ... error = %d", result);
-        retValue    = -1;
-        goto FuncExit;
+        return;
     }
+    uplinkTimingMs  = platform_now_ms();
 
-    /* connect the socket */
-    LOG_HI("socket.connect...");
-    result  = socket.connect(addr_resolved);
-    if (result < 0)
+    uplink_timing_report(timing);
+    for (int i = 0; i < UPLINK_PHASE_COUNT; i++)
     {
-        LOG_WARN("Failed to connect with %s ... error = %d", SERVER_NAME, result);
-        retValue    = -1;
-        goto FuncExit;
+        phaseMs[i]  = timing->phase[i].count ? (int32_t) uplink_timing_percentile(timing, (UplinkPhase_e) i, UPLINK_TIMING_PERCENT) : -1;
     }
+    uplink_timing_clear(timing);
 
-    // TODO: may be retry GET if HTTP request or response is in error
-
-    // compose GET message buffer
-    bytes = snprintf(message, MSG_LEN, "GET /dweet/for/" MBED_APP_CONF_DWEET_PAGE "?%s HTTP/1.1\nHost: dweet.io\r\nConnection: close\r\n\r\n", readings);
-    message[bytes] = 0;
+    core_util_critical_section_enter();
+    memcpy(uplinkStatus.phaseMs, phaseMs, sizeof(phaseMs));
+    uplinkStatus.timingWindows++;
+    core_util_critical_section_exit();
+}
 
-    LOG_HI("socket.send...");
-    result  = socket.send(message, strlen(message));
-    if (result < 0)
-    {
-        LOG_WARN("Failed to send HTTP request ... error = %d", result);
-        retValue    = -1;
-        goto FuncExit;
-    }
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+#endif
 
-    /* receive the response */
-    memset(response, 0, MSG_LEN);
+/**
+ * One send through aSend, its outcome goes to the retry policy. A failure counts as link-level
+ * when the cellular link is no longer up or a DNS lookup failed on the way, an outage of the
+ * server alone leaves both working. Only a run of link-level failures resets the system, and
+ * the modem with it.
+ */
+static int uplink_attempt(
+    char*   aPayload,
+    int     (*aSend)(char* aReadings))
+{
+    uint32_t    dnsFailures = dnsCache.stats.failures;
+    bool        linkDown;
 
-    LOG_HI("socket.recv...");
-    result  = socket.recv(response, MSG_LEN - 1);
-    if (result < 0)
+#if UPLINK_TIMING
+    uplink_timing_poll();
+#endif
+    if (0 == aSend(aPayload))
     {
-        LOG_WARN("Failed to receive HTTP response, error = %d", result);
-        retValue    = -1;
-        goto FuncExit;
+        uplink_retry_success(&uplinkRetry);
+        return 0;
     }
-    // LOG_HI("Socket received: %s", response);
 
-FuncExit:
-    LOG_HI("socket.close...");
-    socket.close();
-    if (NULL != message)
+    linkDown    = (NSAPI_STATUS_GLOBAL_UP != interface->get_connection_status()) || (dnsFailures != dnsCache.stats.failures);
+    if (UPLINK_RETRY_RESET == uplink_retry_failure(&uplinkRetry, platform_now_ms(), linkDown))
     {
-        free((void*) message);
+        LOG_ERROR("Link down for %u attempts in a row", (unsigned) uplinkRetry.linkFailuresInRow);
+        SYSTEM_RECOVERY();
     }
-    if (NULL != response)
-    {
-        free((void*) response);
-    }
-    return retValue;
-
-FuncExit2:
-    return retValue;
+    LOG_WARN("Uplink failure %u in a row (%s), next attempt in %u ms%s", (unsigned) uplinkRetry.failuresInRow,
+             linkDown ? "link" : "server", (unsigned) uplink_retry_wait_ms(&uplinkRetry, platform_now_ms()),
+             (UPLINK_RETRY_OPEN == uplinkRetry.state) ? ", sending parked" : "");
+    return -1;
 }
-#endif
-/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
 /**
- * I2C
- * SCL (Green wire) -> pin 1 on UARTs connector; J3 / ANA2 / P0_2
- * SDA (Blue wire)  -> pin 3 on UARTs connector; J3 / ANA3 / P0_3
+ * Store-and-forward: a report that fails to send is queued in flash. After each successful
+ * send up to UPLINK_DRAIN_BATCH queued reports follow, tagged with UPLINK_QUEUED_TAG. A queued
+ * report is only acked once it was sent, so it may arrive twice but is never lost to a reset.
+ * Queued JSON batches get "queued":1 added. While the retry policy holds sending back, reports
+ * go to the queue without an attempt.
+ *
+ * @return Result of sending aReadings itself.
  */
-
-void rm_i2c_scan(
-    uint8_t    aFoundAddrs[])
+static int uplink_deliver(
+    char*   aReadings,
+    int     (*aSend)(char* aReadings))
 {
-    int addrCount   = 0;
+    char*       backlog = uplinkBuffers.backlog;
+    int         len;
+    bool        allowed = uplink_retry_allow(&uplinkRetry, platform_now_ms());
 
-    I2C i2c((PinName) I2C_SDA0, (PinName) I2C_SCL0);
-    ThisThread::sleep_for(1000);
-    LOG_HI(">>>>>>>>>  START  I2C  ADDR  SCAN  <<<<<<<<<");
-    for(int i = 0; i < 128 ; i++)
+    if (false == allowed || 0 != uplink_attempt(aReadings, aSend))
     {
-        int         addr8bit    = (i << 1);
-        // LOG_HI("I2C scan 8 bit address 0x%02X", addr8bit);
-
-        const char  data        = 1;
-
-        ThisThread::sleep_for(50);
-        i2c.start();
-        if(0 == i2c.write(addr8bit, &data, 1))
+        if (0 == uplink_queue_push(&uplinkQueue, aReadings, strlen(aReadings)))
         {
-            LOG_HI("0x%02X ACK", addr8bit);
-            aFoundAddrs[addrCount++]    = addr8bit;
+            LOG_WARN("Report queued%s, %u pending", allowed ? "" : " without trying, sending held back",
+                     (unsigned) uplink_queue_pending(&uplinkQueue));
         }
-        i2c.stop();
+        return -1;
     }
-    LOG_HI(">>>>>>>>>  FINISHED  I2C  ADDR  SCAN  <<<<<<<<<");
-}
-
-/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
 
-void update_sensor_params(
-    SensorSelect_e  aSensor,
-    int             aValNew[],
-    int             aValOld[],
-    int             aValSend[],
-    bool*           aIsSendUpdate)
-{
-    switch (aSensor)
+    for (int i = 0; i < UPLINK_DRAIN_BATCH; i++)
     {
-        case SENSOR_LIGHT_OPT3001:
-        case SENSOR_DIST_VL53L1X:
+        len = uplink_queue_peek(&uplinkQueue, backlog, UPLINK_PAYLOAD_MAX);
+        if (len <= 0)
         {
-            if ( CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > 10 )
+            if (len < 0)
             {
-                if(false == *aIsSendUpdate)
-                {
-                    aValSend[0] = aValNew[0];
-                }
-                else if (CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > CALC_ABSOLUTE_DIFF(aValOld[0], aValSend[0]))
-                {
-                    aValSend[0] = aValNew[0];
-                }
-                *aIsSendUpdate    = true;
+                /* Cannot be sent with this build, do not let it block the queue */
+                uplink_queue_skip(&uplinkQueue);
+                LOG_WARN("Queued report unreadable or too long, dropped, %u pending", (unsigned) uplink_queue_pending(&uplinkQueue));
             }
             break;
         }
-
-        case SENSOR_TILT_LIS3DH:
+        if (UPLINK_IS_BATCH(backlog))
         {
-            if ( CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > 8 ||
-                 CALC_ABSOLUTE_DIFF(aValNew[1], aValOld[1]) > 8 ||
-                 CALC_ABSOLUTE_DIFF(aValNew[2], aValOld[2]) > 8 )
-            {
-                LOG_WARN("Tilt REMOVED X, Y, Z = %d, %d, %d vs %d, %d, %d",
-                         aValNew[TILT_IDX_X], aValNew[TILT_IDX_Y], aValNew[TILT_IDX_Z],
-                         aValOld[TILT_IDX_X], aValOld[TILT_IDX_Y], aValOld[TILT_IDX_Z]);
-                if(false == *aIsSendUpdate)
-                {
-                    UPDATE_SENSOR_READS(aValSend, aValNew);
-                }
-                else if (CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > CALC_ABSOLUTE_DIFF(aValOld[0], aValSend[0]) ||
-                         CALC_ABSOLUTE_DIFF(aValNew[1], aValOld[1]) > CALC_ABSOLUTE_DIFF(aValOld[1], aValSend[1]) ||
-                         CALC_ABSOLUTE_DIFF(aValNew[2], aValOld[2]) > CALC_ABSOLUTE_DIFF(aValOld[2], aValSend[2]))
-                {
-                    UPDATE_SENSOR_READS(aValSend, aValNew);
-                }
-                *aIsSendUpdate    = true;
-            }
+            /* Replaces the closing brace */
+            strcpy(backlog + len - 1, UPLINK_QUEUED_JSON);
+        }
+        else
+        {
+            strcpy(backlog + len, UPLINK_QUEUED_TAG);
+        }
+        if (0 != uplink_attempt(backlog, aSend))
+        {
+            break;
+        }
+        uplink_queue_ack(&uplinkQueue);
+        LOG_HI("Queued report delivered, %u pending", (unsigned) uplink_queue_pending(&uplinkQueue));
+    }
+
+#if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_COAP)
+    LOG_HI("CoAP: %u requests in %u messages, %u retransmitted, %u bytes sent, %u received, last %u ms",
+           (unsigned) coapClient.stats.requests, (unsigned) coapClient.stats.messages,
+           (unsigned) coapClient.stats.retransmits, (unsigned) coapClient.stats.bytesTx,
+           (unsigned) coapClient.stats.bytesRx, (unsigned) coapClient.stats.lastRttMs);
+#elif (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+    LOG_HI("MQTT: %u reports in %u publishes (%u acked, last %u ms) on %u sessions, %u bytes sent, %u received",
+           (unsigned) mqttUplink.stats.reports, (unsigned) mqttUplink.stats.publishes,
+           (unsigned) mqttUplink.stats.acked, (unsigned) mqttUplink.stats.lastAckMs,
+           (unsigned) mqttUplink.stats.connects, (unsigned) mqttUplink.stats.bytesTx,
+           (unsigned) mqttUplink.stats.bytesRx);
+#else
+    LOG_HI("HTTP: %u requests on %u connections, %u bytes sent, %u received",
+           (unsigned) dweetConn.stats.requests, (unsigned) dweetConn.stats.connects,
+           (unsigned) dweetConn.stats.bytesTx, (unsigned) dweetConn.stats.bytesRx);
+    LOG_HI("HTTP: %u ms on average, %u ms at most, %u resent, %u refused, failed to connect %u, to send %u, to receive %u",
+           (unsigned) (dweetConn.stats.requests ? dweetConn.stats.totalMs / dweetConn.stats.requests : 0),
+           (unsigned) dweetConn.stats.maxMs, (unsigned) dweetConn.stats.retries,
+           (unsigned) dweetConn.stats.rejected, (unsigned) dweetConn.stats.connectFailures,
+           (unsigned) dweetConn.stats.sendFailures, (unsigned) dweetConn.stats.recvFailures);
+#endif
+#if MBED_APP_CONF_UPLINK_TLS
+    LOG_HI("TLS: %u full handshakes, %u resumed, %u failed, %u ms and %u bytes on average, last %u ms and %u bytes, %u bytes sent, %u received",
+           (unsigned) uplinkTls.stats.handshakes, (unsigned) uplinkTls.stats.resumed, (unsigned) uplinkTls.stats.failures,
+           (unsigned) ((uplinkTls.stats.handshakes + uplinkTls.stats.resumed) ?
+                       uplinkTls.stats.handshakeMs / (uplinkTls.stats.handshakes + uplinkTls.stats.resumed) : 0),
+           (unsigned) ((uplinkTls.stats.handshakes + uplinkTls.stats.resumed) ?
+                       uplinkTls.stats.handshakeBytes / (uplinkTls.stats.handshakes + uplinkTls.stats.resumed) : 0),
+           (unsigned) uplinkTls.stats.lastHandshakeMs, (unsigned) uplinkTls.stats.lastHandshakeBytes,
+           (unsigned) uplinkTls.stats.bytesTx, (unsigned) uplinkTls.stats.bytesRx);
+#endif
+    LOG_HI("Retry: %u attempts, %u failed (%u link-level), %u held back, breaker opened %u times",
+           (unsigned) uplinkRetry.stats.attempts, (unsigned) uplinkRetry.stats.failures,
+           (unsigned) uplinkRetry.stats.linkFailures, (unsigned) uplinkRetry.stats.deferred,
+           (unsigned) uplinkRetry.stats.opens);
+
+    log_heap_stats("after uplink");
+    log_stack_stats();
+
+    /* The report is out, renew addresses close to expiry now rather than on the next send */
+    dns_cache_refresh(&dnsCache);
+    return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+/**
+ * Sends the pending batch, if any, through uplink_deliver().
+ */
+static int uplink_flush(void)
+{
+    char*   body;
+    int     result;
+
+    if (uplink_batch_empty(&uplinkBatch))
+    {
+        return 0;
+    }
+
+    body    = uplink_batch_close(&uplinkBatch, platform_now_ms());
+    LOG_HI("Batch of %u reports, %u bytes", (unsigned) uplinkBatch.count, (unsigned) strlen(body));
+    result  = uplink_deliver(body, uplink_transport_send);
+    uplink_batch_reset(&uplinkBatch);
+    return result;
+}
+#endif
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Entry point of all reports. With uplink-batch-samples set, a report joins the pending batch,
+ * which is sent once it holds that many reports, its first report is uplink-batch-age-s old, it
+ * is full or aUrgent is set. Otherwise the report is delivered at once with aSend.
+ *
+ * @return -1 when a send was attempted and failed, the report is then queued.
+ */
+static int uplink_submit(
+    char*   aReadings,
+    bool    aUrgent,
+    int     (*aSend)(char* aReadings))
+{
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+    int     result  = 0;
+
+    if (0 != uplink_batch_add(&uplinkBatch, platform_now_ms(), aReadings, aUrgent))
+    {
+        /* No room left, the batch goes now and the report starts the next one */
+        result  = uplink_flush();
+        if (0 != uplink_batch_add(&uplinkBatch, platform_now_ms(), aReadings, aUrgent))
+        {
+            LOG_WARN("Report too long for a batch, sent alone");
+            return uplink_deliver(aReadings, aSend);
+        }
+    }
+
+    if (uplink_batch_due(&uplinkBatch, platform_now_ms()))
+    {
+        result |= uplink_flush();
+    }
+    return result;
+#else
+    (void) aUrgent;
+    return uplink_deliver(aReadings, aSend);
+#endif
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+/**
+ * Samples the link quality when it is due, sends a batch that got old without new reports and
+ * keeps the MQTT session alive, to be called once per loop.
+ */
+static void uplink_poll(void)
+{
+    const LinkPolicy_t* policy;
+    bool                levelChanged    = link_quality_poll(&linkQuality, platform_now_ms());
+
+    /* linkQuality belongs to the uplink, the acquisition loop only sees what is published here */
+    if (linkQuality.samples != uplinkStatus.linkSamples)
+    {
+        core_util_critical_section_enter();
+        uplinkStatus.link           = linkQuality.last;
+        uplinkStatus.linkSamples    = linkQuality.samples;
+        uplinkStatus.linkLevel      = linkQuality.level;
+        core_util_critical_section_exit();
+    }
+
+    if (levelChanged)
+    {
+        policy  = &linkPolicy[linkQuality.level];
+        LOG_WARN("Link %s (RSSI %d dBm, RSRP %d dBm, RSRQ %d dB), report interval x%u, batches of %u",
+                 link_level_name(linkQuality.level), linkQuality.last.rssiDbm, linkQuality.last.rsrpDbm,
+                 linkQuality.last.rsrqDb, (unsigned) policy->intervalFactor,
+                 (unsigned) (MBED_APP_CONF_UPLINK_BATCH_SAMPLES * policy->batchFactor));
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+        uplink_batch_set_limits(&uplinkBatch, MBED_APP_CONF_UPLINK_BATCH_SAMPLES * policy->batchFactor,
+                                MBED_APP_CONF_UPLINK_BATCH_AGE_S * 1000UL * policy->batchFactor);
+#endif
+    }
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+    if (uplink_batch_due(&uplinkBatch, platform_now_ms()))
+    {
+        uplink_flush();
+    }
+#endif
+#if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+    mqtt_uplink_poll(&mqttUplink);
+#endif
+}
+#endif
+#endif
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_SIGNAL)
+int send_dweet_readings(char* aReadings)
+{
+    return uplink_transport_send(aReadings);
+}
+
+int send_dweet_signal(const char *key, int val)
+{
+    char    readings[64];
+
+    snprintf(readings, sizeof(readings), "%s=%d", key, val);
+    return uplink_submit(readings, false, send_dweet_readings);
+}
+#endif /*#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_SIGNAL)*/
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+char* manhole_channel_enum(int aChannel)
+{
+    char*   enum_string = NULL;
+
+    switch(aChannel)
+    {
+        case MANHOLE_CHN_HEARTBEAT_OUT:
+            enum_string = (char*) "HEARTBEAT";
+            break;
+        case MANHOLE_CHN_TEMPERATURE_OUT:
+            enum_string = (char*) "TEMPERATURE";
+            break;
+        case MANHOLE_CHN_HUMIDITY_OUT:
+            enum_string = (char*) "HUMIDITY";
+            break;
+        case MANHOLE_CHN_PRESSURE_OUT:
+            enum_string = (char*) "PRESSURE";
+            break;
+        case MANHOLE_CHN_ORIENTATION_X_OUT:
+            enum_string = (char*) "ORIENTATION_X";
+            break;
+        case MANHOLE_CHN_ORIENTATION_Y_OUT:
+            enum_string = (char*) "ORIENTATION_Y";
+            break;
+        case MANHOLE_CHN_ORIENTATION_Z_OUT:
+            enum_string = (char*) "ORIENTATION_Z";
+            break;
+        case MANHOLE_CHN_LIGHT_OUT:
+            enum_string = (char*) "LIGHT";
+            break;
+        case MANHOLE_CHN_DIST_OUT:
+            enum_string = (char*) "DISTANCE";
+            break;
+        case MANHOLE_CHN_RSSI_OUT:
+            enum_string = (char*) "RSSI";
+            break;
+        case MANHOLE_CHN_RSRP_OUT:
+            enum_string = (char*) "RSRP";
+            break;
+        case MANHOLE_CHN_RSRQ_OUT:
+            enum_string = (char*) "RSRQ";
+            break;
+        case MANHOLE_CHN_MAG_X_OUT:
+            enum_string = (char*) "MAG_X";
+            break;
+        case MANHOLE_CHN_MAG_Y_OUT:
+            enum_string = (char*) "MAG_Y";
+            break;
+        case MANHOLE_CHN_MAG_Z_OUT:
+            enum_string = (char*) "MAG_Z";
+            break;
+        case MANHOLE_CHN_PITCH_OUT:
+            enum_string = (char*) "PITCH";
+            break;
+        case MANHOLE_CHN_ROLL_OUT:
+            enum_string = (char*) "ROLL";
+            break;
+        case MANHOLE_CHN_HEADING_OUT:
+            enum_string = (char*) "HEADING";
+            break;
+        case MANHOLE_CHN_BATTERY_OUT:
+            enum_string = (char*) "BATTERY";
+            break;
+        case MANHOLE_CHN_FLEX_OUT:
+            enum_string = (char*) "FLEX";
+            break;
+        default:
+            LOG_ERROR("%s: Invalid channel (%d) selection", __func__, aChannel);
+            break;
+    }
+
+    return enum_string;
+}
+
+char* manhole_event_enum(int aEvent)
+{
+    char*   enum_string = NULL;
+
+    switch(aEvent)
+    {
+        case MANHOLE_EVT_COVER_TILT:
+            enum_string = (char*) "EVT_COVER_TILT";
+            break;
+        case MANHOLE_EVT_FLOOD:
+            enum_string = (char*) "EVT_FLOOD";
+            break;
+        case MANHOLE_EVT_LIGHT_INGRESS:
+            enum_string = (char*) "EVT_LIGHT_INGRESS";
             break;
+        case MANHOLE_EVT_MAG_DISTURBANCE:
+            enum_string = (char*) "EVT_MAG_DISTURBANCE";
+            break;
+        default:
+            LOG_ERROR("%s: Invalid event (%d) selection", __func__, aEvent);
+            break;
+    }
+
+    return enum_string;
+}
+
+int sendSensorReadings(char* readings)
+{
+    return uplink_transport_send(readings);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+#if defined(LIVE_NETWORK)
+/**
+ * Called once a report left the device. An event report keeps its sample to delivery time
+ * for the next periodic report.
+ */
+static void uplink_delivered(
+    bool        aUrgent,
+    uint32_t    aSampleMs)
+{
+    uint32_t    latencyMs   = platform_now_ms() - aSampleMs;
+
+    LOG_HI("%s report delivered %u ms after sampling", aUrgent ? "Event" : "Periodic", (unsigned) latencyMs);
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+    if (aUrgent)
+    {
+        core_util_atomic_store_u32(&eventLatencyMs, latencyMs);
+    }
+#endif
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+#if UPLINK_THREADED
+/**
+ * Sends what the acquisition loop queued, so a slow or dead network never holds up sampling.
+ * Runs below the acquisition loop and wakes up on UPLINK_THREAD_FLAG, or every
+ * UPLINK_THREAD_POLL_MS for uplink_poll().
+ */
+static void uplink_thread(void)
+{
+    char*       pending = uplinkBuffers.pending;
+    bool        urgent;
+    uint32_t    sampleMs;
+
+    while (true)
+    {
+        rtos::ThisThread::flags_wait_any_for(UPLINK_THREAD_FLAG, UPLINK_THREAD_POLL_MS);
+        while (report_ring_pop(&reportRing, pending, UPLINK_REPORT_BYTES, &urgent, &sampleMs) >= 0)
+        {
+            if (0 == uplink_submit(pending, urgent, sendSensorReadings))
+            {
+                uplink_delivered(urgent, sampleMs);
+            }
+            else
+            {
+                LOG_WARN("Sending %s report failed", urgent ? "event" : "periodic");
+            }
+        }
+        uplink_poll();
+    }
+}
+#endif
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Hands a report over to the uplink thread, or sends it right away with uplink-thread-queue 0.
+ * A full queue drops its oldest report or merges reports per key, see uplink-overflow.
+ * aSampleMs is when the oldest reading in the report was taken.
+ *
+ * @return -1 when the report was not sent, or not queued.
+ */
+static int uplink_enqueue(
+    char*       aReport,
+    bool        aUrgent,
+    uint32_t    aSampleMs)
+{
+#if UPLINK_THREADED
+    int     result  = report_ring_push(&reportRing, aReport, aUrgent, aSampleMs);
+
+    if (result > 0)
+    {
+        LOG_WARN("Uplink queue full, %u reports dropped, %u coalesced", (unsigned) reportRing.dropped,
+                 (unsigned) reportRing.coalesced);
+    }
+    if (result >= 0)
+    {
+        uplinkThread.flags_set(UPLINK_THREAD_FLAG);
+    }
+    return (result < 0) ? -1 : 0;
+#else
+    if (0 != uplink_submit(aReport, aUrgent, sendSensorReadings))
+    {
+        return -1;
+    }
+    uplink_delivered(aUrgent, aSampleMs);
+    return 0;
+#endif
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+/**
+ * Called once per acquisition loop. Inline it polls the uplink, threaded it queues a report held
+ * back by REPORT_RING_COALESCE once there is room.
+ */
+static void uplink_idle(void)
+{
+#if UPLINK_THREADED
+    uint32_t    pushed  = reportRing.pushed;
+
+    report_ring_flush(&reportRing);
+    if (pushed != reportRing.pushed)
+    {
+        uplinkThread.flags_set(UPLINK_THREAD_FLAG);
+    }
+#else
+    uplink_poll();
+#endif
+}
+#endif // #if defined(LIVE_NETWORK)
+#endif
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+
+/**
+ * I2C
+ * SCL (Green wire) -> pin 1 on UARTs connector; J3 / ANA2 / P0_2
+ * SDA (Blue wire)  -> pin 3 on UARTs connector; J3 / ANA3 / P0_3
+ */
+
+void rm_i2c_scan(
+    uint8_t    aFoundAddrs[])
+{
+    int addrCount   = 0;
+
+    I2C i2c((PinName) I2C_SDA0, (PinName) I2C_SCL0);
+    platform_sleep_ms(1000);
+    LOG_HI(">>>>>>>>>  START  I2C  ADDR  SCAN  <<<<<<<<<");
+    for(int i = 0; i < 128 ; i++)
+    {
+        int         addr8bit    = (i << 1);
+        // LOG_HI("I2C scan 8 bit address 0x%02X", addr8bit);
+
+        const char  data        = 1;
+
+        platform_sleep_ms(50);
+        i2c.start();
+        if(0 == i2c.write(addr8bit, &data, 1))
+        {
+            LOG_HI("0x%02X ACK", addr8bit);
+            aFoundAddrs[addrCount++]    = addr8bit;
+        }
+        i2c.stop();
+    }
+    LOG_HI(">>>>>>>>>  FINISHED  I2C  ADDR  SCAN  <<<<<<<<<");
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+#if MBED_APP_CONF_SENSOR_FILTER
+template <typename FILTER>
+static void filter_channel(
+    FILTER&     aFilter,
+    int         aIdx,
+    int32_t     aVal[],
+    uint32_t*   aValid)
+{
+    if (*aValid & CHN_MASK(aIdx))
+    {
+        if (false == aFilter.update(aVal[aIdx], &aVal[aIdx]))
+        {
+            /* Decimating filter has no output for this sample yet */
+            *aValid &= ~CHN_MASK(aIdx);
+        }
+    }
+}
+
+void filter_sensor_readings(
+    int32_t     aVal[],
+    uint32_t*   aValid)
+{
+    filter_channel(envFilter[0], CHN_IDX_TEMPERATURE, aVal, aValid);
+    filter_channel(envFilter[1], CHN_IDX_PRESSURE, aVal, aValid);
+    filter_channel(envFilter[2], CHN_IDX_HUMIDITY, aVal, aValid);
+    filter_channel(lightFilter, CHN_IDX_LIGHT, aVal, aValid);
+    filter_channel(distFilter, CHN_IDX_DIST, aVal, aValid);
+}
+#endif
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int fuse_orientation(
+    const float     aAccMg[3],
+    const int16_t   aMag[3],
+    Orientation_t*  aOut)
+{
+    int32_t     acc[3];
+    int32_t     mag[3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        acc[i]  = (int32_t) aAccMg[i];
+        mag[i]  = (NULL != aMag) ? aMag[i] : 0;
+    }
+    return orientation_fusion_update(&orientFusion, acc, (NULL != aMag) ? mag : NULL, aOut);
+}
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void stamp_channels(
+    uint32_t    aTimeMs[],
+    uint32_t    aMask)
+{
+    uint32_t    nowMs   = platform_now_ms();
+
+    for (int i = 0; i < CHN_IDX_TOTAL; i++)
+    {
+        if (aMask & CHN_MASK(i))
+        {
+            aTimeMs[i]  = nowMs;
         }
+    }
+}
+
+#if MBED_APP_CONF_SENSOR_REPLAY
+/* Loads one replayed frame the way the sensor reads in demo_loop() would. */
+static void replay_sensor_frame(
+    const SensorFrame_t*    aFrame,
+    int32_t                 aVal[],
+    uint32_t                aTimeMs[],
+    uint32_t*               aValid,
+    float                   aTiltMg[3],
+    int16_t                 aMag[3])
+{
+    uint32_t    valid   = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        aTiltMg[i]  = aFrame->accMg[i];
+        aMag[i]     = aFrame->mag[i];
+    }
+    aVal[CHN_IDX_TEMPERATURE]   = aFrame->temperature;
+    aVal[CHN_IDX_PRESSURE]      = aFrame->pressure;
+    aVal[CHN_IDX_HUMIDITY]      = aFrame->humidity;
+    aVal[CHN_IDX_LIGHT]         = aFrame->light;
+    aVal[CHN_IDX_DIST]          = aFrame->dist;
+    aVal[CHN_IDX_BATTERY]       = aFrame->batteryMv;
+    aVal[CHN_IDX_FLEX]          = aFrame->flexMv;
+
+    valid  |= (aFrame->valid & REPLAY_VALID_ENV) ? CHN_MASK_ENV : 0;
+    valid  |= (aFrame->valid & REPLAY_VALID_LIGHT) ? CHN_MASK(CHN_IDX_LIGHT) : 0;
+    valid  |= (aFrame->valid & REPLAY_VALID_DIST) ? CHN_MASK(CHN_IDX_DIST) : 0;
+    valid  |= (aFrame->valid & REPLAY_VALID_ANALOG) ? CHN_MASK_ANALOG : 0;
+    stamp_channels(aTimeMs, valid);
+    *aValid    |= valid;
+}
+#endif
+
+/* Event ids of the rules in aRuleMask */
+static uint32_t rules_to_events(
+    uint32_t    aRuleMask)
+{
+    uint32_t    events  = 0;
 
-        case SENSOR_ENVIRO_BME280:
+    for (int i = 0; i < EVT_RULE_COUNT; i++)
+    {
+        if (aRuleMask & (1UL << i))
         {
-            if ( CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > DISCARD_SENSOR_FLUCT ||
-                 CALC_ABSOLUTE_DIFF(aValNew[1], aValOld[1]) > DISCARD_SENSOR_FLUCT ||
-                 CALC_ABSOLUTE_DIFF(aValNew[2], aValOld[2]) > DISCARD_SENSOR_FLUCT )
-            {
-                if(false == *aIsSendUpdate)
-                {
-                    UPDATE_SENSOR_READS(aValSend, aValNew);
-                }
-                else if (CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > CALC_ABSOLUTE_DIFF(aValOld[0], aValSend[0]) ||
-                         CALC_ABSOLUTE_DIFF(aValNew[1], aValOld[1]) > CALC_ABSOLUTE_DIFF(aValOld[1], aValSend[1]) ||
-                         CALC_ABSOLUTE_DIFF(aValNew[2], aValOld[2]) > CALC_ABSOLUTE_DIFF(aValOld[2], aValSend[2]))
-                {
-                    UPDATE_SENSOR_READS(aValSend, aValNew);
-                }
-                *aIsSendUpdate    = true;
-            }
-            break;
+            events |= (1UL << manholeEventRules[i].event);
         }
+    }
+    return events;
+}
+
+#if defined(LIVE_NETWORK)
+/**
+ * Priority uplink: sends raised events with a snapshot of all channels, outside of
+ * the periodic DWEET_UPDATE_MS report.
+ */
+static void send_event_report(
+    uint32_t        aRaisedRules,
+    const int32_t   aVal[],
+    uint32_t        aValid,
+    const uint32_t  aTimeMs[])
+{
+    char*       report          = uplinkBuffers.report;
+    int         bytes_written   = 0;
+    uint32_t    events          = rules_to_events(aRaisedRules);
+    uint32_t    sampleMs        = platform_now_ms();
 
-        case SENSOR_MAGNT_LIS2MDL:
+    for (int i = 0; i < EVT_RULE_COUNT; i++)
+    {
+        /* Latency is measured from the oldest sample that raised an event */
+        if ((aRaisedRules & (1UL << i)) &&
+            (int32_t) (aTimeMs[manholeEventRules[i].input] - sampleMs) < 0)
         {
-            if ( CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > 10 ||
-                 CALC_ABSOLUTE_DIFF(aValNew[1], aValOld[1]) > 10 ||
-                 CALC_ABSOLUTE_DIFF(aValNew[2], aValOld[2]) > 10 )
-            {
-                if(false == *aIsSendUpdate)
-                {
-                    UPDATE_SENSOR_READS(aValSend, aValNew);
-                }
-                else if (CALC_ABSOLUTE_DIFF(aValNew[0], aValOld[0]) > CALC_ABSOLUTE_DIFF(aValOld[0], aValSend[0]) ||
-                         CALC_ABSOLUTE_DIFF(aValNew[1], aValOld[1]) > CALC_ABSOLUTE_DIFF(aValOld[1], aValSend[1]) ||
-                         CALC_ABSOLUTE_DIFF(aValNew[2], aValOld[2]) > CALC_ABSOLUTE_DIFF(aValOld[2], aValSend[2]))
-                {
-                    UPDATE_SENSOR_READS(aValSend, aValNew);
-                }
-                *aIsSendUpdate    = true;
-            }
-            break;
+            sampleMs    = aTimeMs[manholeEventRules[i].input];
         }
-        default:
-            LOG_ERROR("%s: Invalid sensor selection %d", __func__, aSensor);
-            break;
+    }
+
+    for (int i = 0; i < 32; i++)
+    {
+        if (events & (1UL << i))
+        {
+            bytes_written += sprintf(report + bytes_written, "%s=1&", manhole_event_enum(i));
+        }
+    }
+    for (int i = 0; i < CHN_IDX_COUNT; i++)
+    {
+        if (aValid & CHN_MASK(i))
+        {
+            bytes_written += sprintf(report + bytes_written, "%s=%d&", manhole_channel_enum(manholeChannels[i].channel), (int) aVal[i]);
+        }
+    }
+
+    report[bytes_written - 1]   = '\0';
+    MBED_ASSERT(bytes_written <= UPLINK_REPORT_BYTES);
+
+    if (0 == uplink_enqueue(report, true, sampleMs))
+    {
+        LOG_WARN("Event report " UPLINK_HANDOFF " %u ms after sampling", (unsigned) (platform_now_ms() - sampleMs));
+    }
+    else
+    {
+        LOG_WARN("Event report not " UPLINK_HANDOFF);
+    }
+}
+#endif // #if defined(LIVE_NETWORK)
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static int health_read_reg(
+    uint8_t     aAddr,
+    uint8_t     aReg,
+    char*       aBuf,
+    int         aLen)
+{
+    char    reg = (char) aReg;
+
+    if (0 != manholeSensors.i2c->write(aAddr, &reg, 1, true))
+    {
+        return -1;
+    }
+    return (0 == manholeSensors.i2c->read(aAddr, aBuf, aLen)) ? 0 : -1;
+}
+
+static int health_probe_tilt(
+    void*   aCtx)
+{
+    ManholeSensors_t*   sensors = (ManholeSensors_t*) aCtx;
+
+    return (I_AM_LIS3DH == sensors->tilt->read_id()) ? 0 : -1;
+}
+
+static int health_probe_env(
+    void*   aCtx)
+{
+    char    id;
+
+    if (0 != health_read_reg(I2C_ENV_SENSOR_ADDR, BME280_REG_CHIP_ID, &id, 1))
+    {
+        return -1;
+    }
+    return (BME280_CHIP_ID == id) ? 0 : -1;
+}
+
+static int health_reinit_env(
+    void*   aCtx)
+{
+    ManholeSensors_t*   sensors = (ManholeSensors_t*) aCtx;
+
+    if (0 != health_probe_env(aCtx))
+    {
+        return -1;
+    }
+    /* Reloads the trimming parameters, the profile settings are restored by the caller */
+    sensors->env->initialize();
+    return 0;
+}
+
+static int health_probe_light(
+    void*   aCtx)
+{
+    char    id[2];
+
+    if (0 != health_read_reg(I2C_LIGHT_SENSOR_ADDR, OPT3001_REG_DEVICE_ID, id, 2))
+    {
+        return -1;
+    }
+    return (OPT3001_DEVICE_ID == (((uint8_t) id[0] << 8) | (uint8_t) id[1])) ? 0 : -1;
+}
+
+static int health_reinit_dist(
+    void*   aCtx)
+{
+    ManholeSensors_t*   sensors = (ManholeSensors_t*) aCtx;
+
+    sensor_power_reset_dist(&sensorPower);
+    return (VL53L1X_SENSOR_ID == sensors->dist->getSensorID()) ? 0 : -1;
+}
+
+static int health_probe_magn(
+    void*   aCtx)
+{
+    ManholeSensors_t*   sensors = (ManholeSensors_t*) aCtx;
+    uint8_t             id      = 0;
+
+    if (0 != sensors->magn->read_id(&id))
+    {
+        return -1;
+    }
+    return (LIS2MDL_WHO_AM_I == id) ? 0 : -1;
+}
+
+static int health_reinit_magn(
+    void*   aCtx)
+{
+    ManholeSensors_t*   sensors = (ManholeSensors_t*) aCtx;
+
+    if (0 != sensors->magn->init(NULL) ||
+        0 != health_probe_magn(aCtx))
+    {
+        return -1;
+    }
+    return (0 == sensors->magn->enable()) ? 0 : -1;
+}
+
+/* Indexed by SensorSelect_e. LIS3DH and OPT3001 keep no state in their drivers, a good identity
+ * check followed by sensor_power_restore() is all they need. The VL53L1X reports its own
+ * timeouts, it is only probed as part of its re-init.
+ */
+static const SensorHealthDriver_t manholeHealthDrivers[SENSOR_HEALTH_COUNT] =
+{
+    /* name         probe                   reinit              */
+    { "LIS3DH",     health_probe_tilt,      health_probe_tilt   },
+    { "BME280",     health_probe_env,       health_reinit_env   },
+    { "OPT3001",    health_probe_light,     health_probe_light  },
+    { "VL53L1X",    NULL,                   health_reinit_dist  },
+    { "LIS2MDL",    health_probe_magn,      health_reinit_magn  },
+};
+
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
+static void select_sensor_profile(
+    int     aProfile)
+{
+    const SensorProfile_t*  profile;
+    uint32_t                currentNa;
+
+    if (0 != sensor_power_select(&sensorPower, aProfile))
+    {
+        LOG_WARN("Sensor profile %d not fully applied", aProfile);
+    }
+
+    profile     = sensor_profile_get(aProfile);
+    if (NULL != profile)
+    {
+        currentNa   = sensor_profile_current_na(profile, profile->samplePeriodMs);
+        LOG_HI("Sensor profile %s: %u uA expected, %u days on %u mAh", profile->name, (unsigned) (currentNa / 1000),
+               (unsigned) (sensor_profile_battery_hours(profile, profile->samplePeriodMs, MBED_APP_CONF_BATTERY_CAPACITY_MAH) / 24),
+               (unsigned) MBED_APP_CONF_BATTERY_CAPACITY_MAH);
     }
 }
 
+/* --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- --- */
+
 void demo_loop(void)
 {
     uint8_t tiltId;
-    float   totalWaitTime   = 0;
 
     I2C     i2c((PinName) I2C_SDA0,
                 (PinName) I2C_SCL0);
@@ -777,53 +1882,70 @@ void demo_loop(void)
     LIS2MDLSensor sensorMagnentic(&devI2c, I2C_MAGN_SENSOR_ADDR);
 
     float   tiltRead[3]     = {0, 0, 0};
-    int     tiltValOld[3]   = {0, 0, 0};
-    int     tiltValNew[3]   = {0, 0, 0};
-    int     tiltValSend[3]  = {0, 0, 0};
-
-    int     envValOld[3]    = {0, 0, 0};
-    int     envValNew[3]    = {0, 0, 0};
-    int     envValSend[3]   = {0, 0, 0};
-
-    int     lightValOld[1]  = {0};
-    int     lightValNew[1]  = {0};
-    int     lightValSend[1] = {0};
-
-    int     distValOld[1]   = {0};
-    int     distValNew[1]   = {0};
-    int     distValSend[1]  = {0};
+    bool    tiltReady;
     int     distWaitTotal   = 0;
-
-    int     magValOld[3]    = {0, 0, 0};
     int16_t magVal[3]       = {0, 0, 0};
-    int     magValNew[3]    = {0, 0, 0};
-    int     magValSend[3]   = {0, 0, 0};
 
-    bool    isSendUpdateTilt    = false;
-    bool    isSendUpdateEnv     = true;
-    bool    isSendUpdateLight   = true;
-    bool    isSendUpdateDist    = true;
-    bool    isSendUpdateMag     = true;
+    Orientation_t   orientation;
 
-    do {
-        ThisThread::sleep_for(2000);
-        blink_led(3);
+    int32_t     chnVal[CHN_IDX_TOTAL]     = {0};
+    uint32_t    chnTimeMs[CHN_IDX_TOTAL]  = {0};
+    uint32_t    chnValid;
+    uint32_t    chnExceed;
+
+    uint32_t    evtRaised;
+    uint32_t    evtCleared;
+    uint32_t    evtClearPending = 0;
 
-        volatile unsigned int reg;
-        volatile unsigned int *regPtr = &reg;
+    uint32_t    cycleStartMs;
+    uint32_t    cycleMs;
+#if MBED_APP_CONF_LATENCY_BENCH_CYCLES
+    uint32_t    cycleStartUs;
+#endif
 
+    bool        batteryLow      = false;
+    uint32_t    reportIntervalMs = DWEET_UPDATE_MS;
+    uint32_t    reportEveryMs   = 0;
+    uint32_t    samplePeriodMs;
+    uint32_t    lastReportMs;
+
+    bool        magReady;
+    uint32_t    recovered;
+    uint32_t    degradedReported = 0;
+    uint32_t    linkReported    = 0;
+    UplinkStatus_t  uplinkNow;
+#if UPLINK_TIMING
+    uint32_t    timingReported  = 0;
+#endif
 
-        unsigned battery = batteryMon.read_u16();
-        unsigned flex = flexAnalog.read_u16();
+    manholeSensors.i2c  = &i2c;
+    manholeSensors.tilt = &sensorTilt;
+    manholeSensors.env  = &sensorEnv;
+    manholeSensors.dist = &sensorDist;
+    manholeSensors.magn = &sensorMagnentic;
+    sensor_health_init(&sensorHealth, manholeHealthDrivers, SENSOR_HEALTH_COUNT, &manholeSensors);
+    timeseries_init(&history, historyBlocks, HISTORY_BLOCKS, CHN_IDX_TOTAL);
+#if MBED_APP_CONF_LATENCY_BENCH_CYCLES
+    stage_bench_init(&stageBench, benchStageNames, BENCH_STAGE_COUNT, benchSamplesUs, MBED_APP_CONF_LATENCY_BENCH_CYCLES);
+    LOG_WARN("Latency benchmark on, stage statistics every %d cycles", MBED_APP_CONF_LATENCY_BENCH_CYCLES);
+#endif
+#if MBED_APP_CONF_SENSOR_REPLAY
+    const SensorFrame_t*    frame;
 
-        LOG_HI("Battery normalized: 0x%04X \n", battery);
-        *regPtr = battery;
+    sensor_replay_init(&sensorReplay, replayTrace, sizeof(replayTrace) / sizeof(replayTrace[0]));
+    LOG_WARN("Sensor readings are REPLAYED from a %u frame trace", (unsigned) sensorReplay.count);
+#endif
 
-        LOG_HI("Flex normalized: 0x%04X \n", flex);
-        *regPtr = flex;
+    change_detect_init(&changeDetect, manholeChannels, CHN_IDX_COUNT, platform_now_ms());
+    event_detect_init(&eventDetect, manholeEventRules, EVT_RULE_COUNT);
 
+    do {
+        platform_sleep_ms(2000);
+        blink_led(3);
     } while(0);
 
+    analog_monitor_init(&analogMon, &batteryMon, &batteryMonEn, &flexAnalog, &batteryCal, &flexCal);
+
     do
     {
 
@@ -840,22 +1962,12 @@ void demo_loop(void)
         blink_led(2);
     } while(0);
 
-    // Tilt Sensor LIS3DH
-    if (0 != sensorTilt.data_ready())
-    {
-        sensorTilt.read_data(tiltRead);
-        tiltValOld[TILT_IDX_X]  = (int) tiltRead[TILT_IDX_X];
-        tiltValOld[TILT_IDX_Y]  = (int) tiltRead[TILT_IDX_Y];
-        tiltValOld[TILT_IDX_Z]  = (int) tiltRead[TILT_IDX_Z];
-        LOG_WARN("Tilt REFERENCE X, Y, Z = %d, %d, %d", tiltValOld[TILT_IDX_X], tiltValOld[TILT_IDX_Y], tiltValOld[TILT_IDX_Z]);
-    }
-
     // Distance sensor init
     xshut = 1;
-    ThisThread::sleep_for(2);    // 1.2 ms sensor boot (Fig 7 in data sheet)
+    platform_sleep_ms(2);    // 1.2 ms sensor boot (Fig 7 in data sheet)
 
     sensorDist.setDistanceMode(0);
-    ThisThread::sleep_for(100);
+    platform_sleep_ms(100);
 
     // Magnetometer
 
@@ -883,174 +1995,361 @@ void demo_loop(void)
     // enable it
     sensorMagnentic.enable();
 
+    // Orientation reference
+    if (0 != sensorTilt.data_ready())
+    {
+        sensorTilt.read_mg_data(tiltRead);
+        sensorMagnentic.get_m_axes_raw(magVal);
+        if (0 == fuse_orientation(tiltRead, magVal, &orientation))
+        {
+            change_detect_set_reference(&changeDetect, CHN_IDX_PITCH, CDEG_TO_DEG(orientation.pitch));
+            change_detect_set_reference(&changeDetect, CHN_IDX_ROLL, CDEG_TO_DEG(orientation.roll));
+            LOG_WARN("Tilt REFERENCE pitch, roll = %d, %d", CDEG_TO_DEG(orientation.pitch), CDEG_TO_DEG(orientation.roll));
+        }
+    }
+
+    sensor_power_init(&sensorPower, &i2c, &xshut, &sensorDist);
+    select_sensor_profile(MBED_APP_CONF_SENSOR_PROFILE);
+    lastReportMs    = platform_now_ms();
+
     while (true)
     {
-        /* No wait time needed here as reading the sensors implies a total 100 ms delay! */
-        totalWaitTime  += SENSOR_TIME_RESOLUTION;
+        cycleStartMs    = platform_now_ms();
+#if MBED_APP_CONF_LATENCY_BENCH_CYCLES
+        cycleStartUs    = platform_now_us();
+#endif
+        BENCH_LAP();
 
+        /* One-shot conversions run while the LEDs blink */
+        sensor_power_wake(&sensorPower);
         blink_led(2);
+        sensor_power_wait_ready(&sensorPower);
+        BENCH_MARK(BENCH_WAKE);
+
+        chnValid    = 0;
+
+#if MBED_APP_CONF_SENSOR_REPLAY
+        frame       = sensor_replay_next(&sensorReplay);
+        replay_sensor_frame(frame, chnVal, chnTimeMs, &chnValid, tiltRead, magVal);
+        tiltReady   = (0 != (frame->valid & REPLAY_VALID_TILT));
+        magReady    = (0 != (frame->valid & REPLAY_VALID_MAGN));
+        BENCH_LAP();
+#else
+        /* Degraded sensors are left alone until the supervisor brings them back */
 
         // Tilt Sensor LIS3DH
-        if (0 != sensorTilt.data_ready())
+        tiltReady   = false;
+        if (sensor_health_usable(&sensorHealth, SENSOR_TILT_LIS3DH))
         {
-            sensorTilt.read_data(tiltRead);
-            tiltValNew[TILT_IDX_X]  = (int) tiltRead[TILT_IDX_X];
-            tiltValNew[TILT_IDX_Y]  = (int) tiltRead[TILT_IDX_Y];
-            tiltValNew[TILT_IDX_Z]  = (int) tiltRead[TILT_IDX_Z];
-            LOG_HI("Tilt NEW X, Y, Z = %d, %d, %d", tiltValNew[TILT_IDX_X], tiltValNew[TILT_IDX_Y], tiltValNew[TILT_IDX_Z]);
-
-            update_sensor_params(SENSOR_TILT_LIS3DH,
-                                 tiltValNew,
-                                 tiltValOld,
-                                 tiltValSend,
-                                 &isSendUpdateTilt);
+            tiltReady   = (0 != sensorTilt.data_ready());
+            sensor_health_record(&sensorHealth, SENSOR_TILT_LIS3DH, tiltReady ? SENSOR_HEALTH_OK : SENSOR_HEALTH_TIMEOUT, cycleStartMs);
+            if (tiltReady)
+            {
+                sensorTilt.read_mg_data(tiltRead);
+                LOG_HI("Tilt NEW X, Y, Z = %d, %d, %d mg", (int) tiltRead[TILT_IDX_X], (int) tiltRead[TILT_IDX_Y], (int) tiltRead[TILT_IDX_Z]);
+            }
+            else
+            {
+                LOG_WARN("LIS3DH not ready");
+            }
         }
-        else
+        BENCH_MARK(BENCH_TILT);
+
+        // Environment Sensor BME280
+        if (sensor_health_usable(&sensorHealth, SENSOR_ENVIRO_BME280) &&
+            0 == sensor_health_check(&sensorHealth, SENSOR_ENVIRO_BME280, cycleStartMs))
         {
-            LOG_WARN("LIS3DH not ready");
+            chnVal[CHN_IDX_TEMPERATURE] = (int32_t) sensorEnv.getTemperature();
+            chnVal[CHN_IDX_PRESSURE]    = (int32_t) sensorEnv.getPressure();
+            chnVal[CHN_IDX_HUMIDITY]    = (int32_t) sensorEnv.getHumidity();
+            chnValid   |= CHN_MASK_ENV;
+            stamp_channels(chnTimeMs, CHN_MASK_ENV);
+            LOG_HI("Temperature = %d, Pressure = %d, Humidity = %d", chnVal[CHN_IDX_TEMPERATURE], chnVal[CHN_IDX_PRESSURE], chnVal[CHN_IDX_HUMIDITY]);
         }
+        BENCH_MARK(BENCH_ENV);
 
-        // Environment Sensor BME280
-        envValNew[ENV_IDX_TEMPERATURE]  = (int) sensorEnv.getTemperature();
-        envValNew[ENV_IDX_PRESSURE]     = (int) sensorEnv.getPressure();
-        envValNew[ENV_IDX_HUMIDITY]     = (int) sensorEnv.getHumidity();
-        LOG_HI("Temperature = %d, Pressure = %d, Humidity = %d", envValNew[ENV_IDX_TEMPERATURE], envValNew[ENV_IDX_PRESSURE], envValNew[ENV_IDX_HUMIDITY]);
-
-        update_sensor_params(SENSOR_ENVIRO_BME280,
-                             envValNew,
-                             envValOld,
-                             envValSend,
-                             &isSendUpdateEnv);
-
-        lightValNew[0]  = sensorLight.readSensor();
-        LOG_HI("Light = %d", lightValNew[0]);
-
-        update_sensor_params(SENSOR_LIGHT_OPT3001,
-                             lightValNew,
-                             lightValOld,
-                             lightValSend,
-                             &isSendUpdateLight);
+        if (sensor_health_usable(&sensorHealth, SENSOR_LIGHT_OPT3001) &&
+            0 == sensor_health_check(&sensorHealth, SENSOR_LIGHT_OPT3001, cycleStartMs))
+        {
+            chnVal[CHN_IDX_LIGHT]   = sensorLight.readSensor();
+            chnValid   |= CHN_MASK(CHN_IDX_LIGHT);
+            stamp_channels(chnTimeMs, CHN_MASK(CHN_IDX_LIGHT));
+            LOG_HI("Light = %d", chnVal[CHN_IDX_LIGHT]);
+        }
+        BENCH_MARK(BENCH_LIGHT);
 
         // Distance sensor
-        sensorDist.startMeasurement();
-        ThisThread::sleep_for(DIST_SENSOR_WAIT_STEP);
+        if (sensor_health_usable(&sensorHealth, SENSOR_DIST_VL53L1X))
+        {
+            sensorDist.startMeasurement();
+            platform_sleep_ms(DIST_SENSOR_WAIT_STEP);
+
+            distWaitTotal   = 0;
+            while (distWaitTotal <= DIST_SENSOR_WAIT_MAX &&
+                   false == sensorDist.newDataReady())
+            {
+                LOG_HI("Waiting Distance sensor, total wait = %d, max wait = %d", distWaitTotal, DIST_SENSOR_WAIT_MAX);
+                platform_sleep_ms(DIST_SENSOR_WAIT_STEP);
+                distWaitTotal += 100;
+            }
+
+            if (distWaitTotal > DIST_SENSOR_WAIT_MAX)
+            {
+                LOG_WARN("Waiting Distance sensor reading timed out");
+                sensor_health_record(&sensorHealth, SENSOR_DIST_VL53L1X, SENSOR_HEALTH_TIMEOUT, cycleStartMs);
+            }
+            else
+            {
+                chnVal[CHN_IDX_DIST]    = (int32_t) (sensorDist.getDistance() / 10);
+                chnValid   |= CHN_MASK(CHN_IDX_DIST);
+                stamp_channels(chnTimeMs, CHN_MASK(CHN_IDX_DIST));
+                sensor_health_record(&sensorHealth, SENSOR_DIST_VL53L1X, SENSOR_HEALTH_OK, cycleStartMs);
+
+                LOG_HI("Distance = %d", chnVal[CHN_IDX_DIST]);
+            }
+        }
+        BENCH_MARK(BENCH_DIST);
 
-        distWaitTotal   = 0;
-        while (distWaitTotal <= DIST_SENSOR_WAIT_MAX &&
-               false == sensorDist.newDataReady())
+        // Magnetometer
+        magReady    = false;
+        if (sensor_health_usable(&sensorHealth, SENSOR_MAGNT_LIS2MDL))
         {
-            LOG_HI("Waiting Distance sensor, total wait = %d, max wait = %d", distWaitTotal, DIST_SENSOR_WAIT_MAX);
-            ThisThread::sleep_for(DIST_SENSOR_WAIT_STEP);
-            distWaitTotal += 100;
+            magReady    = (0 == sensorMagnentic.get_m_axes_raw(magVal));
+            sensor_health_record(&sensorHealth, SENSOR_MAGNT_LIS2MDL, magReady ? SENSOR_HEALTH_OK : SENSOR_HEALTH_ERROR, cycleStartMs);
+            LOG_HI("magX = %d, magY = %d, magZ = %d", magVal[0], magVal[1], magVal[2]);
         }
+        BENCH_MARK(BENCH_MAGN);
+#endif
+
+        sensor_power_sleep(&sensorPower);
+
+#if !MBED_APP_CONF_SENSOR_REPLAY
+        // Battery and flex
+        analog_monitor_sample(&analogMon, &chnVal[CHN_IDX_BATTERY], &chnVal[CHN_IDX_FLEX]);
+        chnValid   |= CHN_MASK_ANALOG;
+        stamp_channels(chnTimeMs, CHN_MASK_ANALOG);
+#endif
+        LOG_HI("Battery = %d mV, Flex = %d mV", chnVal[CHN_IDX_BATTERY], chnVal[CHN_IDX_FLEX]);
+        BENCH_MARK(BENCH_ANALOG);
 
-        if (distWaitTotal > DIST_SENSOR_WAIT_MAX)
+        /* Stretch sampling and reporting while the battery is low */
+        if (false == batteryLow && chnVal[CHN_IDX_BATTERY] < BATTERY_LOW_MV)
         {
-            LOG_WARN("Waiting Distance sensor reading timed out");
-            isSendUpdateDist = false;
+            LOG_WARN("Battery low (%d mV), switching to ultra-low-power operation", chnVal[CHN_IDX_BATTERY]);
+            batteryLow          = true;
+            select_sensor_profile(SENSOR_PROFILE_ULTRA_LOW_POWER);
         }
-        else
+        else if (batteryLow && chnVal[CHN_IDX_BATTERY] > BATTERY_OK_MV)
+        {
+            LOG_WARN("Battery recovered (%d mV)", chnVal[CHN_IDX_BATTERY]);
+            batteryLow          = false;
+            select_sensor_profile(MBED_APP_CONF_SENSOR_PROFILE);
+        }
+        uplink_status_get(&uplinkNow);
+        reportIntervalMs    = DWEET_UPDATE_MS * (batteryLow ? BATTERY_LOW_REPORT_FACTOR : 1) *
+                              linkPolicy[uplinkNow.linkLevel].intervalFactor;
+        /* The interval is checked once per cycle, so reports go out on the first cycle past it */
+        samplePeriodMs      = sensorPower.profile->samplePeriodMs;
+        if (reportEveryMs != ((reportIntervalMs + samplePeriodMs - 1) / samplePeriodMs) * samplePeriodMs)
+        {
+            reportEveryMs   = ((reportIntervalMs + samplePeriodMs - 1) / samplePeriodMs) * samplePeriodMs;
+            LOG_WARN("Periodic report every %u ms (interval %u ms, %s cycle of %u ms)", (unsigned) reportEveryMs,
+                     (unsigned) reportIntervalMs, sensorPower.profile->name, (unsigned) samplePeriodMs);
+        }
+
+        if (magReady)
+        {
+            chnVal[CHN_IDX_FIELD]   = (int32_t) fx_sqrt((uint64_t) ((int32_t) magVal[0] * magVal[0] +
+                                                                    (int32_t) magVal[1] * magVal[1] +
+                                                                    (int32_t) magVal[2] * magVal[2]));
+            chnValid   |= CHN_MASK(CHN_IDX_FIELD);
+            stamp_channels(chnTimeMs, CHN_MASK(CHN_IDX_FIELD));
+        }
+
+        // Pitch, roll and heading from both vectors, pitch and roll do not depend on the magnetometer.
+        // Without a new field sample the magnetometer filter is held instead of fed the old one again
+        if (tiltReady &&
+            0 == fuse_orientation(tiltRead, magReady ? magVal : NULL, &orientation))
         {
-            distValNew[0] = (int) (sensorDist.getDistance() / 10);
-//            distValNew[0] = sensorDist.getDistance();
+            chnVal[CHN_IDX_PITCH]   = CDEG_TO_DEG(orientation.pitch);
+            chnVal[CHN_IDX_ROLL]    = CDEG_TO_DEG(orientation.roll);
+            chnVal[CHN_IDX_HEADING] = CDEG_TO_DEG(orientation.heading) % 360;
+            chnValid   |= magReady ? CHN_MASK_ORIENTATION : CHN_MASK_TILT;
+            stamp_channels(chnTimeMs, magReady ? CHN_MASK_ORIENTATION : CHN_MASK_TILT);
+            LOG_HI("Pitch = %d, Roll = %d, Heading = %d", chnVal[CHN_IDX_PITCH], chnVal[CHN_IDX_ROLL], chnVal[CHN_IDX_HEADING]);
+        }
+        BENCH_MARK(BENCH_FUSE);
 
-            LOG_HI("Distance = %d", distValNew[0]);
+#if MBED_APP_CONF_SENSOR_FILTER
+        filter_sensor_readings(chnVal, &chnValid);
+#endif
 
-            update_sensor_params(SENSOR_DIST_VL53L1X,
-                                 distValNew,
-                                 distValOld,
-                                 distValSend,
-                                 &isSendUpdateDist);
+        for (int i = 0; i < CHN_IDX_TOTAL; i++)
+        {
+            if (chnValid & CHN_MASK(i))
+            {
+                timeseries_append(&history, i, chnTimeMs[i], chnVal[i]);
+            }
         }
+        BENCH_MARK(BENCH_FILTER);
 
-        // Magnetometer
-        sensorMagnentic.get_m_axes_raw(magVal);
-        magValNew[0] = magVal[0];
-        magValNew[1] = magVal[1];
-        magValNew[2] = magVal[2];
-        LOG_HI("magX = %d, magY = %d, magZ = %d", magValNew[0], magValNew[1], magValNew[2]);
-        update_sensor_params(SENSOR_MAGNT_LIS2MDL,
-                             magValNew,
-                             magValOld,
-                             magValSend,
-                             &isSendUpdateMag);
+        chnExceed   = change_detect_process(&changeDetect, chnVal, chnValid);
+        if (chnExceed & CHN_MASK_TILT)
+        {
+            LOG_WARN("Tilt CHANGED pitch, roll = %d, %d vs %d, %d",
+                     chnVal[CHN_IDX_PITCH], chnVal[CHN_IDX_ROLL],
+                     changeDetect.ref[CHN_IDX_PITCH], changeDetect.ref[CHN_IDX_ROLL]);
+        }
 
-#if defined(LIVE_NETWORK)
-        if (totalWaitTime > DWEET_UPDATE_MS)
+        evtRaised   = event_detect_process(&eventDetect, chnVal, chnValid, &evtCleared);
+        evtClearPending    |= rules_to_events(evtCleared) & ~rules_to_events(eventDetect.active);
+        evtClearPending    &= ~rules_to_events(evtRaised);
+        BENCH_MARK(BENCH_DETECT);
+        if (evtRaised)
         {
-            static char sensors_key_values[MSG_LEN - 100];
-            int bytes_written = 0;
+            LOG_WARN("EVENT raised, rules 0x%x", (unsigned) evtRaised);
+#if defined(LIVE_NETWORK)
+            send_event_report(evtRaised, chnVal, chnValid, chnTimeMs);
+#endif
+            BENCH_MARK(BENCH_EVENT_SEND);
+        }
 
-            /* **** ATMOSPHERIC SENSOR **** */
-            if (isSendUpdateEnv)
+#if defined(LIVE_NETWORK)
+        /* Timed on the clock from the start of the cycle, a cycle lasts as long as the profile's sample
+         * period, so the time read after the sensors cannot make a report miss its cycle */
+        if (cycleStartMs - lastReportMs >= reportIntervalMs)
+        {
+            char*       sensors_key_values  = uplinkBuffers.report;
+            int         bytes_written   = 0;
+            uint32_t    nowMs           = platform_now_ms();
+            uint32_t    dueMask         = change_detect_due(&changeDetect, nowMs);
+            uint32_t    latencyMs;
+            uint32_t    histSamples;
+            uint32_t    histBytes;
+
+            for (int i = 0; i < CHN_IDX_COUNT; i++)
             {
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_TEMPERATURE_OUT), envValSend[ENV_IDX_TEMPERATURE]);
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_PRESSURE_OUT), envValSend[ENV_IDX_PRESSURE]);
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_HUMIDITY_OUT), envValSend[ENV_IDX_HUMIDITY]);
-
-                UPDATE_SENSOR_READS(envValOld, envValSend);
-                isSendUpdateEnv = false;
+                if (dueMask & CHN_MASK(i))
+                {
+                    bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(manholeChannels[i].channel), (int) change_detect_value(&changeDetect, i));
+                }
             }
+            change_detect_commit(&changeDetect, dueMask, nowMs);
 
-            /* **** ACCELERMETER SENSOR **** */
-            if (isSendUpdateTilt)
+            /* Cleared events are not urgent, they ride along with the periodic report */
+            for (int i = 0; i < 32; i++)
             {
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_ORIENTATION_X_OUT), tiltValSend[TILT_IDX_X]);
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_ORIENTATION_Y_OUT), tiltValSend[TILT_IDX_Y]);
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_ORIENTATION_Z_OUT), tiltValSend[TILT_IDX_Z]);
-
-                UPDATE_SENSOR_READS(tiltValOld, tiltValSend);
-                isSendUpdateTilt    = false;
+                if (evtClearPending & (1UL << i))
+                {
+                    bytes_written += sprintf(sensors_key_values + bytes_written, "%s=0&", manhole_event_enum(i));
+                }
             }
+            evtClearPending = 0;
 
-
-            /* **** LIGHT SENSOR **** */
-            if (isSendUpdateLight)
+            /* Sample to delivery time of the last event report, once it was delivered */
+            latencyMs   = core_util_atomic_load_u32(&eventLatencyMs);
+            if (EVT_LATENCY_NONE != latencyMs &&
+                core_util_atomic_cas_u32(&eventLatencyMs, &latencyMs, EVT_LATENCY_NONE))
             {
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_LIGHT_OUT), lightValSend[0]);
-
-                lightValOld[0]      = lightValSend[0];
-                isSendUpdateLight   = false;
+                bytes_written  += sprintf(sensors_key_values + bytes_written, "EVT_LATENCY=%u&", (unsigned) latencyMs);
             }
 
-            /* **** DISTANCE SENSOR **** */
-            if (isSendUpdateDist)
+            /* Sensors the supervisor gave up on, sent whenever the set changes */
+            if (degradedReported != sensorHealth.degradedMask)
             {
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_DIST_OUT), distValSend[0]);
-
-                distValOld[0]       = distValSend[0];
-                isSendUpdateDist    = false;
+                bytes_written  += sprintf(sensors_key_values + bytes_written, "DEGRADED=%u&", (unsigned) sensorHealth.degradedMask);
+                degradedReported    = sensorHealth.degradedMask;
             }
 
-            if (isSendUpdateMag)
+            /* Signal quality, whenever there is a new sample */
+            if (linkReported != uplinkNow.linkSamples)
             {
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_MAG_X_OUT), magValSend[0]);
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_MAG_Y_OUT), magValSend[1]);
-                bytes_written += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(MANHOLE_CHN_MAG_Z_OUT), magValSend[2]);
+                const int   linkValue[]     = { uplinkNow.link.rssiDbm, uplinkNow.link.rsrpDbm, uplinkNow.link.rsrqDb };
+                const int   linkChannel[]   = { MANHOLE_CHN_RSSI_OUT, MANHOLE_CHN_RSRP_OUT, MANHOLE_CHN_RSRQ_OUT };
 
-                UPDATE_SENSOR_READS(magValOld, magValSend);
-                isSendUpdateMag     = false;
+                for (int i = 0; i < 3; i++)
+                {
+                    if (LINK_QUALITY_UNKNOWN != linkValue[i])
+                    {
+                        bytes_written  += sprintf(sensors_key_values + bytes_written, "%s=%d&", manhole_channel_enum(linkChannel[i]), linkValue[i]);
+                    }
+                }
+                linkReported    = uplinkNow.linkSamples;
             }
 
             if (bytes_written)
             {
                 sensors_key_values[bytes_written-1] = '\0';
-                MBED_ASSERT(bytes_written <= (MSG_LEN - 100));
+                MBED_ASSERT(bytes_written <= UPLINK_REPORT_BYTES);
+                BENCH_MARK(BENCH_PAYLOAD);
 
-                if (0 == sendSensorReadings(sensors_key_values))
+                if (0 == uplink_enqueue(sensors_key_values, false, nowMs))
                 {
-                    LOG_HI("[ [[ [[[ [[[[  All sensors readings sent successfully (len=%d) ]]]] ]]] ]] ]", bytes_written);
+                    LOG_HI("[ [[ [[[ [[[[  All sensors readings " UPLINK_HANDOFF " successfully (len=%d) ]]]] ]]] ]] ]", bytes_written);
                 }
                 else
                 {
-                    LOG_WARN("Sending sensors readings failed");
+                    LOG_WARN("Sensors readings not " UPLINK_HANDOFF);
+                }
+                BENCH_MARK(BENCH_SEND);
+            }
+
+#if UPLINK_TIMING
+            /* Uplink phase times, once per window in a report of their own */
+            if (timingReported != uplinkNow.timingWindows)
+            {
+                bytes_written   = 0;
+                for (int i = 0; i < UPLINK_PHASE_COUNT; i++)
+                {
+                    if (uplinkNow.phaseMs[i] >= 0)
+                    {
+                        bytes_written  += sprintf(sensors_key_values + bytes_written, "%s=%d&", uplinkPhaseKeys[i], (int) uplinkNow.phaseMs[i]);
+                    }
+                }
+                timingReported  = uplinkNow.timingWindows;
+                if (bytes_written)
+                {
+                    sensors_key_values[bytes_written-1] = '\0';
+                    if (0 != uplink_enqueue(sensors_key_values, false, nowMs))
+                    {
+                        LOG_WARN("Uplink phase times not " UPLINK_HANDOFF);
+                    }
                 }
             }
-            totalWaitTime   = 0;
+#endif
+
+            timeseries_usage(&history, &histSamples, &histBytes);
+            LOG_HI("History: %u samples in %u bytes, %u evicted", (unsigned) histSamples, (unsigned) histBytes, (unsigned) history.evicted);
+            lastReportMs    = cycleStartMs;
         }
+        uplink_idle();
 #else
-        ThisThread::sleep_for(1000);
+        platform_sleep_ms(1000);
 #endif // #if defined(LIVE_NETWORK)
+        BENCH_LAP();
+
+        /* Re-init degraded sensors in place, a recovered sensor goes back to the profile idle state */
+        recovered   = sensor_health_supervise(&sensorHealth, platform_now_ms());
+        for (int i = 0; i < SENSOR_HEALTH_COUNT; i++)
+        {
+            if (recovered & (1UL << i))
+            {
+                sensor_power_restore(&sensorPower, i);
+            }
+        }
+        BENCH_MARK(BENCH_SUPERVISE);
+
+#if MBED_APP_CONF_LATENCY_BENCH_CYCLES
+        stage_bench_record(&stageBench, BENCH_CYCLE, platform_now_us() - cycleStartUs);
+        stage_bench_cycle_done(&stageBench);
+#endif
+
+        /* Sensors are powered down until the next cycle of the profile */
+        cycleMs = platform_now_ms() - cycleStartMs;
+        if (cycleMs < sensorPower.profile->samplePeriodMs)
+        {
+            platform_sleep_ms(sensorPower.profile->samplePeriodMs - cycleMs);
+        }
     }
 
     return;
@@ -1066,30 +2365,21 @@ void demo_loop(void)
     int success = 0;
     int fail    = 0;
 
-    int consecutiveFail = 0;
-
+    /* Failures are left to the retry policy, a server outage is no reason to reset */
     while(true)
     {
-        ThisThread::sleep_for(1000);
+        platform_sleep_ms(1000);
         signal  = (i % 2) ? i : 0;
         if ( 0 != send_dweet_signal("Signal", signal) )
         {
             blink_led(4);
             LOG_WARN("DWEET signal failed");
             fail++;
-            consecutiveFail++;
-
-            if (3 <= consecutiveFail)
-            {
-                LOG_ERROR("A lot of consecutive errors");
-                SYSTEM_RECOVERY();
-            }
         }
         else
         {
             blink_led(1);
             success++;
-            consecutiveFail = 0;
         }
         i++;
         LOG_HI("[[[[ [[[ [[ [ %d Success / %d Failure ] ]] ]]] ]]]]", success, fail);
@@ -1103,7 +2393,7 @@ void demo_loop(void)
 {
     while (true)
     {
-        ThisThread::sleep_for(2000);
+        platform_sleep_ms(2000);
         LOG_HI("Idle APP...");
         blink_led(2);
     }
@@ -1125,7 +2415,7 @@ int main()
     LOG_HI("RM7100 Demo\n");
     LOG_HI("Built: %s, %s\n", __DATE__, __TIME__);
 	
-    ThisThread::sleep_for(1000);
+    platform_sleep_ms(1000);
     blink_led(1);
 
     xshut = 0;      // needs to be low when we power on 2V9
@@ -1134,17 +2424,17 @@ int main()
     modemPowerEn[1] = 1;
     modemPowerEn[2] = 1;
 
-    batteryMonEn = 1;
+    batteryMonEn = 0;       // battery divider is only enabled while it is sampled
 
     /* Get Modem out of reset */
     modem_chen  = 0;
     modem_remap = 0;
     modem_reset = 0;
-    ThisThread::sleep_for(100);
+    platform_sleep_ms(100);
     modem_reset = 1;
 
     do {
-        ThisThread::sleep_for(2000);
+        platform_sleep_ms(2000);
         blink_led(3);
     } while(0);
 
@@ -1169,6 +2459,50 @@ int main()
     while (do_connect() != NSAPI_ERROR_OK) {
         LOG_WARN("Could not connect to cellular network .. try again\n");
     }
+
+    /* Backoff jitter and CoAP message IDs must differ between devices, connect times and addresses do */
+    srand(platform_now_us() ^ ip_hash(interface->get_ip_address()));
+    uplink_queue_init(&uplinkQueue, &flashIap, MBED_APP_CONF_UPLINK_QUEUE_SECTORS);
+    uplink_retry_init(&uplinkRetry, &uplinkRetryConfig);
+#if (MBED_APP_CONF_TEST_TYPE == DEMO_DWEET_MANHOLE)
+    link_quality_init(&linkQuality, ((CellularContext*) interface)->get_device()->open_network(),
+                      MBED_APP_CONF_LINK_QUALITY_PERIOD_S * 1000UL);
+#endif
+    dns_cache_init(&dnsCache, interface, DNS_TTL_MS);
+#if (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_COAP)
+    coap_client_init(&coapClient, interface, &dnsCache, MBED_APP_CONF_COAP_SERVER, MBED_APP_CONF_COAP_PORT,
+                     MBED_APP_CONF_DWEET_PAGE, MBED_APP_CONF_COAP_CONFIRMABLE);
+#elif (MBED_APP_CONF_UPLINK_TRANSPORT == UPLINK_MQTT)
+    mqtt_uplink_init(&mqttUplink, interface, &dnsCache, MBED_APP_CONF_MQTT_SERVER, MBED_APP_CONF_MQTT_PORT,
+                     MBED_APP_CONF_MQTT_USERNAME, MBED_APP_CONF_MQTT_PASSWORD, MBED_APP_CONF_MQTT_CLIENT_ID,
+                     MBED_APP_CONF_MQTT_KEEP_ALIVE_S, mqttChannels, sizeof(mqttChannels) / sizeof(mqttChannels[0]));
+#else
+    http_conn_init(&dweetConn, interface, &dnsCache, SERVER_NAME, SERVER_PORT, MBED_APP_CONF_HTTP_KEEP_ALIVE, HTTP_IDLE_CLOSE_MS);
+#endif
+#if MBED_APP_CONF_UPLINK_TLS
+    /* Set even when the set-up failed, reports then wait in the queue rather than go out in clear */
+    if (0 != tls_conn_init(&uplinkTls, UPLINK_TLS_HOST, tlsRootCaPem))
+    {
+        LOG_ERROR("TLS not available, reports are only queued");
+    }
+    http_conn_set_tls(&dweetConn, &uplinkTls);
+#endif
+#if MBED_APP_CONF_UPLINK_BATCH_SAMPLES
+    uplink_batch_init(&uplinkBatch, uplinkBuffers.batch, UPLINK_BATCH_BYTES,
+                      MBED_APP_CONF_UPLINK_BATCH_SAMPLES, MBED_APP_CONF_UPLINK_BATCH_AGE_S * 1000UL);
+#endif
+#if UPLINK_THREADED
+    report_ring_init(&reportRing, reportRingSlots, uplinkBuffers.ring[0], UPLINK_REPORT_BYTES,
+                     MBED_APP_CONF_UPLINK_THREAD_QUEUE, (ReportRingPolicy_e) MBED_APP_CONF_UPLINK_OVERFLOW,
+#if (MBED_APP_CONF_UPLINK_OVERFLOW == UPLINK_OVERFLOW_COALESCE)
+                     uplinkBuffers.staging[0]);
+#else
+                     NULL);
+#endif
+    uplinkThread.start(callback(uplink_thread));
+#endif
+    LOG_HI("Uplink buffers: %u bytes", (unsigned) sizeof(uplinkBuffers));
+    log_heap_stats("after start-up");
 #endif /*#if defined(LIVE_NETWORK)*/
 #endif
 
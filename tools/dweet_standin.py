@@ -0,0 +1,420 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019 Riot Micro. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Local stand-in for dweet.io, for measuring the uplink of the dweet demos.
+
+Answers GET and POST /dweet/for/<thing> as dweet.io does, with injected latency, lost
+responses, throttling and error statuses. Point the device at it with dweet-server and
+dweet-port in mbed_app.json. Every --report-s, and on exit, it prints requests per second,
+latency percentiles, bytes on the wire and what became of each request. The device logs its
+own side of the same run as "HTTP: ..." and "Retry: ...".
+
+    python3 tools/dweet_standin.py --port 8080 --latency-ms 300 --jitter-ms 200 --loss 0.05
+
+With --tls-cert and --tls-key it speaks TLS 1.2, as the device does with uplink-tls, and counts
+full and resumed handshakes with their time; the device logs the bytes as "TLS: ...".
+
+    python3 tools/dweet_standin.py --port 8443 --tls-cert standin.pem --tls-key standin.key
+
+Only the standard library is used.
+"""
+
+import argparse
+import json
+import random
+import signal
+import socket
+import ssl
+import sys
+import threading
+import time
+from datetime import datetime, timezone
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qsl, unquote, urlsplit
+
+DWEET_PREFIXES = ("/dweet/for/", "/dweet/quietly/for/")
+LATEST_PREFIX = "/get/latest/dweet/for/"
+PERCENTILES = (50, 90, 99)
+
+
+def percentile(aSorted, aPercent):
+    if not aSorted:
+        return 0.0
+    index = min(len(aSorted) - 1, int(round(aPercent / 100.0 * (len(aSorted) - 1))))
+    return aSorted[index]
+
+
+def parse_value(aText):
+    for kind in (int, float):
+        try:
+            return kind(aText)
+        except ValueError:
+            pass
+    return aText
+
+
+class Stats:
+    """Counters of one measuring window, merged into the run totals when the window closes."""
+
+    FIELDS = ("connections", "requests", "delivered", "dropped", "throttled", "injected", "notFound",
+              "samples", "queued", "cut", "bytesRx", "bytesTx", "handshakes", "resumed", "tlsFailed",
+              "handshakeMs")
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        self.start = time.monotonic()
+        self.latencyMs = []
+        self.statuses = {}
+        for field in self.FIELDS:
+            setattr(self, field, 0)
+
+    def add(self, **aCounts):
+        with self.lock:
+            for field, count in aCounts.items():
+                setattr(self, field, getattr(self, field) + count)
+
+    def answered(self, aStatus, aLatencyMs):
+        with self.lock:
+            self.statuses[aStatus] = self.statuses.get(aStatus, 0) + 1
+            self.latencyMs.append(aLatencyMs)
+
+    def snapshot(self):
+        with self.lock:
+            data = {field: getattr(self, field) for field in self.FIELDS}
+            data["seconds"] = time.monotonic() - self.start
+            data["statuses"] = dict(sorted(self.statuses.items()))
+            data["latencyMs"] = sorted(self.latencyMs)
+        return data
+
+    def merge(self, aOther):
+        with self.lock:
+            for field in self.FIELDS:
+                setattr(self, field, getattr(self, field) + aOther[field])
+            for status, count in aOther["statuses"].items():
+                self.statuses[status] = self.statuses.get(status, 0) + count
+            self.latencyMs.extend(aOther["latencyMs"])
+
+
+def summary(aName, aData):
+    latency = aData["latencyMs"]
+    seconds = max(aData["seconds"], 1e-3)
+    text = "%s: %.1f s, %d requests (%.2f/s) on %d connections, %d samples" % (
+        aName, seconds, aData["requests"], aData["requests"] / seconds, aData["connections"], aData["samples"])
+    text += "\n  latency ms: " + ", ".join("p%d %.0f" % (p, percentile(latency, p)) for p in PERCENTILES)
+    text += ", max %.0f" % (latency[-1] if latency else 0)
+    text += "\n  bytes: %d received, %d sent, %.0f per request" % (
+        aData["bytesRx"], aData["bytesTx"], (aData["bytesRx"] + aData["bytesTx"]) / max(aData["requests"], 1))
+    text += "\n  outcome: %d delivered, %d dropped, %d throttled, %d injected errors, %d not found" % (
+        aData["delivered"], aData["dropped"], aData["throttled"], aData["injected"], aData["notFound"])
+    text += "\n  %d reports sent late from the device queue, %d responses not read to the end" % (
+        aData["queued"], aData["cut"])
+    if aData["handshakes"] + aData["resumed"] + aData["tlsFailed"] > 0:
+        text += "\n  tls: %d full handshakes, %d resumed, %d failed, %.0f ms per handshake" % (
+            aData["handshakes"], aData["resumed"], aData["tlsFailed"],
+            aData["handshakeMs"] / max(aData["handshakes"] + aData["resumed"], 1))
+    text += "\n  statuses: " + (", ".join("%d x%d" % (s, n) for s, n in aData["statuses"].items()) or "none")
+    return text
+
+
+class CountingReader:
+    def __init__(self, aFile, aStats):
+        self.file = aFile
+        self.stats = aStats
+
+    def readline(self, *aArgs):
+        line = self.file.readline(*aArgs)
+        self.stats.add(bytesRx=len(line))
+        return line
+
+    def read(self, *aArgs):
+        data = self.file.read(*aArgs)
+        self.stats.add(bytesRx=len(data))
+        return data
+
+    def __getattr__(self, aName):
+        return getattr(self.file, aName)
+
+
+class CountingWriter:
+    def __init__(self, aFile, aStats):
+        self.file = aFile
+        self.stats = aStats
+
+    def write(self, aData):
+        self.stats.add(bytesTx=len(aData))
+        return self.file.write(aData)
+
+    def __getattr__(self, aName):
+        return getattr(self.file, aName)
+
+
+class DweetHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "dweet-standin"
+
+    def setup(self):
+        if self.server.tlsContext is not None:
+            self.handshake()
+        super().setup()
+        self.timeout = self.server.options.idle_s
+        self.connection.settimeout(self.timeout)
+        self.rfile = CountingReader(self.rfile, self.server.window)
+        self.wfile = CountingWriter(self.wfile, self.server.window)
+        self.server.window.add(connections=1)
+        self.served = 0
+
+    def handshake(self):
+        # In the handler thread, so a slow device does not hold up the others
+        start = time.monotonic()
+        self.request.settimeout(self.server.options.idle_s)
+        self.request = self.server.tlsContext.wrap_socket(self.request, server_side=True,
+                                                          do_handshake_on_connect=False)
+        try:
+            self.request.do_handshake()
+        except (ssl.SSLError, ConnectionError, socket.timeout):
+            self.server.window.add(tlsFailed=1)
+            raise
+        self.server.window.add(handshakeMs=(time.monotonic() - start) * 1000.0,
+                               **{"resumed" if self.request.session_reused else "handshakes": 1})
+
+    def finish(self):
+        super().finish()
+        # OpenSSL forgets sessions closed without close_notify, they could not be resumed by ID
+        if self.server.tlsContext is not None:
+            try:
+                self.request.unwrap()
+            except (ssl.SSLError, OSError):
+                pass
+
+    def log_message(self, aFormat, *aArgs):
+        if self.server.options.verbose:
+            sys.stderr.write("%s %s\n" % (self.address_string(), aFormat % aArgs))
+
+    def do_GET(self):
+        self.handle_dweet(None)
+
+    def do_POST(self):
+        length = int(self.headers.get("Content-Length", 0))
+        self.handle_dweet(self.rfile.read(length) if length > 0 else b"")
+
+    def handle_dweet(self, aBody):
+        options = self.server.options
+        stats = self.server.window
+        start = time.monotonic()
+        stats.add(requests=1)
+        self.served += 1
+
+        url = urlsplit(self.path)
+        if url.path.startswith(LATEST_PREFIX):
+            thing = unquote(url.path[len(LATEST_PREFIX):])
+            latest = self.server.latest.get(thing)
+            if latest is None:
+                self.reply(404, {"this": "failed", "with": "we couldn't find this"}, start)
+            else:
+                self.reply(200, {"this": "succeeded", "by": "getting", "the": "dweets", "with": [latest]}, start)
+            return
+
+        prefix = next((p for p in DWEET_PREFIXES if url.path.startswith(p)), None)
+        if prefix is None or len(url.path) == len(prefix):
+            stats.add(notFound=1)
+            self.reply(404, {"this": "failed", "with": "not a dweet path"}, start)
+            return
+        thing = unquote(url.path[len(prefix):])
+
+        delay = options.latency_ms + random.uniform(0, options.jitter_ms)
+        if delay > 0:
+            time.sleep(delay / 1000.0)
+
+        if random.random() < options.loss:
+            # The request arrived but its response is lost, as on a dropped link
+            stats.add(dropped=1)
+            self.close_connection = True
+            return
+
+        if random.random() < options.error_rate:
+            stats.add(injected=1)
+            self.reply(options.error_status, {"this": "failed", "with": "injected error"}, start)
+            return
+
+        now = time.monotonic()
+        with self.server.lock:
+            last = self.server.lastDweet.get(thing)
+            throttled = options.throttle_s > 0 and last is not None and (now - last) < options.throttle_s
+            if not throttled:
+                self.server.lastDweet[thing] = now
+        if throttled:
+            stats.add(throttled=1)
+            self.reply(429, {"this": "failed", "with": "Rate limit exceeded, try again in %g second(s)." %
+                             options.throttle_s}, start)
+            return
+
+        content, samples, queued = self.decode(url.query, aBody)
+        stats.add(delivered=1, samples=samples, queued=queued)
+        created = datetime.now(timezone.utc).isoformat(timespec="milliseconds").replace("+00:00", "Z")
+        dweet = {"thing": thing, "created": created, "content": content}
+        self.server.latest[thing] = dweet
+        if prefix == "/dweet/quietly/for/":
+            self.reply(204, None, start)
+        else:
+            self.reply(200, {"this": "succeeded", "by": "dweeting", "the": "dweet", "with": dweet}, start)
+
+    def decode(self, aQuery, aBody):
+        """Content of a query string report or of a JSON batch, with its sample count."""
+        if aBody is None:
+            content = {key: parse_value(value) for key, value in parse_qsl(aQuery, keep_blank_values=True)}
+            return content, 1, int(content.get("QUEUED") == 1)
+        try:
+            content = json.loads(aBody.decode("utf-8"))
+        except (UnicodeDecodeError, ValueError):
+            return {"raw": aBody.decode("latin-1")}, 1, 0
+        samples = len(content.get("samples", ())) if isinstance(content, dict) else 1
+        queued = int(isinstance(content, dict) and content.get("queued") == 1)
+        return content, samples, queued
+
+    def reply(self, aStatus, aJson, aStart):
+        options = self.server.options
+        body = b"" if aJson is None else json.dumps(aJson, separators=(",", ":")).encode()
+        if options.close_after and self.served >= options.close_after:
+            self.close_connection = True
+
+        self.send_response(aStatus)
+        self.send_header("Content-Type", "application/json")
+        if options.chunked and body:
+            self.send_header("Transfer-Encoding", "chunked")
+        else:
+            self.send_header("Content-Length", str(len(body)))
+        if self.close_connection:
+            self.send_header("Connection", "close")
+        try:
+            self.end_headers()
+            if options.chunked and body:
+                half = len(body) // 2
+                for chunk in (body[:half], body[half:]):
+                    self.wfile.write(b"%x\r\n%s\r\n" % (len(chunk), chunk))
+                self.wfile.write(b"0\r\n\r\n")
+            else:
+                self.wfile.write(body)
+        except ConnectionError:
+            # The device stops reading after the status line of a response on a closing connection
+            self.server.window.add(cut=1)
+            self.close_connection = True
+        self.server.window.answered(aStatus, (time.monotonic() - aStart) * 1000.0)
+
+
+class StandinServer(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def __init__(self, aOptions):
+        self.options = aOptions
+        self.window = Stats()
+        self.total = Stats()
+        self.lock = threading.Lock()
+        self.lastDweet = {}
+        self.latest = {}
+        self.tlsContext = None
+        if aOptions.tls_cert:
+            # TLS 1.2 as mbedTLS 2.16 on the device, tickets and the session cache are on by default
+            self.tlsContext = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            self.tlsContext.maximum_version = ssl.TLSVersion.TLSv1_2
+            self.tlsContext.load_cert_chain(aOptions.tls_cert, aOptions.tls_key)
+            if aOptions.tls_no_tickets:
+                self.tlsContext.options |= ssl.OP_NO_TICKET
+        super().__init__((aOptions.host, aOptions.port), DweetHandler)
+
+    def handle_error(self, aRequest, aAddress):
+        # Failed handshakes and devices going away are counted, not worth a traceback
+        if not isinstance(sys.exc_info()[1], (ssl.SSLError, ConnectionError, socket.timeout)):
+            super().handle_error(aRequest, aAddress)
+
+    def close_window(self, aPrint):
+        data = self.window.snapshot()
+        self.window.reset()
+        self.total.merge(data)
+        if aPrint and data["requests"] + data["connections"] > 0:
+            print(summary("window", data), flush=True)
+        return data
+
+
+def stop(aSignal, aFrame):
+    """SIGTERM ends the run as Ctrl-C does, with the totals, e.g. when a script started it in the background."""
+    raise KeyboardInterrupt
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--host", default="0.0.0.0", help="address to listen on")
+    parser.add_argument("--port", type=int, default=8080, help="TCP port to listen on")
+    parser.add_argument("--latency-ms", type=float, default=0, help="delay before every dweet is answered")
+    parser.add_argument("--jitter-ms", type=float, default=0, help="random extra delay, up to this much")
+    parser.add_argument("--loss", type=float, default=0, help="share of dweets whose response is never sent")
+    parser.add_argument("--error-rate", type=float, default=0, help="share of dweets answered with --error-status")
+    parser.add_argument("--error-status", type=int, default=503, help="status of injected errors")
+    parser.add_argument("--throttle-s", type=float, default=0,
+                        help="least time between dweets for one thing, closer ones get 429 as on dweet.io")
+    parser.add_argument("--idle-s", type=float, default=60, help="idle keep-alive connections are closed after this")
+    parser.add_argument("--close-after", type=int, default=0, help="close connections after this many requests")
+    parser.add_argument("--chunked", action="store_true", help="send response bodies in chunks")
+    parser.add_argument("--report-s", type=float, default=60, help="seconds between window summaries, 0 = none")
+    parser.add_argument("--duration-s", type=float, default=0, help="stop after this long, 0 = until Ctrl-C")
+    parser.add_argument("--json", metavar="FILE", help="write the run totals to FILE as JSON on exit")
+    parser.add_argument("--seed", type=int, help="seed of the injected faults, for repeatable runs")
+    parser.add_argument("--tls-cert", metavar="PEM", help="serve TLS 1.2 with this certificate chain")
+    parser.add_argument("--tls-key", metavar="PEM", help="private key of --tls-cert")
+    parser.add_argument("--tls-no-tickets", action="store_true",
+                        help="no session tickets, sessions are resumed by their ID from the server cache")
+    parser.add_argument("--verbose", action="store_true", help="log every request")
+    options = parser.parse_args()
+    if bool(options.tls_cert) != bool(options.tls_key):
+        parser.error("--tls-cert and --tls-key go together")
+
+    if options.seed is not None:
+        random.seed(options.seed)
+    server = StandinServer(options)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print("dweet stand-in on %s:%d%s" % (options.host, options.port, " over TLS" if options.tls_cert else ""),
+          flush=True)
+
+    signal.signal(signal.SIGTERM, stop)
+    end = time.monotonic() + options.duration_s if options.duration_s > 0 else None
+    nextReport = time.monotonic() + options.report_s
+    try:
+        while end is None or time.monotonic() < end:
+            time.sleep(0.2)
+            if options.report_s > 0 and time.monotonic() >= nextReport:
+                server.close_window(True)
+                nextReport += options.report_s
+    except KeyboardInterrupt:
+        pass
+    server.shutdown()
+    server.close_window(False)
+
+    total = server.total.snapshot()
+    total["seconds"] = time.monotonic() - server.total.start
+    print(summary("total", total), flush=True)
+    if options.json:
+        latency = total.pop("latencyMs")
+        total["latencyMs"] = {"p%d" % p: percentile(latency, p) for p in PERCENTILES}
+        total["latencyMs"]["max"] = latency[-1] if latency else 0
+        with open(options.json, "w") as out:
+            json.dump(total, out, indent=2)
+
+
+if __name__ == "__main__":
+    main()